@@ -33,37 +33,29 @@
 
 #include <errno.h>
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>		/* open() */
 #include <unistd.h>		/* close() */
+#include <time.h>
 #include <sys/ioctl.h>
 #include "fsl_mc_sys.h"
 #include "fsl_mc_ioctl.h"
 #include "utils.h"
 
-int mc_io_init(struct fsl_mc_io *mc_io)
+static int mc_ioctl_open(struct fsl_mc_io *mc_io)
 {
-	int fd = -1;
-	int error;
-
-	fd = open(restool.device_file, O_RDWR | O_SYNC);
+	int fd;
 
-	if (fd < 0) {
-		error = -errno;
-		perror("open() failed ");
-		goto error;
-	}
+	fd = open(restool.device_file, O_RDWR | O_SYNC | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
 
 	mc_io->fd = fd;
 	return 0;
-error:
-	if (fd != -1)
-		(void)close(fd);
-
-	return error;
 }
 
-void mc_io_cleanup(struct fsl_mc_io *mc_io)
+static void mc_ioctl_close(struct fsl_mc_io *mc_io)
 {
 	int error;
 
@@ -74,7 +66,8 @@ void mc_io_cleanup(struct fsl_mc_io *mc_io)
 		perror("close failed");
 }
 
-int mc_send_command(struct fsl_mc_io *mc_io, struct mc_command *cmd)
+static int mc_ioctl_send_command(struct fsl_mc_io *mc_io,
+				 struct mc_command *cmd)
 {
 	int error;
 
@@ -92,3 +85,118 @@ int mc_send_command(struct fsl_mc_io *mc_io, struct mc_command *cmd)
 
 	return error;
 }
+
+static int mc_ioctl_get_root_dprc_id(struct fsl_mc_io *mc_io,
+				     uint32_t *root_dprc_id)
+{
+	int error;
+
+	if (strcmp(restool.device_file, "/dev/mc_restool") == 0) {
+		DEBUG_PRINTF("calling ioctl(RESTOOL_GET_ROOT_DPRC_INFO)\n");
+		error = ioctl(mc_io->fd, RESTOOL_GET_ROOT_DPRC_INFO,
+			      root_dprc_id);
+		if (error == -1)
+			return -errno;
+
+		DEBUG_PRINTF("ioctl returned MC-bus's root_dprc_id: %#x\n",
+			     *root_dprc_id);
+	} else {
+		*root_dprc_id = atoi(&restool.device_file[10]);
+	}
+
+	return 0;
+}
+
+/*
+ * Transport sending MC commands through the ioctl() interface of the fsl-mc
+ * bus driver, on /dev/mc_restool or on a /dev/dprc.N device file.
+ */
+const struct fsl_mc_transport mc_ioctl_transport = {
+	.name = "ioctl",
+	.open = mc_ioctl_open,
+	.close = mc_ioctl_close,
+	.send_command = mc_ioctl_send_command,
+	.get_root_dprc_id = mc_ioctl_get_root_dprc_id,
+};
+
+int mc_io_init(struct fsl_mc_io *mc_io,
+	       const struct fsl_mc_transport *transport)
+{
+	int error;
+
+	mc_io->fd = -1;
+	mc_io->transport = transport;
+	error = transport->open(mc_io);
+	if (error < 0) {
+		ERROR_PRINTF("opening the MC portal on %s failed: %s\n",
+			     transport->name, strerror(-error));
+		return error;
+	}
+
+	return 0;
+}
+
+/**
+ * Open another MC portal on the transport of 'orig'. Errors are not
+ * reported, since callers fall back to 'orig' when no more portals are
+ * available.
+ */
+int mc_io_clone(struct fsl_mc_io *mc_io, const struct fsl_mc_io *orig)
+{
+	mc_io->fd = -1;
+	mc_io->transport = orig->transport;
+	return orig->transport->open(mc_io);
+}
+
+void mc_io_cleanup(struct fsl_mc_io *mc_io)
+{
+	mc_io->transport->close(mc_io);
+}
+
+int mc_send_command(struct fsl_mc_io *mc_io, struct mc_command *cmd)
+{
+	struct mc_cmd_header *hdr = (struct mc_cmd_header *)&cmd->header;
+	uint16_t cmd_id = le16toh(hdr->cmd_id);
+	struct timespec start_time;
+	struct timespec end_time;
+	struct mc_command request;
+	uint64_t start_ns;
+	uint64_t ns;
+	int obj_state = 0;
+	int error;
+
+	if (!restool.stats && !restool.record && !restool.journal)
+		return mc_io->transport->send_command(mc_io, cmd);
+
+	if (restool.record || restool.journal)
+		request = *cmd;
+	if (restool.journal)
+		obj_state = journal_prepare(mc_io, &request);
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	error = mc_io->transport->send_command(mc_io, cmd);
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+	start_ns = start_time.tv_sec * 1000000000ull + start_time.tv_nsec;
+	ns = end_time.tv_sec * 1000000000ull + end_time.tv_nsec - start_ns;
+	if (restool.stats)
+		mc_stats_record(cmd_id, ns,
+				error != 0 || hdr->status != MC_CMD_STATUS_OK);
+	if (restool.record)
+		mc_trace_record(mc_io->fd, &request, cmd, error, start_ns, ns);
+	if (restool.journal && error == 0 && hdr->status == MC_CMD_STATUS_OK)
+		journal_record(mc_io, &request, cmd, obj_state);
+
+	return error;
+}
+
+int mc_get_root_dprc_id(struct fsl_mc_io *mc_io, uint32_t *root_dprc_id)
+{
+	int error;
+
+	error = mc_io->transport->get_root_dprc_id(mc_io, root_dprc_id);
+	if (error == 0 && restool.record)
+		mc_trace_record_root(*root_dprc_id);
+
+	return error;
+}
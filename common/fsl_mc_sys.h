@@ -37,18 +37,46 @@
 #include <stdint.h>
 
 struct mc_command;
+struct fsl_mc_io;
+
+/**
+ * struct fsl_mc_transport - backend carrying MC commands to an MC
+ * @name: transport name, as given in --device
+ * @open: open a new MC portal
+ * @close: close an MC portal opened by @open
+ * @send_command: send an MC command and wait for its response, returns
+ *	0 on success or a negative errno value mapped from the MC status
+ * @get_root_dprc_id: get the id of the root container seen by the portal
+ */
+struct fsl_mc_transport {
+	const char *name;
+	int (*open)(struct fsl_mc_io *mc_io);
+	void (*close)(struct fsl_mc_io *mc_io);
+	int (*send_command)(struct fsl_mc_io *mc_io, struct mc_command *cmd);
+	int (*get_root_dprc_id)(struct fsl_mc_io *mc_io, uint32_t *root_dprc_id);
+};
 
 /**
  * struct fsl_mc_io - MC I/O object
+ * @fd: file descriptor of the MC portal, -1 if the transport has none
+ * @transport: transport the portal was opened on
  */
 struct fsl_mc_io {
 	int fd;
+	const struct fsl_mc_transport *transport;
 };
 
-int mc_io_init(struct fsl_mc_io *mc_io);
+extern const struct fsl_mc_transport mc_ioctl_transport;
+
+int mc_io_init(struct fsl_mc_io *mc_io,
+	       const struct fsl_mc_transport *transport);
+
+int mc_io_clone(struct fsl_mc_io *mc_io, const struct fsl_mc_io *orig);
 
 void mc_io_cleanup(struct fsl_mc_io *mc_io);
 
 int mc_send_command(struct fsl_mc_io *mc_io, struct mc_command *cmd);
 
+int mc_get_root_dprc_id(struct fsl_mc_io *mc_io, uint32_t *root_dprc_id);
+
 #endif /* _FSL_MC_SYS_H */
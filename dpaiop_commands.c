@@ -135,6 +135,7 @@ const struct flib_ops dpaiop_ops = {
 	.obj_close = dpaiop_close_v10,
 	.obj_get_irq_mask = dpaiop_get_irq_mask_v10,
 	.obj_get_irq_status = dpaiop_get_irq_status_v10,
+	.obj_destroy = dpaiop_destroy_v10,
 };
 
 static int cmd_dpaiop_help(void)
@@ -79,6 +79,8 @@ C_ASSERT(ARRAY_SIZE(dpbp_info_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 enum dpbp_create_options {
 	CREATE_OPT_HELP = 0,
 	CREATE_OPT_PARENT_DPRC,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpbp_create_options[] = {
@@ -96,6 +98,20 @@ static struct option dpbp_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -126,6 +142,7 @@ const struct flib_ops dpbp_ops = {
 	.obj_close = dpbp_close_v10,
 	.obj_get_irq_mask = dpbp_get_irq_mask_v10,
 	.obj_get_irq_status = dpbp_get_irq_status_v10,
+	.obj_destroy = dpbp_destroy_v10,
 };
 
 static int cmd_dpbp_help(void)
@@ -397,13 +414,27 @@ static int create_dpbp_v9(struct dpbp_cfg *dpbp_cfg)
 	return 0;
 }
 
+static int create_dpbp_obj(uint16_t dprc_handle, const void *cfg,
+			   uint32_t *dpbp_id)
+{
+	return dpbp_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpbp_id);
+}
+
 static int create_dpbp_v10(struct dpbp_cfg_v10 *dpbp_cfg)
 {
-	uint32_t dpbp_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -422,24 +453,15 @@ static int create_dpbp_v10(struct dpbp_cfg_v10 *dpbp_cfg)
 		}
 	}
 
-	error = dpbp_create_v10(&restool.mc_io, dprc_handle,
-				0, dpbp_cfg, &dpbp_id);
-	if (error < 0) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpbp", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpbp_obj, dpbp_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpbp", dpbp_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpbp", dpbp_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 
 static int create_dpbp(int mc_fw_version, const char *usage_msg)
@@ -492,6 +514,10 @@ static int cmd_dpbp_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n";
 
 	return create_dpbp(MC_FW_VERSION_10, usage_msg);
@@ -82,6 +82,8 @@ enum dpci_create_options {
 	CREATE_OPT_NUM_PRIORITIES,
 	CREATE_OPT_PARENT_DPRC,
 	CREATE_OPT_OPTIONS,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpci_create_options[] = {
@@ -113,6 +115,20 @@ static struct option dpci_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -143,6 +159,7 @@ const struct flib_ops dpci_ops = {
 	.obj_close = dpci_close_v10,
 	.obj_get_irq_mask = dpci_get_irq_mask_v10,
 	.obj_get_irq_status = dpci_get_irq_status,
+	.obj_destroy = dpci_destroy_v10,
 };
 
 static struct option_entry options_map_v10[] = {
@@ -512,12 +529,20 @@ static int create_dpci_v9(const char *usage_msg)
 	return 0;
 }
 
+static int create_dpci_obj(uint16_t dprc_handle, const void *cfg,
+			   uint32_t *dpci_id)
+{
+	return dpci_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpci_id);
+}
+
 static int create_dpci_v10(const char *usage_msg)
 {
 	struct dpci_cfg_v10 dpci_cfg;
-	uint32_t dpci_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 	long val;
 
@@ -563,6 +588,12 @@ static int create_dpci_v10(const char *usage_msg)
 		dpci_cfg.num_of_priorities = 1;
 	}
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -581,24 +612,15 @@ static int create_dpci_v10(const char *usage_msg)
 		}
 	}
 
-	error = dpci_create_v10(&restool.mc_io, dprc_handle, 0, &dpci_cfg, &dpci_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpci", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpci_obj, &dpci_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpci", dpci_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpci", dpci_id, NULL);
 
-	}
-
-	return 0;
+	return error;
 }
 
 static int cmd_dpci_create_v9(void)
@@ -643,6 +665,10 @@ static int cmd_dpci_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLES:\n"
 		"Create a DPCI object with all default options:\n"
@@ -81,6 +81,8 @@ enum dpcon_create_options {
 	CREATE_OPT_HELP = 0,
 	CREATE_OPT_NUM_PRIORITIES,
 	CREATE_OPT_PARENT_DPRC,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpcon_create_options[] = {
@@ -105,6 +107,20 @@ static struct option dpcon_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -135,6 +151,7 @@ const struct flib_ops dpcon_ops = {
 	.obj_close = dpcon_close_v10,
 	.obj_get_irq_mask = dpcon_get_irq_mask_v10,
 	.obj_get_irq_status = dpcon_get_irq_status_v10,
+	.obj_destroy = dpcon_destroy_v10,
 };
 
 static int cmd_dpcon_help(void)
@@ -416,13 +433,27 @@ static int create_dpcon_v9(struct dpcon_cfg *dpcon_cfg)
 	return 0;
 }
 
+static int create_dpcon_obj(uint16_t dprc_handle, const void *cfg,
+			    uint32_t *dpcon_id)
+{
+	return dpcon_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpcon_id);
+}
+
 static int create_dpcon_v10(struct dpcon_cfg_v10 *dpcon_cfg)
 {
-	uint32_t dpcon_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -441,24 +472,15 @@ static int create_dpcon_v10(struct dpcon_cfg_v10 *dpcon_cfg)
 		}
 	}
 
-	error = dpcon_create_v10(&restool.mc_io, dprc_handle,
-				 0, dpcon_cfg, &dpcon_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpcon", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpcon_obj, dpcon_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpcon", dpcon_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpcon", dpcon_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 
 static int create_dpcon(int mc_fw_version, const char *usage_msg)
@@ -541,6 +563,10 @@ static int cmd_dpcon_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLES:\n"
 		"Create a DPCON object with all default options:\n"
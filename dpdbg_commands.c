@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <assert.h>
 #include <getopt.h>
+#include <limits.h>
 #include "restool.h"
 #include "utils.h"
 #include "mc_v10/fsl_dpdbg.h"
@@ -184,6 +185,63 @@ static struct option dpdbg_destroy_options[] = {
 
 C_ASSERT(ARRAY_SIZE(dpdbg_destroy_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 
+enum dpdbg_profile_options {
+	PROFILE_OPT_HELP = 0,
+	PROFILE_OPT_CTLU,
+	PROFILE_OPT_TABLE,
+	PROFILE_OPT_INTERVAL,
+	PROFILE_OPT_COUNT,
+	PROFILE_OPT_KEEP,
+};
+
+static struct option dpdbg_profile_options[] = {
+	[PROFILE_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[PROFILE_OPT_CTLU] = {
+		.name = "ctlu",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[PROFILE_OPT_TABLE] = {
+		.name = "table",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[PROFILE_OPT_INTERVAL] = {
+		.name = "interval",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[PROFILE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[PROFILE_OPT_KEEP] = {
+		.name = "keep",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dpdbg_profile_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
 
 static int cmd_dpdbg_help(void)
 {
@@ -197,6 +255,7 @@ static int cmd_dpdbg_help(void)
 		"    destroy - destroy DPDBG object.\n"
 		"    dump - displays in MC console information about MC objects or memory usage.\n"
 		"    set - set MC modules on or off.\n"
+		"    profile - samples the CTLU profiling counters.\n"
 		"\n"
 		"For command-specific help, use the --help option of each command.\n"
 		"\n";
@@ -741,6 +800,428 @@ static int cmd_dpdbg_create(void)
 	return 0;
 }
 
+/*
+ * CTLU types, indexed by their DBG_CTLU_* value
+ */
+static const char * const dpdbg_ctlu_names[] = {
+	[DBG_CTLU_EIOP_EGRESS] = "eiop-egress",
+	[DBG_CTLU_EIOP_INGRESS] = "eiop-ingress",
+	[DBG_CTLU_AIOP] = "aiop",
+	[DBG_CTLU_AIOP_MFLU] = "aiop-mflu",
+};
+
+/**
+ * struct dpdbg_profile - profiling state of a CTLU type
+ * @ctlu_type: DBG_CTLU_* value
+ * @enabled: profiling was enabled on the CTLU and must be disabled on exit
+ * @values: last sample of the counters
+ * @prev_values: sample before @values
+ */
+struct dpdbg_profile {
+	uint8_t ctlu_type;
+	bool enabled;
+	struct ctlu_profiling_counters values;
+	struct ctlu_profiling_counters prev_values;
+};
+
+/**
+ * Parse the comma separated list of CTLU types of --ctlu into
+ * 'profiles', "all" selects every type
+ */
+static int parse_ctlu_types(const char *arg, struct dpdbg_profile *profiles,
+			    unsigned int *num_profiles)
+{
+	bool selected[ARRAY_SIZE(dpdbg_ctlu_names)] = { false };
+
+	for (const char *name = arg; *name != '\0'; ) {
+		size_t len = strcspn(name, ",");
+		unsigned int i;
+
+		if (len == 3 && strncmp(name, "all", len) == 0) {
+			for (i = 0; i < ARRAY_SIZE(dpdbg_ctlu_names); i++)
+				selected[i] = true;
+		} else {
+			for (i = 0; i < ARRAY_SIZE(dpdbg_ctlu_names); i++)
+				if (strlen(dpdbg_ctlu_names[i]) == len &&
+				    strncmp(name, dpdbg_ctlu_names[i],
+					    len) == 0)
+					break;
+
+			if (i == ARRAY_SIZE(dpdbg_ctlu_names)) {
+				ERROR_PRINTF("Invalid CTLU type: %.*s\n",
+					     (int)len, name);
+				return -EINVAL;
+			}
+			selected[i] = true;
+		}
+
+		name += len;
+		if (*name == ',')
+			name++;
+	}
+
+	*num_profiles = 0;
+	for (unsigned int i = 0; i < ARRAY_SIZE(dpdbg_ctlu_names); i++) {
+		if (!selected[i])
+			continue;
+
+		memset(&profiles[*num_profiles], 0, sizeof(*profiles));
+		profiles[(*num_profiles)++].ctlu_type = i;
+	}
+
+	return 0;
+}
+
+static int sample_ctlu_profiles(uint16_t dpdbg_handle,
+				struct dpdbg_profile *profiles,
+				unsigned int num_profiles)
+{
+	int error;
+
+	for (unsigned int i = 0; i < num_profiles; i++) {
+		profiles[i].prev_values = profiles[i].values;
+		error = dpdbg_get_ctlu_profiling_counters(&restool.mc_io, 0,
+						dpdbg_handle,
+						profiles[i].ctlu_type,
+						&profiles[i].values);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+					mc_status_to_string(mc_status),
+					mc_status);
+			return error;
+		}
+	}
+
+	return 0;
+}
+
+static void print_ctlu_counter(const char *name, uint32_t value,
+			       uint32_t prev_value, double seconds)
+{
+	/* the counters are 32 bits wide: the difference survives one wrap */
+	uint32_t delta = value - prev_value;
+
+	printf("  %-16s %12u %14.0f", name, delta, delta / seconds);
+}
+
+static void print_ctlu_ratio(uint32_t hits, uint32_t prev_hits,
+			     uint32_t lookups, uint32_t prev_lookups)
+{
+	uint32_t delta_lookups = lookups - prev_lookups;
+
+	if (delta_lookups)
+		printf(" %8.1f%%",
+		       100.0 * (uint32_t)(hits - prev_hits) / delta_lookups);
+	printf("\n");
+}
+
+static void print_ctlu_profiles(const struct dpdbg_profile *profiles,
+				unsigned int num_profiles, double seconds)
+{
+	for (unsigned int i = 0; i < num_profiles; i++) {
+		const struct ctlu_profiling_counters *v = &profiles[i].values;
+		const struct ctlu_profiling_counters *p =
+			&profiles[i].prev_values;
+		uint32_t lookups = v->rule_lookups - p->rule_lookups;
+
+		printf("%s over %.3f s:\n",
+		       dpdbg_ctlu_names[profiles[i].ctlu_type], seconds);
+		printf("  %-16s %12s %14s %9s\n",
+		       "counter", "delta", "per second", "hit ratio");
+
+		print_ctlu_counter("rule lookups", v->rule_lookups,
+				   p->rule_lookups, seconds);
+		printf("\n");
+		print_ctlu_counter("rule hits", v->rule_hits,
+				   p->rule_hits, seconds);
+		print_ctlu_ratio(v->rule_hits, p->rule_hits,
+				 v->rule_lookups, p->rule_lookups);
+		print_ctlu_counter("entry lookups", v->entry_lookups,
+				   p->entry_lookups, seconds);
+		printf("\n");
+		print_ctlu_counter("entry hits", v->entry_hits,
+				   p->entry_hits, seconds);
+		print_ctlu_ratio(v->entry_hits, p->entry_hits,
+				 v->entry_lookups, p->entry_lookups);
+		print_ctlu_counter("cache accesses", v->cache_accesses,
+				   p->cache_accesses, seconds);
+		printf("\n");
+		print_ctlu_counter("cache hits", v->cache_hits,
+				   p->cache_hits, seconds);
+		print_ctlu_ratio(v->cache_hits, p->cache_hits,
+				 v->cache_accesses, p->cache_accesses);
+		print_ctlu_counter("cache updates", v->cache_updates,
+				   p->cache_updates, seconds);
+		printf("\n");
+		print_ctlu_counter("memory accesses", v->memory_accesses,
+				   p->memory_accesses, seconds);
+		printf("\n");
+
+		/* the cost of a lookup in the classification tables */
+		if (lookups)
+			printf("  memory accesses per rule lookup: %.2f\n",
+			       (double)(uint32_t)(v->memory_accesses -
+						  p->memory_accesses) /
+			       lookups);
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+static int set_ctlu_profiling(uint16_t dpdbg_handle,
+			      struct dpdbg_profile *profile, bool enable,
+			      bool table, uint16_t table_id)
+{
+	struct ctlu_profiling_options options = { 0 };
+	int error;
+
+	options.enable_profiling_counters = enable;
+	options.enable_profiling_for_tid = enable && table;
+	options.table_id = enable && table ? table_id : 0;
+
+	error = dpdbg_set_ctlu_profiling_counters(&restool.mc_io, 0,
+						  dpdbg_handle,
+						  profile->ctlu_type,
+						  &options);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+				mc_status_to_string(mc_status), mc_status);
+		return error;
+	}
+
+	profile->enabled = enable;
+	return 0;
+}
+
+/**
+ * struct dpdbg_profile_run - state of 'dpdbg profile'
+ * @when_ns: time of the last sample
+ */
+struct dpdbg_profile_run {
+	uint16_t dpdbg_handle;
+	struct dpdbg_profile *profiles;
+	unsigned int num_profiles;
+	bool table;
+	uint16_t table_id;
+	uint64_t when_ns;
+};
+
+static int profile_sample(void *arg, long n)
+{
+	struct dpdbg_profile_run *run = arg;
+	uint64_t prev_when_ns = run->when_ns;
+	int error;
+
+	/* enabling profiling resets the counters of the CTLU */
+	for (unsigned int i = 0; n == 0 && i < run->num_profiles; i++) {
+		error = set_ctlu_profiling(run->dpdbg_handle, &run->profiles[i],
+					   true, run->table, run->table_id);
+		if (error < 0)
+			return error;
+	}
+
+	run->when_ns = now_ns();
+	error = sample_ctlu_profiles(run->dpdbg_handle, run->profiles,
+				     run->num_profiles);
+	if (error < 0 || n == 0)
+		return error;
+
+	print_ctlu_profiles(run->profiles, run->num_profiles,
+			    (run->when_ns - prev_when_ns) / 1e9);
+	return 0;
+}
+
+/*
+ * Enable profiling on the CTLU types of 'profiles', then sample their
+ * counters every 'interval_ms' and print the differences 'count' times,
+ * or until interrupted if 'count' is 0
+ */
+static int profile(struct dpdbg_profile *profiles, unsigned int num_profiles,
+		   bool table, uint16_t table_id, long interval_ms, long count,
+		   bool keep)
+{
+	uint32_t dpdbg_id = 0;
+	uint16_t dpdbg_handle = 0;
+	bool dpdbg_opened = false;
+	struct dpdbg_profile_run run;
+	int error = 0;
+
+	error = dpdbg_open_v10(&restool.mc_io, 0, dpdbg_id, &dpdbg_handle);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+				mc_status_to_string(mc_status), mc_status);
+		goto out;
+	}
+	dpdbg_opened = true;
+
+	if (dpdbg_handle == 0) {
+		DEBUG_PRINTF("dpdbg_open() returned invalid handle (auth 0)\n");
+		error = -ENOENT;
+		goto out;
+	}
+
+	run.dpdbg_handle = dpdbg_handle;
+	run.profiles = profiles;
+	run.num_profiles = num_profiles;
+	run.table = table;
+	run.table_id = table_id;
+	run.when_ns = 0;
+	error = interval_run((uint64_t)interval_ms * 1000000, count,
+			     profile_sample, &run);
+
+out:
+	if (dpdbg_opened) {
+		int error2;
+
+		for (unsigned int i = 0; i < num_profiles && !keep; i++) {
+			if (!profiles[i].enabled)
+				continue;
+
+			error2 = set_ctlu_profiling(dpdbg_handle, &profiles[i],
+						    false, false, 0);
+			if (error2 < 0 && error == 0)
+				error = error2;
+		}
+
+		error2 = dpdbg_close_v10(&restool.mc_io, 0, dpdbg_handle);
+		if (error2 < 0) {
+			mc_status = flib_error_to_mc_status(error2);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+					mc_status_to_string(mc_status),
+					mc_status);
+			if (error == 0)
+				error = error2;
+		}
+	}
+
+	return error;
+}
+
+static int cmd_dpdbg_profile(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dpdbg profile [--ctlu=<types>] [--table=<id>]\n"
+		"                             [--interval=<ms>] [--count=<n>] [--keep]\n"
+		"\n"
+		"Enables the profiling counters of the classifier (CTLU) lookups, samples\n"
+		"them and displays their differences and rates per second between samples.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--ctlu=<types>\n"
+		"   Comma separated list of the CTLU types to profile, among eiop-ingress,\n"
+		"   eiop-egress, aiop and aiop-mflu, or all. Defaults to all.\n"
+		"--table=<id>\n"
+		"   Only counts the lookups in the table <id>.\n"
+		"--interval=<ms>\n"
+		"   Samples the counters every <ms> milliseconds. Defaults to 1000.\n"
+		"--count=<n>\n"
+		"   Stops after <n> intervals, 0 runs until interrupted. Defaults to 1.\n"
+		"--keep\n"
+		"   Leaves the profiling enabled on exit.\n"
+		"\n"
+		"The counters are 32 bits wide: an interval must not see more than 2^32\n"
+		"lookups.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"Display the ingress classification hit ratios every second:\n"
+		"   $ restool dpdbg profile --ctlu=eiop-ingress --count=0\n"
+		"\n";
+	struct dpdbg_profile profiles[ARRAY_SIZE(dpdbg_ctlu_names)];
+	struct dprc_obj_desc target_obj_desc;
+	uint32_t target_parent_dprc_id;
+	unsigned int num_profiles;
+	bool found = false;
+	bool table = false;
+	bool keep = false;
+	long interval_ms = 1000;
+	long table_id = 0;
+	long count = 1;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(PROFILE_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(PROFILE_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name != NULL) {
+		ERROR_PRINTF("Unexpected argument: \'%s\'\n\n",
+				restool.obj_name);
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	error = parse_ctlu_types("all", profiles, &num_profiles);
+	if (restool.cmd_option_mask & ONE_BIT_MASK(PROFILE_OPT_CTLU)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(PROFILE_OPT_CTLU);
+		error = parse_ctlu_types(
+				restool.cmd_option_args[PROFILE_OPT_CTLU],
+				profiles, &num_profiles);
+	}
+	if (error < 0) {
+		puts(usage_msg);
+		return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(PROFILE_OPT_TABLE)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(PROFILE_OPT_TABLE);
+		error = get_option_value(PROFILE_OPT_TABLE, &table_id,
+					 "Invalid table id", 0, UINT16_MAX);
+		if (error)
+			return error;
+		table = true;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(PROFILE_OPT_INTERVAL)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(PROFILE_OPT_INTERVAL);
+		error = get_option_value(PROFILE_OPT_INTERVAL, &interval_ms,
+					 "Invalid interval", 1, 3600000);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(PROFILE_OPT_COUNT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(PROFILE_OPT_COUNT);
+		error = get_option_value(PROFILE_OPT_COUNT, &count,
+					 "Invalid count", 0, LONG_MAX);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(PROFILE_OPT_KEEP)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(PROFILE_OPT_KEEP);
+		keep = true;
+	}
+
+	error = daemon_decline_command();
+	if (error)
+		return error;
+
+	memset(&target_obj_desc, 0, sizeof(struct dprc_obj_desc));
+	error = find_target_obj_desc(restool.root_dprc_id,
+					restool.root_dprc_handle,
+					0,
+					0,
+					"dpdbg",
+					&target_obj_desc,
+					&target_parent_dprc_id,
+					&found);
+	if (error < 0)
+		return error;
+
+	if (strcmp(target_obj_desc.type, "dpdbg")) {
+		printf("dpdbg.0 does not exist\n");
+		return -EINVAL;
+	}
+
+	return profile(profiles, num_profiles, table, table_id, interval_ms,
+		       count, keep);
+}
+
 
 struct object_command dpdbg_commands[] = {
 	{ .cmd_name = "--help",
@@ -767,6 +1248,10 @@ struct object_command dpdbg_commands[] = {
 	  .options = dpdbg_destroy_options,
 	  .cmd_func = cmd_dpdbg_destroy },
 
+	{ .cmd_name = "profile",
+	  .options = dpdbg_profile_options,
+	  .cmd_func = cmd_dpdbg_profile },
+
 	{ .cmd_name = NULL },
 };
 
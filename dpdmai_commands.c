@@ -80,6 +80,8 @@ enum dpdmai_create_options {
 	CREATE_OPT_PRIORITIES,
 	CREATE_OPT_PARENT_DPRC,
 	CREATE_OPT_NUM_QUEUES,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpdmai_create_options[] = {
@@ -111,6 +113,20 @@ static struct option dpdmai_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -141,6 +157,7 @@ const struct flib_ops dpdmai_ops = {
 	.obj_close = dpdmai_close_v10,
 	.obj_get_irq_mask = dpdmai_get_irq_mask_v10,
 	.obj_get_irq_status = dpdmai_get_irq_status_v10,
+	.obj_destroy = dpdmai_destroy_v10,
 };
 
 static int cmd_dpdmai_help(void)
@@ -454,14 +471,29 @@ static int create_dpdmai_v9(struct dpdmai_cfg *dpdmai_cfg)
 	return 0;
 }
 
+static int create_dpdmai_obj(uint16_t dprc_handle, const void *cfg,
+			     uint32_t *dpdmai_id)
+{
+	return dpdmai_create_v10(&restool.mc_io, dprc_handle, 0, cfg,
+				 dpdmai_id);
+}
+
 static int create_dpdmai_v10(struct dpdmai_cfg_v10 *dpdmai_cfg)
 {
-	uint32_t dpdmai_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
 	long value;
+	const char *label_prefix;
+	long count;
 	int error;
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -491,24 +523,15 @@ static int create_dpdmai_v10(struct dpdmai_cfg_v10 *dpdmai_cfg)
 		dpdmai_cfg->num_queues = (uint8_t)value;
 	}
 
-	error = dpdmai_create_v10(&restool.mc_io, dprc_handle, 0,
-				  dpdmai_cfg, &dpdmai_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpdmai", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpdmai_obj, dpdmai_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpdmai", dpdmai_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpdmai", dpdmai_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 
 static int create_dpdmai(int mc_fw_version, const char *usage_msg)
@@ -601,6 +624,10 @@ static int cmd_dpdmai_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLES:\n"
 		"create a DPDMAI object with all default options:\n"
@@ -166,6 +166,8 @@ enum dpdmux_create_options_v9 {
 	CREATE_OPT_MAX_MC_GROUPS_V9,
 	CREATE_OPT_PARENT_DPRC,
 	CREATE_OPT_DEFAULT_IF,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpdmux_create_options_v9[] = {
@@ -232,6 +234,20 @@ static struct option dpdmux_create_options_v9[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -269,6 +285,7 @@ const struct flib_ops dpdmux_ops = {
 	.obj_close = dpdmux_close_v10,
 	.obj_get_irq_mask = dpdmux_get_irq_mask_v10,
 	.obj_get_irq_status = dpdmux_get_irq_status_v10,
+	.obj_destroy = dpdmux_destroy_v10,
 };
 
 static int cmd_dpdmux_help(void)
@@ -862,12 +879,21 @@ static int cmd_dpdmux_create_v9(void)
 	return create_dpdmux_v9(usage_msg);
 }
 
+static int create_dpdmux_obj(uint16_t dprc_handle, const void *cfg,
+			     uint32_t *dpdmux_id)
+{
+	return dpdmux_create_v10(&restool.mc_io, dprc_handle, 0, cfg,
+				 dpdmux_id);
+}
+
 static int create_dpdmux_v10(const char *usage_msg)
 {
 	struct dpdmux_cfg_v10 dpdmux_cfg = {0};
-	uint32_t dpdmux_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 	long val;
 
@@ -987,6 +1013,12 @@ static int create_dpdmux_v10(const char *usage_msg)
 		dpdmux_cfg.adv.max_mc_groups = 0;
 	}
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -1005,24 +1037,16 @@ static int create_dpdmux_v10(const char *usage_msg)
 		}
 	}
 
-	error = dpdmux_create_v10(&restool.mc_io, dprc_handle, 0,
-				  &dpdmux_cfg, &dpdmux_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpdmux", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpdmux_obj,
+			    &dpdmux_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpdmux", dpdmux_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpdmux", dpdmux_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 
 
@@ -1063,6 +1087,10 @@ static int cmd_dpdmux_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n";
 
 	return create_dpdmux_v10(usage_msg);
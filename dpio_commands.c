@@ -81,6 +81,8 @@ enum dpio_create_options {
 	CREATE_OPT_CHANNEL_MODE,
 	CREATE_OPT_NUM_PRIORITIES,
 	CREATE_OPT_PARENT_DPRC,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpio_create_options[] = {
@@ -112,6 +114,20 @@ static struct option dpio_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -142,6 +158,7 @@ const struct flib_ops dpio_ops = {
 	.obj_close = dpio_close_v10,
 	.obj_get_irq_mask = dpio_get_irq_mask_v10,
 	.obj_get_irq_status = dpio_get_irq_status_v10,
+	.obj_destroy = dpio_destroy_v10,
 };
 
 static int cmd_dpio_help(void)
@@ -440,13 +457,27 @@ static int create_dpio_v9(struct dpio_cfg *dpio_cfg)
 	return 0;
 }
 
+static int create_dpio_obj(uint16_t dprc_handle, const void *cfg,
+			   uint32_t *dpio_id)
+{
+	return dpio_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpio_id);
+}
+
 static int create_dpio_v10(struct dpio_cfg_v10 *dpio_cfg)
 {
-	uint32_t dpio_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -465,22 +496,13 @@ static int create_dpio_v10(struct dpio_cfg_v10 *dpio_cfg)
 		}
 	}
 
-	error = dpio_create_v10(&restool.mc_io, dprc_handle, 0,
-				dpio_cfg, &dpio_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpio", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpio_obj, dpio_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpio", dpio_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpio", dpio_id, NULL);
-	}
 
 	return error;
 }
@@ -594,6 +616,10 @@ static int cmd_dpio_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLE:\n"
 		"Create a DPIO object with all default options:\n"
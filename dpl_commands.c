@@ -0,0 +1,2087 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <getopt.h>
+#include "restool.h"
+#include "utils.h"
+#include "dprc_commands_generate_dpl.h"
+#include "mc_v10/fsl_dprc.h"
+
+static enum mc_cmd_status mc_status;
+
+enum dpl_apply_options {
+	APPLY_OPT_HELP = 0,
+};
+
+static struct option dpl_apply_options[] = {
+	[APPLY_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dpl_apply_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+enum dpl_reconcile_options {
+	RECONCILE_OPT_HELP = 0,
+	RECONCILE_OPT_DRY_RUN,
+};
+
+static struct option dpl_reconcile_options[] = {
+	[RECONCILE_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[RECONCILE_OPT_DRY_RUN] = {
+		.name = "dry-run",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dpl_reconcile_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+/*
+ * What becomes of a container or an object of a target DPL
+ */
+enum dpl_action {
+	DPL_CREATE = 0,	/* created */
+	DPL_KEEP,	/* already there, left untouched */
+	DPL_MOVE,	/* already there, moved to another container */
+};
+
+/**
+ * struct dpl_container - container found in the /containers node
+ * @node: DPL node of the container
+ * @dpl_id: container id in the DPL
+ * @parent: index of the parent container in the plan, -1 if the parent
+ *	is an existing container
+ * @parent_id: id of the existing parent container, if @parent is -1
+ * @existing: the container is the top of the DPL (its parent is "none"),
+ *	it stands for the existing dprc.<dpl_id> and is not created
+ * @action: DPL_CREATE or DPL_KEEP
+ * @match: index of the same container in the other plan, when comparing
+ *	two plans, -1 if there is none
+ * @depth: number of ancestors of the container in the plan
+ * @id: id of the container in the MC, -1 until it is created
+ */
+struct dpl_container {
+	struct dpl_node *node;
+	uint32_t dpl_id;
+	int parent;
+	uint32_t parent_id;
+	bool existing;
+	enum dpl_action action;
+	int match;
+	int depth;
+	int id;
+};
+
+/**
+ * struct dpl_object - object found in an obj_set of a container
+ * @type: object type
+ * @dpl_id: object id in the DPL
+ * @node: DPL node of the object, found in the /objects node
+ * @container: index of the container of the object in the plan
+ * @action: what dpl apply or dpl reconcile does with the object
+ * @match: index of the same object in the other plan, when comparing two
+ *	plans, -1 if there is none
+ * @id: id of the object in the MC, -1 until it is created
+ */
+struct dpl_object {
+	char type[OBJ_TYPE_MAX_LENGTH + 1];
+	uint32_t dpl_id;
+	struct dpl_node *node;
+	int container;
+	enum dpl_action action;
+	int match;
+	int id;
+};
+
+/**
+ * struct dpl_endpoint - end of a connection
+ * @object: index of the object in the plan, -1 if the endpoint is an
+ *	existing object
+ * @type: object type
+ * @id: object id, in the MC for existing objects, in the DPL otherwise
+ * @if_id: interface id, 0 if the endpoint has no interface
+ */
+struct dpl_endpoint {
+	int object;
+	char type[OBJ_TYPE_MAX_LENGTH + 1];
+	uint32_t id;
+	uint16_t if_id;
+};
+
+/**
+ * struct dpl_connection - connection found in the /connections node
+ * @keep: the connection is already there, when comparing two plans, or
+ *	is left out of a clone
+ */
+struct dpl_connection {
+	struct dpl_node *node;
+	struct dpl_endpoint endpoints[2];
+	bool keep;
+};
+
+/**
+ * struct dpl_plan - everything a DPL asks to create, in creation order
+ * @sorted: objects sorted by type and DPL id, to resolve the endpoints
+ */
+struct dpl_plan {
+	struct dpl_container *containers;
+	unsigned int num_containers;
+	struct dpl_object *objects;
+	unsigned int num_objects;
+	struct dpl_object **sorted;
+	struct dpl_connection *connections;
+	unsigned int num_connections;
+};
+
+static int cmd_dpl_help(void)
+{
+	static const char help_msg[] =
+		"\n"
+		"Usage: restool dpl <command> [--help] [ARGS...]\n"
+		"Where <command> can be:\n"
+		"   apply - creates the containers, objects and connections of a DPL file.\n"
+		"   reconcile - converges the live layout to a DPL file.\n"
+		"\n"
+		"For command-specific help, use the --help option of each command.\n"
+		"\n";
+
+	printf(help_msg);
+	return 0;
+}
+
+/*
+ * Split a "<type>@<id>" node name
+ */
+static int parse_dpl_name(const char *name, char *type, uint32_t *id)
+{
+	unsigned int n;
+	int num_chars;
+
+	n = sscanf(name, "%" STRINGIFY(OBJ_TYPE_MAX_LENGTH) "[a-z]@%u%n",
+		   type, id, &num_chars);
+	if (n != 2 || name[num_chars] != '\0')
+		return -EINVAL;
+
+	return 0;
+}
+
+static const char *get_string_prop(const struct dpl_node *node,
+				   const char *name)
+{
+	struct dpl_prop *prop = dpl_get_prop(node, name);
+
+	if (!prop || !dpl_prop_is_string(prop))
+		return NULL;
+
+	return (const char *)prop->data;
+}
+
+static int compare_objects(const void *a, const void *b)
+{
+	const struct dpl_object *obj1 = *(struct dpl_object * const *)a;
+	const struct dpl_object *obj2 = *(struct dpl_object * const *)b;
+	int diff = strcmp(obj1->type, obj2->type);
+
+	if (diff != 0)
+		return diff;
+	if (obj1->dpl_id != obj2->dpl_id)
+		return obj1->dpl_id < obj2->dpl_id ? -1 : 1;
+
+	return 0;
+}
+
+static struct dpl_object *find_plan_object(struct dpl_plan *plan,
+					   const char *type, uint32_t dpl_id)
+{
+	struct dpl_object key = { .dpl_id = dpl_id };
+	struct dpl_object *keyp = &key;
+	struct dpl_object **found;
+
+	strncpy(key.type, type, OBJ_TYPE_MAX_LENGTH);
+	found = bsearch(&keyp, plan->sorted, plan->num_objects,
+			sizeof(*plan->sorted), compare_objects);
+
+	return found ? *found : NULL;
+}
+
+static int find_plan_container(struct dpl_plan *plan, uint32_t dpl_id)
+{
+	for (unsigned int i = 0; i < plan->num_containers; i++) {
+		if (plan->containers[i].dpl_id == dpl_id)
+			return i;
+	}
+
+	return -1;
+}
+
+static void free_plan(struct dpl_plan *plan)
+{
+	free(plan->containers);
+	free(plan->objects);
+	free(plan->sorted);
+	free(plan->connections);
+	memset(plan, 0, sizeof(*plan));
+}
+
+/*
+ * Add the objects listed in the obj_set nodes of a container to the plan
+ */
+static int plan_container_objects(struct dpl_plan *plan,
+				  const struct dpl_node *root, int container)
+{
+	struct dpl_node *dprc_node = plan->containers[container].node;
+	struct dpl_node *obj_set;
+	struct dpl_object *objects;
+	struct dpl_object *obj;
+	struct dpl_prop *ids;
+	const char *type;
+	char path[64];
+	unsigned int num_ids;
+
+	obj_set = dpl_get_node(dprc_node, "objects");
+	for (obj_set = obj_set ? obj_set->children : NULL; obj_set;
+	     obj_set = obj_set->next) {
+		if (strncmp(obj_set->name, "obj_set@", 8) != 0) {
+			ERROR_PRINTF("unknown node %s in %s\n",
+				     obj_set->name, dprc_node->name);
+			return -EINVAL;
+		}
+
+		type = get_string_prop(obj_set, "type");
+		ids = dpl_get_prop(obj_set, "ids");
+		if (!type || strlen(type) > OBJ_TYPE_MAX_LENGTH || !ids) {
+			ERROR_PRINTF("%s of %s needs a type and ids\n",
+				     obj_set->name, dprc_node->name);
+			return -EINVAL;
+		}
+
+		if (strcmp(type, "dprc") == 0) {
+			ERROR_PRINTF("containers must be described in /containers, not in %s\n",
+				     dprc_node->name);
+			return -EINVAL;
+		}
+
+		num_ids = dpl_prop_num_cells(ids);
+		objects = realloc(plan->objects,
+				  (plan->num_objects + num_ids) *
+				  sizeof(*objects));
+		if (!objects)
+			return -ENOMEM;
+		plan->objects = objects;
+
+		for (unsigned int i = 0; i < num_ids; i++) {
+			obj = &plan->objects[plan->num_objects++];
+			memset(obj, 0, sizeof(*obj));
+			strcpy(obj->type, type);
+			obj->dpl_id = dpl_prop_cell(ids, i);
+			obj->container = container;
+			obj->match = -1;
+			obj->id = -1;
+			if (plan->containers[container].existing) {
+				obj->action = DPL_KEEP;
+				obj->id = obj->dpl_id;
+			}
+
+			snprintf(path, sizeof(path), "/objects/%s@%u",
+				 type, obj->dpl_id);
+			obj->node = dpl_get_node(root, path);
+			if (!obj->node &&
+			    !plan->containers[container].existing) {
+				ERROR_PRINTF("%s@%u was not defined in /objects\n",
+					     type, obj->dpl_id);
+				return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int plan_container(struct dpl_plan *plan, struct dpl_node *dprc_node)
+{
+	struct dpl_container *container;
+	char type[OBJ_TYPE_MAX_LENGTH + 1];
+	struct dpl_prop *prop;
+	const char *compatible;
+	uint32_t dpl_id;
+
+	if (parse_dpl_name(dprc_node->name, type, &dpl_id) < 0 ||
+	    strcmp(type, "dprc") != 0) {
+		ERROR_PRINTF("invalid container node %s\n", dprc_node->name);
+		return -EINVAL;
+	}
+
+	compatible = get_string_prop(dprc_node, "compatible");
+	if (compatible && strcmp(compatible, "fsl,dprc") != 0) {
+		ERROR_PRINTF("unknown compatible %s for node %s\n",
+			     compatible, dprc_node->name);
+		return -EINVAL;
+	}
+
+	for (prop = dprc_node->props; prop; prop = prop->next) {
+		if (strcmp(prop->name, "compatible") != 0 &&
+		    strcmp(prop->name, "parent") != 0 &&
+		    strcmp(prop->name, "options") != 0) {
+			ERROR_PRINTF("unknown property %s for node %s\n",
+				     prop->name, dprc_node->name);
+			return -EINVAL;
+		}
+	}
+
+	if (!get_string_prop(dprc_node, "parent")) {
+		ERROR_PRINTF("%s has no parent property\n", dprc_node->name);
+		return -EINVAL;
+	}
+
+	container = &plan->containers[plan->num_containers++];
+	memset(container, 0, sizeof(*container));
+	container->node = dprc_node;
+	container->dpl_id = dpl_id;
+	container->parent = -1;
+	container->match = -1;
+	container->id = -1;
+
+	return 0;
+}
+
+/*
+ * Resolve the parent of each container: "none" marks the top of the DPL,
+ * which is the existing dprc.<n> of the container itself, "dprc@<n>" is
+ * a container of the DPL or, if the DPL does not define it, the existing
+ * dprc.<n>, and "dprc.<n>" is an existing container
+ */
+static int plan_container_parents(struct dpl_plan *plan)
+{
+	struct dpl_container *container;
+	const char *parent;
+	uint32_t parent_id;
+	int error;
+
+	for (unsigned int i = 0; i < plan->num_containers; i++) {
+		container = &plan->containers[i];
+		parent = get_string_prop(container->node, "parent");
+
+		if (strcmp(parent, "none") == 0) {
+			container->existing = true;
+			container->action = DPL_KEEP;
+			container->id = container->dpl_id;
+			continue;
+		}
+
+		if (strncmp(parent, "dprc@", 5) == 0) {
+			char type[OBJ_TYPE_MAX_LENGTH + 1];
+
+			error = parse_dpl_name(parent, type, &parent_id);
+			if (error == 0) {
+				container->parent = find_plan_container(plan,
+								parent_id);
+				container->parent_id = parent_id;
+			}
+		} else {
+			error = parse_object_name(parent, "dprc", &parent_id);
+			container->parent_id = parent_id;
+		}
+
+		if (error < 0) {
+			ERROR_PRINTF("invalid parent %s for node %s\n",
+				     parent, container->node->name);
+			return -EINVAL;
+		}
+	}
+
+	for (unsigned int i = 0; i < plan->num_containers; i++) {
+		int parent = plan->containers[i].parent;
+
+		while (parent >= 0 &&
+		       plan->containers[i].depth <= (int)plan->num_containers) {
+			plan->containers[i].depth++;
+			parent = plan->containers[parent].parent;
+		}
+
+		if (parent >= 0) {
+			ERROR_PRINTF("%s is its own ancestor\n",
+				     plan->containers[i].node->name);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Resolve an endpoint: "<type>@<id>[/if@<n>]" is an object of the DPL or,
+ * if the DPL does not define it, the existing <type>.<id>
+ */
+static int plan_endpoint(struct dpl_plan *plan, const char *str,
+			 struct dpl_endpoint *endpoint)
+{
+	char name[OBJ_TYPE_MAX_LENGTH + 16];
+	struct dpl_object *obj;
+	const char *slash;
+	unsigned int if_id;
+	int num_chars;
+
+	memset(endpoint, 0, sizeof(*endpoint));
+	slash = strchr(str, '/');
+	if (slash) {
+		if (sscanf(slash, "/if@%u%n", &if_id, &num_chars) != 1 ||
+		    slash[num_chars] != '\0' || if_id > UINT16_MAX)
+			return -EINVAL;
+		endpoint->if_id = if_id;
+	} else {
+		slash = str + strlen(str);
+	}
+
+	if ((size_t)(slash - str) >= sizeof(name))
+		return -EINVAL;
+	memcpy(name, str, slash - str);
+	name[slash - str] = '\0';
+	if (parse_dpl_name(name, endpoint->type, &endpoint->id) < 0)
+		return -EINVAL;
+
+	obj = find_plan_object(plan, endpoint->type, endpoint->id);
+	endpoint->object = obj ? obj - plan->objects : -1;
+
+	return 0;
+}
+
+static int plan_connections(struct dpl_plan *plan, const struct dpl_node *root)
+{
+	struct dpl_node *connections = dpl_get_node(root, "connections");
+	struct dpl_connection *connection;
+	struct dpl_node *node;
+	unsigned int num = 0;
+	const char *str;
+	int error;
+
+	if (!connections)
+		return 0;
+
+	for (node = connections->children; node; node = node->next)
+		num++;
+
+	plan->connections = calloc(num, sizeof(*plan->connections));
+	if (num != 0 && !plan->connections)
+		return -ENOMEM;
+
+	for (node = connections->children; node; node = node->next) {
+		connection = &plan->connections[plan->num_connections++];
+		connection->node = node;
+		for (int i = 0; i < 2; i++) {
+			str = get_string_prop(node, i == 0 ? "endpoint1" :
+							     "endpoint2");
+			error = str ? plan_endpoint(plan, str,
+						    &connection->endpoints[i]) :
+				      -EINVAL;
+			if (error < 0) {
+				ERROR_PRINTF("invalid endpoint%d in %s\n",
+					     i + 1, node->name);
+				return error;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Build the whole creation plan of a DPL before sending any MC command,
+ * so that a malformed DPL does not leave a half created layout behind
+ */
+static int build_plan(const struct dpl_node *root, struct dpl_plan *plan)
+{
+	struct dpl_node *containers;
+	struct dpl_node *node;
+	unsigned int num = 0;
+	int error;
+
+	containers = dpl_get_node(root, "containers");
+	if (!containers) {
+		ERROR_PRINTF("the DPL does not have a containers node\n");
+		return -EINVAL;
+	}
+
+	for (node = containers->children; node; node = node->next)
+		num++;
+
+	plan->containers = calloc(num, sizeof(*plan->containers));
+	if (num != 0 && !plan->containers)
+		return -ENOMEM;
+
+	for (node = containers->children; node; node = node->next) {
+		error = plan_container(plan, node);
+		if (error < 0)
+			return error;
+	}
+
+	error = plan_container_parents(plan);
+	if (error < 0)
+		return error;
+
+	for (unsigned int i = 0; i < plan->num_containers; i++) {
+		error = plan_container_objects(plan, root, i);
+		if (error < 0)
+			return error;
+	}
+
+	plan->sorted = malloc(plan->num_objects * sizeof(*plan->sorted));
+	if (plan->num_objects != 0 && !plan->sorted)
+		return -ENOMEM;
+
+	for (unsigned int i = 0; i < plan->num_objects; i++)
+		plan->sorted[i] = &plan->objects[i];
+	qsort(plan->sorted, plan->num_objects, sizeof(*plan->sorted),
+	      compare_objects);
+
+	for (unsigned int i = 1; i < plan->num_objects; i++) {
+		if (compare_objects(&plan->sorted[i - 1],
+				    &plan->sorted[i]) == 0) {
+			ERROR_PRINTF("%s@%u is listed more than once\n",
+				     plan->sorted[i]->type,
+				     plan->sorted[i]->dpl_id);
+			return -EINVAL;
+		}
+	}
+
+	return plan_connections(plan, root);
+}
+
+/**
+ * struct dpl_args - command line of a create command run by dpl apply
+ */
+struct dpl_args {
+	int argc;
+	char *argv[MAX_NUM_CMD_LINE_OPTIONS + 8];
+};
+
+static int add_arg(struct dpl_args *args, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+static int add_arg(struct dpl_args *args, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (args->argc == ARRAY_SIZE(args->argv) - 1) {
+		ERROR_PRINTF("too many properties\n");
+		return -E2BIG;
+	}
+
+	va_start(ap, fmt);
+	n = vasprintf(&args->argv[args->argc], fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return -ENOMEM;
+
+	args->argv[++args->argc] = NULL;
+
+	return 0;
+}
+
+static void free_args(struct dpl_args *args)
+{
+	while (args->argc > 0)
+		free(args->argv[--args->argc]);
+}
+
+/*
+ * Turn a DPL property into a create command option, the way
+ * ls-append-dpl did: "num_queues = <8>" becomes --num-queues=8 and
+ * "options = "A", "B"" becomes --options=A,B. Zero values are left to
+ * the defaults of the create command.
+ */
+static int add_prop_arg(struct dpl_args *args, const struct dpl_prop *prop)
+{
+	char value[256] = { 0 };
+	char option[64];
+	unsigned int len = 0;
+	unsigned int num_cells;
+	bool all_zero = true;
+	uint32_t cell;
+	unsigned int i;
+
+	snprintf(option, sizeof(option), "%s", prop->name);
+	for (i = 0; option[i] != '\0'; i++) {
+		if (option[i] == '_')
+			option[i] = '-';
+	}
+
+	if (prop->len == 0)
+		return add_arg(args, "--%s", option);
+
+	if (dpl_prop_is_string(prop)) {
+		for (i = 0; i < prop->len - 1 && i < sizeof(value) - 1; i++)
+			value[i] = prop->data[i] == '\0' ? ',' :
+							   prop->data[i];
+		return add_arg(args, "--%s=%s", option, value);
+	}
+
+	num_cells = dpl_prop_num_cells(prop);
+	if (prop->len % sizeof(uint32_t) != 0)
+		return -EINVAL;
+
+	for (i = 0; i < num_cells; i++) {
+		cell = dpl_prop_cell(prop, i);
+		if (cell != 0)
+			all_zero = false;
+
+		if (strcmp(prop->name, "mac_addr") == 0 && num_cells == 6)
+			len += snprintf(value + len, sizeof(value) - len,
+					"%s%02x", i ? ":" : "", cell & 0xff);
+		else
+			len += snprintf(value + len, sizeof(value) - len,
+					"%s%u", i ? "," : "", cell);
+		if (len >= sizeof(value))
+			return -E2BIG;
+	}
+
+	if (all_zero)
+		return 0;
+
+	return add_arg(args, "--%s=%s", option, value);
+}
+
+/*
+ * Run a create command in this process, on the MC portal already opened,
+ * and return the id of the object it created
+ */
+static int run_create_command(struct dpl_args *args, int *id)
+{
+	int error;
+
+	*id = -1;
+	restool.new_obj_id = id;
+	error = restool_execute(args->argc, args->argv);
+	restool.new_obj_id = NULL;
+	if (error == 0 && *id < 0)
+		error = -EIO;
+
+	return error;
+}
+
+static int create_container(struct dpl_plan *plan, int index)
+{
+	struct dpl_container *container = &plan->containers[index];
+	struct dpl_args args = { 0 };
+	struct dpl_prop *options;
+	uint32_t parent_id;
+	int error;
+
+	if (container->id >= 0)
+		return 0;
+
+	parent_id = container->parent_id;
+	if (container->parent >= 0) {
+		error = create_container(plan, container->parent);
+		if (error < 0)
+			return error;
+		parent_id = plan->containers[container->parent].id;
+	}
+
+	error = add_arg(&args, "restool");
+	if (error == 0)
+		error = add_arg(&args, "dprc");
+	if (error == 0)
+		error = add_arg(&args, "create");
+	if (error == 0)
+		error = add_arg(&args, "dprc.%u", parent_id);
+
+	options = dpl_get_prop(container->node, "options");
+	if (error == 0 && options)
+		error = add_prop_arg(&args, options);
+
+	if (error == 0)
+		error = run_create_command(&args, &container->id);
+	if (error < 0)
+		ERROR_PRINTF("cannot create %s under dprc.%u\n",
+			     container->node->name, parent_id);
+
+	free_args(&args);
+
+	return error;
+}
+
+static int create_object(struct dpl_plan *plan, struct dpl_object *obj)
+{
+	int container_id = plan->containers[obj->container].id;
+	struct dpl_args args = { 0 };
+	const struct dpl_prop *prop;
+	const char *compatible;
+	char expected[OBJ_TYPE_MAX_LENGTH + 5];
+	bool has_mac_id = false;
+	int error;
+
+	snprintf(expected, sizeof(expected), "fsl,%s", obj->type);
+	compatible = get_string_prop(obj->node, "compatible");
+	if (compatible && strcmp(compatible, expected) != 0) {
+		ERROR_PRINTF("unknown compatible %s for %s\n",
+			     compatible, obj->node->name);
+		return -EINVAL;
+	}
+
+	error = add_arg(&args, "restool");
+	if (error == 0)
+		error = add_arg(&args, "%s", obj->type);
+	if (error == 0)
+		error = add_arg(&args, "create");
+
+	for (prop = obj->node->props; prop && error == 0; prop = prop->next) {
+		if (strcmp(prop->name, "compatible") == 0 ||
+		    strcmp(prop->name, "type") == 0)
+			continue;
+
+		if (strcmp(prop->name, "mac_id") == 0)
+			has_mac_id = true;
+
+		error = add_prop_arg(&args, prop);
+		if (error < 0)
+			ERROR_PRINTF("invalid property %s for %s\n",
+				     prop->name, obj->node->name);
+	}
+
+	/* the DPMAC id is the id of the MAC it stands for */
+	if (error == 0 && strcmp(obj->type, "dpmac") == 0 && !has_mac_id)
+		error = add_arg(&args, "--mac-id=%u", obj->dpl_id);
+
+	if (error == 0)
+		error = add_arg(&args, "--container=dprc.%d", container_id);
+
+	if (error == 0)
+		error = run_create_command(&args, &obj->id);
+	if (error < 0)
+		ERROR_PRINTF("cannot create %s under dprc.%d\n",
+			     obj->node->name, container_id);
+
+	free_args(&args);
+
+	return error;
+}
+
+static int plug_object(uint16_t dprc_handle, int container_id,
+		       struct dpl_object *obj)
+{
+	struct dprc_res_req res_req;
+	int error;
+
+	memset(&res_req, 0, sizeof(res_req));
+	strcpy(res_req.type, obj->type);
+	res_req.num = 1;
+	res_req.options = DPRC_RES_REQ_OPT_EXPLICIT | DPRC_RES_REQ_OPT_PLUGGED;
+	res_req.id_base_align = obj->id;
+
+	error = dprc_assign(&restool.mc_io, 0, dprc_handle, container_id,
+			    &res_req);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("cannot plug %s.%d: MC error: %s (status %#x)\n",
+			     obj->type, obj->id,
+			     mc_status_to_string(mc_status), mc_status);
+	}
+
+	return error;
+}
+
+static void get_endpoint(struct dpl_plan *plan,
+			 const struct dpl_endpoint *endpoint,
+			 struct dprc_endpoint *dprc_endpoint)
+{
+	memset(dprc_endpoint, 0, sizeof(*dprc_endpoint));
+	strcpy(dprc_endpoint->type, endpoint->type);
+	dprc_endpoint->if_id = endpoint->if_id;
+	if (endpoint->object >= 0)
+		dprc_endpoint->id = plan->objects[endpoint->object].id;
+	else
+		dprc_endpoint->id = endpoint->id;
+}
+
+/*
+ * Tell whether two existing endpoints are connected to each other already
+ */
+static bool already_connected(const struct dprc_endpoint *endpoint1,
+			      const struct dprc_endpoint *endpoint2)
+{
+	struct dprc_endpoint peer;
+	int state;
+	int error;
+
+	memset(&peer, 0, sizeof(peer));
+	error = dprc_get_connection(&restool.mc_io, 0,
+				    restool.root_dprc_handle,
+				    endpoint1, &peer, &state);
+
+	return error == 0 && state != -1 &&
+	       strcmp(peer.type, endpoint2->type) == 0 &&
+	       peer.id == endpoint2->id && peer.if_id == endpoint2->if_id;
+}
+
+static int connect_endpoints(struct dpl_plan *plan,
+			     struct dpl_connection *connection)
+{
+	struct dprc_connection_cfg cfg = { 0 };
+	struct dprc_endpoint endpoint1;
+	struct dprc_endpoint endpoint2;
+	bool existing = true;
+	int error;
+
+	get_endpoint(plan, &connection->endpoints[0], &endpoint1);
+	get_endpoint(plan, &connection->endpoints[1], &endpoint2);
+
+	for (int i = 0; i < 2; i++) {
+		int object = connection->endpoints[i].object;
+
+		if (object >= 0 && plan->objects[object].action == DPL_CREATE)
+			existing = false;
+	}
+
+	if (existing && already_connected(&endpoint1, &endpoint2))
+		return 0;
+
+	error = dprc_connect(&restool.mc_io, 0, restool.root_dprc_handle,
+			     &endpoint1, &endpoint2, &cfg);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("cannot connect %s.%d to %s.%d: MC error: %s (status %#x)\n",
+			     endpoint1.type, endpoint1.id,
+			     endpoint2.type, endpoint2.id,
+			     mc_status_to_string(mc_status), mc_status);
+	}
+
+	return error;
+}
+
+static int open_container(int dprc_id, uint16_t *dprc_handle)
+{
+	if ((uint32_t)dprc_id == restool.root_dprc_id) {
+		*dprc_handle = restool.root_dprc_handle;
+		return 0;
+	}
+
+	return open_dprc(dprc_id, dprc_handle);
+}
+
+static int close_container(int dprc_id, uint16_t dprc_handle)
+{
+	int error;
+
+	if ((uint32_t)dprc_id == restool.root_dprc_id)
+		return 0;
+
+	error = dprc_close(&restool.mc_io, 0, dprc_handle);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			     mc_status_to_string(mc_status), mc_status);
+	}
+
+	return error;
+}
+
+/*
+ * Create and plug the objects to create, one container at a time so
+ * that each container is opened once
+ */
+static int create_container_objects(struct dpl_plan *plan, bool verbose)
+{
+	struct dpl_container *container;
+	struct dpl_object *obj;
+	bool opened = false;
+	uint16_t dprc_handle;
+	unsigned int i, j;
+	int error = 0;
+	int error2;
+
+	for (i = 0; i < plan->num_containers && error == 0; i++) {
+		container = &plan->containers[i];
+
+		for (j = 0; j < plan->num_objects && error == 0; j++) {
+			obj = &plan->objects[j];
+			if (obj->container != (int)i || obj->action != DPL_CREATE)
+				continue;
+
+			if (!opened) {
+				error = open_container(container->id,
+						       &dprc_handle);
+				if (error < 0)
+					return error;
+				opened = true;
+			}
+
+			error = create_object(plan, obj);
+			if (error == 0)
+				error = plug_object(dprc_handle, container->id,
+						    obj);
+			if (error == 0 && verbose) {
+				char parent[OBJ_TYPE_MAX_LENGTH + 16];
+
+				snprintf(parent, sizeof(parent), "dprc.%d",
+					 container->id);
+				print_new_obj(obj->type, obj->id, parent);
+			}
+		}
+
+		if (opened) {
+			error2 = close_container(container->id, dprc_handle);
+			if (error == 0)
+				error = error2;
+			opened = false;
+		}
+	}
+
+	return error;
+}
+
+static int apply_plan(struct dpl_plan *plan)
+{
+	int error;
+
+	for (unsigned int i = 0; i < plan->num_containers; i++) {
+		error = create_container(plan, i);
+		if (error < 0)
+			return error;
+	}
+
+	error = create_container_objects(plan, false);
+	if (error < 0)
+		return error;
+
+	for (unsigned int i = 0; i < plan->num_connections; i++) {
+		if (plan->connections[i].keep)
+			continue;
+
+		error = connect_endpoints(plan, &plan->connections[i]);
+		if (error < 0)
+			return error;
+	}
+
+	return 0;
+}
+
+static void print_created_objects(struct dpl_plan *plan)
+{
+	const char *indent = restool.script ? "" : "\t";
+	unsigned int i, j;
+
+	if (!restool.script)
+		printf("Created the following objects:\n");
+
+	for (i = 0; i < plan->num_containers; i++) {
+		struct dpl_container *container = &plan->containers[i];
+
+		if (container->action == DPL_CREATE && container->id >= 0)
+			printf("%sdprc.%d\n", indent, container->id);
+
+		for (j = 0; j < plan->num_objects; j++) {
+			struct dpl_object *obj = &plan->objects[j];
+
+			if (obj->container == (int)i &&
+			    obj->action == DPL_CREATE && obj->id >= 0)
+				printf("%s%s.%d\n", indent, obj->type, obj->id);
+		}
+	}
+}
+
+static int cmd_dpl_apply(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dpl apply <dpl-file>\n"
+		"\n"
+		"Creates the containers, objects and connections described by\n"
+		"<dpl-file>, a DPL in the DTS format written by\n"
+		"'restool dprc generate-dpl' or compiled to a DTB by dtc.\n"
+		"\n"
+		"NOTE:\n"
+		" -A container whose parent is \"none\" is the top of the DPL. It stands\n"
+		"  for the existing container with the same id (e.g. dprc.1 for\n"
+		"  \"dprc@1\") and its objects are not created.\n"
+		" -A parent or an endpoint the DPL does not define refers to an\n"
+		"  existing object: \"dprc@2\" is dprc.2 and \"dpmac@3\" is dpmac.3.\n"
+		" -The objects of the new containers are plugged once created.\n"
+		" -Connections already made between existing objects are left alone.\n"
+		" -If the DPL cannot be applied completely, the changes already made\n"
+		"  are undone.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"   $ restool dprc generate-dpl dprc.2 > dpl.dts\n"
+		"   $ restool dpl apply dpl.dts\n"
+		"\n";
+	struct dpl_plan plan = { 0 };
+	struct dpl_node *root = NULL;
+	bool rescan = restool.rescan;
+	bool journaled;
+	const char *path;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(APPLY_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(APPLY_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<dpl-file> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	path = restool.obj_name;
+	error = dpl_load(path, &root);
+	if (error < 0)
+		return error;
+
+	error = build_plan(root, &plan);
+	if (error < 0)
+		goto out;
+
+	/*
+	 * Journal the changes so that a DPL applied in part can be undone,
+	 * unless a batch transaction journals them already
+	 */
+	journaled = !restool.journal;
+	if (journaled)
+		journal_begin(&restool.mc_io, restool.root_dprc_handle);
+
+	/* the create commands run below must not rescan the bus each */
+	restool.rescan = false;
+	error = apply_plan(&plan);
+	restool.rescan = rescan;
+	restool.obj_name = path;
+
+	if (error < 0 && journaled) {
+		ERROR_PRINTF("undoing the changes made for %s\n", path);
+		if (journal_rollback() < 0)
+			ERROR_PRINTF("some changes made for %s could not be undone\n",
+				     path);
+		goto out;
+	}
+
+	if (journaled)
+		journal_commit();
+
+	print_created_objects(&plan);
+out:
+	free_plan(&plan);
+	dpl_free(root);
+
+	return error;
+}
+
+/*
+ * Tell whether the properties a target DPL gives to a container or an
+ * object match the live one. Properties the target leaves out or sets to
+ * zero are left to the defaults of the create commands and match anything.
+ */
+static bool same_props(const struct dpl_node *target,
+		       const struct dpl_node *live)
+{
+	const struct dpl_prop *prop;
+	const struct dpl_prop *live_prop;
+	bool all_zero;
+
+	if (!target)
+		return true;
+
+	for (prop = target->props; prop; prop = prop->next) {
+		if (strcmp(prop->name, "parent") == 0)
+			continue;
+
+		if (!dpl_prop_is_string(prop) &&
+		    prop->len % sizeof(uint32_t) == 0) {
+			all_zero = true;
+			for (unsigned int i = 0; i < dpl_prop_num_cells(prop);
+			     i++) {
+				if (dpl_prop_cell(prop, i) != 0)
+					all_zero = false;
+			}
+			if (all_zero)
+				continue;
+		}
+
+		live_prop = dpl_get_prop(live, prop->name);
+		if (!live_prop || live_prop->len != prop->len ||
+		    memcmp(live_prop->data, prop->data, prop->len) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Tell whether the live container 'match' can stand for the target
+ * container 'index': it is not taken yet, it is under the same parent and
+ * it has the same options
+ */
+static bool same_container(struct dpl_plan *target, struct dpl_plan *live,
+			   int index, int match)
+{
+	const struct dpl_container *container = &target->containers[index];
+	const struct dpl_container *live_container = &live->containers[match];
+	int parent = container->parent;
+
+	return live_container->match < 0 &&
+	       container->existing == live_container->existing &&
+	       (parent < 0 ||
+		(target->containers[parent].action == DPL_KEEP &&
+		 target->containers[parent].match == live_container->parent)) &&
+	       (container->existing ||
+		same_props(container->node, live_container->node));
+}
+
+/*
+ * A target container is kept if the live layout has it, under the same
+ * parent and with the same options. It is found by id or, since created
+ * containers get the ids the MC allocates, as a container left unmatched
+ * under the same parent with the same options. Containers cannot be moved
+ * nor reconfigured, the others are created.
+ */
+static void match_containers(struct dpl_plan *target, struct dpl_plan *live)
+{
+	struct dpl_container *container;
+	int max_depth = 0;
+	int match;
+
+	for (unsigned int i = 0; i < target->num_containers; i++) {
+		if (target->containers[i].depth > max_depth)
+			max_depth = target->containers[i].depth;
+	}
+
+	for (int depth = 0; depth <= max_depth; depth++) {
+		for (int by_id = 1; by_id >= 0; by_id--) {
+			for (unsigned int i = 0; i < target->num_containers;
+			     i++) {
+				container = &target->containers[i];
+				if (container->depth != depth ||
+				    container->match >= 0)
+					continue;
+
+				if (by_id) {
+					match = find_plan_container(live,
+							container->dpl_id);
+					if (match >= 0 &&
+					    !same_container(target, live, i,
+							    match))
+						match = -1;
+				} else {
+					match = -1;
+					for (unsigned int j = 0;
+					     j < live->num_containers &&
+					     !container->existing; j++) {
+						if (same_container(target, live,
+								   i, j)) {
+							match = j;
+							break;
+						}
+					}
+				}
+
+				if (match < 0)
+					continue;
+
+				container->action = DPL_KEEP;
+				container->match = match;
+				container->id = live->containers[match].id;
+				live->containers[match].match = i;
+			}
+		}
+	}
+}
+
+/*
+ * Tell whether a moved object goes from its live container down to a
+ * child container (dprc assign) rather than up to the parent container
+ * (dprc unassign)
+ */
+static bool move_is_assign(struct dpl_plan *target, struct dpl_plan *live,
+			   const struct dpl_object *obj)
+{
+	int src = live->objects[obj->match].container;
+	int parent = target->containers[obj->container].parent;
+
+	return parent >= 0 && target->containers[parent].action == DPL_KEEP &&
+	       target->containers[parent].match == src;
+}
+
+/*
+ * A target object is kept if the live layout has it, in the same
+ * container and with the same properties. Objects found in the parent
+ * or in a child container are moved. Since created objects get the ids
+ * the MC allocates, an object not found by id is also kept if its
+ * container has an object of the same type and properties left unmatched.
+ * All the others are created.
+ */
+static int match_objects(struct dpl_plan *target, struct dpl_plan *live)
+{
+	struct dpl_container *container;
+	struct dpl_object *live_obj;
+	struct dpl_object *obj;
+	int src;
+
+	for (unsigned int i = 0; i < target->num_objects; i++) {
+		obj = &target->objects[i];
+		container = &target->containers[obj->container];
+		obj->action = DPL_CREATE;
+		obj->match = -1;
+		obj->id = -1;
+
+		live_obj = find_plan_object(live, obj->type, obj->dpl_id);
+		if (!live_obj || !same_props(obj->node, live_obj->node))
+			continue;
+
+		src = live_obj->container;
+		if (container->action == DPL_KEEP && container->match == src)
+			obj->action = DPL_KEEP;
+		else if (move_is_assign(target, live, obj) ||
+			 (container->action == DPL_KEEP &&
+			  live->containers[src].parent == container->match))
+			obj->action = DPL_MOVE;
+		else
+			continue;
+
+		obj->match = live_obj - live->objects;
+		obj->id = live_obj->id;
+		live_obj->match = i;
+	}
+
+	for (unsigned int i = 0; i < target->num_objects; i++) {
+		obj = &target->objects[i];
+		container = &target->containers[obj->container];
+		if (obj->action != DPL_CREATE || !obj->node ||
+		    container->action != DPL_KEEP)
+			continue;
+
+		for (unsigned int j = 0; j < live->num_objects; j++) {
+			live_obj = &live->objects[j];
+			if (live_obj->match >= 0 ||
+			    live_obj->container != container->match ||
+			    strcmp(live_obj->type, obj->type) != 0 ||
+			    !same_props(obj->node, live_obj->node))
+				continue;
+
+			obj->action = DPL_KEEP;
+			obj->match = j;
+			obj->id = live_obj->id;
+			live_obj->match = i;
+			break;
+		}
+	}
+
+	for (unsigned int i = 0; i < target->num_objects; i++) {
+		obj = &target->objects[i];
+		if (obj->action == DPL_CREATE && !obj->node) {
+			ERROR_PRINTF("%s@%u was not defined in /objects\n",
+				     obj->type, obj->dpl_id);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static bool same_endpoint(const struct dprc_endpoint *endpoint1,
+			  const struct dprc_endpoint *endpoint2)
+{
+	return strcmp(endpoint1->type, endpoint2->type) == 0 &&
+	       endpoint1->id == endpoint2->id &&
+	       endpoint1->if_id == endpoint2->if_id;
+}
+
+/*
+ * A target connection is kept if both its ends exist already and the
+ * live layout already connects them. Ends are compared by their ids in
+ * the MC, which differ from the DPL ids of the objects matched by
+ * properties.
+ */
+static void match_connections(struct dpl_plan *target, struct dpl_plan *live)
+{
+	struct dpl_connection *connection;
+	struct dpl_connection *live_conn;
+	struct dprc_endpoint endpoints[2];
+	struct dprc_endpoint live_endpoints[2];
+	struct dpl_endpoint *ep;
+	bool stable;
+
+	for (unsigned int i = 0; i < target->num_connections; i++) {
+		connection = &target->connections[i];
+		stable = true;
+		for (int j = 0; j < 2; j++) {
+			ep = &connection->endpoints[j];
+			if (ep->object >= 0 &&
+			    target->objects[ep->object].action == DPL_CREATE)
+				stable = false;
+			get_endpoint(target, ep, &endpoints[j]);
+		}
+		if (!stable)
+			continue;
+
+		for (unsigned int j = 0; j < live->num_connections; j++) {
+			live_conn = &live->connections[j];
+			if (live_conn->keep)
+				continue;
+
+			get_endpoint(live, &live_conn->endpoints[0],
+				     &live_endpoints[0]);
+			get_endpoint(live, &live_conn->endpoints[1],
+				     &live_endpoints[1]);
+			if ((same_endpoint(&endpoints[0], &live_endpoints[0]) &&
+			     same_endpoint(&endpoints[1], &live_endpoints[1])) ||
+			    (same_endpoint(&endpoints[0], &live_endpoints[1]) &&
+			     same_endpoint(&endpoints[1], &live_endpoints[0]))) {
+				connection->keep = true;
+				live_conn->keep = true;
+				break;
+			}
+		}
+	}
+}
+
+static void endpoint_name(struct dpl_plan *plan,
+			  const struct dpl_endpoint *endpoint,
+			  char *name, size_t size)
+{
+	const struct dpl_object *obj = NULL;
+	int n;
+
+	if (endpoint->object >= 0)
+		obj = &plan->objects[endpoint->object];
+
+	if (obj && obj->id < 0)
+		n = snprintf(name, size, "%s@%u", obj->type, obj->dpl_id);
+	else
+		n = snprintf(name, size, "%s.%u", endpoint->type,
+			     obj ? (uint32_t)obj->id : endpoint->id);
+
+	if (endpoint->if_id != 0 && n > 0 && (size_t)n < size)
+		snprintf(name + n, size - n, ".%u", endpoint->if_id);
+}
+
+static void container_name(struct dpl_plan *plan, int index,
+			   char *name, size_t size)
+{
+	const struct dpl_container *container = &plan->containers[index];
+
+	if (container->id < 0)
+		snprintf(name, size, "dprc@%u", container->dpl_id);
+	else
+		snprintf(name, size, "dprc.%d", container->id);
+}
+
+/*
+ * Run a destroy command in this process, on the MC portal already opened
+ */
+static int run_destroy_command(const char *type, uint32_t id)
+{
+	struct dpl_args args = { 0 };
+	int error;
+
+	error = add_arg(&args, "restool");
+	if (error == 0)
+		error = add_arg(&args, "%s", type);
+	if (error == 0)
+		error = add_arg(&args, "destroy");
+	if (error == 0)
+		error = add_arg(&args, "%s.%u", type, id);
+	if (error == 0)
+		error = restool_execute(args.argc, args.argv);
+
+	free_args(&args);
+
+	return error;
+}
+
+static int reconcile_disconnect(struct dpl_plan *live, bool dry_run,
+				unsigned int *num_ops)
+{
+	struct dpl_connection *connection;
+	struct dprc_endpoint endpoint;
+	char name1[OBJ_TYPE_MAX_LENGTH + 32];
+	char name2[OBJ_TYPE_MAX_LENGTH + 32];
+	int error;
+
+	for (unsigned int i = 0; i < live->num_connections; i++) {
+		connection = &live->connections[i];
+		if (connection->keep)
+			continue;
+
+		(*num_ops)++;
+		endpoint_name(live, &connection->endpoints[0],
+			      name1, sizeof(name1));
+		endpoint_name(live, &connection->endpoints[1],
+			      name2, sizeof(name2));
+		if (dry_run) {
+			printf("disconnect %s from %s\n", name1, name2);
+			continue;
+		}
+
+		get_endpoint(live, &connection->endpoints[0], &endpoint);
+		error = dprc_disconnect(&restool.mc_io, 0,
+					restool.root_dprc_handle, &endpoint);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("cannot disconnect %s: MC error: %s (status %#x)\n",
+				     name1, mc_status_to_string(mc_status),
+				     mc_status);
+			return error;
+		}
+		printf("%s is disconnected from %s\n", name1, name2);
+	}
+
+	return 0;
+}
+
+static int reconcile_destroy_objects(struct dpl_plan *live, bool dry_run,
+				     unsigned int *num_ops)
+{
+	struct dpl_object *obj;
+	int error;
+
+	for (unsigned int i = 0; i < live->num_objects; i++) {
+		obj = &live->objects[i];
+		if (obj->match >= 0)
+			continue;
+
+		(*num_ops)++;
+		if (dry_run) {
+			printf("destroy %s.%u\n", obj->type, obj->dpl_id);
+			continue;
+		}
+
+		error = run_destroy_command(obj->type, obj->dpl_id);
+		if (error < 0)
+			return error;
+	}
+
+	return 0;
+}
+
+static int reconcile_create_containers(struct dpl_plan *target, bool dry_run,
+				       unsigned int *num_ops)
+{
+	struct dpl_container *container;
+	char parent[OBJ_TYPE_MAX_LENGTH + 16];
+	int max_depth = 0;
+	int error;
+
+	for (unsigned int i = 0; i < target->num_containers; i++) {
+		if (target->containers[i].depth > max_depth)
+			max_depth = target->containers[i].depth;
+	}
+
+	for (int depth = 0; depth <= max_depth; depth++) {
+		for (unsigned int i = 0; i < target->num_containers; i++) {
+			container = &target->containers[i];
+			if (container->depth != depth ||
+			    container->action != DPL_CREATE)
+				continue;
+
+			(*num_ops)++;
+			container_name(target, container->parent,
+				       parent, sizeof(parent));
+			if (dry_run) {
+				printf("create dprc@%u under %s\n",
+				       container->dpl_id, parent);
+				continue;
+			}
+
+			error = create_container(target, i);
+			if (error < 0)
+				return error;
+			print_new_obj("dprc", container->id, parent);
+		}
+	}
+
+	return 0;
+}
+
+static int move_object(struct dpl_plan *target, struct dpl_plan *live,
+		       struct dpl_object *obj)
+{
+	int src_id = live->containers[live->objects[obj->match].container].id;
+	int dst_id = target->containers[obj->container].id;
+	struct dprc_res_req res_req;
+	uint16_t src_handle;
+	uint16_t dst_handle;
+	char name[OBJ_TYPE_MAX_LENGTH + 16];
+	int error;
+	int error2;
+
+	snprintf(name, sizeof(name), "%s.%d", obj->type, obj->id);
+	if (in_use(name, "moved"))
+		return -EBUSY;
+
+	memset(&res_req, 0, sizeof(res_req));
+	strcpy(res_req.type, obj->type);
+	res_req.num = 1;
+	res_req.id_base_align = obj->id;
+
+	error = open_container(src_id, &src_handle);
+	if (error < 0)
+		return error;
+
+	/* plugged objects cannot be moved */
+	res_req.options = DPRC_RES_REQ_OPT_EXPLICIT;
+	error = dprc_assign(&restool.mc_io, 0, src_handle, src_id, &res_req);
+	if (error == 0 && move_is_assign(target, live, obj)) {
+		res_req.options |= DPRC_RES_REQ_OPT_PLUGGED;
+		error = dprc_assign(&restool.mc_io, 0, src_handle, dst_id,
+				    &res_req);
+	} else if (error == 0) {
+		error = open_container(dst_id, &dst_handle);
+		if (error == 0) {
+			error = dprc_unassign(&restool.mc_io, 0, dst_handle,
+					      src_id, &res_req);
+			if (error == 0)
+				error = plug_object(dst_handle, dst_id, obj);
+			error2 = close_container(dst_id, dst_handle);
+			if (error == 0)
+				error = error2;
+		}
+	}
+
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("cannot move %s: MC error: %s (status %#x)\n",
+			     name, mc_status_to_string(mc_status), mc_status);
+	}
+
+	error2 = close_container(src_id, src_handle);
+	if (error == 0)
+		error = error2;
+
+	return error;
+}
+
+static int reconcile_move_objects(struct dpl_plan *target,
+				  struct dpl_plan *live, bool dry_run,
+				  unsigned int *num_ops)
+{
+	struct dpl_object *obj;
+	char src[OBJ_TYPE_MAX_LENGTH + 16];
+	char dst[OBJ_TYPE_MAX_LENGTH + 16];
+	int error;
+
+	for (unsigned int i = 0; i < target->num_objects; i++) {
+		obj = &target->objects[i];
+		if (obj->action != DPL_MOVE)
+			continue;
+
+		(*num_ops)++;
+		container_name(live, live->objects[obj->match].container,
+			       src, sizeof(src));
+		container_name(target, obj->container, dst, sizeof(dst));
+		if (dry_run) {
+			printf("move %s.%d from %s to %s\n",
+			       obj->type, obj->id, src, dst);
+			continue;
+		}
+
+		error = move_object(target, live, obj);
+		if (error < 0)
+			return error;
+		printf("%s.%d is moved to %s\n", obj->type, obj->id, dst);
+	}
+
+	return 0;
+}
+
+/*
+ * Destroy the live containers the target DPL does not keep, children
+ * first. Their objects are destroyed or moved out already.
+ */
+static int reconcile_destroy_containers(struct dpl_plan *live, bool dry_run,
+					unsigned int *num_ops)
+{
+	struct dpl_container *container;
+	int max_depth = 0;
+	int error;
+
+	for (unsigned int i = 0; i < live->num_containers; i++) {
+		if (live->containers[i].depth > max_depth)
+			max_depth = live->containers[i].depth;
+	}
+
+	for (int depth = max_depth; depth >= 0; depth--) {
+		for (unsigned int i = 0; i < live->num_containers; i++) {
+			container = &live->containers[i];
+			if (container->depth != depth || container->match >= 0)
+				continue;
+
+			(*num_ops)++;
+			if (dry_run) {
+				printf("destroy dprc.%u\n", container->dpl_id);
+				continue;
+			}
+
+			error = run_destroy_command("dprc", container->dpl_id);
+			if (error < 0)
+				return error;
+		}
+	}
+
+	return 0;
+}
+
+static int reconcile_create_objects(struct dpl_plan *target, bool dry_run,
+				    unsigned int *num_ops)
+{
+	struct dpl_object *obj;
+	char parent[OBJ_TYPE_MAX_LENGTH + 16];
+	unsigned int num = 0;
+
+	for (unsigned int i = 0; i < target->num_objects; i++) {
+		obj = &target->objects[i];
+		if (obj->action != DPL_CREATE)
+			continue;
+
+		num++;
+		if (dry_run) {
+			container_name(target, obj->container,
+				       parent, sizeof(parent));
+			printf("create %s@%u under %s\n",
+			       obj->type, obj->dpl_id, parent);
+		}
+	}
+
+	*num_ops += num;
+	if (dry_run || num == 0)
+		return 0;
+
+	return create_container_objects(target, true);
+}
+
+static int reconcile_connect(struct dpl_plan *target, bool dry_run,
+			     unsigned int *num_ops)
+{
+	struct dpl_connection *connection;
+	char name1[OBJ_TYPE_MAX_LENGTH + 32];
+	char name2[OBJ_TYPE_MAX_LENGTH + 32];
+	int error;
+
+	for (unsigned int i = 0; i < target->num_connections; i++) {
+		connection = &target->connections[i];
+		if (connection->keep)
+			continue;
+
+		(*num_ops)++;
+		endpoint_name(target, &connection->endpoints[0],
+			      name1, sizeof(name1));
+		endpoint_name(target, &connection->endpoints[1],
+			      name2, sizeof(name2));
+		if (dry_run) {
+			printf("connect %s to %s\n", name1, name2);
+			continue;
+		}
+
+		error = connect_endpoints(target, connection);
+		if (error < 0)
+			return error;
+		printf("%s is connected to %s\n", name1, name2);
+	}
+
+	return 0;
+}
+
+/*
+ * Snapshot the live container tree rooted at dprc.<dprc_id>, the same way
+ * 'dprc generate-dpl' does
+ */
+static int load_live_layout(uint32_t dprc_id, struct dpl_node **root)
+{
+	size_t size = 0;
+	char *buf = NULL;
+	int error;
+	FILE *fp;
+
+	fp = open_memstream(&buf, &size);
+	if (!fp)
+		return -ENOMEM;
+
+	error = dpl_generate_to(fp, dprc_id);
+	if (fclose(fp) != 0 && error == 0)
+		error = -ENOMEM;
+
+	if (error == 0)
+		error = dpl_parse("live layout", (uint8_t *)buf, size, root);
+
+	free(buf);
+
+	return error;
+}
+
+/*
+ * Compare the target DPL with the live layout and run, or only print with
+ * --dry-run, the operations converging the live layout to the target, in
+ * an order the MC accepts: connections and objects go away before the
+ * containers holding them, containers are created before their objects
+ * and objects before their connections.
+ */
+static int reconcile(struct dpl_plan *target, struct dpl_plan *live,
+		     bool dry_run, unsigned int *num_ops)
+{
+	int error;
+
+	match_containers(target, live);
+	error = match_objects(target, live);
+	if (error < 0)
+		return error;
+	match_connections(target, live);
+
+	error = reconcile_disconnect(live, dry_run, num_ops);
+	if (error == 0)
+		error = reconcile_destroy_objects(live, dry_run, num_ops);
+	if (error == 0)
+		error = reconcile_create_containers(target, dry_run, num_ops);
+	if (error == 0)
+		error = reconcile_move_objects(target, live, dry_run, num_ops);
+	if (error == 0)
+		error = reconcile_destroy_containers(live, dry_run, num_ops);
+	if (error == 0)
+		error = reconcile_create_objects(target, dry_run, num_ops);
+	if (error == 0)
+		error = reconcile_connect(target, dry_run, num_ops);
+
+	return error;
+}
+
+static int cmd_dpl_reconcile(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dpl reconcile <dpl-file> [--dry-run]\n"
+		"\n"
+		"Converges the live layout to <dpl-file> with the fewest MC operations:\n"
+		"objects and connections the DPL does not describe are removed, the\n"
+		"missing ones are created and the objects found in the parent or in a\n"
+		"child container are moved. Objects already in place are untouched.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--dry-run\n"
+		"   Only prints the operations, without changing the layout.\n"
+		"\n"
+		"NOTE:\n"
+		" -The container whose parent is \"none\" is the top of the DPL. The\n"
+		"  container tree rooted at it is compared with the DPL, the rest of\n"
+		"  the layout is left alone.\n"
+		" -Objects are matched by type and id. The properties the DPL leaves\n"
+		"  out or sets to 0 are not compared. Objects whose properties differ\n"
+		"  are destroyed and created again, since they cannot be changed.\n"
+		" -Created containers and objects get the ids the MC allocates, not\n"
+		"  the ids of the DPL. A container or an object not found by id\n"
+		"  matches one left unmatched in the same place with the same type\n"
+		"  and properties, so that reconciling again with the same DPL finds\n"
+		"  the layout already matches.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"   $ restool dprc generate-dpl dprc.2 > dpl.dts\n"
+		"   (edit dpl.dts)\n"
+		"   $ restool dpl reconcile dpl.dts --dry-run\n"
+		"   $ restool dpl reconcile dpl.dts\n"
+		"\n";
+	struct dpl_plan target = { 0 };
+	struct dpl_plan live = { 0 };
+	struct dpl_node *target_root = NULL;
+	struct dpl_node *live_root = NULL;
+	bool rescan = restool.rescan;
+	unsigned int num_ops = 0;
+	bool dry_run = false;
+	int top = -1;
+	const char *path;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECONCILE_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECONCILE_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECONCILE_OPT_DRY_RUN)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECONCILE_OPT_DRY_RUN);
+		dry_run = true;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<dpl-file> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	path = restool.obj_name;
+	error = dpl_load(path, &target_root);
+	if (error < 0)
+		return error;
+
+	error = build_plan(target_root, &target);
+	if (error < 0)
+		goto out;
+
+	for (unsigned int i = 0; i < target.num_containers; i++) {
+		if (target.containers[i].existing) {
+			if (top >= 0) {
+				ERROR_PRINTF("%s has more than one container whose parent is \"none\"\n",
+					     path);
+				error = -EINVAL;
+				goto out;
+			}
+			top = i;
+		} else if (target.containers[i].parent < 0) {
+			ERROR_PRINTF("%s: the parent of %s is not in the DPL\n",
+				     path, target.containers[i].node->name);
+			error = -EINVAL;
+			goto out;
+		}
+	}
+
+	if (top < 0) {
+		ERROR_PRINTF("%s has no container whose parent is \"none\"\n",
+			     path);
+		error = -EINVAL;
+		goto out;
+	}
+
+	error = load_live_layout(target.containers[top].dpl_id, &live_root);
+	if (error == 0)
+		error = build_plan(live_root, &live);
+	if (error < 0) {
+		ERROR_PRINTF("cannot read the layout of dprc.%u\n",
+			     target.containers[top].dpl_id);
+		goto out;
+	}
+
+	/* everything in the live layout exists already */
+	for (unsigned int i = 0; i < live.num_containers; i++)
+		live.containers[i].id = live.containers[i].dpl_id;
+	for (unsigned int i = 0; i < live.num_objects; i++)
+		live.objects[i].id = live.objects[i].dpl_id;
+
+	/* the commands run below must not rescan the bus each */
+	restool.rescan = false;
+	error = reconcile(&target, &live, dry_run, &num_ops);
+	restool.rescan = rescan;
+	restool.obj_name = path;
+
+	if (error == 0 && num_ops == 0)
+		printf("the layout already matches %s\n", path);
+	else if (error == 0 && dry_run)
+		printf("%u operation(s)\n", num_ops);
+out:
+	free_plan(&target);
+	free_plan(&live);
+	dpl_free(target_root);
+	dpl_free(live_root);
+
+	return error;
+}
+
+/*
+ * Turn the plan of the live container tree of the container to clone into
+ * the plan of a copy under dprc.<parent_id>: every container and object
+ * is to be created. DPMACs stand for physical MACs and cannot be copied,
+ * they are left out with their connections, as are the connections to
+ * objects outside of the tree. The copied objects come out plugged.
+ *
+ * Returns the index of the top container of the copy
+ */
+static int plan_clone(struct dpl_plan *plan, uint32_t parent_id)
+{
+	unsigned int num_skipped = 0;
+	int top = 0;
+
+	for (unsigned int i = 0; i < plan->num_containers; i++) {
+		struct dpl_container *container = &plan->containers[i];
+
+		container->action = DPL_CREATE;
+		container->id = -1;
+		if (container->existing) {
+			container->existing = false;
+			container->parent = -1;
+			container->parent_id = parent_id;
+			top = i;
+		}
+	}
+
+	for (unsigned int i = 0; i < plan->num_objects; i++) {
+		struct dpl_object *obj = &plan->objects[i];
+
+		obj->id = -1;
+		if (strcmp(obj->type, "dpmac") == 0) {
+			obj->action = DPL_KEEP;
+			ERROR_PRINTF("dpmac.%u is not cloned\n", obj->dpl_id);
+		} else {
+			obj->action = DPL_CREATE;
+		}
+	}
+
+	for (unsigned int i = 0; i < plan->num_connections; i++) {
+		struct dpl_connection *connection = &plan->connections[i];
+
+		for (int j = 0; j < 2; j++) {
+			int object = connection->endpoints[j].object;
+
+			if (object < 0 ||
+			    plan->objects[object].action != DPL_CREATE)
+				connection->keep = true;
+		}
+
+		if (connection->keep)
+			num_skipped++;
+	}
+
+	if (num_skipped != 0)
+		ERROR_PRINTF("%u connection(s) to DPMACs or out of the container tree are not cloned\n",
+			     num_skipped);
+
+	return top;
+}
+
+/*
+ * Forget the ids of the containers and objects created for the previous
+ * copy
+ */
+static void reset_clone(struct dpl_plan *plan)
+{
+	for (unsigned int i = 0; i < plan->num_containers; i++)
+		plan->containers[i].id = -1;
+	for (unsigned int i = 0; i < plan->num_objects; i++)
+		plan->objects[i].id = -1;
+}
+
+/**
+ * Create 'count' copies of the container tree rooted at dprc.<dprc_id>
+ * under dprc.<parent_dprc_id>. The tree and the attributes of its objects
+ * are read once, the way 'dprc generate-dpl' does, and every copy is
+ * created from the same plan.
+ */
+int dpl_clone(uint32_t dprc_id, uint32_t parent_dprc_id, unsigned int count)
+{
+	char parent[OBJ_TYPE_MAX_LENGTH + 16];
+	struct dpl_plan plan = { 0 };
+	struct dpl_node *root = NULL;
+	bool rescan = restool.rescan;
+	const char *obj_name = restool.obj_name;
+	unsigned int num_created = 0;
+	bool journaled;
+	int error;
+	int top;
+
+	error = load_live_layout(dprc_id, &root);
+	if (error == 0)
+		error = build_plan(root, &plan);
+	if (error < 0) {
+		ERROR_PRINTF("cannot read the layout of dprc.%u\n", dprc_id);
+		goto out;
+	}
+
+	top = plan_clone(&plan, parent_dprc_id);
+	snprintf(parent, sizeof(parent), "dprc.%u", parent_dprc_id);
+
+	/* the create commands run below must not rescan the bus each */
+	restool.rescan = false;
+	for ( ; num_created < count; num_created++) {
+		if (daemon_interrupted()) {
+			ERROR_PRINTF("interrupted\n");
+			error = -EINTR;
+			break;
+		}
+
+		/*
+		 * Journal each copy so that a copy created in part can be
+		 * undone, unless a batch transaction journals it already
+		 */
+		journaled = !restool.journal;
+		if (journaled)
+			journal_begin(&restool.mc_io, restool.root_dprc_handle);
+
+		reset_clone(&plan);
+		error = apply_plan(&plan);
+		if (error < 0 && journaled) {
+			ERROR_PRINTF("undoing the copy of dprc.%u\n", dprc_id);
+			if (journal_rollback() < 0)
+				ERROR_PRINTF("some changes made for the copy of dprc.%u could not be undone\n",
+					     dprc_id);
+		}
+		if (error < 0)
+			break;
+
+		if (journaled)
+			journal_commit();
+
+		print_new_obj("dprc", plan.containers[top].id, parent);
+	}
+	restool.rescan = rescan;
+	restool.obj_name = obj_name;
+
+	if (error < 0 && count > 1)
+		ERROR_PRINTF("%u of %u copies of dprc.%u created\n",
+			     num_created, count, dprc_id);
+out:
+	free_plan(&plan);
+	dpl_free(root);
+
+	return error;
+}
+
+struct object_command dpl_commands[] = {
+	{ .cmd_name = "help",
+	  .options = NULL,
+	  .cmd_func = cmd_dpl_help },
+
+	{ .cmd_name = "apply",
+	  .options = dpl_apply_options,
+	  .cmd_func = cmd_dpl_apply },
+
+	{ .cmd_name = "reconcile",
+	  .options = dpl_reconcile_options,
+	  .cmd_func = cmd_dpl_reconcile },
+
+	{ .cmd_name = NULL },
+};
@@ -129,11 +129,56 @@ static struct option dpmac_destroy_options[] = {
 
 C_ASSERT(ARRAY_SIZE(dpmac_destroy_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 
+/**
+ * dpmac stats command options
+ */
+enum dpmac_stats_options {
+	STATS_OPT_HELP = 0,
+	STATS_OPT_COUNTERS,
+	STATS_OPT_INTERVAL,
+	STATS_OPT_COUNT,
+};
+
+static struct option dpmac_stats_options[] = {
+	[STATS_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[STATS_OPT_COUNTERS] = {
+		.name = "counters",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[STATS_OPT_INTERVAL] = {
+		.name = "interval",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[STATS_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dpmac_stats_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
 const struct flib_ops dpmac_ops = {
 	.obj_open = dpmac_open_v10,
 	.obj_close = dpmac_close_v10,
 	.obj_get_irq_mask = dpmac_get_irq_mask_v10,
 	.obj_get_irq_status = dpmac_get_irq_status_v10,
+	.obj_destroy = dpmac_destroy_v10,
 };
 
 static int cmd_dpmac_help(void)
@@ -145,6 +190,7 @@ static int cmd_dpmac_help(void)
 		"   info - displays detailed information about a DPMAC object.\n"
 		"   create - creates a new child DPMAC under the root DPRC.\n"
 		"   destroy - destroys a child DPMAC under the root DPRC.\n"
+		"   stats - displays the counters of DPMAC objects, or their rates.\n"
 		"\n"
 		"For command-specific help, use the --help option of each command.\n"
 		"\n";
@@ -271,66 +317,32 @@ static void print_dpmac_eth_if(enum dpmac_eth_if eth_if)
 	}
 }
 
-#define ETH_GSTRING_LEN		32
-
-static struct {
-	enum dpmac_counter id;
-	char name[ETH_GSTRING_LEN];
-} dpaa2_mac_counters[] =  {
-	{DPMAC_CNT_ING_ALL_FRAME,		"rx all frames"},
-	{DPMAC_CNT_ING_GOOD_FRAME,		"rx frames ok"},
-	{DPMAC_CNT_ING_ERR_FRAME,		"rx frame errors"},
-	{DPMAC_CNT_ING_FRAME_DISCARD,		"rx frame discards"},
-	{DPMAC_CNT_ING_UCAST_FRAME,		"rx u-cast"},
-	{DPMAC_CNT_ING_BCAST_FRAME,		"rx b-cast"},
-	{DPMAC_CNT_ING_MCAST_FRAME,		"rx m-cast"},
-	{DPMAC_CNT_ING_FRAME_64,		"rx 64 bytes"},
-	{DPMAC_CNT_ING_FRAME_127,		"rx 65-127 bytes"},
-	{DPMAC_CNT_ING_FRAME_255,		"rx 128-255 bytes"},
-	{DPMAC_CNT_ING_FRAME_511,		"rx 256-511 bytes"},
-	{DPMAC_CNT_ING_FRAME_1023,		"rx 512-1023 bytes"},
-	{DPMAC_CNT_ING_FRAME_1518,		"rx 1024-1518 bytes"},
-	{DPMAC_CNT_ING_FRAME_1519_MAX,		"rx 1519-max bytes"},
-	{DPMAC_CNT_ING_FRAG,			"rx frags"},
-	{DPMAC_CNT_ING_JABBER,			"rx jabber"},
-	{DPMAC_CNT_ING_ALIGN_ERR,		"rx align errors"},
-	{DPMAC_CNT_ING_OVERSIZED,		"rx oversized"},
-	{DPMAC_CNT_ING_VALID_PAUSE_FRAME,	"rx pause"},
-	{DPMAC_CNT_ING_BYTE,			"rx bytes"},
-	{DPMAC_CNT_ENG_GOOD_FRAME,		"tx frames ok"},
-	{DPMAC_CNT_EGR_UCAST_FRAME,		"tx u-cast"},
-	{DPMAC_CNT_EGR_MCAST_FRAME,		"tx m-cast"},
-	{DPMAC_CNT_EGR_BCAST_FRAME,		"tx b-cast"},
-	{DPMAC_CNT_EGR_ERR_FRAME,		"tx frame errors"},
-	{DPMAC_CNT_EGR_UNDERSIZED,		"tx undersized"},
-	{DPMAC_CNT_EGR_VALID_PAUSE_FRAME,	"tx b-pause"},
-	{DPMAC_CNT_EGR_BYTE,			"tx bytes"},
-
-};
-
-static int print_dpmac_counters(struct fsl_mc_io *mc_io, uint16_t token)
+/*
+ * Read the counters once, on the DPMAC already open for 'dpmac info'
+ */
+static int print_dpmac_counters(uint32_t dpmac_id, uint16_t dpmac_handle)
 {
-	uint64_t counter_value;
-	unsigned i;
+	struct counter_set set = { 0 };
+	struct counter_obj *obj;
 	int error;
 
-	printf("Counters: \n");
-	for (i = 0; i < ARRAY_SIZE(dpaa2_mac_counters); i++) {
-		error = dpmac_get_counter_v10(mc_io,
-					    0,
-					    token,
-					    dpaa2_mac_counters[i].id, &counter_value);
-		if (error < 0) {
-			mc_status = flib_error_to_mc_status(error);
-			ERROR_PRINTF("MC error: %s (status %#x)\n",
-				     mc_status_to_string(mc_status), mc_status);
-			return error;
-		}
+	error = counters_add(&set, "dpmac", dpmac_id, NULL);
+	if (error < 0)
+		goto out;
 
-		printf("%s: %lu\n", dpaa2_mac_counters[i].name, counter_value);
-	}
+	error = counters_read_open(&set, &dpmac_handle);
+	if (error < 0)
+		goto out;
 
-	return 0;
+	obj = &set.objs[0];
+	printf("Counters: \n");
+	for (unsigned int i = 0; i < obj->num_counters; i++)
+		printf("%s: %lu\n", obj->counters[i]->name,
+		       (unsigned long)obj->values[i]);
+
+out:
+	counters_free(&set);
+	return error;
 }
 
 #define MAC_ADDR_LEN	6
@@ -477,7 +489,7 @@ static int print_dpmac_attr_v10(uint32_t dpmac_id,
 	printf("maximum supported rate %lu Mbps\n",
 			(unsigned long)dpmac_attr.max_rate);
 	print_obj_label(target_obj_desc);
-	print_dpmac_counters(&restool.mc_io, dpmac_handle);
+	print_dpmac_counters(dpmac_id, dpmac_handle);
 
 	error = 0;
 
@@ -891,6 +903,259 @@ static int cmd_dpmac_destroy_v10(void)
 	return destroy_dpmac(MC_FW_VERSION_10);
 }
 
+/*
+ * Width of the columns of the rates of a counter
+ */
+#define DPMAC_RATE_WIDTH	12
+
+/**
+ * Add to 'set' the DPMACs of the command line: a comma separated list of
+ * DPMAC objects, or all the DPMACs of the container tree for "all"
+ */
+static int add_dpmac_stats_objs(struct counter_set *set, const char *names)
+{
+	struct walk_result walk;
+	char obj_name[OBJ_TYPE_MAX_LENGTH + 12];
+	uint32_t dpmac_id;
+	int error;
+
+	if (strcmp(restool.obj_name, "all") == 0) {
+		error = walk_containers(restool.root_dprc_id,
+					restool.root_dprc_handle, 0, &walk);
+		for (unsigned int i = 0;
+		     error == 0 && i < walk.num_containers; i++) {
+			struct walk_container *container = &walk.containers[i];
+
+			for (int j = 0; error == 0 && j < container->num_objs;
+			     j++) {
+				if (strcmp(container->objs[j].type, "dpmac"))
+					continue;
+
+				error = counters_add(set, "dpmac",
+						     container->objs[j].id,
+						     names);
+			}
+		}
+		walk_free(&walk);
+
+		if (error == 0 && set->num_objs == 0) {
+			ERROR_PRINTF("No DPMAC found\n");
+			error = -ENOENT;
+		}
+
+		return error;
+	}
+
+	for (const char *name = restool.obj_name; *name != '\0'; ) {
+		size_t len = strcspn(name, ",");
+
+		if (len >= sizeof(obj_name)) {
+			ERROR_PRINTF("Invalid object name: %.*s\n",
+				     (int)len, name);
+			return -EINVAL;
+		}
+
+		memcpy(obj_name, name, len);
+		obj_name[len] = '\0';
+		error = parse_object_name(obj_name, "dpmac", &dpmac_id);
+		if (error < 0)
+			return error;
+
+		error = counters_add(set, "dpmac", dpmac_id, names);
+		if (error < 0)
+			return error;
+
+		name += len;
+		if (*name == ',')
+			name++;
+	}
+
+	return 0;
+}
+
+static void print_dpmac_stats(const struct counter_set *set)
+{
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		const struct counter_obj *obj = &set->objs[i];
+
+		if (set->num_objs > 1)
+			printf("%sdpmac.%u:\n", i ? "\n" : "", obj->id);
+
+		for (unsigned int c = 0; c < obj->num_counters; c++)
+			printf("%s: %lu\n", obj->counters[c]->name,
+			       (unsigned long)obj->values[c]);
+	}
+}
+
+static int dpmac_rate_width(const struct counter_desc *counter)
+{
+	int len = strlen(counter->name);
+
+	return len > DPMAC_RATE_WIDTH ? len : DPMAC_RATE_WIDTH;
+}
+
+/*
+ * All the objects of a set sample the same counters: the header of the
+ * first object is the header of all.
+ */
+static void print_dpmac_rates_header(const struct counter_set *set)
+{
+	const struct counter_obj *obj = &set->objs[0];
+
+	printf("%-10s", "object");
+	for (unsigned int c = 0; c < obj->num_counters; c++)
+		printf(" %*s", dpmac_rate_width(obj->counters[c]),
+		       obj->counters[c]->name);
+	printf("\n");
+}
+
+static void print_dpmac_rates(const struct counter_set *set)
+{
+	char obj_name[OBJ_TYPE_MAX_LENGTH + 12];
+
+	if (set->num_objs > 1)
+		printf("\n");
+
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		const struct counter_obj *obj = &set->objs[i];
+
+		snprintf(obj_name, sizeof(obj_name), "dpmac.%u", obj->id);
+		printf("%-10s", obj_name);
+		for (unsigned int c = 0; c < obj->num_counters; c++)
+			printf(" %*.0f", dpmac_rate_width(obj->counters[c]),
+			       counters_rate(set, obj, c));
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+static int watch_dpmac_stats_sample(void *arg, long n)
+{
+	struct counter_set *set = arg;
+	int error;
+
+	error = counters_sample(set);
+	if (error < 0)
+		return error;
+
+	if (n == 0)
+		print_dpmac_rates_header(set);
+	else
+		print_dpmac_rates(set);
+	return 0;
+}
+
+/*
+ * Sample the counters every 'interval_ms' and print the rates per second
+ * between samples, 'count' times or until interrupted if 'count' is 0
+ */
+static int watch_dpmac_stats(struct counter_set *set, long interval_ms,
+			     long count)
+{
+	return interval_run((uint64_t)interval_ms * 1000000, count,
+			    watch_dpmac_stats_sample, set);
+}
+
+static int cmd_dpmac_stats_v10(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dpmac stats <dpmac-object>[,<dpmac-object>...] [--counters=<names>]\n"
+		"                           [--interval=<ms>] [--count=<n>]\n"
+		"       restool dpmac stats all [OPTIONS]\n"
+		"\n"
+		"OPTIONS:\n"
+		"if no option is specified, all the counters are displayed once\n"
+		"--counters=<names>\n"
+		"   Only reads the counters in the comma separated list <names>, named\n"
+		"   as in 'restool dpmac info' with '-' in place of the spaces.\n"
+		"--interval=<ms>\n"
+		"   Samples the counters every <ms> milliseconds and displays their\n"
+		"   rates per second between samples, until interrupted.\n"
+		"--count=<n>\n"
+		"   Stops after <n> samples.\n"
+		"\n"
+		"The DPMACs stay open while sampling and the counters are read on up to\n"
+		"--portals MC portals at once.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"Display the frame and byte rates of all the DPMACs every second:\n"
+		"   $ restool dpmac stats all --counters=rx-all-frames,rx-bytes,tx-frames-ok,tx-bytes --interval=1000\n"
+		"\n";
+	struct counter_set set = { 0 };
+	const char *names = NULL;
+	long interval_ms = 0;
+	long count = 0;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<object> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_COUNTERS)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_COUNTERS);
+		names = restool.cmd_option_args[STATS_OPT_COUNTERS];
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_INTERVAL)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_INTERVAL);
+		error = get_option_value(STATS_OPT_INTERVAL, &interval_ms,
+					 "Invalid interval", 1, 3600000);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_COUNT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_COUNT);
+		error = get_option_value(STATS_OPT_COUNT, &count,
+					 "Invalid count", 1, LONG_MAX);
+		if (error)
+			return error;
+
+		if (interval_ms == 0) {
+			ERROR_PRINTF("--count requires --interval\n");
+			return -EINVAL;
+		}
+	}
+
+	if (interval_ms != 0) {
+		error = daemon_decline_command();
+		if (error)
+			return error;
+	}
+
+	error = add_dpmac_stats_objs(&set, names);
+	if (error < 0)
+		goto out;
+
+	error = counters_start(&set);
+	if (error < 0)
+		goto out;
+
+	if (interval_ms != 0) {
+		error = watch_dpmac_stats(&set, interval_ms, count);
+		goto out;
+	}
+
+	error = counters_sample(&set);
+	if (error < 0)
+		goto out;
+
+	print_dpmac_stats(&set);
+
+out:
+	counters_free(&set);
+	return error;
+}
+
 struct object_command dpmac_commands_v9[] = {
 	{ .cmd_name = "--help",
 	  .options = NULL,
@@ -928,6 +1193,10 @@ struct object_command dpmac_commands_v10[] = {
 	  .options = dpmac_destroy_options,
 	  .cmd_func = cmd_dpmac_destroy_v10 },
 
+	{ .cmd_name = "stats",
+	  .options = dpmac_stats_options,
+	  .cmd_func = cmd_dpmac_stats_v10 },
+
 	{ .cmd_name = NULL },
 };
 
@@ -79,6 +79,8 @@ C_ASSERT(ARRAY_SIZE(dpmcp_info_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 enum dpmcp_create_options {
 	CREATE_OPT_HELP = 0,
 	CREATE_OPT_PARENT_DPRC,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpmcp_create_options[] = {
@@ -96,6 +98,20 @@ static struct option dpmcp_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -126,6 +142,7 @@ const struct flib_ops dpmcp_ops = {
 	.obj_close = dpmcp_close_v10,
 	.obj_get_irq_mask = dpmcp_get_irq_mask_v10,
 	.obj_get_irq_status = dpmcp_get_irq_status_v10,
+	.obj_destroy = dpmcp_destroy_v10,
 };
 
 static int cmd_dpmcp_help(void)
@@ -400,13 +417,27 @@ static int create_dpmcp_v9(struct dpmcp_cfg *dpmcp_cfg)
 	return 0;
 }
 
+static int create_dpmcp_obj(uint16_t dprc_handle, const void *cfg,
+			    uint32_t *dpmcp_id)
+{
+	return dpmcp_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpmcp_id);
+}
+
 static int create_dpmcp_v10(struct dpmcp_cfg *dpmcp_cfg)
 {
-	uint32_t dpmcp_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -425,24 +456,15 @@ static int create_dpmcp_v10(struct dpmcp_cfg *dpmcp_cfg)
 		}
 	}
 
-	error = dpmcp_create_v10(&restool.mc_io, dprc_handle, 0,
-				 dpmcp_cfg, &dpmcp_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpmcp", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpmcp_obj, dpmcp_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpmcp", dpmcp_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpmcp", dpmcp_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 
 static int create_dpmcp(int mc_fw_version, const char *usage_msg)
@@ -496,6 +518,10 @@ static int cmd_dpmcp_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n";
 
 	return create_dpmcp(MC_FW_VERSION_10, usage_msg);
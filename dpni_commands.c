@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <assert.h>
 #include <getopt.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include "restool.h"
 #include "utils.h"
@@ -150,6 +151,8 @@ enum dpni_create_options {
 	CREATE_OPT_MAC_FILTER_ENTRIES,
 	CREATE_OPT_VLAN_FILTER_ENTRIES,
 	CREATE_OPT_NUM_CGS,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpni_create_options[] = {
@@ -314,6 +317,20 @@ static struct option dpni_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -364,11 +381,56 @@ static struct option dpni_update_options_v10[] = {
 
 C_ASSERT(ARRAY_SIZE(dpni_update_options_v10) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 
+/**
+ * dpni stats command options
+ */
+enum dpni_stats_options {
+	STATS_OPT_HELP = 0,
+	STATS_OPT_INTERVAL,
+	STATS_OPT_COUNT,
+	STATS_OPT_TC,
+};
+
+static struct option dpni_stats_options[] = {
+	[STATS_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[STATS_OPT_INTERVAL] = {
+		.name = "interval",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[STATS_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[STATS_OPT_TC] = {
+		.name = "tc",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dpni_stats_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
 const struct flib_ops dpni_ops = {
 	.obj_open = dpni_open_v10,
 	.obj_close = dpni_close_v10,
 	.obj_get_irq_mask = dpni_get_irq_mask_v10,
 	.obj_get_irq_status = dpni_get_irq_status_v10,
+	.obj_destroy = dpni_destroy_v10,
 };
 
 static struct option_entry options_map_v9[] = {
@@ -466,6 +528,7 @@ static int cmd_dpni_help_v10(void)
 		"   create - creates a new child DPNI under the root DPRC.\n"
 		"   destroy - destroys a child DPNI under the root DPRC.\n"
 		"   update - update attributes of already created DPNI.\n"
+		"   stats - displays the statistics of a DPNI, once or as rates.\n"
 		"\n"
 		"For command-specific help, use the --help option of each command.\n"
 		"\n";
@@ -1398,13 +1461,21 @@ static int cmd_dpni_create_v9(void)
 	return create_dpni_v9(usage_msg);
 }
 
+static int create_dpni_obj(uint16_t dprc_handle, const void *cfg,
+			   uint32_t *dpni_id)
+{
+	return dpni_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpni_id);
+}
+
 static int create_dpni_v10(const char *usage_msg)
 {
 	struct dpni_cfg_v10 dpni_cfg;
-	uint32_t dpni_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
 	long value;
+	const char *label_prefix;
+	long count;
 	int error;
 
 	memset(&dpni_cfg, 0, sizeof(dpni_cfg));
@@ -1542,6 +1613,12 @@ static int create_dpni_v10(const char *usage_msg)
 		dpni_cfg.num_cgs = (uint8_t)value;
 	}
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -1560,24 +1637,15 @@ static int create_dpni_v10(const char *usage_msg)
 		}
 	}
 
-	error = dpni_create_v10(&restool.mc_io, dprc_handle, 0,
-				&dpni_cfg, &dpni_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpni", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpni_obj, &dpni_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpni", dpni_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpni", dpni_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 static int cmd_dpni_create_v10(void)
 {
@@ -1620,6 +1688,10 @@ static int cmd_dpni_create_v10(void)
 		"   Defaults to 64. Maximum value is 1024\n"
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n";
 
 	static const char usage_msg_v10_1[] =
@@ -1671,6 +1743,10 @@ static int cmd_dpni_create_v10(void)
 		"   Defaults to one per TC. Maximum supported value is 128.\n"
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n";
 
 	if (restool.mc_fw_version.minor == 0)
@@ -1889,6 +1965,418 @@ out:
 }
 
 
+/*
+ * Statistics pages sampled by 'dpni stats': 0 is ingress, 1 egress and 2
+ * the filtered and discarded frames. With --tc, page 3 is read for each
+ * egress traffic class and page 4 for each ingress traffic class.
+ */
+#define DPNI_STATS_NUM_PAGES	3
+#define DPNI_STATS_PAGE_TX_TC	3
+#define DPNI_STATS_PAGE_RX_TC	4
+
+/**
+ * struct dpni_stats_sample - statistics read at once by 'dpni stats'
+ * @pages: pages 0 to 2, not read with --tc
+ * @tx_tcs: page 3 of each egress traffic class, only read with --tc
+ * @rx_tcs: page 4 of each ingress traffic class, only read with --tc
+ * @when: time the sample was read at
+ */
+struct dpni_stats_sample {
+	union dpni_statistics_v10 pages[DPNI_STATS_NUM_PAGES];
+	union dpni_statistics_v10 tx_tcs[DPNI_MAX_TC];
+	union dpni_statistics_v10 rx_tcs[DPNI_MAX_TC];
+	struct timespec when;
+};
+
+/**
+ * struct dpni_stats_view - what 'dpni stats' reads and prints
+ * @dpni_handle: handle of the open DPNI
+ * @per_tc: read and print the traffic class statistics
+ * @num_tx_tcs: number of egress traffic classes of the DPNI
+ * @num_rx_tcs: number of ingress traffic classes of the DPNI
+ */
+struct dpni_stats_view {
+	uint16_t dpni_handle;
+	bool per_tc;
+	uint8_t num_tx_tcs;
+	uint8_t num_rx_tcs;
+};
+
+static int read_dpni_stats_page(const struct dpni_stats_view *view,
+				uint8_t page, uint16_t param,
+				union dpni_statistics_v10 *stats)
+{
+	int error;
+
+	error = dpni_get_statistics_v10(&restool.mc_io, 0, view->dpni_handle,
+					page, param, stats);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			     mc_status_to_string(mc_status), mc_status);
+	}
+
+	return error;
+}
+
+static int read_dpni_stats(const struct dpni_stats_view *view,
+			   struct dpni_stats_sample *sample)
+{
+	int error = 0;
+
+	if (!view->per_tc) {
+		for (uint8_t page = 0;
+		     error == 0 && page < DPNI_STATS_NUM_PAGES; page++)
+			error = read_dpni_stats_page(view, page, 0,
+						     &sample->pages[page]);
+	}
+
+	for (uint8_t tc = 0; view->per_tc && error == 0 &&
+	     tc < view->num_tx_tcs; tc++)
+		error = read_dpni_stats_page(view, DPNI_STATS_PAGE_TX_TC, tc,
+					     &sample->tx_tcs[tc]);
+
+	for (uint8_t tc = 0; view->per_tc && error == 0 &&
+	     tc < view->num_rx_tcs; tc++)
+		error = read_dpni_stats_page(view, DPNI_STATS_PAGE_RX_TC, tc,
+					     &sample->rx_tcs[tc]);
+
+	clock_gettime(CLOCK_MONOTONIC, &sample->when);
+
+	return error;
+}
+
+static void print_dpni_tc_stats(const struct dpni_stats_view *view,
+				const struct dpni_stats_sample *sample)
+{
+	for (uint8_t tc = 0; tc < view->num_tx_tcs; tc++) {
+		printf("tx tc %u:\n", tc);
+		printf("ceetm_dequeue_frames: %lu\n",
+		       sample->tx_tcs[tc].page_3.ceetm_dequeue_frames);
+		printf("ceetm_dequeue_bytes: %lu\n",
+		       sample->tx_tcs[tc].page_3.ceetm_dequeue_bytes);
+		printf("ceetm_reject_frames: %lu\n",
+		       sample->tx_tcs[tc].page_3.ceetm_reject_frames);
+		printf("ceetm_reject_bytes: %lu\n",
+		       sample->tx_tcs[tc].page_3.ceetm_reject_bytes);
+	}
+
+	for (uint8_t tc = 0; tc < view->num_rx_tcs; tc++) {
+		printf("rx tc %u:\n", tc);
+		printf("cgr_reject_frames: %lu\n",
+		       sample->rx_tcs[tc].page_4.cgr_reject_frames);
+		printf("cgr_reject_bytes: %lu\n",
+		       sample->rx_tcs[tc].page_4.cgr_reject_bytes);
+	}
+}
+
+/* Counters are free running, the unsigned difference survives a wrap */
+static double dpni_stats_rate(uint64_t prev, uint64_t curr, double seconds)
+{
+	return (double)(curr - prev) / seconds;
+}
+
+static void print_dpni_rates_header(const struct dpni_stats_view *view)
+{
+	if (view->per_tc)
+		printf("%4s %12s %14s %12s %14s %12s %14s\n", "tc",
+		       "tx frames/s", "tx bytes/s", "tx reject/s",
+		       "tx rej bytes/s", "rx reject/s", "rx rej bytes/s");
+	else
+		printf("%12s %14s %12s %14s %12s %12s %12s %12s\n",
+		       "rx frames/s", "rx bytes/s", "tx frames/s",
+		       "tx bytes/s", "rx filter/s", "rx discard/s",
+		       "rx nobuf/s", "tx discard/s");
+}
+
+static void print_dpni_tc_rates(const struct dpni_stats_view *view,
+				const struct dpni_stats_sample *prev,
+				const struct dpni_stats_sample *curr,
+				double seconds)
+{
+	const union dpni_statistics_v10 *prev_tc;
+	const union dpni_statistics_v10 *curr_tc;
+	uint8_t num_tcs = view->num_tx_tcs > view->num_rx_tcs ?
+			  view->num_tx_tcs : view->num_rx_tcs;
+
+	for (uint8_t tc = 0; tc < num_tcs; tc++) {
+		printf("%4u", tc);
+
+		prev_tc = &prev->tx_tcs[tc];
+		curr_tc = &curr->tx_tcs[tc];
+		if (tc < view->num_tx_tcs)
+			printf(" %12.0f %14.0f %12.0f %14.0f",
+			       dpni_stats_rate(prev_tc->page_3.ceetm_dequeue_frames,
+					       curr_tc->page_3.ceetm_dequeue_frames,
+					       seconds),
+			       dpni_stats_rate(prev_tc->page_3.ceetm_dequeue_bytes,
+					       curr_tc->page_3.ceetm_dequeue_bytes,
+					       seconds),
+			       dpni_stats_rate(prev_tc->page_3.ceetm_reject_frames,
+					       curr_tc->page_3.ceetm_reject_frames,
+					       seconds),
+			       dpni_stats_rate(prev_tc->page_3.ceetm_reject_bytes,
+					       curr_tc->page_3.ceetm_reject_bytes,
+					       seconds));
+		else
+			printf(" %12s %14s %12s %14s", "-", "-", "-", "-");
+
+		prev_tc = &prev->rx_tcs[tc];
+		curr_tc = &curr->rx_tcs[tc];
+		if (tc < view->num_rx_tcs)
+			printf(" %12.0f %14.0f\n",
+			       dpni_stats_rate(prev_tc->page_4.cgr_reject_frames,
+					       curr_tc->page_4.cgr_reject_frames,
+					       seconds),
+			       dpni_stats_rate(prev_tc->page_4.cgr_reject_bytes,
+					       curr_tc->page_4.cgr_reject_bytes,
+					       seconds));
+		else
+			printf(" %12s %14s\n", "-", "-");
+	}
+}
+
+static void print_dpni_rates(const struct dpni_stats_view *view,
+			     const struct dpni_stats_sample *prev,
+			     const struct dpni_stats_sample *curr)
+{
+	const union dpni_statistics_v10 *p = prev->pages;
+	const union dpni_statistics_v10 *c = curr->pages;
+	double seconds;
+
+	seconds = (curr->when.tv_sec - prev->when.tv_sec) +
+		  (curr->when.tv_nsec - prev->when.tv_nsec) / 1e9;
+
+	if (view->per_tc) {
+		/* a blank line between the samples of all the classes */
+		if (view->num_tx_tcs + view->num_rx_tcs > 2)
+			printf("\n");
+		print_dpni_tc_rates(view, prev, curr, seconds);
+		fflush(stdout);
+		return;
+	}
+
+	printf("%12.0f %14.0f %12.0f %14.0f %12.0f %12.0f %12.0f %12.0f\n",
+	       dpni_stats_rate(p[0].page_0.ingress_all_frames,
+			       c[0].page_0.ingress_all_frames, seconds),
+	       dpni_stats_rate(p[0].page_0.ingress_all_bytes,
+			       c[0].page_0.ingress_all_bytes, seconds),
+	       dpni_stats_rate(p[1].page_1.egress_all_frames,
+			       c[1].page_1.egress_all_frames, seconds),
+	       dpni_stats_rate(p[1].page_1.egress_all_bytes,
+			       c[1].page_1.egress_all_bytes, seconds),
+	       dpni_stats_rate(p[2].page_2.ingress_filtered_frames,
+			       c[2].page_2.ingress_filtered_frames, seconds),
+	       dpni_stats_rate(p[2].page_2.ingress_discarded_frames,
+			       c[2].page_2.ingress_discarded_frames, seconds),
+	       dpni_stats_rate(p[2].page_2.ingress_nobuffer_discards,
+			       c[2].page_2.ingress_nobuffer_discards, seconds),
+	       dpni_stats_rate(p[2].page_2.egress_discarded_frames,
+			       c[2].page_2.egress_discarded_frames, seconds));
+	fflush(stdout);
+}
+
+/**
+ * struct dpni_stats_watch - state of 'dpni stats --interval'
+ * @samples: the last two samples, @curr being the index of the last one
+ */
+struct dpni_stats_watch {
+	const struct dpni_stats_view *view;
+	struct dpni_stats_sample samples[2];
+	int curr;
+};
+
+static int watch_dpni_stats_sample(void *arg, long n)
+{
+	struct dpni_stats_watch *watch = arg;
+	int error;
+
+	watch->curr = !watch->curr;
+	error = read_dpni_stats(watch->view, &watch->samples[watch->curr]);
+	if (error < 0)
+		return error;
+
+	if (n == 0)
+		print_dpni_rates_header(watch->view);
+	else
+		print_dpni_rates(watch->view, &watch->samples[!watch->curr],
+				 &watch->samples[watch->curr]);
+	return 0;
+}
+
+/*
+ * Sample the statistics every 'interval_ms' and print the rates between
+ * samples, 'count' times or until interrupted if 'count' is 0. The DPNI
+ * stays open and nothing but the statistics is read in the loop.
+ */
+static int watch_dpni_stats(const struct dpni_stats_view *view,
+			    long interval_ms, long count)
+{
+	struct dpni_stats_watch *watch;
+	int error;
+
+	watch = calloc(1, sizeof(*watch));
+	if (!watch)
+		return -ENOMEM;
+
+	watch->view = view;
+	error = interval_run((uint64_t)interval_ms * 1000000, count,
+			     watch_dpni_stats_sample, watch);
+	free(watch);
+	return error;
+}
+
+static int cmd_dpni_stats_v10(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dpni stats <dpni-object> [--tc] [--interval=<ms>] [--count=<n>]\n"
+		"\n"
+		"OPTIONS:\n"
+		"if no option is specified, the statistics counters are displayed once\n"
+		"--tc\n"
+		"   Displays the statistics of each traffic class instead: frames\n"
+		"   dequeued and rejected by each egress class and frames rejected by\n"
+		"   the congestion group of each ingress class.\n"
+		"--interval=<ms>\n"
+		"   Samples the statistics every <ms> milliseconds and displays the\n"
+		"   frame, byte and discard rates between samples, until interrupted.\n"
+		"--count=<n>\n"
+		"   Stops after <n> samples.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"Display the rates of dpni.5 every second, 10 times:\n"
+		"   $ restool dpni stats dpni.5 --interval=1000 --count=10\n"
+		"Display the rates of each traffic class of dpni.5 every second:\n"
+		"   $ restool dpni stats dpni.5 --tc --interval=1000\n"
+		"\n";
+	struct dpni_stats_view view = { 0 };
+	struct dpni_stats_sample *sample = NULL;
+	struct dpni_attr_v10 dpni_attr;
+	bool dpni_opened = false;
+	long interval_ms = 0;
+	uint32_t dpni_id;
+	long count = 0;
+	int error;
+	int error2;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<object> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	error = parse_object_name(restool.obj_name, "dpni", &dpni_id);
+	if (error < 0)
+		return error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_TC)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_TC);
+		view.per_tc = true;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_INTERVAL)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_INTERVAL);
+		error = get_option_value(STATS_OPT_INTERVAL, &interval_ms,
+					 "Invalid interval", 1, 3600000);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(STATS_OPT_COUNT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(STATS_OPT_COUNT);
+		error = get_option_value(STATS_OPT_COUNT, &count,
+					 "Invalid count", 1, LONG_MAX);
+		if (error)
+			return error;
+
+		if (interval_ms == 0) {
+			ERROR_PRINTF("--count requires --interval\n");
+			return -EINVAL;
+		}
+	}
+
+	if (interval_ms != 0) {
+		error = daemon_decline_command();
+		if (error)
+			return error;
+	}
+
+	error = dpni_open_v10(&restool.mc_io, 0, dpni_id, &view.dpni_handle);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			     mc_status_to_string(mc_status), mc_status);
+		goto out;
+	}
+	dpni_opened = true;
+
+	if (view.per_tc) {
+		memset(&dpni_attr, 0, sizeof(dpni_attr));
+		error = dpni_get_attributes_v10(&restool.mc_io, 0,
+						view.dpni_handle, &dpni_attr);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+			goto out;
+		}
+
+		/* a DPNI has at least one traffic class each way */
+		view.num_tx_tcs = dpni_attr.num_tx_tcs ? : 1;
+		view.num_rx_tcs = dpni_attr.num_rx_tcs ? : 1;
+		if (view.num_tx_tcs > DPNI_MAX_TC)
+			view.num_tx_tcs = DPNI_MAX_TC;
+		if (view.num_rx_tcs > DPNI_MAX_TC)
+			view.num_rx_tcs = DPNI_MAX_TC;
+	}
+
+	if (interval_ms != 0) {
+		error = watch_dpni_stats(&view, interval_ms, count);
+		goto out;
+	}
+
+	sample = calloc(1, sizeof(*sample));
+	if (!sample) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	error = read_dpni_stats(&view, sample);
+	if (error < 0)
+		goto out;
+
+	if (view.per_tc) {
+		print_dpni_tc_stats(&view, sample);
+	} else {
+		for (unsigned int page = 0; page < DPNI_STATS_NUM_PAGES;
+		     page++)
+			dpni_print_stats(dpni_stats_v10[page],
+					 sample->pages[page]);
+	}
+
+out:
+	free(sample);
+	if (dpni_opened) {
+		error2 = dpni_close_v10(&restool.mc_io, 0, view.dpni_handle);
+		if (error2 < 0) {
+			mc_status = flib_error_to_mc_status(error2);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+			if (error == 0)
+				error = error2;
+		}
+	}
+
+	return error;
+}
+
 static int cmd_dpni_update_v10(void)
 {
 	static const char usage_msg[] =
@@ -1944,6 +2432,10 @@ struct object_command dpni_commands_v10[] = {
 	  .options = dpni_update_options_v10,
 	  .cmd_func = cmd_dpni_update_v10 },
 
+	{ .cmd_name = "stats",
+	  .options = dpni_stats_options,
+	  .cmd_func = cmd_dpni_stats_v10 },
+
 	{ .cmd_name = NULL },
 };
 
@@ -42,6 +42,9 @@
 #include "restool.h"
 #include "utils.h"
 #include "dprc_commands_generate_dpl.h"
+#include "dprc_commands_top.h"
+#include "dprc_commands_destroy.h"
+#include "dprc_commands_connect.h"
 
 #define ALL_DPRC_OPTS (				\
 	DPRC_CFG_OPT_SPAWN_ALLOWED |		\
@@ -176,6 +179,7 @@ C_ASSERT(ARRAY_SIZE(dprc_create_child_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
  */
 enum dprc_destroy_options {
 	DESTROY_OPT_HELP = 0,
+	DESTROY_OPT_RECURSIVE,
 };
 
 static struct option dprc_destroy_options[] = {
@@ -183,6 +187,10 @@ static struct option dprc_destroy_options[] = {
 		.name = "help",
 	},
 
+	[DESTROY_OPT_RECURSIVE] = {
+		.name = "recursive",
+	},
+
 	{ 0 },
 };
 
@@ -290,6 +298,7 @@ enum dprc_connect_options {
 	CONNECT_OPT_ENDPOINT2,
 	CONNECT_OPT_COMMITTED_RATE,
 	CONNECT_OPT_MAX_RATE,
+	CONNECT_OPT_FROM_FILE,
 };
 
 static struct option dprc_connect_options[] = {
@@ -320,6 +329,11 @@ static struct option dprc_connect_options[] = {
 		.flag = NULL,
 		.val = 0,
 	},
+
+	[CONNECT_OPT_FROM_FILE] = {
+		.name = "from-file",
+		.has_arg = 1,
+	},
 	{ 0 },
 };
 
@@ -331,6 +345,7 @@ C_ASSERT(ARRAY_SIZE(dprc_connect_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 enum dprc_disconnect_options {
 	DISCONNECT_OPT_HELP = 0,
 	DISCONNECT_OPT_ENDPOINT,
+	DISCONNECT_OPT_FROM_FILE,
 };
 
 static struct option dprc_disconnect_options[] = {
@@ -343,6 +358,11 @@ static struct option dprc_disconnect_options[] = {
 		.has_arg = 1,
 	},
 
+	[DISCONNECT_OPT_FROM_FILE] = {
+		.name = "from-file",
+		.has_arg = 1,
+	},
+
 	{ 0 },
 };
 
@@ -353,6 +373,7 @@ C_ASSERT(ARRAY_SIZE(dprc_disconnect_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
  */
 enum dpl_generate_options {
 	GENERATE_OPT_HELP = 0,
+	GENERATE_OPT_FORMAT,
 };
 
 struct option dpl_generate_options[] = {
@@ -360,11 +381,96 @@ struct option dpl_generate_options[] = {
 		.name = "help",
 	},
 
+	[GENERATE_OPT_FORMAT] = {
+		.name = "format",
+		.has_arg = 1,
+	},
+
 	{ 0 },
 };
 
 C_ASSERT(ARRAY_SIZE(dpl_generate_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
 
+/**
+ * dprc top command options
+ */
+enum dprc_top_options {
+	TOP_OPT_HELP = 0,
+	TOP_OPT_SORT,
+	TOP_OPT_INTERVAL,
+	TOP_OPT_COUNT,
+};
+
+static struct option dprc_top_options[] = {
+	[TOP_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[TOP_OPT_SORT] = {
+		.name = "sort",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[TOP_OPT_INTERVAL] = {
+		.name = "interval",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[TOP_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dprc_top_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+/**
+ * dprc clone command options
+ */
+enum dprc_clone_options {
+	CLONE_OPT_HELP = 0,
+	CLONE_OPT_COUNT,
+	CLONE_OPT_PARENT,
+};
+
+static struct option dprc_clone_options[] = {
+	[CLONE_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CLONE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CLONE_OPT_PARENT] = {
+		.name = "parent",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(dprc_clone_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
 const struct flib_ops dprc_ops = {
 	.obj_open = dprc_open,
 	.obj_close = dprc_close,
@@ -404,6 +510,8 @@ static int cmd_dprc_help(void)
 		"   disconnect   - removes the link between two objects. Either endpoint can\n"
 		"                  be specified as the target of the operation.\n"
 		"   generate-dpl - generate DPL syntax for the specified container\n"
+		"   top          - displays the busiest network objects of a container tree.\n"
+		"   clone        - creates copies of a container tree.\n"
 		"\n"
 		"For command-specific help, use the --help option of each command.\n"
 		"\n";
@@ -449,12 +557,13 @@ static int cmd_dprc_sync(void)
 /**
  * Lists nested DPRCs inside a given DPRC, recursively
  */
-static int list_dprc(uint32_t dprc_id, uint16_t dprc_handle,
+static int list_dprc(const struct walk_result *walk, int index,
 		     int nesting_level, bool show_non_dprc_objects,
 		     char *full_path)
 {
+	const struct walk_container *container = &walk->containers[index];
 	char *updated_full_path = NULL;
-	int num_child_devices;
+	uint32_t dprc_id = container->id;
 	int error = 0;
 	int full_path_len;
 
@@ -478,64 +587,26 @@ static int list_dprc(uint32_t dprc_id, uint16_t dprc_handle,
 		printf("dprc.%u\n", dprc_id);
 	}
 
-	error = dprc_get_obj_count(&restool.mc_io, 0,
-				   dprc_handle,
-				   &num_child_devices);
-	if (error < 0) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		goto out;
-	}
+	for (int i = 0; i < container->num_objs; i++) {
+		const struct dprc_obj_desc *obj_desc = &container->objs[i];
 
-	for (int i = 0; i < num_child_devices; i++) {
-		struct dprc_obj_desc obj_desc;
-		uint16_t child_dprc_handle;
-		int error2;
-
-		error = dprc_get_obj(
-				&restool.mc_io, 0,
-				dprc_handle,
-				i,
-				&obj_desc);
-		if (error < 0) {
-			DEBUG_PRINTF(
-				"dprc_get_object(%u) failed with error %d\n",
-				i, error);
-			goto out;
-		}
-
-		if (strcmp(obj_desc.type, "dprc") != 0) {
+		if (container->children[i] < 0) {
 			if (show_non_dprc_objects) {
 				for (int i = 0; i < nesting_level + 1; i++)
 					printf("  ");
 
-				printf("%s.%u\n", obj_desc.type, obj_desc.id);
+				printf("%s.%u\n", obj_desc->type, obj_desc->id);
 			}
 
 			continue;
 		}
 
-		error = open_dprc(obj_desc.id, &child_dprc_handle);
-		if (error < 0)
-			goto out;
-
-		error = list_dprc(obj_desc.id,
-				  child_dprc_handle,
+		error = list_dprc(walk, container->children[i],
 				  nesting_level + 1,
 				  show_non_dprc_objects,
 				  updated_full_path);
-
-		error2 = dprc_close(&restool.mc_io, 0, child_dprc_handle);
-		if (error2 < 0) {
-			mc_status = flib_error_to_mc_status(error2);
-			ERROR_PRINTF("MC error: %s (status %#x)\n",
-				     mc_status_to_string(mc_status), mc_status);
-			if (error == 0)
-				error = error2;
-
+		if (error < 0)
 			goto out;
-		}
 	}
 
 out:
@@ -556,7 +627,9 @@ static int cmd_dprc_list(void)
 		"   prints the dprc list in a full-path\n"
 		"   format like: dprc.1/dprc.2\n"
 		"\n";
+	struct walk_result walk;
 	bool full_path = false;
+	int error;
 
 	if (restool.cmd_option_mask & ONE_BIT_MASK(LIST_OPT_HELP)) {
 		puts(usage_msg);
@@ -577,10 +650,13 @@ static int cmd_dprc_list(void)
 		return -EINVAL;
 	}
 
-	return list_dprc(restool.root_dprc_id,
-			 restool.root_dprc_handle,
-			 0, false,
-			 full_path ? "" : NULL);
+	error = walk_containers(restool.root_dprc_id,
+				restool.root_dprc_handle, 0, &walk);
+	if (error == 0)
+		error = list_dprc(&walk, 0, 0, false, full_path ? "" : NULL);
+
+	walk_free(&walk);
+	return error;
 }
 
 static int show_one_resource_type(uint16_t dprc_handle,
@@ -1219,7 +1295,16 @@ static int cmd_dprc_destroy_child(void)
 {
 	static const char usage_msg[] =
 		"\n"
-		"Usage: restool dprc destroy <container>\n"
+		"Usage: restool dprc destroy <container> [--recursive]\n"
+		"\n"
+		"OPTIONS:\n"
+		"--recursive\n"
+		"   Also destroys the containers and objects in <container>, after\n"
+		"   disconnecting their interfaces. Nothing is changed if one of them\n"
+		"   is bound to a driver. Independent containers are emptied on up\n"
+		"   to --portals MC portals at once.\n"
+		"   The dpmac, dpaiop and dprtc objects stand for hardware blocks:\n"
+		"   they are moved, unplugged, to the parent of <container> instead.\n"
 		"\n"
 		"NOTE:\n"
 		" -<container> cannot be the root container\n"
@@ -1275,6 +1360,12 @@ static int cmd_dprc_destroy_child(void)
 		goto out;
 	}
 
+	if (restool.cmd_option_mask & ONE_BIT_MASK(DESTROY_OPT_RECURSIVE)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(DESTROY_OPT_RECURSIVE);
+		error = dprc_destroy_recursive(child_dprc_id, parent_dprc_id);
+		goto out;
+	}
+
 	if (parent_dprc_id == restool.root_dprc_id)
 		parent_dprc_handle = restool.root_dprc_handle;
 	else {
@@ -1315,6 +1406,15 @@ static int lookup_obj_desc(uint32_t parent_dprc_id,
 	int error;
 	int num_child_devices;
 	bool dprc_opened = false;
+	struct dprc_obj_desc indexed_obj_desc;
+	uint32_t indexed_parent_dprc_id;
+
+	error = topology_lookup(obj_type, obj_id, &indexed_obj_desc,
+				&indexed_parent_dprc_id);
+	if (error == 0 && indexed_parent_dprc_id == parent_dprc_id) {
+		*obj_desc_out = indexed_obj_desc;
+		return 0;
+	}
 
 	if (parent_dprc_id != restool.root_dprc_id) {
 		error = open_dprc(parent_dprc_id, &dprc_handle);
@@ -1946,32 +2046,13 @@ out:
 	return error;
 }
 
-static int parse_endpoint(char *endpoint_str, struct dprc_endpoint *endpoint)
-{
-	int n;
-
-	memset(endpoint, 0, sizeof(*endpoint));
-
-	n = sscanf(endpoint_str,
-		   "%" STRINGIFY(OBJ_TYPE_MAX_LENGTH) "[a-z].%d.%hu",
-		   endpoint->type, &endpoint->id, &endpoint->if_id);
-
-	if (n < 2)
-		return -EINVAL;
-
-	if (n == 2)
-		assert(endpoint->if_id == 0);
-
-	return 0;
-}
-
-
 static int cmd_dprc_connect(void)
 {
 	static const char usage_msg[] =
 		"\n"
 		"Usage: restool dprc connect <parent-container> --endpoint1=<object>\n"
 		"		--endpoint2=<object> [OPTIONS]\n"
+		"       restool dprc connect <parent-container> --from-file=<map>\n"
 		"\n"
 		"  <parent-container>\n"
 		"    Specifies the parent-container.\n"
@@ -1985,6 +2066,11 @@ static int cmd_dprc_connect(void)
 		"    Committed rate (Mbits/s). Must be provided alongside max-rate.\n"
 		"  --max-rate=<number>\n"
 		"    Maximum rate (Mbits/s). Must be provided alongside committed-rate.\n"
+		"  --from-file=<map>\n"
+		"    Connects the endpoints found in <map>, one pair per line:\n"
+		"      <object> <object> [<committed-rate> <max-rate>]\n"
+		"    '#' starts a comment. All the endpoints are checked before the\n"
+		"    first one is connected.\n"
 		"\n"
 		"NOTES:\n"
 		"  -<parent-container> must be a common ancestor of both <object> arguments\n"
@@ -1998,6 +2084,8 @@ static int cmd_dprc_connect(void)
 		"EXAMPLE:\n"
 		"To connect dpni.8 to dpsw.0.0:\n"
 		"   $ restool dprc connect dprc.1 --endpoint1=dpsw.0.0 --endpoint2=dpni.8\n"
+		"To connect the endpoints listed in links.map:\n"
+		"   $ restool dprc connect dprc.1 --from-file=links.map\n"
 		"\n";
 
 	struct dprc_connection_cfg dprc_connection_cfg;
@@ -2040,6 +2128,24 @@ static int cmd_dprc_connect(void)
 		dprc_handle = restool.root_dprc_handle;
 	}
 
+	if (restool.cmd_option_mask & ONE_BIT_MASK(CONNECT_OPT_FROM_FILE)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(CONNECT_OPT_FROM_FILE);
+		if (restool.cmd_option_mask &
+		    (ONE_BIT_MASK(CONNECT_OPT_ENDPOINT1) |
+		     ONE_BIT_MASK(CONNECT_OPT_ENDPOINT2) |
+		     ONE_BIT_MASK(CONNECT_OPT_COMMITTED_RATE) |
+		     ONE_BIT_MASK(CONNECT_OPT_MAX_RATE))) {
+			ERROR_PRINTF("--from-file cannot be used with the other options\n");
+			error = -EINVAL;
+			goto out;
+		}
+
+		error = dprc_connect_from_file(parent_dprc_id, dprc_handle,
+				restool.cmd_option_args[CONNECT_OPT_FROM_FILE],
+				true);
+		goto out;
+	}
+
 	if (!(restool.cmd_option_mask & ONE_BIT_MASK(CONNECT_OPT_ENDPOINT1))) {
 		ERROR_PRINTF("--endpoint1 option missing\n");
 		puts(usage_msg);
@@ -2143,11 +2249,15 @@ static int cmd_dprc_disconnect(void)
 	static const char usage_msg[] =
 		"\n"
 		"Usage: restool dprc disconnect <parent-container> --endpoint=<object>\n"
+		"       restool dprc disconnect <parent-container> --from-file=<map>\n"
 		"\n"
 		"  <parent-container>\n"
 		"    Specifies the parent-container.\n"
 		"  --endpoint=<object>\n"
 		"    Specifies either endpoint of a connection.\n"
+		"  --from-file=<map>\n"
+		"    Disconnects the first endpoint of each line of <map>, so that\n"
+		"    the map given to 'dprc connect --from-file' undoes its links.\n"
 		"\n"
 		"NOTES:\n"
 		"  -<parent-container> must be an ancestor of the <object>\n"
@@ -2193,6 +2303,22 @@ static int cmd_dprc_disconnect(void)
 		dprc_handle = restool.root_dprc_handle;
 	}
 
+	if (restool.cmd_option_mask & ONE_BIT_MASK(DISCONNECT_OPT_FROM_FILE)) {
+		restool.cmd_option_mask &=
+			~ONE_BIT_MASK(DISCONNECT_OPT_FROM_FILE);
+		if (restool.cmd_option_mask &
+		    ONE_BIT_MASK(DISCONNECT_OPT_ENDPOINT)) {
+			ERROR_PRINTF("--from-file cannot be used with --endpoint\n");
+			error = -EINVAL;
+			goto out;
+		}
+
+		error = dprc_connect_from_file(parent_dprc_id, dprc_handle,
+			restool.cmd_option_args[DISCONNECT_OPT_FROM_FILE],
+			false);
+		goto out;
+	}
+
 	if (!(restool.cmd_option_mask &
 	    ONE_BIT_MASK(DISCONNECT_OPT_ENDPOINT))) {
 		ERROR_PRINTF("--endpoint option missing\n");
@@ -2237,15 +2363,112 @@ out:
 	return error;
 }
 
+static int cmd_dprc_clone(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dprc clone <container> [--count=<number>]\n"
+		"		[--parent=<parent-container>]\n"
+		"\n"
+		"Creates copies of <container>, its child containers and their objects,\n"
+		"with the same options and attributes, and connects the copied objects\n"
+		"the way the original ones are connected.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--count=<number>\n"
+		"   Number of copies to create (default: 1).\n"
+		"--parent=<parent-container>\n"
+		"   Container the copies are created under (default: the parent of\n"
+		"   <container>).\n"
+		"\n"
+		"NOTE:\n"
+		" -The container tree and the attributes of its objects are read once,\n"
+		"  the way 'dprc generate-dpl' does, and every copy is created from\n"
+		"  them.\n"
+		" -DPMACs and the connections to objects out of the container tree\n"
+		"  are not copied.\n"
+		" -The copied objects are plugged, whatever the plugged state of the\n"
+		"  original ones.\n"
+		" -A copy that fails midway is undone, the copies already created\n"
+		"  are kept.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"Create 4 copies of dprc.2 under dprc.1:\n"
+		"   $ restool dprc clone dprc.2 --count=4 --parent=dprc.1\n"
+		"\n";
+	struct dprc_obj_desc obj_desc;
+	uint32_t parent_dprc_id;
+	uint32_t dprc_id;
+	bool found = false;
+	long count = 1;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(CLONE_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(CLONE_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<container> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	error = parse_object_name(restool.obj_name, "dprc", &dprc_id);
+	if (error < 0)
+		return error;
+
+	if (dprc_id == restool.root_dprc_id) {
+		ERROR_PRINTF("The root DPRC (%s) cannot be cloned\n",
+			     restool.obj_name);
+		return -EINVAL;
+	}
+
+	memset(&obj_desc, 0, sizeof(obj_desc));
+	error = find_target_obj_desc(restool.root_dprc_id,
+				     restool.root_dprc_handle, 0, dprc_id,
+				     "dprc", &obj_desc, &parent_dprc_id, &found);
+	if (!found) {
+		if (error == 0)
+			printf("%s does not exist\n", restool.obj_name);
+		return -EINVAL;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(CLONE_OPT_COUNT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(CLONE_OPT_COUNT);
+		error = get_option_value(CLONE_OPT_COUNT, &count,
+					 "Invalid count", 1, UINT16_MAX);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(CLONE_OPT_PARENT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(CLONE_OPT_PARENT);
+		error = parse_object_name(
+				restool.cmd_option_args[CLONE_OPT_PARENT],
+				"dprc", &parent_dprc_id);
+		if (error < 0)
+			return error;
+	}
+
+	return dpl_clone(dprc_id, parent_dprc_id, count);
+}
+
 static int cmd_dpl_generate(void)
 {
 	int error;
 
 	static const char usage_msg[] =
 		"\n"
-		"Usage: restool dprc generate-dpl <container>\n"
+		"Usage: restool dprc generate-dpl <container> [--format=<format>]\n"
 		"   <container> specifies the name of the container\n"
 		"\n"
+		"OPTIONS:\n"
+		"--format=<format>\n"
+		"   dts (default) writes the DPL source, dtb writes it compiled to\n"
+		"   a flattened device tree blob, as dtc -O dtb would.\n"
+		"\n"
 		"NOTES:\n"
 		"Generates the DPL syntax for the specified container to stdout,\n"
 		"including all child and decendant containers.\n"
@@ -2253,7 +2476,10 @@ static int cmd_dpl_generate(void)
 		"EXAMPLE:\n"
 		"Generate a DPL for dprc.1:\n"
 		"   $ restool dprc generate-dpl dprc.1\n"
+		"Generate a DPL blob for dprc.1:\n"
+		"   $ restool dprc generate-dpl dprc.1 --format=dtb > dpl.dtb\n"
 		"\n";
+	bool dtb = false;
 
 	if (restool.cmd_option_mask & ONE_BIT_MASK(GENERATE_OPT_HELP)) {
 		puts(usage_msg);
@@ -2261,11 +2487,103 @@ static int cmd_dpl_generate(void)
 		return 0;
 	}
 
-	error = dpl_generate();
+	if (restool.cmd_option_mask & ONE_BIT_MASK(GENERATE_OPT_FORMAT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(GENERATE_OPT_FORMAT);
+		if (strcmp(restool.cmd_option_args[GENERATE_OPT_FORMAT],
+			   "dtb") == 0) {
+			dtb = true;
+		} else if (strcmp(restool.cmd_option_args[GENERATE_OPT_FORMAT],
+				  "dts") != 0) {
+			ERROR_PRINTF("Invalid format: %s\n",
+				     restool.cmd_option_args[GENERATE_OPT_FORMAT]);
+			puts(usage_msg);
+			return -EINVAL;
+		}
+	}
+
+	error = dpl_generate(dtb);
 
 	return error;
 }
 
+static int cmd_dprc_top(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool dprc top [<container>] [--sort=<key>] [--interval=<ms>]\n"
+		"                        [--count=<n>]\n"
+		"   <container> is the root of the container tree displayed, the root\n"
+		"   container by default\n"
+		"\n"
+		"Displays the DPNI, DPMAC, DPSW and DPDMUX objects of the container tree\n"
+		"with their rx and tx rates in frames (pps) and bits (bps) per second\n"
+		"and their discarded frames per second, busiest first, refreshed until\n"
+		"interrupted. The rates of a DPSW or a DPDMUX are the sums of the\n"
+		"rates of its interfaces.\n"
+		"\n"
+		"The objects and their endpoints are read once; a refresh only reads\n"
+		"the counters of the objects.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--sort=<key>\n"
+		"   bps (default), pps, rx-bps, tx-bps, rx-pps, tx-pps or drops.\n"
+		"--interval=<ms>\n"
+		"   Refreshes every <ms> milliseconds, 1000 by default.\n"
+		"--count=<n>\n"
+		"   Stops after <n> refreshes.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"Display the objects dropping the most frames:\n"
+		"   $ restool dprc top --sort=drops\n"
+		"\n";
+	const char *sort = "bps";
+	long interval_ms = 1000;
+	uint32_t dprc_id;
+	long count = 0;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(TOP_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(TOP_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		dprc_id = restool.root_dprc_id;
+	} else {
+		error = parse_object_name(restool.obj_name, "dprc", &dprc_id);
+		if (error < 0)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(TOP_OPT_SORT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(TOP_OPT_SORT);
+		sort = restool.cmd_option_args[TOP_OPT_SORT];
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(TOP_OPT_INTERVAL)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(TOP_OPT_INTERVAL);
+		error = get_option_value(TOP_OPT_INTERVAL, &interval_ms,
+					 "Invalid interval", 1, 3600000);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(TOP_OPT_COUNT)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(TOP_OPT_COUNT);
+		error = get_option_value(TOP_OPT_COUNT, &count,
+					 "Invalid count", 1, LONG_MAX);
+		if (error)
+			return error;
+	}
+
+	error = daemon_decline_command();
+	if (error)
+		return error;
+
+	return dprc_top(dprc_id, sort, interval_ms, count);
+}
+
 /**
  * DPRC command table
  */
@@ -2326,6 +2644,14 @@ struct object_command dprc_commands[] = {
 	  .options = dpl_generate_options,
 	  .cmd_func = cmd_dpl_generate },
 
+	{ .cmd_name = "top",
+	  .options = dprc_top_options,
+	  .cmd_func = cmd_dprc_top },
+
+	{ .cmd_name = "clone",
+	  .options = dprc_clone_options,
+	  .cmd_func = cmd_dprc_clone },
+
 	{ .cmd_name = NULL },
 };
 
@@ -0,0 +1,441 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include "restool.h"
+#include "utils.h"
+#include "dprc_commands_connect.h"
+#include "mc_v10/fsl_dprc.h"
+
+/**
+ * Maximum number of words of a link-map line
+ */
+#define LINK_MAP_MAX_WORDS	4
+
+/**
+ * struct link - line of a link-map file
+ * @line: line number in the file
+ * @endpoint1: first endpoint
+ * @endpoint2: second endpoint, unused when disconnecting
+ * @cfg: rates of the connection
+ */
+struct link {
+	unsigned int line;
+	struct dprc_endpoint endpoint1;
+	struct dprc_endpoint endpoint2;
+	struct dprc_connection_cfg cfg;
+};
+
+/**
+ * struct link_map - links read from a link-map file
+ */
+struct link_map {
+	struct link *links;
+	unsigned int num_links;
+	unsigned int max_links;
+};
+
+/**
+ * struct link_obj - object of the topology snapshot that is an endpoint
+ * @type: object type
+ * @id: object id
+ * @num_ifs: number of interfaces of the object
+ */
+struct link_obj {
+	const char *type;
+	uint32_t id;
+	uint16_t num_ifs;
+};
+
+int parse_endpoint(char *endpoint_str, struct dprc_endpoint *endpoint)
+{
+	int n;
+
+	memset(endpoint, 0, sizeof(*endpoint));
+
+	n = sscanf(endpoint_str,
+		   "%" STRINGIFY(OBJ_TYPE_MAX_LENGTH) "[a-z].%d.%hu",
+		   endpoint->type, &endpoint->id, &endpoint->if_id);
+
+	if (n < 2)
+		return -EINVAL;
+
+	if (n == 2)
+		assert(endpoint->if_id == 0);
+
+	return 0;
+}
+
+static int parse_rate(const char *str, unsigned int line, uint32_t *rate)
+{
+	unsigned long val;
+	char *endptr;
+
+	errno = 0;
+	val = strtoul(str, &endptr, 0);
+	if (errno != 0 || *endptr != '\0' || endptr == str ||
+	    val < 1 || val > UINT32_MAX) {
+		ERROR_PRINTF("line %u: invalid rate '%s'\n", line, str);
+		return -EINVAL;
+	}
+
+	*rate = val;
+	return 0;
+}
+
+/**
+ * Parse a link-map line split in 'words'. Only the first endpoint is
+ * needed to disconnect, the rest of the line is then ignored.
+ */
+static int parse_link(char *words[], int num_words, bool connect,
+		      struct link *link)
+{
+	int error;
+
+	if (num_words != 2 && num_words != 4 && (connect || num_words > 4)) {
+		ERROR_PRINTF("line %u: <endpoint1> <endpoint2> [<committed-rate> <max-rate>] expected\n",
+			     link->line);
+		return -EINVAL;
+	}
+
+	error = parse_endpoint(words[0], &link->endpoint1);
+	if (error < 0) {
+		ERROR_PRINTF("line %u: invalid endpoint '%s'\n",
+			     link->line, words[0]);
+		return error;
+	}
+
+	if (!connect)
+		return 0;
+
+	error = parse_endpoint(words[1], &link->endpoint2);
+	if (error < 0) {
+		ERROR_PRINTF("line %u: invalid endpoint '%s'\n",
+			     link->line, words[1]);
+		return error;
+	}
+
+	if (num_words == 2)
+		return 0;
+
+	error = parse_rate(words[2], link->line, &link->cfg.committed_rate);
+	if (error < 0)
+		return error;
+
+	error = parse_rate(words[3], link->line, &link->cfg.max_rate);
+	if (error < 0)
+		return error;
+
+	if (link->cfg.max_rate < link->cfg.committed_rate) {
+		ERROR_PRINTF("line %u: max-rate must be bigger than committed-rate\n",
+			     link->line);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Read the link-map file 'path': one link per line, blank lines and
+ * text following a '#' being ignored
+ */
+static int read_link_map(const char *path, bool connect,
+			 struct link_map *map)
+{
+	char *words[LINK_MAP_MAX_WORDS + 1];
+	unsigned int line_num = 0;
+	size_t line_size = 0;
+	char *line = NULL;
+	int error = 0;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		error = -errno;
+		ERROR_PRINTF("cannot open %s (error %d)\n", path, error);
+		return error;
+	}
+
+	while (getline(&line, &line_size, fp) >= 0) {
+		struct link *link;
+		char *saveptr;
+		char *comment;
+		int num_words = 0;
+
+		line_num++;
+		comment = strchr(line, '#');
+		if (comment)
+			*comment = '\0';
+
+		for (char *word = strtok_r(line, " \t\r\n", &saveptr);
+		     word && num_words <= LINK_MAP_MAX_WORDS;
+		     word = strtok_r(NULL, " \t\r\n", &saveptr))
+			words[num_words++] = word;
+
+		if (num_words == 0)
+			continue;
+
+		if (map->num_links == map->max_links) {
+			unsigned int max = map->max_links * 2 + 16;
+
+			link = realloc(map->links, max * sizeof(*link));
+			if (!link) {
+				error = -ENOMEM;
+				break;
+			}
+
+			map->links = link;
+			map->max_links = max;
+		}
+
+		link = &map->links[map->num_links];
+		memset(link, 0, sizeof(*link));
+		link->line = line_num;
+		error = parse_link(words, num_words, connect, link);
+		if (error < 0)
+			break;
+
+		map->num_links++;
+	}
+
+	if (error == 0 && ferror(fp)) {
+		error = -errno;
+		ERROR_PRINTF("error reading %s (error %d)\n", path, error);
+	}
+
+	if (error == 0 && map->num_links == 0) {
+		ERROR_PRINTF("no link found in %s\n", path);
+		error = -EINVAL;
+	}
+
+	free(line);
+	fclose(fp);
+	return error;
+}
+
+static bool same_endpoint(const struct dprc_endpoint *endpoint1,
+			  const struct dprc_endpoint *endpoint2)
+{
+	return strcmp(endpoint1->type, endpoint2->type) == 0 &&
+	       endpoint1->id == endpoint2->id &&
+	       endpoint1->if_id == endpoint2->if_id;
+}
+
+/**
+ * Check 'endpoint' of the link of 'line' against the objects of the
+ * snapshot 'objs', reading the number of interfaces of multi-port
+ * objects the first time they are met
+ */
+static int check_endpoint(const struct dprc_endpoint *endpoint,
+			  unsigned int line, struct link_obj *objs,
+			  unsigned int num_objs)
+{
+	struct link_obj *obj = NULL;
+	int error;
+
+	for (unsigned int i = 0; i < num_objs; i++) {
+		if (objs[i].id == (uint32_t)endpoint->id &&
+		    strcmp(objs[i].type, endpoint->type) == 0) {
+			obj = &objs[i];
+			break;
+		}
+	}
+
+	if (!obj) {
+		ERROR_PRINTF("line %u: %s.%d is not in the container\n",
+			     line, endpoint->type, endpoint->id);
+		return -ENOENT;
+	}
+
+	if (obj->num_ifs == 0) {
+		error = get_obj_num_ifs(obj->type, obj->id, &obj->num_ifs);
+		if (error < 0)
+			return error;
+	}
+
+	if (endpoint->if_id >= obj->num_ifs) {
+		ERROR_PRINTF("line %u: %s.%d has no interface %u\n",
+			     line, endpoint->type, endpoint->id,
+			     endpoint->if_id);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Check all the links of 'map' against a single snapshot of the container
+ * tree of 'dprc_id': their endpoints must exist under the container, have
+ * the interfaces given and be used only once in the map
+ */
+static int check_link_map(uint32_t dprc_id, uint16_t dprc_handle,
+			  bool connect, const struct link_map *map)
+{
+	struct walk_result walk = { 0 };
+	struct link_obj *objs = NULL;
+	unsigned int num_objs = 0;
+	int error;
+
+	error = walk_containers(dprc_id, dprc_handle, 0, &walk);
+	if (error < 0)
+		return error;
+
+	for (unsigned int i = 0; i < walk.num_containers; i++)
+		num_objs += walk.containers[i].num_objs;
+
+	objs = calloc(num_objs ? num_objs : 1, sizeof(*objs));
+	if (!objs) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	num_objs = 0;
+	for (unsigned int i = 0; i < walk.num_containers; i++) {
+		const struct walk_container *container = &walk.containers[i];
+
+		for (int j = 0; j < container->num_objs; j++) {
+			objs[num_objs].type = container->objs[j].type;
+			objs[num_objs].id = container->objs[j].id;
+			num_objs++;
+		}
+	}
+
+	for (unsigned int i = 0; i < map->num_links; i++) {
+		const struct link *link = &map->links[i];
+
+		error = check_endpoint(&link->endpoint1, link->line,
+				       objs, num_objs);
+		if (error < 0)
+			goto out;
+
+		if (connect) {
+			error = check_endpoint(&link->endpoint2, link->line,
+					       objs, num_objs);
+			if (error < 0)
+				goto out;
+
+			if (same_endpoint(&link->endpoint1,
+					  &link->endpoint2)) {
+				ERROR_PRINTF("line %u: endpoint connected to itself\n",
+					     link->line);
+				error = -EINVAL;
+				goto out;
+			}
+		}
+
+		for (unsigned int k = 0; k < i; k++) {
+			const struct link *prev = &map->links[k];
+			const struct dprc_endpoint *endpoint = NULL;
+
+			if (same_endpoint(&link->endpoint1, &prev->endpoint1) ||
+			    (connect &&
+			     same_endpoint(&link->endpoint1, &prev->endpoint2)))
+				endpoint = &link->endpoint1;
+			else if (connect &&
+				 (same_endpoint(&link->endpoint2,
+						&prev->endpoint1) ||
+				  same_endpoint(&link->endpoint2,
+						&prev->endpoint2)))
+				endpoint = &link->endpoint2;
+
+			if (endpoint) {
+				ERROR_PRINTF("line %u: %s.%d.%u already used on line %u\n",
+					     link->line, endpoint->type,
+					     endpoint->id, endpoint->if_id,
+					     prev->line);
+				error = -EINVAL;
+				goto out;
+			}
+		}
+	}
+
+out:
+	free(objs);
+	walk_free(&walk);
+	return error;
+}
+
+/**
+ * Connect (or disconnect if 'connect' is false) the links of the link-map
+ * file 'path' under the container 'dprc_id' open on 'dprc_handle'. The
+ * whole map is checked before the first MC command changing a connection
+ * is sent, the links are then processed in the order of the file until
+ * one fails.
+ */
+int dprc_connect_from_file(uint32_t dprc_id, uint16_t dprc_handle,
+			   const char *path, bool connect)
+{
+	struct link_map map = { 0 };
+	enum mc_cmd_status mc_status;
+	unsigned int done = 0;
+	int error;
+
+	error = read_link_map(path, connect, &map);
+	if (error < 0)
+		goto out;
+
+	error = check_link_map(dprc_id, dprc_handle, connect, &map);
+	if (error < 0)
+		goto out;
+
+	for ( ; done < map.num_links; done++) {
+		struct link *link = &map.links[done];
+
+		if (connect)
+			error = dprc_connect(&restool.mc_io, 0, dprc_handle,
+					     &link->endpoint1,
+					     &link->endpoint2, &link->cfg);
+		else
+			error = dprc_disconnect(&restool.mc_io, 0,
+						dprc_handle,
+						&link->endpoint1);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("line %u: MC error: %s (status %#x)\n",
+				     link->line,
+				     mc_status_to_string(mc_status),
+				     mc_status);
+			ERROR_PRINTF("%u of %u links %s\n", done,
+				     map.num_links,
+				     connect ? "connected" : "disconnected");
+			break;
+		}
+	}
+
+out:
+	free(map.links);
+	return error;
+}
@@ -0,0 +1,612 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+#include "dprc_commands_destroy.h"
+#include "mc_v10/fsl_dprc.h"
+
+/**
+ * struct destroy_type - object type destroyed with its container
+ * @type: object type
+ * @ops: flib operations of the type
+ * @connectable: objects of the type have interfaces to disconnect
+ */
+struct destroy_type {
+	const char *type;
+	const struct flib_ops *ops;
+	bool connectable;
+};
+
+/*
+ * The objects of a container are destroyed type by type, in this order:
+ * the objects using others go before the objects they use
+ */
+static const struct destroy_type destroy_types[] = {
+	{ "dpni", &dpni_ops, true },
+	{ "dpsw", &dpsw_ops, true },
+	{ "dpdmux", &dpdmux_ops, true },
+	{ "dpci", &dpci_ops, true },
+	{ "dpseci", &dpseci_ops, false },
+	{ "dpdmai", &dpdmai_ops, false },
+	{ "dpdcei", &dpdcei_ops, false },
+	{ "dpcon", &dpcon_ops, false },
+	{ "dpbp", &dpbp_ops, false },
+	{ "dpio", &dpio_ops, false },
+	{ "dpmcp", &dpmcp_ops, false },
+};
+
+/*
+ * Objects of these types stand for hardware blocks: they are returned to
+ * the parent of the destroyed container instead of being destroyed
+ */
+static const char * const keep_types[] = {
+	"dpmac",
+	"dpaiop",
+	"dprtc",
+};
+
+/**
+ * struct destroy_state - state shared by the threads tearing down a
+ * container tree
+ * @lock: protects all the fields below
+ * @cond: signaled when a container is ready or the teardown is over
+ * @walk: snapshot of the tree, the first container is the top one
+ * @parents: for each container, index of its parent in @walk
+ * @pending: for each container, number of child containers not
+ *	destroyed yet
+ * @ready: indexes of the containers whose children are all destroyed
+ * @num_ready: number of entries of @ready
+ * @next_ready: index in @ready of the next container to empty
+ * @done: the top container is empty
+ * @error: first error met, the teardown stops as soon as it is set
+ */
+struct destroy_state {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	const struct walk_result *walk;
+	unsigned int *parents;
+	unsigned int *pending;
+	unsigned int *ready;
+	unsigned int num_ready;
+	unsigned int next_ready;
+	bool done;
+	int error;
+};
+
+static const struct destroy_type *find_destroy_type(const char *type)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(destroy_types); i++) {
+		if (strcmp(destroy_types[i].type, type) == 0)
+			return &destroy_types[i];
+	}
+
+	return NULL;
+}
+
+static bool is_keep_type(const char *type)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(keep_types); i++) {
+		if (strcmp(keep_types[i], type) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Check that every object of the snapshot can be destroyed before
+ * changing anything
+ */
+static int destroy_check(const struct walk_result *walk)
+{
+	char name[OBJ_TYPE_MAX_LENGTH + 12];
+
+	for (unsigned int i = 0; i < walk->num_containers; i++) {
+		const struct walk_container *container = &walk->containers[i];
+
+		snprintf(name, sizeof(name), "dprc.%u", container->id);
+		if (in_use(name, "destroyed"))
+			return -EBUSY;
+
+		for (int j = 0; j < container->num_objs; j++) {
+			const struct dprc_obj_desc *obj = &container->objs[j];
+
+			if (container->children[j] >= 0)
+				continue;
+
+			snprintf(name, sizeof(name), "%s.%d",
+				 obj->type, obj->id);
+			if (!find_destroy_type(obj->type) &&
+			    !is_keep_type(obj->type)) {
+				ERROR_PRINTF("%s cannot be destroyed\n", name);
+				return -EINVAL;
+			}
+
+			if (in_use(name, "destroyed"))
+				return -EBUSY;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Only the interfaces of a DPSW or DPDMUX are named
+ */
+static void endpoint_name(char *name, size_t size,
+			  const struct dprc_endpoint *endpoint)
+{
+	if (strncmp(endpoint->type, "dpsw", EP_OBJ_TYPE_MAX_LEN) == 0 ||
+	    strncmp(endpoint->type, "dpdmux", EP_OBJ_TYPE_MAX_LEN) == 0)
+		snprintf(name, size, "%.*s.%d.%d", EP_OBJ_TYPE_MAX_LEN,
+			 endpoint->type, endpoint->id, endpoint->if_id);
+	else
+		snprintf(name, size, "%.*s.%d", EP_OBJ_TYPE_MAX_LEN,
+			 endpoint->type, endpoint->id);
+}
+
+/**
+ * Disconnect the interfaces of an object from their peers, which may be
+ * outside of the tree
+ */
+static int destroy_disconnect(const struct dprc_obj_desc *obj)
+{
+	struct dprc_endpoint endpoint1;
+	struct dprc_endpoint endpoint2;
+	char name1[EP_OBJ_TYPE_MAX_LEN + 24];
+	char name2[EP_OBJ_TYPE_MAX_LEN + 24];
+	uint16_t num_ifs;
+	int state;
+	enum mc_cmd_status mc_status;
+	int error;
+
+	error = get_obj_num_ifs(obj->type, obj->id, &num_ifs);
+	if (error < 0)
+		return error;
+
+	for (uint16_t if_id = 0; if_id < num_ifs; if_id++) {
+		memset(&endpoint1, 0, sizeof(endpoint1));
+		memset(&endpoint2, 0, sizeof(endpoint2));
+		strncpy(endpoint1.type, obj->type, EP_OBJ_TYPE_MAX_LEN);
+		endpoint1.id = obj->id;
+		endpoint1.if_id = if_id;
+
+		state = -1;
+		error = dprc_get_connection(&restool.mc_io, 0,
+					    restool.root_dprc_handle,
+					    &endpoint1, &endpoint2, &state);
+		if (error < 0 || state == -1)
+			continue;
+
+		error = dprc_disconnect(&restool.mc_io, 0,
+					restool.root_dprc_handle, &endpoint1);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+			return error;
+		}
+
+		endpoint_name(name1, sizeof(name1), &endpoint1);
+		endpoint_name(name2, sizeof(name2), &endpoint2);
+		printf("%s is disconnected from %s\n", name1, name2);
+	}
+
+	return 0;
+}
+
+/**
+ * Unplug the kept objects of a container, so that they can be moved
+ */
+static int destroy_unplug_objs(struct fsl_mc_io *mc_io, uint16_t dprc_handle,
+			       const struct walk_container *container)
+{
+	struct dprc_res_req res_req;
+	enum mc_cmd_status mc_status;
+	int error;
+
+	for (int j = 0; j < container->num_objs; j++) {
+		const struct dprc_obj_desc *obj = &container->objs[j];
+
+		if (!is_keep_type(obj->type) ||
+		    !(obj->state & DPRC_OBJ_STATE_PLUGGED))
+			continue;
+
+		memset(&res_req, 0, sizeof(res_req));
+		strncpy(res_req.type, obj->type, sizeof(res_req.type) - 1);
+		res_req.num = 1;
+		res_req.options = DPRC_RES_REQ_OPT_EXPLICIT;
+		res_req.id_base_align = obj->id;
+		error = dprc_assign(mc_io, 0, dprc_handle, container->id,
+				    &res_req);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+			return error;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Move the kept objects of the subtree of walk container 'index', which
+ * all ended up in the container 'child_id', to its parent 'dprc_handle'
+ */
+static int destroy_return_objs(struct fsl_mc_io *mc_io, uint16_t dprc_handle,
+			       uint32_t dprc_id, uint32_t child_id,
+			       const struct walk_result *walk,
+			       unsigned int index)
+{
+	const struct walk_container *container = &walk->containers[index];
+	struct dprc_res_req res_req;
+	enum mc_cmd_status mc_status;
+	int error;
+
+	for (int j = 0; j < container->num_objs; j++) {
+		const struct dprc_obj_desc *obj = &container->objs[j];
+
+		if (container->children[j] >= 0) {
+			error = destroy_return_objs(mc_io, dprc_handle,
+						    dprc_id, child_id, walk,
+						    container->children[j]);
+			if (error < 0)
+				return error;
+
+			continue;
+		}
+
+		if (!is_keep_type(obj->type))
+			continue;
+
+		memset(&res_req, 0, sizeof(res_req));
+		strncpy(res_req.type, obj->type, sizeof(res_req.type) - 1);
+		res_req.num = 1;
+		res_req.options = DPRC_RES_REQ_OPT_EXPLICIT;
+		res_req.id_base_align = obj->id;
+		error = dprc_unassign(mc_io, 0, dprc_handle, child_id,
+				      &res_req);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+			return error;
+		}
+
+		printf("%s.%d is moved to dprc.%u\n", obj->type, obj->id,
+		       dprc_id);
+	}
+
+	return 0;
+}
+
+/**
+ * Destroy the objects of a container, type by type, then its child
+ * containers, which are empty already but for the kept objects of their
+ * subtrees, moved to the container first
+ */
+static int destroy_container_objs(struct fsl_mc_io *mc_io,
+				  const struct walk_result *walk,
+				  unsigned int index)
+{
+	const struct walk_container *container = &walk->containers[index];
+	uint16_t dprc_handle;
+	enum mc_cmd_status mc_status;
+	int error;
+	int error2;
+
+	error = dprc_open(mc_io, 0, container->id, &dprc_handle);
+	if (error < 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			     mc_status_to_string(mc_status), mc_status);
+		return error;
+	}
+
+	error = destroy_unplug_objs(mc_io, dprc_handle, container);
+
+	for (unsigned int t = 0; t < ARRAY_SIZE(destroy_types); t++) {
+		const struct destroy_type *type = &destroy_types[t];
+
+		for (int j = 0; error == 0 && j < container->num_objs; j++) {
+			const struct dprc_obj_desc *obj = &container->objs[j];
+
+			if (strcmp(obj->type, type->type))
+				continue;
+
+			error = type->ops->obj_destroy(mc_io, dprc_handle, 0,
+						       obj->id);
+			if (error < 0) {
+				mc_status = flib_error_to_mc_status(error);
+				ERROR_PRINTF("MC error: %s (status %#x)\n",
+					     mc_status_to_string(mc_status),
+					     mc_status);
+			} else {
+				printf("%s.%d is destroyed\n",
+				       obj->type, obj->id);
+			}
+		}
+	}
+
+	for (int j = 0; error == 0 && j < container->num_objs; j++) {
+		if (container->children[j] < 0)
+			continue;
+
+		error = destroy_return_objs(mc_io, dprc_handle, container->id,
+					    container->objs[j].id, walk,
+					    container->children[j]);
+		if (error < 0)
+			break;
+
+		error = dprc_destroy_container(mc_io, 0, dprc_handle,
+					       container->objs[j].id);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+		} else {
+			printf("dprc.%d is destroyed\n",
+			       container->objs[j].id);
+		}
+	}
+
+	error2 = dprc_close(mc_io, 0, dprc_handle);
+	if (error2 < 0) {
+		mc_status = flib_error_to_mc_status(error2);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			     mc_status_to_string(mc_status), mc_status);
+		if (error == 0)
+			error = error2;
+	}
+
+	return error;
+}
+
+/**
+ * Empty the ready containers on 'mc_io', bottom-up, until the top
+ * container is empty or an error is met
+ */
+static int destroy_run(struct destroy_state *state, struct fsl_mc_io *mc_io)
+{
+	unsigned int index;
+	unsigned int parent;
+	int error;
+
+	pthread_mutex_lock(&state->lock);
+	for ( ; ; ) {
+		while (state->error == 0 && !state->done &&
+		       state->next_ready == state->num_ready)
+			pthread_cond_wait(&state->cond, &state->lock);
+
+		if (state->error != 0 || state->done)
+			break;
+
+		index = state->ready[state->next_ready++];
+		pthread_mutex_unlock(&state->lock);
+
+		error = destroy_container_objs(mc_io, state->walk, index);
+
+		pthread_mutex_lock(&state->lock);
+		if (error < 0 && state->error == 0)
+			state->error = error;
+
+		if (error == 0 && index == 0) {
+			state->done = true;
+		} else if (error == 0) {
+			parent = state->parents[index];
+			if (--state->pending[parent] == 0)
+				state->ready[state->num_ready++] = parent;
+		}
+		pthread_cond_broadcast(&state->cond);
+	}
+	error = state->error;
+	pthread_mutex_unlock(&state->lock);
+
+	return error;
+}
+
+static int destroy_worker_run(void *arg, struct fsl_mc_io *mc_io,
+			      unsigned int index)
+{
+	(void)index;
+	return destroy_run(arg, mc_io);
+}
+
+/**
+ * Empty the containers of 'walk' bottom-up, the containers of
+ * independent subtrees concurrently on up to restool.num_portals MC
+ * portals. The top container itself is left.
+ */
+static int destroy_tree(const struct walk_result *walk)
+{
+	unsigned int max_threads = 0;
+	struct portal_pool pool;
+	struct destroy_state state;
+	int error = 0;
+	int error2;
+
+	memset(&state, 0, sizeof(state));
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.cond, NULL);
+	state.walk = walk;
+	state.parents = calloc(walk->num_containers, sizeof(*state.parents));
+	state.pending = calloc(walk->num_containers, sizeof(*state.pending));
+	state.ready = calloc(walk->num_containers, sizeof(*state.ready));
+	if (!state.parents || !state.pending || !state.ready) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < walk->num_containers; i++) {
+		const struct walk_container *container = &walk->containers[i];
+
+		for (int j = 0; j < container->num_objs; j++) {
+			if (container->children[j] < 0)
+				continue;
+
+			state.parents[container->children[j]] = i;
+			state.pending[i]++;
+		}
+	}
+
+	for (unsigned int i = 0; i < walk->num_containers; i++) {
+		if (state.pending[i] == 0)
+			state.ready[state.num_ready++] = i;
+	}
+
+	if (state.num_ready > 1) {
+		max_threads = restool.num_portals - 1;
+		if (max_threads > state.num_ready - 1)
+			max_threads = state.num_ready - 1;
+	}
+
+	error = portal_pool_start(&pool, max_threads, destroy_worker_run,
+				  &state);
+	if (error < 0)
+		goto out;
+
+	error = destroy_run(&state, &restool.mc_io);
+	error2 = portal_pool_join(&pool);
+	if (error == 0)
+		error = error2;
+
+out:
+	free(state.parents);
+	free(state.pending);
+	free(state.ready);
+	pthread_cond_destroy(&state.cond);
+	pthread_mutex_destroy(&state.lock);
+	return error;
+}
+
+/**
+ * Destroy the container 'dprc_id', child of 'parent_dprc_id', with all
+ * the containers and objects below it: snapshot the tree, check that
+ * nothing of it is bound to a driver, disconnect the interfaces of its
+ * objects, destroy its objects and containers bottom-up and finally the
+ * container itself. The DPMACs, DPAIOPs and DPRTCs of the tree are moved
+ * to 'parent_dprc_id', unplugged.
+ */
+int dprc_destroy_recursive(uint32_t dprc_id, uint32_t parent_dprc_id)
+{
+	struct walk_result walk = { 0 };
+	uint16_t parent_dprc_handle;
+	uint16_t dprc_handle;
+	enum mc_cmd_status mc_status;
+	int error;
+	int error2;
+
+	error = open_dprc(dprc_id, &dprc_handle);
+	if (error < 0)
+		return error;
+
+	error = walk_containers(dprc_id, dprc_handle, 0, &walk);
+	error2 = dprc_close(&restool.mc_io, 0, dprc_handle);
+	if (error2 < 0) {
+		mc_status = flib_error_to_mc_status(error2);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			     mc_status_to_string(mc_status), mc_status);
+		if (error == 0)
+			error = error2;
+	}
+	if (error < 0)
+		goto out;
+
+	error = destroy_check(&walk);
+	if (error < 0)
+		goto out;
+
+	for (unsigned int i = 0; i < walk.num_containers; i++) {
+		const struct walk_container *container = &walk.containers[i];
+
+		for (int j = 0; j < container->num_objs; j++) {
+			const struct dprc_obj_desc *obj = &container->objs[j];
+			const struct destroy_type *type;
+
+			type = find_destroy_type(obj->type);
+			if (!type || !type->connectable)
+				continue;
+
+			error = destroy_disconnect(obj);
+			if (error < 0)
+				goto out;
+		}
+	}
+
+	error = destroy_tree(&walk);
+	if (error < 0)
+		goto out;
+
+	if (parent_dprc_id == restool.root_dprc_id) {
+		parent_dprc_handle = restool.root_dprc_handle;
+	} else {
+		error = open_dprc(parent_dprc_id, &parent_dprc_handle);
+		if (error < 0)
+			goto out;
+	}
+
+	error = destroy_return_objs(&restool.mc_io, parent_dprc_handle,
+				    parent_dprc_id, dprc_id, &walk, 0);
+	if (error == 0) {
+		error = dprc_destroy_container(&restool.mc_io, 0,
+					       parent_dprc_handle, dprc_id);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+		} else {
+			printf("dprc.%u is destroyed\n", dprc_id);
+		}
+	}
+
+	if (parent_dprc_id != restool.root_dprc_id) {
+		error2 = dprc_close(&restool.mc_io, 0, parent_dprc_handle);
+		if (error2 < 0) {
+			mc_status = flib_error_to_mc_status(error2);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+			if (error == 0)
+				error = error2;
+		}
+	}
+
+out:
+	walk_free(&walk);
+	return error;
+}
@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <getopt.h>
 #include <ctype.h>
+#include <pthread.h>
 #include "restool.h"
 #include "utils.h"
 #include "dprc_commands_generate_dpl.h"
@@ -135,22 +136,7 @@ struct dpni_config {
 #define RESTOOL_DYNAMIC_DPL "./dynamic-dpl.dts"
 
 /**
- * struct obj_list - linked list node of all objects
- * @next: tracks next objects, the objects are sorted
- * @type: object type
- * @id: object id
- * @label: object label
- */
-struct obj_list {
-	struct obj_list *next;
-	char type[16];
-	int id;
-	char label[16];
-};
-
-/**
- * struct conn_list - linked list node of 2 connected endpoints
- * @next: tracks next connection, the connections are not sorted.
+ * struct conn_entry - 2 connected endpoints
  * @type1: endpoint1's object type
  * @type2: endpoint2's object type
  * @id1: endpoint1's id
@@ -158,8 +144,7 @@ struct obj_list {
  * @if_id1: endpoint1's interface id, initialized as -1 if no interface
  * @if_id2: endpoint2's interface id, initialized as -1 if no interface
  */
-struct conn_list {
-	struct conn_list *next;
+struct conn_entry {
 	char type1[16];
 	char type2[16];
 	int id1;
@@ -169,261 +154,225 @@ struct conn_list {
 };
 
 /**
- * struct container_list - linked list node of all containers
- * @next: tracks next container
- * @obj_list: tracks the objects in current container, sorted list
+ * struct obj_entry - object found in the container tree
+ * @type: object type
+ * @id: object id
+ * @label: object label
+ * @text: DPL node of the object, written by the fetch stage
+ * @text_len: length of @text
+ * @conns: connections found from the endpoints of the object
+ * @num_conns: number of entries of @conns
+ */
+struct obj_entry {
+	char type[16];
+	int id;
+	char label[16];
+	char *text;
+	size_t text_len;
+	struct conn_entry *conns;
+	unsigned int num_conns;
+};
+
+/**
+ * struct dpl_portal - MC portal objects are fetched on
+ * @mc_io: the MC portal
+ * @root_dprc_handle: handle of the root container opened on @mc_io
+ */
+struct dpl_portal {
+	struct fsl_mc_io *mc_io;
+	uint16_t root_dprc_handle;
+};
+
+/**
+ * struct container_entry - container found in the container tree
+ * @objs: objects of the container, sorted by type and id
+ * @num_objs: number of objects in @objs
  * @id: current container's id
  * @parent_id: current container's parent id. 0 means no parent.
  * @options: configuration options of current container
  */
-struct container_list {
-	struct container_list *next;
-	struct obj_list *obj;
+struct container_entry {
+	struct obj_entry *objs;
+	unsigned int num_objs;
 	int id;
 	int parent_id;
 	uint64_t options;
 };
 
-static int container_count;
-static struct container_list *container_head;
-static struct obj_list *obj_head;
-static struct conn_list *conn_head;
-
-enum mc_cmd_status mc_status;
-
 /**
- * compare_insert_obj - compare the newly added object node with existing ones,
- *			insert in sorted order
- * @head: head of the object list
- * @target: the object node to be inserted
- *
- * Returns 0 on success, negative otherwise
+ * struct dpl_layout - objects and connections of the generated DPL
+ * @arena: single allocation holding @containers, @objs and @sorted_objs
+ * @containers: containers, in depth first order
+ * @objs: objects, grouped by container
+ * @sorted_objs: all the objects, sorted by type and id
+ * @conns: connections, in the order they were found
+ * @conn_hash: open addressing hash set of the connection endpoints,
+ *	holds indexes in @conns plus 1, 0 for a free slot. Each connection
+ *	is hashed once per endpoint.
+ * @conn_hash_size: number of slots in @conn_hash, a power of 2
  */
-static int compare_insert_obj(struct obj_list **head, struct obj_list *target)
-{
-	int error;
-	struct obj_list *prev;
-	struct obj_list *curr;
-
-	if (*head == NULL) {
-		*head = target;
-		target->next = NULL;
-		return 0;
-	}
-
-	curr = prev = *head;
-	while (curr) {
-		error = strcmp(target->type, curr->type);
-
-		if (error < 0) {
-			if (curr == prev) {
-				*head = target;
-				target->next = curr;
-				return 0;
-			}
-
-			prev->next = target;
-			target->next = curr;
-			return 0;
-		}
+struct dpl_layout {
+	void *arena;
+	struct container_entry *containers;
+	unsigned int num_containers;
+	struct obj_entry *objs;
+	struct obj_entry **sorted_objs;
+	unsigned int num_objs;
+	struct conn_entry *conns;
+	unsigned int num_conns;
+	unsigned int max_conns;
+	unsigned int *conn_hash;
+	unsigned int conn_hash_size;
+};
 
-		if (error == 0) {
-			if (target->id < curr->id) {
-				if (curr == prev) {
-					*head = target;
-					target->next = curr;
-					return 0;
-				}
+static struct dpl_layout layout;
 
+/* objects are fetched on several threads */
+static __thread enum mc_cmd_status mc_status;
 
-				prev->next = target;
-				target->next = curr;
-				return 0;
-			}
+static int compare_obj(const struct obj_entry *obj1,
+		       const struct obj_entry *obj2)
+{
+	int error;
 
-			if (target->id == curr->id) {
-				ERROR_PRINTF("Two objects the same: %s.%d\n",
-						curr->type, curr->id);
-				return -EINVAL;
-			}
+	error = strcmp(obj1->type, obj2->type);
+	if (error != 0)
+		return error;
 
-			if (target->id > curr->id) {
-				prev = curr;
-				curr = curr->next;
-			}
-		}
+	return (obj1->id > obj2->id) - (obj1->id < obj2->id);
+}
 
-		if (error > 0) {
-			prev = curr;
-			curr = curr->next;
-		}
-	}
+static int compare_obj_entry(const void *entry1, const void *entry2)
+{
+	return compare_obj(entry1, entry2);
+}
 
-	prev->next = target;
-	target->next = NULL;
-	return 0;
+static int compare_obj_ptr(const void *ptr1, const void *ptr2)
+{
+	return compare_obj(*(struct obj_entry * const *)ptr1,
+			   *(struct obj_entry * const *)ptr2);
 }
 
-static int find_all_obj_desc(uint32_t dprc_id,
-			     uint16_t dprc_handle,
-			     int nesting_level,
-			     struct container_list **prev,
-			     uint32_t parent_id)
+/**
+ * add_container_objs - copy the objects of a container, then of its child
+ *			containers, depth first
+ * @walk: the walked container tree
+ * @index: index of the container in @walk
+ * @obj: where to copy the next object
+ *
+ * Returns the next free object entry
+ */
+static struct obj_entry *add_container_objs(const struct walk_result *walk,
+					    int index, struct obj_entry *obj)
 {
+	const struct walk_container *container = &walk->containers[index];
+	struct container_entry *cont;
 
-	int num_child_devices;
-	int error = 0;
-	enum mc_cmd_status mc_status;
-	struct container_list *prev_cont;
-	struct container_list *curr_cont;
-	struct dprc_attributes dprc_attr;
-
-	if (prev)
-		prev_cont = *prev;
-	curr_cont = malloc(sizeof(struct container_list));
-	if (curr_cont == NULL) {
-		ERROR_PRINTF("malloc failed\n");
-		error = -errno;
-		goto out;
-	}
+	cont = &layout.containers[layout.num_containers++];
+	cont->id = container->id;
+	cont->parent_id = container->parent_id;
+	cont->options = container->options;
+	cont->objs = obj;
+	cont->num_objs = 0;
 
-	assert(nesting_level <= MAX_DPRC_NESTING);
-	if (parent_id == 0) {
-		DEBUG_PRINTF("This is the main dprc.\n");
-		container_head = curr_cont;
-	} else {
-		DEBUG_PRINTF("This is child dprc.\n");
-		prev_cont->next = curr_cont;
-	}
+	for (int i = 0; i < container->num_objs; i++) {
+		const struct dprc_obj_desc *obj_desc = &container->objs[i];
 
-	curr_cont->id = dprc_id;
-	curr_cont->parent_id = parent_id;
-	curr_cont->obj = NULL;
-	curr_cont->next = NULL;
-	if (prev)
-		*prev = curr_cont;
-	prev_cont = curr_cont;
+		if (container->children[i] >= 0)
+			continue;
 
-	memset(&dprc_attr, 0, sizeof(dprc_attr));
-	error = dprc_get_attributes(&restool.mc_io, 0,
-				dprc_handle, &dprc_attr);
-	if (error < 0) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		goto out;
-	}
-	curr_cont->options = dprc_attr.options;
-	container_count++;
-	error = dprc_get_obj_count(&restool.mc_io, 0,
-				   dprc_handle,
-				   &num_child_devices);
-	if (error < 0) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		goto out;
+		DEBUG_PRINTF("it is %s.%u\n", obj_desc->type, obj_desc->id);
+		strncpy(obj->type, obj_desc->type, 16);
+		obj->id = obj_desc->id;
+		strncpy(obj->label, obj_desc->label, 16);
+		obj->text = NULL;
+		obj->text_len = 0;
+		obj->conns = NULL;
+		obj->num_conns = 0;
+		obj++;
+		cont->num_objs++;
 	}
 
-	for (int i = 0; i < num_child_devices; i++) {
-		struct dprc_obj_desc obj_desc;
-		uint16_t child_dprc_handle;
-		int error2;
+	qsort(cont->objs, cont->num_objs, sizeof(*cont->objs),
+	      compare_obj_entry);
 
-		error = dprc_get_obj(
-				&restool.mc_io, 0,
-				dprc_handle,
-				i,
-				&obj_desc);
-		if (error < 0) {
-			DEBUG_PRINTF(
-				"dprc_get_object(%u) failed with error %d\n",
-				i, error);
-			goto out;
-		}
+	for (int i = 0; i < container->num_objs; i++) {
+		if (container->children[i] < 0)
+			continue;
 
-		DEBUG_PRINTF("it is %s.%u\n", obj_desc.type, obj_desc.id);
-
-		if (strcmp(obj_desc.type, "dprc") == 0) {
-
-			error = open_dprc(obj_desc.id, &child_dprc_handle);
-			if (error < 0)
-				goto out;
-
-			DEBUG_PRINTF("entering %s.%u\n", obj_desc.type,
-					obj_desc.id);
-			error = find_all_obj_desc(obj_desc.id,
-					child_dprc_handle,
-					nesting_level + 1,
-					&prev_cont,
-					dprc_id);
-			if (prev)
-				*prev = prev_cont;
-
-			error2 = dprc_close(&restool.mc_io, 0,
-						child_dprc_handle);
-			if (error2 < 0) {
-				mc_status = flib_error_to_mc_status(error2);
-				ERROR_PRINTF("MC error: %s (status %#x)\n",
-				mc_status_to_string(mc_status), mc_status);
-				if (error == 0)
-					error = error2;
+		DEBUG_PRINTF("entering %s.%u\n", container->objs[i].type,
+			     container->objs[i].id);
+		obj = add_container_objs(walk, container->children[i], obj);
+	}
 
-				goto out;
-			}
+	return obj;
+}
 
-			DEBUG_PRINTF("exiting %s.%u\n", obj_desc.type,
-					obj_desc.id);
-		} else {
-			struct obj_list *curr_obj =
-				malloc(sizeof(struct obj_list));
-			if (curr_obj == NULL) {
-				ERROR_PRINTF("malloc failed\n");
-				error = -errno;
-				goto out;
-			}
+/**
+ * find_all_obj_desc - record the containers and objects of the walked
+ *			container tree
+ * @walk: the walked container tree
+ *
+ * Returns 0 on success, negative otherwise
+ */
+static int find_all_obj_desc(const struct walk_result *walk)
+{
+	unsigned int num_objs = 0;
+	uint8_t *arena;
 
-			curr_obj->next = NULL;
-			strncpy(curr_obj->type, obj_desc.type, 16);
-			curr_obj->id = obj_desc.id;
-			strncpy(curr_obj->label, obj_desc.label, 16);
-
-			struct obj_list *curr_obj2 =
-				malloc(sizeof(struct obj_list));
-			if (curr_obj2 == NULL) {
-				ERROR_PRINTF("malloc failed\n");
-				error = -errno;
-				goto out;
-			}
+	for (unsigned int i = 0; i < walk->num_containers; i++)
+		num_objs += walk->containers[i].num_objs;
 
-			curr_obj2->next = NULL;
-			strncpy(curr_obj2->type, obj_desc.type, 16);
-			curr_obj2->id = obj_desc.id;
-			strncpy(curr_obj2->label, obj_desc.label, 16);
-
-			error = compare_insert_obj(&obj_head, curr_obj);
-			if (error)
-				goto out;
-			error = compare_insert_obj(&curr_cont->obj, curr_obj2);
-			if (error)
-				goto out;
+	/* containers, objects and sorted object pointers in one block */
+	arena = malloc(walk->num_containers * sizeof(*layout.containers) +
+		       num_objs * (sizeof(*layout.objs) +
+				   sizeof(*layout.sorted_objs)));
+	if (arena == NULL) {
+		ERROR_PRINTF("malloc failed\n");
+		return -errno;
+	}
+
+	layout.arena = arena;
+	layout.sorted_objs = (struct obj_entry **)arena;
+	arena += num_objs * sizeof(*layout.sorted_objs);
+	layout.objs = (struct obj_entry *)arena;
+	arena += num_objs * sizeof(*layout.objs);
+	layout.containers = (struct container_entry *)arena;
+	layout.num_containers = 0;
+
+	layout.num_objs = add_container_objs(walk, 0, layout.objs) -
+			  layout.objs;
+
+	for (unsigned int i = 0; i < layout.num_objs; i++)
+		layout.sorted_objs[i] = &layout.objs[i];
+	qsort(layout.sorted_objs, layout.num_objs,
+	      sizeof(*layout.sorted_objs), compare_obj_ptr);
+
+	for (unsigned int i = 1; i < layout.num_objs; i++) {
+		if (compare_obj(layout.sorted_objs[i - 1],
+				layout.sorted_objs[i]) == 0) {
+			ERROR_PRINTF("Two objects the same: %s.%d\n",
+				     layout.sorted_objs[i]->type,
+				     layout.sorted_objs[i]->id);
+			return -EINVAL;
 		}
 	}
 
-out:
-	return error;
+	return 0;
 }
 
 static int parse_layout(uint32_t dprc_id)
 {
 	int error;
+	int error2;
+	struct walk_result walk;
 
 	bool opened = false;
 
 	uint16_t dprc_handle;
 
 	/* if no dprc specified, use root dprc */
-	if (restool.obj_name == NULL || dprc_id == restool.root_dprc_id) {
+	if (dprc_id == 0 || dprc_id == restool.root_dprc_id) {
 		dprc_id = restool.root_dprc_id;
 		dprc_handle = restool.root_dprc_handle;
 	} else {
@@ -437,15 +386,20 @@ static int parse_layout(uint32_t dprc_id)
 		opened = true;
 	}
 
-	error = find_all_obj_desc(dprc_id, dprc_handle, 0, NULL, 0);
+	error = walk_containers(dprc_id, dprc_handle, WALK_ATTRIBUTES, &walk);
+	if (error == 0)
+		error = find_all_obj_desc(&walk);
+
+	walk_free(&walk);
 
 	if (opened == true) {
-		error = dprc_close(&restool.mc_io, 0, dprc_handle);
-		if (error < 0) {
-			mc_status = flib_error_to_mc_status(error);
+		error2 = dprc_close(&restool.mc_io, 0, dprc_handle);
+		if (error2 < 0) {
+			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
 				     mc_status_to_string(mc_status), mc_status);
-			goto out;
+			if (error == 0)
+				error = error2;
 		}
 
 	}
@@ -536,10 +490,9 @@ static char *to_upper(char *string)
 	return upper_string;
 }
 
-static int start_obj_set(char *obj_type)
+static int start_obj_set(FILE *fp, char *obj_type)
 {
 	char *obj_type_upper;
-	FILE *fp = stdout;
 
 	obj_type_upper = to_upper(obj_type);
 	if (!obj_type_upper)
@@ -556,31 +509,26 @@ static int start_obj_set(char *obj_type)
 	return 0;
 }
 
-static void add_to_obj_set(int index)
+static void add_to_obj_set(FILE *fp, int index)
 {
-	FILE *fp = stdout;
-
 	fprintf(fp, "%d ", index);
 }
 
-static void end_obj_set(void)
+static void end_obj_set(FILE *fp)
 {
-	FILE *fp = stdout;
-
 	fprintf(fp, ">;\n");
 	fprintf(fp, "\t\t\t\t};\n");
 }
 
-static int write_containers(void)
+static int write_containers(FILE *fp)
 {
-	struct container_list *curr_cont;
-	struct obj_list *curr_obj;
-	struct obj_list *prev_obj;
+	struct container_entry *curr_cont;
+	struct obj_entry *curr_obj;
+	struct obj_entry *prev_obj;
 	char curr_obj_type[OBJ_TYPE_MAX_LENGTH];
 	int remain, error;
 	int obj_num = 99;
 	int base = 100;
-	FILE *fp = stdout;
 
 	fprintf(fp,
 		"\t/*****************************************************************\n");
@@ -590,11 +538,10 @@ static int write_containers(void)
 
 	fprintf(fp, "\tcontainers {\n");
 
-	curr_cont = container_head;
-	while (curr_cont) {
+	for (unsigned int i = 0; i < layout.num_containers; i++) {
+		curr_cont = &layout.containers[i];
 		obj_num = 99;
 		prev_obj = NULL;
-		curr_obj = curr_cont->obj;
 		memset(curr_obj_type, 0, OBJ_TYPE_MAX_LENGTH);
 
 		fprintf(fp, "\n");
@@ -611,12 +558,11 @@ static int write_containers(void)
 		fprintf(fp, "\n");
 		fprintf(fp, "\t\t\tobjects {\n");
 
-		while (curr_obj) {
+		for (unsigned int j = 0; j < curr_cont->num_objs; j++) {
+			curr_obj = &curr_cont->objs[j];
 			if (strcmp(curr_obj->type, "dpmcp") == 0 &&
-			    0 == curr_obj->id) {
-				curr_obj = curr_obj->next;
+			    0 == curr_obj->id)
 				continue;
-			}
 			if (prev_obj == NULL ||
 			    strcmp(curr_obj->type, prev_obj->type) > 0) {
 				remain = obj_num % base;
@@ -633,38 +579,38 @@ static int write_containers(void)
 			} else if (restool.mc_fw_version.major == MC_FW_VERSION_10) {
 				if (curr_obj_type[0] == '\0') {
 					memcpy(curr_obj_type, curr_obj->type, OBJ_TYPE_MAX_LENGTH);
-					error = start_obj_set(curr_obj->type);
+					error = start_obj_set(fp, curr_obj->type);
 					if (error) {
 						ERROR_PRINTF("start_obj_set() failed with error = %d\n", error);
 						return error;
 					}
 
-					add_to_obj_set(curr_obj->id);
+					add_to_obj_set(fp, curr_obj->id);
 				} else if (strcmp(curr_obj_type, curr_obj->type)) {
-					end_obj_set();
+					end_obj_set(fp);
 
 					memcpy(curr_obj_type, curr_obj->type, OBJ_TYPE_MAX_LENGTH);
-					error = start_obj_set(curr_obj->type);
+					error = start_obj_set(fp, curr_obj->type);
 					if (error) {
 						ERROR_PRINTF("start_obj_set() failed with error = %d\n", error);
 						return error;
 					}
-					add_to_obj_set(curr_obj->id);
+					add_to_obj_set(fp, curr_obj->id);
 				} else {
-					add_to_obj_set(curr_obj->id);
+					add_to_obj_set(fp, curr_obj->id);
 				}
 			}
 
 			obj_num++;
 			prev_obj = curr_obj;
-			curr_obj = curr_obj->next;
 		}
 
-		end_obj_set();
+		/* empty containers and MC v9 DPLs have no object set open */
+		if (curr_obj_type[0] != '\0')
+			end_obj_set(fp);
 
 		fprintf(fp, "\t\t\t};\n");
 		fprintf(fp, "\t\t};\n");
-		curr_cont = curr_cont->next;
 	}
 
 	fprintf(fp, "\t};\n");
@@ -673,29 +619,109 @@ static int write_containers(void)
 }
 
 /**
- * compare_insert_connection - Just insert target into conn_list.
- *				The conn_list is unsorted.
- *				Algorithm is used to avoid adding duplication
- *				connection node from 2 objects
- * @head: conn_list head
+ * add_obj_connection - record a connection found from an endpoint of obj,
+ *			it is added to the DPL once all objects are fetched
+ */
+static int add_obj_connection(struct obj_entry *obj,
+			      const struct conn_entry *conn)
+{
+	struct conn_entry *conns;
+
+	conns = realloc(obj->conns, (obj->num_conns + 1) * sizeof(*conns));
+	if (conns == NULL) {
+		ERROR_PRINTF("malloc failed\n");
+		return -ENOMEM;
+	}
+
+	conns[obj->num_conns++] = *conn;
+	obj->conns = conns;
+
+	return 0;
+}
+
+static unsigned int hash_endpoint(const char *type, int id, int if_id)
+{
+	unsigned int hash = 2166136261u;
+
+	/* FNV-1a */
+	while (*type)
+		hash = (hash ^ (unsigned char)*type++) * 16777619u;
+	hash = (hash ^ (unsigned int)id) * 16777619u;
+	hash = (hash ^ (unsigned int)if_id) * 16777619u;
+
+	return hash;
+}
+
+static void hash_connection(struct dpl_layout *l, unsigned int index)
+{
+	const struct conn_entry *conn = &l->conns[index];
+	unsigned int mask = l->conn_hash_size - 1;
+	unsigned int slot;
+
+	slot = hash_endpoint(conn->type1, conn->id1, conn->if_id1) & mask;
+	while (l->conn_hash[slot] != 0)
+		slot = (slot + 1) & mask;
+	l->conn_hash[slot] = index + 1;
+
+	slot = hash_endpoint(conn->type2, conn->id2, conn->if_id2) & mask;
+	while (l->conn_hash[slot] != 0)
+		slot = (slot + 1) & mask;
+	l->conn_hash[slot] = index + 1;
+}
+
+/**
+ * grow_connections - make room for one more connection, keeping the hash
+ *			set at most half full
+ */
+static int grow_connections(struct dpl_layout *l)
+{
+	struct conn_entry *conns;
+	unsigned int *conn_hash;
+	unsigned int max_conns;
+
+	if (l->num_conns < l->max_conns)
+		return 0;
+
+	max_conns = l->max_conns ? 2 * l->max_conns : 64;
+	conns = realloc(l->conns, max_conns * sizeof(*conns));
+	if (conns == NULL)
+		return -ENOMEM;
+	l->conns = conns;
+
+	/* 2 endpoints per connection */
+	conn_hash = calloc(4 * max_conns, sizeof(*conn_hash));
+	if (conn_hash == NULL)
+		return -ENOMEM;
+	free(l->conn_hash);
+	l->conn_hash = conn_hash;
+	l->conn_hash_size = 4 * max_conns;
+	l->max_conns = max_conns;
+
+	for (unsigned int i = 0; i < l->num_conns; i++)
+		hash_connection(l, i);
+
+	return 0;
+}
+
+/**
+ * insert_connection - add target to the connections, unless it is found
+ *			already from its other endpoint
  * @target: the one to be inserted
  *
  * Return 0 on success, negative otherwise
  */
-static int compare_insert_connection(struct conn_list **head,
-				     struct conn_list *target)
+static int insert_connection(const struct conn_entry *target)
 {
-	struct conn_list *prev;
-	struct conn_list *curr;
+	unsigned int mask = layout.conn_hash_size - 1;
+	const struct conn_entry *curr;
+	unsigned int slot;
+	int error;
 
-	if (*head == NULL) {
-		*head = target;
-		target->next = NULL;
-		return 0;
-	}
+	slot = hash_endpoint(target->type1, target->id1, target->if_id1);
+	for (slot &= mask; layout.conn_hash_size != 0 &&
+	     layout.conn_hash[slot] != 0; slot = (slot + 1) & mask) {
+		curr = &layout.conns[layout.conn_hash[slot] - 1];
 
-	curr = prev = *head;
-	while (curr) {
 		if (strcmp(target->type1, curr->type1) == 0 &&
 		    target->id1 == curr->id1 &&
 		    target->if_id1 == curr->if_id1) {
@@ -719,70 +745,87 @@ static int compare_insert_connection(struct conn_list **head,
 
 			return -EINVAL;
 		}
+	}
 
-		prev = curr;
-		curr = curr->next;
+	error = grow_connections(&layout);
+	if (error) {
+		ERROR_PRINTF("malloc failed\n");
+		return error;
 	}
 
-	prev->next = target;
-	target->next = NULL;
+	layout.conns[layout.num_conns] = *target;
+	hash_connection(&layout, layout.num_conns);
+	layout.num_conns++;
 
 	return 0;
 }
 
 /* objects don't Need to be parse and get attributes for now */
-static int parse_dpbp(FILE *fp, struct obj_list *curr)
+static int parse_dpbp(struct dpl_portal *portal, FILE *fp,
+		      struct obj_entry *curr)
 {
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
 }
 
-static int parse_dpdbg(FILE *fp, struct obj_list *curr)
+static int parse_dpdbg(struct dpl_portal *portal, FILE *fp,
+		       struct obj_entry *curr)
 {
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
 }
 
-static int parse_dpmcp(FILE *fp, struct obj_list *curr)
+static int parse_dpmcp(struct dpl_portal *portal, FILE *fp,
+		       struct obj_entry *curr)
 {
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
 }
 
-static int parse_dprc(FILE *fp, struct obj_list *curr)
+static int parse_dprc(struct dpl_portal *portal, FILE *fp,
+		      struct obj_entry *curr)
 {
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
 }
 
-static int parse_dprtc(FILE *fp, struct obj_list *curr)
+static int parse_dprtc(struct dpl_portal *portal, FILE *fp,
+		       struct obj_entry *curr)
 {
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
 }
 
 /* objects Need to be parsed and get attributes*/
-static int parse_dpaiop(FILE *fp, struct obj_list *curr)
+static int parse_dpaiop(struct dpl_portal *portal, FILE *fp,
+			struct obj_entry *curr)
 {
 	/* dpaiop_attr{} does not have field called aiop_container_id */
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
 }
 
-static int parse_dpcon_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpcon_v9(struct dpl_portal *portal, FILE *fp,
+			  struct obj_entry *curr)
 {
 	uint16_t dpcon_handle;
 	int error;
 	struct dpcon_attr dpcon_attr;
 	bool dpcon_opened = false;
 
-	error = dpcon_open_v10(&restool.mc_io, 0, curr->id, &dpcon_handle);
+	error = dpcon_open_v10(portal->mc_io, 0, curr->id, &dpcon_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -799,7 +842,7 @@ static int parse_dpcon_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpcon_attr, 0, sizeof(dpcon_attr));
-	error = dpcon_get_attributes(&restool.mc_io, 0, dpcon_handle,
+	error = dpcon_get_attributes(portal->mc_io, 0, dpcon_handle,
 					&dpcon_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -818,7 +861,7 @@ out:
 	if (dpcon_opened) {
 		int error2;
 
-		error2 = dpcon_close(&restool.mc_io, 0, dpcon_handle);
+		error2 = dpcon_close(portal->mc_io, 0, dpcon_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -832,14 +875,15 @@ out:
 }
 
 
-static int parse_dpcon_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpcon_v10(struct dpl_portal *portal, FILE *fp,
+			   struct obj_entry *curr)
 {
 	struct dpcon_attr_v10 dpcon_attr;
 	bool dpcon_opened = false;
 	uint16_t dpcon_handle;
 	int error;
 
-	error = dpcon_open_v10(&restool.mc_io, 0, curr->id, &dpcon_handle);
+	error = dpcon_open_v10(portal->mc_io, 0, curr->id, &dpcon_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -856,7 +900,7 @@ static int parse_dpcon_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpcon_attr, 0, sizeof(dpcon_attr));
-	error = dpcon_get_attributes_v10(&restool.mc_io, 0, dpcon_handle,
+	error = dpcon_get_attributes_v10(portal->mc_io, 0, dpcon_handle,
 					 &dpcon_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -875,7 +919,7 @@ out:
 	if (dpcon_opened) {
 		int error2;
 
-		error2 = dpcon_close_v10(&restool.mc_io, 0, dpcon_handle);
+		error2 = dpcon_close_v10(portal->mc_io, 0, dpcon_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -888,7 +932,8 @@ out:
 	return error;
 }
 
-static int parse_dpdcei_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpdcei_v9(struct dpl_portal *portal, FILE *fp,
+			   struct obj_entry *curr)
 {
 	/* dpdcei_attr{} does not have a field called priority */
 	uint16_t dpdcei_handle;
@@ -896,7 +941,7 @@ static int parse_dpdcei_v9(FILE *fp, struct obj_list *curr)
 	struct dpdcei_attr dpdcei_attr;
 	bool dpdcei_opened = false;
 
-	error = dpdcei_open(&restool.mc_io, 0, curr->id, &dpdcei_handle);
+	error = dpdcei_open(portal->mc_io, 0, curr->id, &dpdcei_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -913,7 +958,7 @@ static int parse_dpdcei_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpdcei_attr, 0, sizeof(dpdcei_attr));
-	error = dpdcei_get_attributes(&restool.mc_io, 0, dpdcei_handle,
+	error = dpdcei_get_attributes(portal->mc_io, 0, dpdcei_handle,
 					&dpdcei_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -941,7 +986,7 @@ out:
 	if (dpdcei_opened) {
 		int error2;
 
-		error2 = dpdcei_close(&restool.mc_io, 0, dpdcei_handle);
+		error2 = dpdcei_close(portal->mc_io, 0, dpdcei_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -954,14 +999,15 @@ out:
 	return error;
 }
 
-static int parse_dpdcei_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpdcei_v10(struct dpl_portal *portal, FILE *fp,
+			    struct obj_entry *curr)
 {
 	struct dpdcei_attr_v10 dpdcei_attr;
 	bool dpdcei_opened = false;
 	uint16_t dpdcei_handle;
 	int error;
 
-	error = dpdcei_open_v10(&restool.mc_io, 0, curr->id, &dpdcei_handle);
+	error = dpdcei_open_v10(portal->mc_io, 0, curr->id, &dpdcei_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -978,7 +1024,7 @@ static int parse_dpdcei_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpdcei_attr, 0, sizeof(dpdcei_attr));
-	error = dpdcei_get_attributes_v10(&restool.mc_io, 0, dpdcei_handle,
+	error = dpdcei_get_attributes_v10(portal->mc_io, 0, dpdcei_handle,
 					  &dpdcei_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1006,7 +1052,7 @@ out:
 	if (dpdcei_opened) {
 		int error2;
 
-		error2 = dpdcei_close_v10(&restool.mc_io, 0, dpdcei_handle);
+		error2 = dpdcei_close_v10(portal->mc_io, 0, dpdcei_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1019,14 +1065,15 @@ out:
 	return error;
 }
 
-static int parse_dpdmai_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpdmai_v9(struct dpl_portal *portal, FILE *fp,
+			   struct obj_entry *curr)
 {
 	uint16_t dpdmai_handle;
 	int error;
 	struct dpdmai_attr dpdmai_attr;
 	bool dpdmai_opened = false;
 
-	error = dpdmai_open(&restool.mc_io, 0, curr->id, &dpdmai_handle);
+	error = dpdmai_open(portal->mc_io, 0, curr->id, &dpdmai_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1043,7 +1090,7 @@ static int parse_dpdmai_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpdmai_attr, 0, sizeof(dpdmai_attr));
-	error = dpdmai_get_attributes(&restool.mc_io, 0, dpdmai_handle,
+	error = dpdmai_get_attributes(portal->mc_io, 0, dpdmai_handle,
 					&dpdmai_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1062,7 +1109,7 @@ out:
 	if (dpdmai_opened) {
 		int error2;
 
-		error2 = dpdmai_close(&restool.mc_io, 0, dpdmai_handle);
+		error2 = dpdmai_close(portal->mc_io, 0, dpdmai_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1075,14 +1122,15 @@ out:
 	return error;
 }
 
-static int parse_dpdmai_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpdmai_v10(struct dpl_portal *portal, FILE *fp,
+			    struct obj_entry *curr)
 {
 	struct dpdmai_attr_v10 dpdmai_attr;
 	bool dpdmai_opened = false;
 	uint16_t dpdmai_handle;
 	int error;
 
-	error = dpdmai_open_v10(&restool.mc_io, 0, curr->id, &dpdmai_handle);
+	error = dpdmai_open_v10(portal->mc_io, 0, curr->id, &dpdmai_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1099,7 +1147,7 @@ static int parse_dpdmai_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpdmai_attr, 0, sizeof(dpdmai_attr));
-	error = dpdmai_get_attributes_v10(&restool.mc_io, 0, dpdmai_handle,
+	error = dpdmai_get_attributes_v10(portal->mc_io, 0, dpdmai_handle,
 					  &dpdmai_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1118,7 +1166,7 @@ out:
 	if (dpdmai_opened) {
 		int error2;
 
-		error2 = dpdmai_close_v10(&restool.mc_io, 0, dpdmai_handle);
+		error2 = dpdmai_close_v10(portal->mc_io, 0, dpdmai_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1131,14 +1179,15 @@ out:
 	return error;
 }
 
-static int parse_dpio_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpio_v9(struct dpl_portal *portal, FILE *fp,
+			 struct obj_entry *curr)
 {
 	uint16_t dpio_handle;
 	int error;
 	struct dpio_attr dpio_attr;
 	bool dpio_opened = false;
 
-	error = dpio_open(&restool.mc_io, 0, curr->id, &dpio_handle);
+	error = dpio_open(portal->mc_io, 0, curr->id, &dpio_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1155,7 +1204,7 @@ static int parse_dpio_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpio_attr, 0, sizeof(dpio_attr));
-	error = dpio_get_attributes(&restool.mc_io, 0, dpio_handle, &dpio_attr);
+	error = dpio_get_attributes(portal->mc_io, 0, dpio_handle, &dpio_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1177,7 +1226,7 @@ out:
 	if (dpio_opened) {
 		int error2;
 
-		error2 = dpio_close(&restool.mc_io, 0, dpio_handle);
+		error2 = dpio_close(portal->mc_io, 0, dpio_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1190,14 +1239,15 @@ out:
 	return error;
 }
 
-static int parse_dpio_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpio_v10(struct dpl_portal *portal, FILE *fp,
+			  struct obj_entry *curr)
 {
 	struct dpio_attr_v10 dpio_attr;
 	bool dpio_opened = false;
 	uint16_t dpio_handle;
 	int error;
 
-	error = dpio_open_v10(&restool.mc_io, 0, curr->id, &dpio_handle);
+	error = dpio_open_v10(portal->mc_io, 0, curr->id, &dpio_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1214,7 +1264,7 @@ static int parse_dpio_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpio_attr, 0, sizeof(dpio_attr));
-	error = dpio_get_attributes_v10(&restool.mc_io, 0, dpio_handle, &dpio_attr);
+	error = dpio_get_attributes_v10(portal->mc_io, 0, dpio_handle, &dpio_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1236,7 +1286,7 @@ out:
 	if (dpio_opened) {
 		int error2;
 
-		error2 = dpio_close_v10(&restool.mc_io, 0, dpio_handle);
+		error2 = dpio_close_v10(portal->mc_io, 0, dpio_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1249,7 +1299,8 @@ out:
 	return error;
 }
 
-static int parse_dpseci_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpseci_v9(struct dpl_portal *portal, FILE *fp,
+			   struct obj_entry *curr)
 {
 	int error;
 	uint16_t dpseci_handle;
@@ -1258,7 +1309,7 @@ static int parse_dpseci_v9(FILE *fp, struct obj_list *curr)
 	struct dpseci_tx_queue_attr tx_attr;
 	char *priorities;
 
-	error = dpseci_open(&restool.mc_io, 0, curr->id, &dpseci_handle);
+	error = dpseci_open(portal->mc_io, 0, curr->id, &dpseci_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1276,7 +1327,7 @@ static int parse_dpseci_v9(FILE *fp, struct obj_list *curr)
 	memset(&tx_attr, 0, sizeof(tx_attr));
 	memset(&dpseci_attr, 0, sizeof(dpseci_attr));
 
-	error = dpseci_get_attributes(&restool.mc_io, 0, dpseci_handle,
+	error = dpseci_get_attributes(portal->mc_io, 0, dpseci_handle,
 					&dpseci_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1293,7 +1344,7 @@ static int parse_dpseci_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	for (int i = 0; i < dpseci_attr.num_tx_queues; i++) {
-		error = dpseci_get_tx_queue(&restool.mc_io, 0, dpseci_handle,
+		error = dpseci_get_tx_queue(portal->mc_io, 0, dpseci_handle,
 					    i, &tx_attr);
 
 		if (error < 0) {
@@ -1319,7 +1370,7 @@ out:
 	if (dpseci_opened) {
 		int error2;
 
-		error2 = dpseci_close(&restool.mc_io, 0, dpseci_handle);
+		error2 = dpseci_close(portal->mc_io, 0, dpseci_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1331,7 +1382,8 @@ out:
 	return 0;
 }
 
-static int parse_dpseci_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpseci_v10(struct dpl_portal *portal, FILE *fp,
+			    struct obj_entry *curr)
 {
 	struct dpseci_tx_queue_attr_v10 tx_attr;
 	struct dpseci_attr_v10 dpseci_attr;
@@ -1340,7 +1392,7 @@ static int parse_dpseci_v10(FILE *fp, struct obj_list *curr)
 	char *priorities;
 	int error;
 
-	error = dpseci_open_v10(&restool.mc_io, 0, curr->id, &dpseci_handle);
+	error = dpseci_open_v10(portal->mc_io, 0, curr->id, &dpseci_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1358,7 +1410,7 @@ static int parse_dpseci_v10(FILE *fp, struct obj_list *curr)
 	memset(&tx_attr, 0, sizeof(tx_attr));
 	memset(&dpseci_attr, 0, sizeof(dpseci_attr));
 
-	error = dpseci_get_attributes_v10(&restool.mc_io, 0, dpseci_handle,
+	error = dpseci_get_attributes_v10(portal->mc_io, 0, dpseci_handle,
 					  &dpseci_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1375,7 +1427,7 @@ static int parse_dpseci_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	for (int i = 0; i < dpseci_attr.num_tx_queues; i++) {
-		error = dpseci_get_tx_queue_v10(&restool.mc_io, 0, dpseci_handle,
+		error = dpseci_get_tx_queue_v10(portal->mc_io, 0, dpseci_handle,
 						i, &tx_attr);
 
 		if (error < 0) {
@@ -1401,7 +1453,7 @@ out:
 	if (dpseci_opened) {
 		int error2;
 
-		error2 = dpseci_close_v10(&restool.mc_io, 0, dpseci_handle);
+		error2 = dpseci_close_v10(portal->mc_io, 0, dpseci_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1414,17 +1466,18 @@ out:
 }
 
 /* following objects have possible connections*/
-static int parse_dpci_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpci_v9(struct dpl_portal *portal, FILE *fp,
+			 struct obj_entry *curr)
 {
 	uint16_t dpci_handle;
 	int error;
 	struct dpci_attr dpci_attr;
 	struct dpci_peer_attr dpci_peer_attr;
 	bool dpci_opened = false;
-	struct conn_list *curr_conn;
+	struct conn_entry curr_conn;
 
 
-	error = dpci_open(&restool.mc_io, 0, curr->id, &dpci_handle);
+	error = dpci_open(portal->mc_io, 0, curr->id, &dpci_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1441,7 +1494,7 @@ static int parse_dpci_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpci_attr, 0, sizeof(dpci_attr));
-	error = dpci_get_attributes(&restool.mc_io, 0, dpci_handle, &dpci_attr);
+	error = dpci_get_attributes(portal->mc_io, 0, dpci_handle, &dpci_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1450,7 +1503,7 @@ static int parse_dpci_v9(FILE *fp, struct obj_list *curr)
 	}
 	assert(curr->id == dpci_attr.id);
 
-	error = dpci_get_peer_attributes(&restool.mc_io, 0, dpci_handle,
+	error = dpci_get_peer_attributes(portal->mc_io, 0, dpci_handle,
 					 &dpci_peer_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1466,21 +1519,15 @@ static int parse_dpci_v9(FILE *fp, struct obj_list *curr)
 		DEBUG_PRINTF("no peer\n");
 	} else {
 		/* dpci has connection */
-		curr_conn = malloc(sizeof(struct conn_list));
-		if (curr_conn == NULL) {
-			ERROR_PRINTF("malloc failed\n");
-			error = -errno;
-			goto out;
-		}
-		curr_conn->next = NULL;
-		strcpy(curr_conn->type1, "dpci");
-		strcpy(curr_conn->type2, "dpci");
-		curr_conn->id1 = dpci_attr.id;
-		curr_conn->id2 = dpci_peer_attr.peer_id;
-		curr_conn->if_id1 = -1;	/* -1 means no interface */
-		curr_conn->if_id2 = -1;
-
-		error = compare_insert_connection(&conn_head, curr_conn);
+		memset(&curr_conn, 0, sizeof(curr_conn));
+		strcpy(curr_conn.type1, "dpci");
+		strcpy(curr_conn.type2, "dpci");
+		curr_conn.id1 = dpci_attr.id;
+		curr_conn.id2 = dpci_peer_attr.peer_id;
+		curr_conn.if_id1 = -1;	/* -1 means no interface */
+		curr_conn.if_id2 = -1;
+
+		error = add_obj_connection(curr, &curr_conn);
 		if (error)
 			goto out;
 	}
@@ -1491,7 +1538,7 @@ out:
 	if (dpci_opened) {
 		int error2;
 
-		error2 = dpci_close(&restool.mc_io, 0, dpci_handle);
+		error2 = dpci_close(portal->mc_io, 0, dpci_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1504,16 +1551,17 @@ out:
 	return error;
 }
 
-static int parse_dpci_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpci_v10(struct dpl_portal *portal, FILE *fp,
+			  struct obj_entry *curr)
 {
 	struct dpci_peer_attr_v10 dpci_peer_attr;
 	struct dpci_attr_v10 dpci_attr;
-	struct conn_list *curr_conn;
+	struct conn_entry curr_conn;
 	bool dpci_opened = false;
 	uint16_t dpci_handle;
 	int error;
 
-	error = dpci_open_v10(&restool.mc_io, 0, curr->id, &dpci_handle);
+	error = dpci_open_v10(portal->mc_io, 0, curr->id, &dpci_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1530,7 +1578,7 @@ static int parse_dpci_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpci_attr, 0, sizeof(dpci_attr));
-	error = dpci_get_attributes_v10(&restool.mc_io, 0, dpci_handle, &dpci_attr);
+	error = dpci_get_attributes_v10(portal->mc_io, 0, dpci_handle, &dpci_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1539,7 +1587,7 @@ static int parse_dpci_v10(FILE *fp, struct obj_list *curr)
 	}
 	assert(curr->id == dpci_attr.id);
 
-	error = dpci_get_peer_attributes_v10(&restool.mc_io, 0, dpci_handle,
+	error = dpci_get_peer_attributes_v10(portal->mc_io, 0, dpci_handle,
 					 &dpci_peer_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1555,21 +1603,15 @@ static int parse_dpci_v10(FILE *fp, struct obj_list *curr)
 		DEBUG_PRINTF("no peer\n");
 	} else {
 		/* dpci has connection */
-		curr_conn = malloc(sizeof(struct conn_list));
-		if (curr_conn == NULL) {
-			ERROR_PRINTF("malloc failed\n");
-			error = -errno;
-			goto out;
-		}
-		curr_conn->next = NULL;
-		strcpy(curr_conn->type1, "dpci");
-		strcpy(curr_conn->type2, "dpci");
-		curr_conn->id1 = dpci_attr.id;
-		curr_conn->id2 = dpci_peer_attr.peer_id;
-		curr_conn->if_id1 = -1;	/* -1 means no interface */
-		curr_conn->if_id2 = -1;
-
-		error = compare_insert_connection(&conn_head, curr_conn);
+		memset(&curr_conn, 0, sizeof(curr_conn));
+		strcpy(curr_conn.type1, "dpci");
+		strcpy(curr_conn.type2, "dpci");
+		curr_conn.id1 = dpci_attr.id;
+		curr_conn.id2 = dpci_peer_attr.peer_id;
+		curr_conn.if_id1 = -1;	/* -1 means no interface */
+		curr_conn.if_id2 = -1;
+
+		error = add_obj_connection(curr, &curr_conn);
 		if (error)
 			goto out;
 	}
@@ -1580,7 +1622,7 @@ out:
 	if (dpci_opened) {
 		int error2;
 
-		error2 = dpci_close_v10(&restool.mc_io, 0, dpci_handle);
+		error2 = dpci_close_v10(portal->mc_io, 0, dpci_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1593,9 +1635,11 @@ out:
 	return error;
 }
 
-static int parse_dpmac(FILE *fp, struct obj_list *curr)
+static int parse_dpmac(struct dpl_portal *portal, FILE *fp,
+		       struct obj_entry *curr)
 {
 	/* don't have anything in the dpl-example.dts */
+	(void)portal;
 	(void)fp;
 	(void)curr;
 	return 0;
@@ -1731,14 +1775,15 @@ static void parse_dpni_options_v10(FILE *fp, uint32_t options)
 	fprintf(fp, "%s\n", buf);
 }
 
-static int parse_endpoint_dpl(struct obj_list *curr_obj, uint16_t num_ifs)
+static int parse_endpoint_dpl(struct dpl_portal *portal,
+			      struct obj_entry *curr_obj, uint16_t num_ifs)
 {
 	struct dprc_endpoint endpoint1;
 	struct dprc_endpoint endpoint2;
 	int state;
 	int error = 0;
 	int k;
-	struct conn_list *curr_conn;
+	struct conn_entry curr_conn;
 
 	/* dpni though not have interfaces,
 	 * need to have num_ifs > 0,
@@ -1753,8 +1798,8 @@ static int parse_endpoint_dpl(struct obj_list *curr_obj, uint16_t num_ifs)
 		endpoint1.id = curr_obj->id;
 		endpoint1.if_id = k;
 
-		error = dprc_get_connection(&restool.mc_io, 0,
-					restool.root_dprc_handle,
+		error = dprc_get_connection(portal->mc_io, 0,
+					portal->root_dprc_handle,
 					&endpoint1,
 					&endpoint2,
 					&state);
@@ -1770,62 +1815,48 @@ static int parse_endpoint_dpl(struct obj_list *curr_obj, uint16_t num_ifs)
 					k, endpoint2.type, endpoint2.id,
 					endpoint2.if_id);
 
-				curr_conn = malloc(sizeof(struct conn_list));
-				if (curr_conn == NULL) {
-					ERROR_PRINTF("malloc failed\n");
-					error = -errno;
-					return error;
-				}
-				curr_conn->next = NULL;
-				strncpy(curr_conn->type1, endpoint1.type,
+				memset(&curr_conn, 0, sizeof(curr_conn));
+				strncpy(curr_conn.type1, endpoint1.type,
 					EP_OBJ_TYPE_MAX_LEN);
-				strncpy(curr_conn->type2, endpoint2.type,
+				strncpy(curr_conn.type2, endpoint2.type,
 					EP_OBJ_TYPE_MAX_LEN);
-				curr_conn->type1[EP_OBJ_TYPE_MAX_LEN] = '\0';
-				curr_conn->type2[EP_OBJ_TYPE_MAX_LEN] = '\0';
-				curr_conn->id1 = endpoint1.id;
-				curr_conn->id2 = endpoint2.id;
+				curr_conn.type1[EP_OBJ_TYPE_MAX_LEN] = '\0';
+				curr_conn.type2[EP_OBJ_TYPE_MAX_LEN] = '\0';
+				curr_conn.id1 = endpoint1.id;
+				curr_conn.id2 = endpoint2.id;
 				if (strcmp(curr_obj->type, "dpni") == 0)
-					curr_conn->if_id1 = -1;
+					curr_conn.if_id1 = -1;
 					/* -1 means no interface */
 				else
-					curr_conn->if_id1 = endpoint1.if_id;
+					curr_conn.if_id1 = endpoint1.if_id;
 
-				curr_conn->if_id2 = endpoint2.if_id;
+				curr_conn.if_id2 = endpoint2.if_id;
 
-				error = compare_insert_connection(&conn_head,
-								  curr_conn);
+				error = add_obj_connection(curr_obj, &curr_conn);
 				if (error)
 					return error;
 			} else if (endpoint2.if_id == 0) {
 				DEBUG_PRINTF("\tinterface %d: %s.%d",
 					k, endpoint2.type, endpoint2.id);
 
-				curr_conn = malloc(sizeof(struct conn_list));
-				if (curr_conn == NULL) {
-					ERROR_PRINTF("malloc failed\n");
-					error = -errno;
-					return error;
-				}
-				curr_conn->next = NULL;
-				strncpy(curr_conn->type1, endpoint1.type,
+				memset(&curr_conn, 0, sizeof(curr_conn));
+				strncpy(curr_conn.type1, endpoint1.type,
 					EP_OBJ_TYPE_MAX_LEN);
-				strncpy(curr_conn->type2, endpoint2.type,
+				strncpy(curr_conn.type2, endpoint2.type,
 					EP_OBJ_TYPE_MAX_LEN);
-				curr_conn->type1[EP_OBJ_TYPE_MAX_LEN] = '\0';
-				curr_conn->type2[EP_OBJ_TYPE_MAX_LEN] = '\0';
-				curr_conn->id1 = endpoint1.id;
-				curr_conn->id2 = endpoint2.id;
+				curr_conn.type1[EP_OBJ_TYPE_MAX_LEN] = '\0';
+				curr_conn.type2[EP_OBJ_TYPE_MAX_LEN] = '\0';
+				curr_conn.id1 = endpoint1.id;
+				curr_conn.id2 = endpoint2.id;
 				if (strcmp(curr_obj->type, "dpni") == 0)
-					curr_conn->if_id1 = -1;
+					curr_conn.if_id1 = -1;
 					/* -1 means no interface */
 				else
-					curr_conn->if_id1 = endpoint1.if_id;
+					curr_conn.if_id1 = endpoint1.if_id;
 
-				curr_conn->if_id2 = -1;
+				curr_conn.if_id2 = -1;
 
-				error = compare_insert_connection(&conn_head,
-								  curr_conn);
+				error = add_obj_connection(curr_obj, &curr_conn);
 				if (error)
 					return error;
 			}
@@ -1851,7 +1882,8 @@ static int parse_endpoint_dpl(struct obj_list *curr_obj, uint16_t num_ifs)
 	return 0;
 }
 
-static int parse_dpni_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpni_v9(struct dpl_portal *portal, FILE *fp,
+			 struct obj_entry *curr)
 {
 	uint16_t dpni_handle;
 	int error;
@@ -1863,7 +1895,7 @@ static int parse_dpni_v9(FILE *fp, struct obj_list *curr)
 	memset(&dpni_extended_cfg, 0, sizeof(dpni_extended_cfg));
 	memset(&dpni_attr, 0, sizeof(dpni_attr));
 
-	error = dpni_open(&restool.mc_io, 0, curr->id, &dpni_handle);
+	error = dpni_open(portal->mc_io, 0, curr->id, &dpni_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1879,7 +1911,7 @@ static int parse_dpni_v9(FILE *fp, struct obj_list *curr)
 		goto out;
 	}
 
-	error = dpni_get_attributes_v9(&restool.mc_io, 0, dpni_handle,
+	error = dpni_get_attributes_v9(portal->mc_io, 0, dpni_handle,
 				       &dpni_attr, &dpni_extended_cfg);
 
 	if (error < 0) {
@@ -1892,7 +1924,7 @@ static int parse_dpni_v9(FILE *fp, struct obj_list *curr)
 	assert(curr->id == dpni_attr.id);
 	assert(DPNI_MAX_TC >= dpni_attr.max_tcs);
 
-	error = dpni_get_primary_mac_addr(&restool.mc_io, 0,
+	error = dpni_get_primary_mac_addr(portal->mc_io, 0,
 					dpni_handle, mac_addr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -1901,7 +1933,7 @@ static int parse_dpni_v9(FILE *fp, struct obj_list *curr)
 		goto out;
 	}
 
-	parse_endpoint_dpl(curr, 1000);
+	parse_endpoint_dpl(portal, curr, 1000);
 
 	fprintf(fp, "\t\t\tmac_addr = <");
 	for (int j = 0; j < 5; ++j)
@@ -1976,7 +2008,7 @@ out:
 	if (dpni_opened) {
 		int error2;
 
-		error2 = dpni_close(&restool.mc_io, 0, dpni_handle);
+		error2 = dpni_close(portal->mc_io, 0, dpni_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -1989,7 +2021,8 @@ out:
 	return error;
 }
 
-static int parse_dpni_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpni_v10(struct dpl_portal *portal, FILE *fp,
+			  struct obj_entry *curr)
 {
 	struct dpni_attr_v10 dpni_attr;
 	uint16_t dpni_handle;
@@ -1997,7 +2030,7 @@ static int parse_dpni_v10(FILE *fp, struct obj_list *curr)
 	int error = 0;
 	int error2;
 
-	error = dpni_open_v10(&restool.mc_io, 0, curr->id, &dpni_handle);
+	error = dpni_open_v10(portal->mc_io, 0, curr->id, &dpni_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2014,7 +2047,7 @@ static int parse_dpni_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpni_attr, 0, sizeof(dpni_attr));
-	error = dpni_get_attributes_v10(&restool.mc_io, 0,
+	error = dpni_get_attributes_v10(portal->mc_io, 0,
 					dpni_handle, &dpni_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -2023,7 +2056,7 @@ static int parse_dpni_v10(FILE *fp, struct obj_list *curr)
 		goto out;
 	}
 
-	parse_endpoint_dpl(curr, 1000);
+	parse_endpoint_dpl(portal, curr, 1000);
 
 	fprintf(fp, "\t\t\ttype = \"DPNI_TYPE_NIC\";\n");
 
@@ -2040,7 +2073,7 @@ static int parse_dpni_v10(FILE *fp, struct obj_list *curr)
 out:
 	if (dpni_opened) {
 
-		error2 = dpni_close_v10(&restool.mc_io, 0, dpni_handle);
+		error2 = dpni_close_v10(portal->mc_io, 0, dpni_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2130,14 +2163,15 @@ static void parse_dpdmux_manip(FILE *fp, enum dpdmux_manip manip)
 	}
 }
 
-static int parse_dpdmux_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpdmux_v9(struct dpl_portal *portal, FILE *fp,
+			   struct obj_entry *curr)
 {
 	uint16_t dpdmux_handle;
 	int error;
 	struct dpdmux_attr_v9 dpdmux_attr;
 	bool dpdmux_opened = false;
 
-	error = dpdmux_open(&restool.mc_io, 0, curr->id, &dpdmux_handle);
+	error = dpdmux_open(portal->mc_io, 0, curr->id, &dpdmux_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2154,7 +2188,7 @@ static int parse_dpdmux_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpdmux_attr, 0, sizeof(dpdmux_attr));
-	error = dpdmux_get_attributes_v9(&restool.mc_io, 0, dpdmux_handle,
+	error = dpdmux_get_attributes_v9(portal->mc_io, 0, dpdmux_handle,
 					&dpdmux_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -2164,7 +2198,7 @@ static int parse_dpdmux_v9(FILE *fp, struct obj_list *curr)
 	}
 	assert(curr->id == dpdmux_attr.id);
 
-	parse_endpoint_dpl(curr, dpdmux_attr.num_ifs + 1);
+	parse_endpoint_dpl(portal, curr, dpdmux_attr.num_ifs + 1);
 	parse_dpdmux_options(fp, dpdmux_attr.options);
 	parse_dpdmux_method(fp, dpdmux_attr.method);
 	parse_dpdmux_manip(fp, dpdmux_attr.manip);
@@ -2177,7 +2211,7 @@ out:
 	if (dpdmux_opened) {
 		int error2;
 
-		error2 = dpdmux_close(&restool.mc_io, 0, dpdmux_handle);
+		error2 = dpdmux_close(portal->mc_io, 0, dpdmux_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2191,14 +2225,15 @@ out:
 
 }
 
-static int parse_dpdmux_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpdmux_v10(struct dpl_portal *portal, FILE *fp,
+			    struct obj_entry *curr)
 {
 	struct dpdmux_attr_v10 dpdmux_attr;
 	bool dpdmux_opened = false;
 	uint16_t dpdmux_handle;
 	int error;
 
-	error = dpdmux_open_v10(&restool.mc_io, 0, curr->id, &dpdmux_handle);
+	error = dpdmux_open_v10(portal->mc_io, 0, curr->id, &dpdmux_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2215,7 +2250,7 @@ static int parse_dpdmux_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpdmux_attr, 0, sizeof(dpdmux_attr));
-	error = dpdmux_get_attributes_v10(&restool.mc_io, 0, dpdmux_handle,
+	error = dpdmux_get_attributes_v10(portal->mc_io, 0, dpdmux_handle,
 					&dpdmux_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -2225,7 +2260,7 @@ static int parse_dpdmux_v10(FILE *fp, struct obj_list *curr)
 	}
 	assert(curr->id == dpdmux_attr.id);
 
-	parse_endpoint_dpl(curr, dpdmux_attr.num_ifs + 1);
+	parse_endpoint_dpl(portal, curr, dpdmux_attr.num_ifs + 1);
 	parse_dpdmux_options(fp, dpdmux_attr.options);
 	parse_dpdmux_method(fp, dpdmux_attr.method);
 	parse_dpdmux_manip(fp, dpdmux_attr.manip);
@@ -2238,7 +2273,7 @@ out:
 	if (dpdmux_opened) {
 		int error2;
 
-		error2 = dpdmux_close_v10(&restool.mc_io, 0, dpdmux_handle);
+		error2 = dpdmux_close_v10(portal->mc_io, 0, dpdmux_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2297,14 +2332,15 @@ static void parse_dpsw_options(FILE *fp, uint64_t options)
 
 }
 
-static int parse_dpsw_v9(FILE *fp, struct obj_list *curr)
+static int parse_dpsw_v9(struct dpl_portal *portal, FILE *fp,
+			 struct obj_entry *curr)
 {
 	uint16_t dpsw_handle;
 	int error;
 	struct dpsw_attr_v9 dpsw_attr;
 	bool dpsw_opened = false;
 
-	error = dpsw_open(&restool.mc_io, 0, curr->id, &dpsw_handle);
+	error = dpsw_open(portal->mc_io, 0, curr->id, &dpsw_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2321,7 +2357,7 @@ static int parse_dpsw_v9(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpsw_attr, 0, sizeof(dpsw_attr));
-	error = dpsw_get_attributes_v9(&restool.mc_io, 0, dpsw_handle,
+	error = dpsw_get_attributes_v9(portal->mc_io, 0, dpsw_handle,
 				       &dpsw_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -2331,7 +2367,7 @@ static int parse_dpsw_v9(FILE *fp, struct obj_list *curr)
 	}
 	assert(curr->id == dpsw_attr.id);
 
-	parse_endpoint_dpl(curr, dpsw_attr.num_ifs);
+	parse_endpoint_dpl(portal, curr, dpsw_attr.num_ifs);
 	parse_dpsw_options(fp, dpsw_attr.options);
 	fprintf(fp, "\t\t\tmax_vlans = <%#x>;\n",
 		(uint32_t)dpsw_attr.max_vlans);
@@ -2355,7 +2391,7 @@ out:
 	if (dpsw_opened) {
 		int error2;
 
-		error2 = dpsw_close(&restool.mc_io, 0, dpsw_handle);
+		error2 = dpsw_close(portal->mc_io, 0, dpsw_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2368,14 +2404,15 @@ out:
 	return error;
 }
 
-static int parse_dpsw_v10(FILE *fp, struct obj_list *curr)
+static int parse_dpsw_v10(struct dpl_portal *portal, FILE *fp,
+			  struct obj_entry *curr)
 {
 	struct dpsw_attr_v10 dpsw_attr;
 	bool dpsw_opened = false;
 	uint16_t dpsw_handle;
 	int error;
 
-	error = dpsw_open_v10(&restool.mc_io, 0, curr->id, &dpsw_handle);
+	error = dpsw_open_v10(portal->mc_io, 0, curr->id, &dpsw_handle);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
 		ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2392,7 +2429,7 @@ static int parse_dpsw_v10(FILE *fp, struct obj_list *curr)
 	}
 
 	memset(&dpsw_attr, 0, sizeof(dpsw_attr));
-	error = dpsw_get_attributes_v10(&restool.mc_io, 0, dpsw_handle,
+	error = dpsw_get_attributes_v10(portal->mc_io, 0, dpsw_handle,
 				       &dpsw_attr);
 	if (error < 0) {
 		mc_status = flib_error_to_mc_status(error);
@@ -2402,7 +2439,7 @@ static int parse_dpsw_v10(FILE *fp, struct obj_list *curr)
 	}
 	assert(curr->id == dpsw_attr.id);
 
-	parse_endpoint_dpl(curr, dpsw_attr.num_ifs);
+	parse_endpoint_dpl(portal, curr, dpsw_attr.num_ifs);
 	parse_dpsw_options(fp, dpsw_attr.options);
 	fprintf(fp, "\t\t\tmax_vlans = <%#x>;\n",
 		(uint32_t)dpsw_attr.max_vlans);
@@ -2426,7 +2463,7 @@ out:
 	if (dpsw_opened) {
 		int error2;
 
-		error2 = dpsw_close_v10(&restool.mc_io, 0, dpsw_handle);
+		error2 = dpsw_close_v10(portal->mc_io, 0, dpsw_handle);
 		if (error2 < 0) {
 			mc_status = flib_error_to_mc_status(error2);
 			ERROR_PRINTF("MC error: %s (status %#x)\n",
@@ -2439,130 +2476,285 @@ out:
 	return error;
 }
 
-static int write_objects(void)
+/**
+ * fetch_object - read the attributes and connections of an object on
+ *		  portal and write its DPL node to curr_obj->text
+ *
+ * Returns 0 on success, negative otherwise. Errors reading the object
+ * are reported and leave its attributes out, as they always did.
+ */
+static int fetch_object(struct dpl_portal *portal, struct obj_entry *curr_obj)
 {
-	struct obj_list *curr_obj;
-	FILE *fp = stdout;
+	FILE *fp;
+
+	fp = open_memstream(&curr_obj->text, &curr_obj->text_len);
+	if (fp == NULL) {
+		ERROR_PRINTF("open_memstream failed\n");
+		return -errno;
+	}
 
 	fprintf(fp, "\n");
-	fprintf(fp,
-		"\t/*****************************************************************\n");
-	fprintf(fp, "\t * Objects\n");
-	fprintf(fp,
-		"\t *****************************************************************/\n");
+	fprintf(fp, "\t\t%s@%d {\n", curr_obj->type, curr_obj->id);
+	fprintf(fp, "\t\t\tcompatible = \"fsl,%s\";\n", curr_obj->type);
 
+	/* objects don't need to be parsed and get attributes for now */
+	if (strcmp(curr_obj->type, "dpbp") == 0)
+		parse_dpbp(portal, fp, curr_obj);
+	if (strcmp(curr_obj->type, "dpdbg") == 0)
+		parse_dpdbg(portal, fp, curr_obj);
+	if (strcmp(curr_obj->type, "dpmcp") == 0)
+		parse_dpmcp(portal, fp, curr_obj);
+	if (strcmp(curr_obj->type, "dprc") == 0)
+		parse_dprc(portal, fp, curr_obj);
+	if (strcmp(curr_obj->type, "dprtc") == 0)
+		parse_dprtc(portal, fp, curr_obj);
 
-	fprintf(fp, "\tobjects {\n");
-	curr_obj = obj_head;
-	while (curr_obj) {
-		if (strcmp(curr_obj->type, "dpmcp") == 0 && 0 == curr_obj->id) {
-			curr_obj = curr_obj->next;
-			continue;
-		}
+	/* objects need to be parsed and get attributes */
+	if (strcmp(curr_obj->type, "dpaiop") == 0)
+		parse_dpaiop(portal, fp, curr_obj);
 
-		fprintf(fp, "\n");
-		fprintf(fp, "\t\t%s@%d {\n", curr_obj->type, curr_obj->id);
-		fprintf(fp, "\t\t\tcompatible = \"fsl,%s\";\n", curr_obj->type);
-
-		/* objects don't need to be parsed and get attributes for now */
-		if (strcmp(curr_obj->type, "dpbp") == 0)
-			parse_dpbp(fp, curr_obj);
-		if (strcmp(curr_obj->type, "dpdbg") == 0)
-			parse_dpdbg(fp, curr_obj);
-		if (strcmp(curr_obj->type, "dpmcp") == 0)
-			parse_dpmcp(fp, curr_obj);
-		if (strcmp(curr_obj->type, "dprc") == 0)
-			parse_dprc(fp, curr_obj);
-		if (strcmp(curr_obj->type, "dprtc") == 0)
-			parse_dprtc(fp, curr_obj);
-
-		/* objects need to be parsed and get attributes */
-		if (strcmp(curr_obj->type, "dpaiop") == 0)
-			parse_dpaiop(fp, curr_obj);
-
-		if (strcmp(curr_obj->type, "dpcon") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpcon_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpcon_v10(fp, curr_obj);
-		}
+	if (strcmp(curr_obj->type, "dpcon") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpcon_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpcon_v10(portal, fp, curr_obj);
+	}
 
-		if (strcmp(curr_obj->type, "dpdcei") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpdcei_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpdcei_v10(fp, curr_obj);
-		}
+	if (strcmp(curr_obj->type, "dpdcei") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpdcei_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpdcei_v10(portal, fp, curr_obj);
+	}
 
-		if (strcmp(curr_obj->type, "dpdmai") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpdmai_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpdmai_v10(fp, curr_obj);
-		}
+	if (strcmp(curr_obj->type, "dpdmai") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpdmai_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpdmai_v10(portal, fp, curr_obj);
+	}
 
-		if (strcmp(curr_obj->type, "dpio") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpio_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpio_v10(fp, curr_obj);
-		}
+	if (strcmp(curr_obj->type, "dpio") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpio_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpio_v10(portal, fp, curr_obj);
+	}
 
-		if (strcmp(curr_obj->type, "dpseci") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpseci_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpseci_v10(fp, curr_obj);
-		}
+	if (strcmp(curr_obj->type, "dpseci") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpseci_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpseci_v10(portal, fp, curr_obj);
+	}
 
-		/* following objects have possible connections */
-		if (strcmp(curr_obj->type, "dpci") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpci_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpci_v10(fp, curr_obj);
-		}
+	/* following objects have possible connections */
+	if (strcmp(curr_obj->type, "dpci") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpci_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpci_v10(portal, fp, curr_obj);
+	}
 
-		if (strcmp(curr_obj->type, "dpmac") == 0)
-			parse_dpmac(fp, curr_obj);
-			/* dpmac do not need to be parsed now */
+	if (strcmp(curr_obj->type, "dpmac") == 0)
+		parse_dpmac(portal, fp, curr_obj);
+		/* dpmac do not need to be parsed now */
 
-		if (strcmp(curr_obj->type, "dpni") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpni_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpni_v10(fp, curr_obj);
-		}
+	if (strcmp(curr_obj->type, "dpni") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpni_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpni_v10(portal, fp, curr_obj);
+	}
 
 
-		/* following objects have possible connections and interface*/
-		if (strcmp(curr_obj->type, "dpdmux") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpdmux_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpdmux_v10(fp, curr_obj);
-		}
+	/* following objects have possible connections and interface*/
+	if (strcmp(curr_obj->type, "dpdmux") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpdmux_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpdmux_v10(portal, fp, curr_obj);
+	}
+
+	if (strcmp(curr_obj->type, "dpsw") == 0) {
+		if (restool.mc_fw_version.major == 9)
+			parse_dpsw_v9(portal, fp, curr_obj);
+		else if (restool.mc_fw_version.major == 10)
+			parse_dpsw_v10(portal, fp, curr_obj);
+	}
+
+	fprintf(fp, "\t\t};\n");
+
+	if (fclose(fp) != 0)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * struct fetch_state - state shared by the threads fetching the objects
+ * @lock: protects all the fields below
+ * @next_obj: index in layout.sorted_objs of the next object to fetch
+ * @error: first error met, the fetch stops as soon as it is set
+ */
+struct fetch_state {
+	pthread_mutex_t lock;
+	unsigned int next_obj;
+	int error;
+};
+
+static bool skip_object(const struct obj_entry *obj)
+{
+	return strcmp(obj->type, "dpmcp") == 0 && 0 == obj->id;
+}
+
+/**
+ * Fetch objects on 'portal' until all objects are fetched or an error is
+ * met
+ */
+static int fetch_run(struct fetch_state *state, struct dpl_portal *portal)
+{
+	unsigned int index;
+	int error;
+
+	pthread_mutex_lock(&state->lock);
+	while (state->error == 0 && state->next_obj < layout.num_objs) {
+		index = state->next_obj++;
+		pthread_mutex_unlock(&state->lock);
+
+		error = 0;
+		if (!skip_object(layout.sorted_objs[index]))
+			error = fetch_object(portal, layout.sorted_objs[index]);
+
+		pthread_mutex_lock(&state->lock);
+		if (error < 0 && state->error == 0)
+			state->error = error;
+	}
+	error = state->error;
+	pthread_mutex_unlock(&state->lock);
+
+	return error;
+}
+
+/**
+ * Fetch objects on the portal of a worker thread. Connections are read
+ * through the root container, which each worker opens on its own portal:
+ * the other workers fetch more objects if the open fails.
+ */
+static int fetch_worker_run(void *arg, struct fsl_mc_io *mc_io,
+			    unsigned int index)
+{
+	struct dpl_portal portal = { .mc_io = mc_io };
+	int error;
+
+	(void)index;
+	if (dprc_open(mc_io, 0, restool.root_dprc_id,
+		      &portal.root_dprc_handle) < 0)
+		return 0;
+
+	error = fetch_run(arg, &portal);
+	dprc_close(mc_io, 0, portal.root_dprc_handle);
+
+	return error;
+}
+
+/**
+ * fetch_objects - fetch stage: read the attributes and the connections of
+ *		   all the objects, concurrently on up to restool.num_portals
+ *		   MC portals. Nothing is written to the DPL yet, so the
+ *		   result does not depend on the number of portals.
+ *
+ * Returns 0 on success, negative otherwise
+ */
+static int fetch_objects(void)
+{
+	struct dpl_portal portal = {
+		.mc_io = &restool.mc_io,
+		.root_dprc_handle = restool.root_dprc_handle,
+	};
+	unsigned int max_threads = 0;
+	struct portal_pool pool;
+	struct fetch_state state;
+	int error;
+	int error2;
+
+	memset(&state, 0, sizeof(state));
+	pthread_mutex_init(&state.lock, NULL);
+
+	if (layout.num_objs > 1) {
+		max_threads = restool.num_portals - 1;
+		if (max_threads > layout.num_objs - 1)
+			max_threads = layout.num_objs - 1;
+	}
+
+	error = portal_pool_start(&pool, max_threads, fetch_worker_run, &state);
+	if (error < 0)
+		goto out;
+
+	error = fetch_run(&state, &portal);
+	error2 = portal_pool_join(&pool);
+	if (error == 0)
+		error = error2;
+
+out:
+	pthread_mutex_destroy(&state.lock);
+	return error;
+}
 
-		if (strcmp(curr_obj->type, "dpsw") == 0) {
-			if (restool.mc_fw_version.major == 9)
-				parse_dpsw_v9(fp, curr_obj);
-			else if (restool.mc_fw_version.major == 10)
-				parse_dpsw_v10(fp, curr_obj);
+/**
+ * collect_connections - add the connections found by the fetch stage, in
+ *			 object order. The same connection found from its
+ *			 other endpoint is added once.
+ *
+ * Returns 0 on success, negative otherwise
+ */
+static int collect_connections(void)
+{
+	struct obj_entry *curr_obj;
+	int error;
+
+	for (unsigned int i = 0; i < layout.num_objs; i++) {
+		curr_obj = layout.sorted_objs[i];
+		for (unsigned int j = 0; j < curr_obj->num_conns; j++) {
+			error = insert_connection(&curr_obj->conns[j]);
+			/* conflicting connections are left out */
+			if (error && error != -EINVAL)
+				return error;
 		}
+	}
 
-		fprintf(fp, "\t\t};\n");
-		curr_obj = curr_obj->next;
+	return 0;
+}
+
+static int write_objects(FILE *fp)
+{
+	struct obj_entry *curr_obj;
+
+	fprintf(fp, "\n");
+	fprintf(fp,
+		"\t/*****************************************************************\n");
+	fprintf(fp, "\t * Objects\n");
+	fprintf(fp,
+		"\t *****************************************************************/\n");
+
+
+	fprintf(fp, "\tobjects {\n");
+	for (unsigned int i = 0; i < layout.num_objs; i++) {
+		curr_obj = layout.sorted_objs[i];
+		if (skip_object(curr_obj))
+			continue;
+
+		fwrite(curr_obj->text, 1, curr_obj->text_len, fp);
 	}
 	fprintf(fp, "\t};\n");
 
 	return 0;
 }
 
-static int write_connections(void)
+static int write_connections(FILE *fp)
 {
-	struct conn_list *curr_conn;
+	struct conn_entry *curr_conn;
 	int conn_num = 1;
-	FILE *fp = stdout;
 
 	fprintf(fp, "\n");
 	fprintf(fp,
@@ -2572,8 +2764,8 @@ static int write_connections(void)
 		"\t *****************************************************************/\n");
 
 	fprintf(fp, "\tconnections {\n");
-	curr_conn = conn_head;
-	while (curr_conn) {
+	for (unsigned int i = 0; i < layout.num_conns; i++) {
+		curr_conn = &layout.conns[i];
 		fprintf(fp, "\n");
 		fprintf(fp, "\t\tconnection@%d{\n", conn_num);
 		if (curr_conn->if_id1 < 0)
@@ -2592,7 +2784,6 @@ static int write_connections(void)
 				curr_conn->if_id2);
 
 		fprintf(fp, "\t\t};\n");
-		curr_conn = curr_conn->next;
 		conn_num++;
 	}
 	fprintf(fp, "\t};\n");
@@ -2602,64 +2793,24 @@ static int write_connections(void)
 
 static void delete_all_list(void)
 {
-	struct container_list *curr_cont;
-	struct container_list *tmp_cont;
-	struct obj_list *curr_obj;
-	struct obj_list *tmp_obj;
-	struct conn_list *curr_conn;
-	struct conn_list *tmp_conn;
-
-	curr_cont = container_head;
-	curr_obj = obj_head;
-	curr_conn = conn_head;
-
-	/* delete global object lists */
-	while (curr_obj) {
-		tmp_obj = curr_obj;
-		curr_obj = curr_obj->next;
-		free(tmp_obj);
-	}
-	obj_head = NULL;
-
-	/* delete global connection lists */
-	while (curr_conn) {
-		tmp_conn = curr_conn;
-		curr_conn = curr_conn->next;
-		free(tmp_conn);
-	}
-	conn_head = NULL;
-
-	/* delete global container lists */
-	while (curr_cont) {
-		tmp_cont = curr_cont;
-		curr_cont = curr_cont->next;
-
-		/* delete the associated object lists whithin each container */
-		curr_obj = tmp_cont->obj;
-		while (curr_obj) {
-			tmp_obj = curr_obj;
-			curr_obj = curr_obj->next;
-			free(tmp_obj);
-		}
-		tmp_cont->obj = NULL;
-
-		free(tmp_cont);
+	for (unsigned int i = 0; i < layout.num_objs; i++) {
+		free(layout.objs[i].text);
+		free(layout.objs[i].conns);
 	}
-	container_head = NULL;
+
+	free(layout.arena);
+	free(layout.conns);
+	free(layout.conn_hash);
+	memset(&layout, 0, sizeof(layout));
 }
 
-int dpl_generate(void)
+/**
+ * Write the DPL of the container tree rooted at dprc.<dprc_id> (the root
+ * container if dprc_id is 0) to 'fp'
+ */
+int dpl_generate_to(FILE *fp, uint32_t dprc_id)
 {
 	int error;
-	uint32_t dprc_id = 0;
-
-	if (restool.obj_name != NULL) {
-		error = parse_object_name(restool.obj_name, "dprc", &dprc_id);
-		if (error < 0)
-			return error;
-	}
-
-	FILE *fp = stdout;
 
 	fprintf(fp, "/dts-v1/;\n");
 	fprintf(fp, "/ {\n");
@@ -2668,30 +2819,94 @@ int dpl_generate(void)
 	error = parse_layout(dprc_id);
 	if (error) {
 		ERROR_PRINTF("parse_layout() failed, error=%d\n", error);
-		return error;
+		goto out;
 	}
 
-	error = write_containers();
+	error = fetch_objects();
+	if (error) {
+		ERROR_PRINTF("fetch_objects() failed, error=%d\n", error);
+		goto out;
+	}
+
+	error = collect_connections();
+	if (error) {
+		ERROR_PRINTF("collect_connections() failed, error=%d\n",
+			     error);
+		goto out;
+	}
+
+	error = write_containers(fp);
 	if (error) {
 		ERROR_PRINTF("write_containers() failed, error=%d\n", error);
-		return error;
+		goto out;
 	}
 
-	error = write_objects();
+	error = write_objects(fp);
 	if (error) {
 		ERROR_PRINTF("write_objects() failed, error=%d\n", error);
-		return error;
+		goto out;
 	}
 
-	error = write_connections();
+	error = write_connections(fp);
 	if (error) {
 		ERROR_PRINTF("write_connections() failed, error=%d\n", error);
-		return error;
+		goto out;
 	}
 
 	fprintf(fp, "};\n");
 
+out:
 	delete_all_list();
 
-	return 0;
+	return error;
+}
+
+/**
+ * Write the DPL as a DTB blob: the DTS text is generated in memory and
+ * compiled, there is no need to run dtc on it
+ */
+static int dpl_generate_dtb(FILE *fp, uint32_t dprc_id)
+{
+	struct dpl_node *root = NULL;
+	size_t size = 0;
+	char *buf = NULL;
+	FILE *dts;
+	int error;
+
+	dts = open_memstream(&buf, &size);
+	if (dts == NULL) {
+		ERROR_PRINTF("open_memstream failed\n");
+		return -errno;
+	}
+
+	error = dpl_generate_to(dts, dprc_id);
+	if (fclose(dts) != 0 && error == 0)
+		error = -ENOMEM;
+
+	if (error == 0)
+		error = dpl_parse("generated DPL", (uint8_t *)buf, size, &root);
+	if (error == 0)
+		error = dpl_write_dtb(fp, root);
+
+	dpl_free(root);
+	free(buf);
+
+	return error;
+}
+
+int dpl_generate(bool dtb)
+{
+	int error;
+	uint32_t dprc_id = 0;
+
+	if (restool.obj_name != NULL) {
+		error = parse_object_name(restool.obj_name, "dprc", &dprc_id);
+		if (error < 0)
+			return error;
+	}
+
+	if (dtb)
+		return dpl_generate_dtb(stdout, dprc_id);
+
+	return dpl_generate_to(stdout, dprc_id);
 }
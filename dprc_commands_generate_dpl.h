@@ -34,4 +34,6 @@
  * dpl generate command options
  */
 
-int dpl_generate(void);
+int dpl_generate(bool dtb);
+
+int dpl_generate_to(FILE *fp, uint32_t dprc_id);
@@ -0,0 +1,408 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "restool.h"
+#include "utils.h"
+#include "dprc_commands_top.h"
+#include "mc_v10/fsl_dprc.h"
+
+/*
+ * Rates displayed for each object
+ */
+enum top_rate {
+	TOP_RX_PPS = 0,
+	TOP_RX_BPS,
+	TOP_TX_PPS,
+	TOP_TX_BPS,
+	TOP_DROPS,
+	TOP_NUM_RATES,
+};
+
+/**
+ * struct top_type - counters sampled for the objects of a type
+ * @type: object type
+ * @counters: rx frames, rx bytes, tx frames and tx bytes counters,
+ *	followed by the counters summed up as drops
+ */
+struct top_type {
+	const char *type;
+	const char *counters;
+};
+
+static const struct top_type top_types[] = {
+	{ "dpni",
+	  "ingress_all_frames,ingress_all_bytes,egress_all_frames,egress_all_bytes,"
+	  "ingress_discarded_frames,ingress_nobuffer_discards,egress_discarded_frames" },
+	{ "dpmac",
+	  "rx all frames,rx bytes,tx frames ok,tx bytes,"
+	  "rx frame discards,rx frame errors,tx frame errors" },
+	{ "dpsw",
+	  "rx frames,rx bytes,tx frames,tx bytes,"
+	  "rx frame discards,rx no buffer discards,tx frame discards" },
+	{ "dpdmux",
+	  "rx frames,rx bytes,tx frames,tx bytes,"
+	  "rx frame discards,rx no buffer discards,tx frame discards" },
+};
+
+/**
+ * struct top_row - object displayed by 'dprc top'
+ * @name: object name
+ * @endpoint: what the object is connected to, read once
+ * @first_obj: first interface of the object in the counter set
+ * @num_objs: number of interfaces of the object in the counter set
+ * @rates: rates of the object, summed over its interfaces
+ * @key: rate the rows are sorted by
+ */
+struct top_row {
+	char name[OBJ_TYPE_MAX_LENGTH + 12];
+	char endpoint[EP_OBJ_TYPE_MAX_LEN + 24];
+	unsigned int first_obj;
+	unsigned int num_objs;
+	double rates[TOP_NUM_RATES];
+	double key;
+};
+
+/**
+ * struct top_sort_key - rates a --sort key adds up
+ */
+struct top_sort_key {
+	const char *name;
+	unsigned int rates;
+};
+
+#define TOP_RATE_BIT(rate)	(1U << (rate))
+
+static const struct top_sort_key top_sort_keys[] = {
+	{ "bps", TOP_RATE_BIT(TOP_RX_BPS) | TOP_RATE_BIT(TOP_TX_BPS) },
+	{ "pps", TOP_RATE_BIT(TOP_RX_PPS) | TOP_RATE_BIT(TOP_TX_PPS) },
+	{ "rx-bps", TOP_RATE_BIT(TOP_RX_BPS) },
+	{ "tx-bps", TOP_RATE_BIT(TOP_TX_BPS) },
+	{ "rx-pps", TOP_RATE_BIT(TOP_RX_PPS) },
+	{ "tx-pps", TOP_RATE_BIT(TOP_TX_PPS) },
+	{ "drops", TOP_RATE_BIT(TOP_DROPS) },
+};
+
+/**
+ * struct top - state of 'dprc top'
+ */
+struct top {
+	struct counter_set set;
+	struct top_row *rows;
+	unsigned int num_rows;
+	uint32_t dprc_id;
+	const struct top_sort_key *sort_key;
+	long interval_ms;
+	bool tty;
+};
+
+static const struct top_type *find_top_type(const char *type)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(top_types); i++) {
+		if (strcmp(top_types[i].type, type) == 0)
+			return &top_types[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * The endpoints are read once: a refresh only reads the counters
+ */
+static void top_read_endpoint(struct top_row *row, const char *type,
+			      uint32_t id, uint16_t num_ifs)
+{
+	struct dprc_endpoint endpoint1;
+	struct dprc_endpoint endpoint2;
+	int state = -1;
+	int error;
+
+	if (strcmp(type, "dpsw") == 0 || strcmp(type, "dpdmux") == 0) {
+		snprintf(row->endpoint, sizeof(row->endpoint), "%u ifs",
+			 num_ifs);
+		return;
+	}
+
+	memset(&endpoint1, 0, sizeof(endpoint1));
+	memset(&endpoint2, 0, sizeof(endpoint2));
+	strncpy(endpoint1.type, type, EP_OBJ_TYPE_MAX_LEN);
+	endpoint1.id = id;
+	error = dprc_get_connection(&restool.mc_io, 0,
+				    restool.root_dprc_handle,
+				    &endpoint1, &endpoint2, &state);
+	if (error < 0 || state == -1)
+		strcpy(row->endpoint, "-");
+	else if (strcmp(endpoint2.type, "dpsw") == 0 ||
+		 strcmp(endpoint2.type, "dpdmux") == 0)
+		snprintf(row->endpoint, sizeof(row->endpoint), "%.*s.%d.%u",
+			 EP_OBJ_TYPE_MAX_LEN, endpoint2.type, endpoint2.id,
+			 endpoint2.if_id);
+	else
+		snprintf(row->endpoint, sizeof(row->endpoint), "%.*s.%d",
+			 EP_OBJ_TYPE_MAX_LEN, endpoint2.type, endpoint2.id);
+}
+
+static int top_add_obj(struct top *top, const struct dprc_obj_desc *obj_desc)
+{
+	const struct top_type *top_type = find_top_type(obj_desc->type);
+	struct top_row *row;
+	uint16_t num_ifs;
+	int error;
+
+	if (!top_type)
+		return 0;
+
+	error = get_obj_num_ifs(obj_desc->type, obj_desc->id, &num_ifs);
+	if (error < 0)
+		return error;
+
+	row = realloc(top->rows, (top->num_rows + 1) * sizeof(*row));
+	if (!row)
+		return -ENOMEM;
+
+	top->rows = row;
+	row = &top->rows[top->num_rows++];
+	memset(row, 0, sizeof(*row));
+	snprintf(row->name, sizeof(row->name), "%s.%u", obj_desc->type,
+		 obj_desc->id);
+	top_read_endpoint(row, obj_desc->type, obj_desc->id, num_ifs);
+	row->first_obj = top->set.num_objs;
+	row->num_objs = num_ifs;
+
+	for (uint16_t if_id = 0; if_id < num_ifs; if_id++) {
+		error = counters_add_if(&top->set, obj_desc->type,
+					obj_desc->id, if_id,
+					top_type->counters);
+		if (error < 0)
+			return error;
+	}
+
+	return 0;
+}
+
+/**
+ * Find the objects of the tree of containers rooted at top->dprc_id, once
+ */
+static int top_start(struct top *top)
+{
+	struct walk_result walk;
+	uint16_t dprc_handle;
+	int error;
+
+	if (top->dprc_id == restool.root_dprc_id) {
+		dprc_handle = restool.root_dprc_handle;
+	} else {
+		error = open_dprc(top->dprc_id, &dprc_handle);
+		if (error < 0)
+			return error;
+	}
+
+	error = walk_containers(top->dprc_id, dprc_handle, 0, &walk);
+	for (unsigned int i = 0; error == 0 && i < walk.num_containers; i++) {
+		struct walk_container *container = &walk.containers[i];
+
+		for (int j = 0; error == 0 && j < container->num_objs; j++)
+			error = top_add_obj(top, &container->objs[j]);
+	}
+	walk_free(&walk);
+
+	if (dprc_handle != restool.root_dprc_handle)
+		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
+
+	if (error < 0)
+		return error;
+
+	if (top->num_rows == 0) {
+		ERROR_PRINTF("No DPNI, DPMAC, DPSW or DPDMUX in dprc.%u\n",
+			     top->dprc_id);
+		return -ENOENT;
+	}
+
+	return counters_start(&top->set);
+}
+
+static int compare_rows(const void *a, const void *b)
+{
+	const struct top_row *row_a = a;
+	const struct top_row *row_b = b;
+
+	if (row_a->key != row_b->key)
+		return row_a->key < row_b->key ? 1 : -1;
+
+	return strcmp(row_a->name, row_b->name);
+}
+
+static void top_compute_rates(struct top *top)
+{
+	const struct counter_set *set = &top->set;
+
+	for (unsigned int r = 0; r < top->num_rows; r++) {
+		struct top_row *row = &top->rows[r];
+
+		memset(row->rates, 0, sizeof(row->rates));
+		for (unsigned int i = 0; i < row->num_objs; i++) {
+			const struct counter_obj *obj =
+				&set->objs[row->first_obj + i];
+
+			row->rates[TOP_RX_PPS] += counters_rate(set, obj, 0);
+			row->rates[TOP_RX_BPS] += counters_rate(set, obj, 1) * 8;
+			row->rates[TOP_TX_PPS] += counters_rate(set, obj, 2);
+			row->rates[TOP_TX_BPS] += counters_rate(set, obj, 3) * 8;
+			for (unsigned int c = 4; c < obj->num_counters; c++)
+				row->rates[TOP_DROPS] +=
+					counters_rate(set, obj, c);
+		}
+
+		row->key = 0;
+		for (unsigned int rate = 0; rate < TOP_NUM_RATES; rate++) {
+			if (top->sort_key->rates & TOP_RATE_BIT(rate))
+				row->key += row->rates[rate];
+		}
+	}
+
+	/* rows move, but each one keeps its interfaces */
+	qsort(top->rows, top->num_rows, sizeof(*top->rows), compare_rows);
+}
+
+static const char *format_rate(char *buf, size_t size, double rate)
+{
+	static const char units[] = " KMGT";
+	unsigned int unit = 0;
+
+	/* 999.96 is displayed as 1.0K, not as 1000.0 */
+	while (rate >= 999.95 && unit < sizeof(units) - 2) {
+		rate /= 1000;
+		unit++;
+	}
+
+	if (unit == 0)
+		snprintf(buf, size, "%.0f", rate);
+	else
+		snprintf(buf, size, "%.1f%c", rate, units[unit]);
+	return buf;
+}
+
+static void top_print(struct top *top, long interval_ms, bool tty)
+{
+	char rates[TOP_NUM_RATES][16];
+	unsigned int num_rows = top->num_rows;
+	struct winsize ws;
+	time_t now = time(NULL);
+	char clock[16];
+
+	if (tty) {
+		/* leave room for the 3 lines of headers */
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 &&
+		    ws.ws_row > 3 && ws.ws_row - 3U < num_rows)
+			num_rows = ws.ws_row - 3U;
+
+		/* cursor home and clear the screen */
+		fputs("\033[H\033[J", stdout);
+	} else {
+		putchar('\n');
+	}
+
+	strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&now));
+	printf("restool top - dprc.%u - %u objects - every %.1f s - sorted by %s - %s\n\n",
+	       top->dprc_id, top->num_rows, interval_ms / 1000.0,
+	       top->sort_key->name, clock);
+	printf("%-14s %-16s %10s %10s %10s %10s %10s\n", "OBJECT", "ENDPOINT",
+	       "RX PPS", "RX BPS", "TX PPS", "TX BPS", "DROPS/S");
+	for (unsigned int r = 0; r < num_rows; r++) {
+		const struct top_row *row = &top->rows[r];
+
+		for (unsigned int rate = 0; rate < TOP_NUM_RATES; rate++)
+			format_rate(rates[rate], sizeof(rates[rate]),
+				    row->rates[rate]);
+
+		printf("%-14s %-16s %10s %10s %10s %10s %10s\n", row->name,
+		       row->endpoint, rates[TOP_RX_PPS], rates[TOP_RX_BPS],
+		       rates[TOP_TX_PPS], rates[TOP_TX_BPS], rates[TOP_DROPS]);
+	}
+	fflush(stdout);
+}
+
+static int top_refresh(void *arg, long n)
+{
+	struct top *top = arg;
+	int error;
+
+	error = counters_sample(&top->set);
+	if (error < 0 || n == 0)
+		return error;
+
+	top_compute_rates(top);
+	top_print(top, top->interval_ms, top->tty);
+	return 0;
+}
+
+/**
+ * Display the objects of the container tree rooted at 'dprc_id' sorted by
+ * 'sort', refreshed every 'interval_ms', 'count' times or until
+ * interrupted if 'count' is 0
+ */
+int dprc_top(uint32_t dprc_id, const char *sort, long interval_ms, long count)
+{
+	struct top top;
+	int error;
+
+	memset(&top, 0, sizeof(top));
+	top.dprc_id = dprc_id;
+	top.interval_ms = interval_ms;
+	top.tty = isatty(STDOUT_FILENO);
+	for (unsigned int i = 0; i < ARRAY_SIZE(top_sort_keys); i++) {
+		if (strcmp(top_sort_keys[i].name, sort) == 0)
+			top.sort_key = &top_sort_keys[i];
+	}
+
+	if (!top.sort_key) {
+		ERROR_PRINTF("Invalid sort key: %s\n", sort);
+		return -EINVAL;
+	}
+
+	error = top_start(&top);
+	if (error < 0)
+		goto out;
+
+	error = interval_run((uint64_t)interval_ms * 1000000, count,
+			     top_refresh, &top);
+out:
+	counters_free(&top.set);
+	free(top.rows);
+	return error;
+}
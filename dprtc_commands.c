@@ -125,6 +125,7 @@ const struct flib_ops dprtc_ops = {
 	.obj_close = dprtc_close_v10,
 	.obj_get_irq_mask = dprtc_get_irq_mask_v10,
 	.obj_get_irq_status = dprtc_get_irq_status_v10,
+	.obj_destroy = dprtc_destroy_v10,
 };
 
 static int cmd_dprtc_help(void)
@@ -82,6 +82,8 @@ enum dpseci_create_options {
 	CREATE_OPT_PRIORITIES,
 	CREATE_OPT_PARENT_DPRC,
 	CREATE_OPT_OPTIONS,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpseci_create_options[] = {
@@ -120,6 +122,20 @@ static struct option dpseci_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -150,6 +166,7 @@ const struct flib_ops dpseci_ops = {
 	.obj_close = dpseci_close_v10,
 	.obj_get_irq_mask = dpseci_get_irq_mask_v10,
 	.obj_get_irq_status = dpseci_get_irq_status_v10,
+	.obj_destroy = dpseci_destroy_v10,
 };
 
 static struct option_entry options_map_v10_1[] = {
@@ -578,12 +595,21 @@ static int create_dpseci_v9(const char *usage_msg)
 	return 0;
 }
 
+static int create_dpseci_obj(uint16_t dprc_handle, const void *cfg,
+			     uint32_t *dpseci_id)
+{
+	return dpseci_create_v10(&restool.mc_io, dprc_handle, 0, cfg,
+				 dpseci_id);
+}
+
 static int create_dpseci_v10(const char *usage_msg)
 {
 	struct dpseci_cfg_v10 dpseci_cfg = { 0 };
-	uint32_t dpseci_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 	long val;
 
@@ -646,6 +672,12 @@ static int create_dpseci_v10(const char *usage_msg)
 		return -EINVAL;
 	}
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -664,23 +696,16 @@ static int create_dpseci_v10(const char *usage_msg)
 		}
 	}
 
-	error = dpseci_create_v10(&restool.mc_io, dprc_handle, 0, &dpseci_cfg, &dpseci_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpseci", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpseci_obj,
+			    &dpseci_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpseci", dpseci_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpseci", dpseci_id, NULL);
-	}
 
-	return 0;
+	return error;
 }
 
 static int cmd_dpseci_create_v9(void)
@@ -720,6 +745,10 @@ static int cmd_dpseci_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLE:\n"
 		"Create a DPSECI with 2 rx/tx queues, 2,4 priorities:\n"
@@ -746,6 +775,10 @@ static int cmd_dpseci_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLE:\n"
 		"Create a DPSECI with 2 rx/tx queues, 2,4 priorities:\n"
@@ -93,6 +93,8 @@ enum dpsw_create_options {
 	CREATE_OPT_FDB_AGING_TIME,
 	CREATE_OPT_MAX_FDB_MC_GROUPS,
 	CREATE_OPT_PARENT_DPRC,
+	CREATE_OPT_COUNT,
+	CREATE_OPT_LABEL_PREFIX,
 };
 
 static struct option dpsw_create_options[] = {
@@ -159,6 +161,20 @@ static struct option dpsw_create_options[] = {
 		.val = 0,
 	},
 
+	[CREATE_OPT_COUNT] = {
+		.name = "count",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[CREATE_OPT_LABEL_PREFIX] = {
+		.name = "label-prefix",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
 	{ 0 },
 };
 
@@ -189,6 +205,7 @@ const struct flib_ops dpsw_ops = {
 	.obj_close = dpsw_close_v10,
 	.obj_get_irq_mask = dpsw_get_irq_mask_v10,
 	.obj_get_irq_status = dpsw_get_irq_status_v10,
+	.obj_destroy = dpsw_destroy_v10,
 };
 
 static struct option_entry options_map[] = {
@@ -714,12 +731,20 @@ static int cmd_dpsw_create_v9(void)
 	return create_dpsw_v9(usage_msg);
 }
 
+static int create_dpsw_obj(uint16_t dprc_handle, const void *cfg,
+			   uint32_t *dpsw_id)
+{
+	return dpsw_create_v10(&restool.mc_io, dprc_handle, 0, cfg, dpsw_id);
+}
+
 static int create_dpsw_v10(const char *usage_msg)
 {
 	struct dpsw_cfg_v10 dpsw_cfg = {0};
-	uint32_t dpsw_id, dprc_id;
+	uint32_t dprc_id;
 	uint16_t dprc_handle;
 	bool dprc_opened;
+	const char *label_prefix;
+	long count;
 	int error;
 	long val;
 
@@ -829,6 +854,12 @@ static int create_dpsw_v10(const char *usage_msg)
 		dpsw_cfg.adv.max_fdb_mc_groups = 0;
 	}
 
+	error = get_create_count_options(CREATE_OPT_COUNT,
+					 CREATE_OPT_LABEL_PREFIX,
+					 &count, &label_prefix);
+	if (error)
+		return error;
+
 	dprc_handle = restool.root_dprc_handle;
 	dprc_opened = false;
 	if (restool.cmd_option_mask & ONE_BIT_MASK(CREATE_OPT_PARENT_DPRC)) {
@@ -847,22 +878,13 @@ static int create_dpsw_v10(const char *usage_msg)
 		}
 	}
 
-	error = dpsw_create_v10(&restool.mc_io, dprc_handle, 0,
-				&dpsw_cfg, &dpsw_id);
-	if (error) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			     mc_status_to_string(mc_status), mc_status);
-		return error;
-	}
-
-	if (dprc_opened) {
+	error = create_objs("dpsw", dprc_handle,
+			    dprc_opened ?
+			    restool.cmd_option_args[CREATE_OPT_PARENT_DPRC] :
+			    NULL,
+			    count, label_prefix, create_dpsw_obj, &dpsw_cfg);
+	if (dprc_opened)
 		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
-		print_new_obj("dpsw", dpsw_id,
-			      restool.cmd_option_args[CREATE_OPT_PARENT_DPRC]);
-	} else {
-		print_new_obj("dpsw", dpsw_id, NULL);
-	}
 
 	return error;
 }
@@ -897,6 +919,10 @@ static int cmd_dpsw_create_v10(void)
 		"--container=<container-name>\n"
 		"   Specifies the parent container name. e.g. dprc.2, dprc.3 etc.\n"
 		"   If it is not specified, the new object will be created under the default dprc.\n"
+		"--count=<number>\n"
+		"   Creates <number> objects with the same options. Defaults to 1.\n"
+		"--label-prefix=<prefix>\n"
+		"   Labels the new objects <prefix>0, <prefix>1, etc.\n"
 		"\n"
 		"EXAMPLE:\n"
 		"Create a DPSW object with all default options:\n"
@@ -0,0 +1,709 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "restool.h"
+#include "utils.h"
+
+/*
+ * Maximum size of an HTTP request header read by 'exporter serve', and
+ * time given to a client to send it
+ */
+#define EXPORTER_MAX_REQUEST	8192
+#define EXPORTER_TIMEOUT_S	5
+
+#define EXPORTER_OPENMETRICS_TYPE \
+	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+#define EXPORTER_TEXT_TYPE	"text/plain; version=0.0.4; charset=utf-8"
+
+enum exporter_serve_options {
+	SERVE_OPT_HELP = 0,
+	SERVE_OPT_LISTEN,
+};
+
+static struct option exporter_serve_options[] = {
+	[SERVE_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[SERVE_OPT_LISTEN] = {
+		.name = "listen",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(exporter_serve_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+enum exporter_write_options {
+	WRITE_OPT_HELP = 0,
+	WRITE_OPT_INTERVAL,
+};
+
+static struct option exporter_write_options[] = {
+	[WRITE_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[WRITE_OPT_INTERVAL] = {
+		.name = "interval",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(exporter_write_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+/**
+ * struct exporter_obj - labels of an object whose counters are exported
+ * @container_id: id of the container of the object
+ * @label: label of the object, may be empty
+ */
+struct exporter_obj {
+	uint32_t container_id;
+	char label[MC_OBJ_LABEL_MAX_LENGTH + 1];
+};
+
+/**
+ * struct exporter - objects exported, found once when the exporter starts
+ * @set: counters of the objects, the objects stay open
+ * @objs: labels of the objects, in the order of @set
+ */
+struct exporter {
+	struct counter_set set;
+	struct exporter_obj *objs;
+};
+
+static int cmd_exporter_help(void)
+{
+	static const char help_msg[] =
+		"\n"
+		"Usage: restool exporter <command> [--help] [ARGS...]\n"
+		"Where <command> can be:\n"
+		"   serve - serves the counters of the DPNIs and DPMACs over HTTP.\n"
+		"   write - writes the counters of the DPNIs and DPMACs to a file.\n"
+		"\n"
+		"For command-specific help, use the --help option of each command.\n"
+		"\n";
+
+	printf(help_msg);
+	return 0;
+}
+
+static bool exporter_exports(const char *type)
+{
+	return strcmp(type, "dpni") == 0 || strcmp(type, "dpmac") == 0;
+}
+
+/**
+ * Walk the container tree once and open every DPNI and DPMAC for the
+ * scrapes to come
+ */
+static int exporter_start(struct exporter *exp)
+{
+	struct walk_result walk;
+	int error;
+
+	memset(exp, 0, sizeof(*exp));
+	error = walk_containers(restool.root_dprc_id, restool.root_dprc_handle,
+				0, &walk);
+	for (unsigned int i = 0; error == 0 && i < walk.num_containers; i++) {
+		struct walk_container *container = &walk.containers[i];
+
+		for (int j = 0; error == 0 && j < container->num_objs; j++) {
+			struct dprc_obj_desc *obj_desc = &container->objs[j];
+			struct exporter_obj *obj;
+
+			if (!exporter_exports(obj_desc->type))
+				continue;
+
+			obj = realloc(exp->objs,
+				      (exp->set.num_objs + 1) * sizeof(*obj));
+			if (!obj) {
+				error = -ENOMEM;
+				break;
+			}
+
+			exp->objs = obj;
+			obj = &exp->objs[exp->set.num_objs];
+			obj->container_id = container->id;
+			strncpy(obj->label, obj_desc->label,
+				MC_OBJ_LABEL_MAX_LENGTH);
+			obj->label[MC_OBJ_LABEL_MAX_LENGTH] = '\0';
+			error = counters_add(&exp->set, obj_desc->type,
+					     obj_desc->id, NULL);
+		}
+	}
+	walk_free(&walk);
+	if (error < 0)
+		return error;
+
+	DEBUG_PRINTF("exporting the counters of %u objects\n",
+		     exp->set.num_objs);
+	return counters_start(&exp->set);
+}
+
+static void exporter_free(struct exporter *exp)
+{
+	counters_free(&exp->set);
+	free(exp->objs);
+	exp->objs = NULL;
+}
+
+/*
+ * Metric names only have letters, digits and underscores
+ */
+static void print_metric_name(FILE *fp, const struct counter_obj *obj,
+			      const struct counter_desc *counter)
+{
+	fprintf(fp, "restool_%s_", obj->type);
+	for (const char *c = counter->name; *c != '\0'; c++)
+		fputc(isalnum((unsigned char)*c) ? *c : '_', fp);
+}
+
+static void print_label_value(FILE *fp, const char *value)
+{
+	for (const char *c = value; *c != '\0'; c++) {
+		if (*c == '\\' || *c == '"')
+			fputc('\\', fp);
+		if (*c == '\n')
+			fputs("\\n", fp);
+		else
+			fputc(*c, fp);
+	}
+}
+
+/**
+ * Sample the counters and print them in the Prometheus text format, or in
+ * the OpenMetrics format if 'openmetrics' is set. Objects of a type sample
+ * the same counters, so each counter of a type is one metric family with
+ * one sample per object.
+ */
+static int exporter_render(struct exporter *exp, FILE *fp, bool openmetrics)
+{
+	struct counter_set *set = &exp->set;
+	int error;
+
+	error = counters_sample(set);
+	if (error < 0)
+		return error;
+
+	for (unsigned int first = 0; first < set->num_objs; first++) {
+		const struct counter_obj *first_obj = &set->objs[first];
+		bool seen = false;
+
+		/* the family of a type is printed with its first object */
+		for (unsigned int i = 0; i < first && !seen; i++)
+			seen = strcmp(set->objs[i].type, first_obj->type) == 0;
+		if (seen)
+			continue;
+
+		for (unsigned int c = 0; c < first_obj->num_counters; c++) {
+			fputs("# TYPE ", fp);
+			print_metric_name(fp, first_obj,
+					  first_obj->counters[c]);
+			fputs(openmetrics ? " counter\n" : "_total counter\n",
+			      fp);
+
+			for (unsigned int i = first; i < set->num_objs; i++) {
+				const struct counter_obj *obj = &set->objs[i];
+
+				if (strcmp(obj->type, first_obj->type) != 0)
+					continue;
+
+				print_metric_name(fp, obj, obj->counters[c]);
+				fprintf(fp,
+					"_total{object=\"%s.%u\",id=\"%u\",container=\"dprc.%u\",label=\"",
+					obj->type, obj->id, obj->id,
+					exp->objs[i].container_id);
+				print_label_value(fp, exp->objs[i].label);
+				fprintf(fp, "\"} %lu\n",
+					(unsigned long)obj->values[c]);
+			}
+		}
+	}
+
+	if (openmetrics)
+		fputs("# EOF\n", fp);
+
+	return 0;
+}
+
+static int exporter_write_file(struct exporter *exp, const char *path)
+{
+	char *tmp_path;
+	FILE *fp;
+	int error;
+
+	if (asprintf(&tmp_path, "%s.%d", path, getpid()) < 0)
+		return -ENOMEM;
+
+	fp = fopen(tmp_path, "w");
+	if (!fp) {
+		error = -errno;
+		ERROR_PRINTF("cannot create %s (error %d)\n", tmp_path, error);
+		goto out;
+	}
+
+	error = exporter_render(exp, fp, false);
+	if (fclose(fp) != 0 && error == 0) {
+		error = -errno;
+		ERROR_PRINTF("cannot write %s (error %d)\n", tmp_path, error);
+	}
+
+	/* a collector reading the file never sees it half written */
+	if (error == 0 && rename(tmp_path, path) < 0) {
+		error = -errno;
+		ERROR_PRINTF("cannot rename %s to %s (error %d)\n",
+			     tmp_path, path, error);
+	}
+
+	if (error < 0)
+		(void)unlink(tmp_path);
+out:
+	free(tmp_path);
+	return error;
+}
+
+static int exporter_write_sample(void *arg, long n)
+{
+	(void)n;
+	return exporter_write_file(arg, restool.obj_name);
+}
+
+static int cmd_exporter_write(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool exporter write <file> [--interval=<ms>]\n"
+		"\n"
+		"Writes the counters of every DPNI and DPMAC to <file> in the Prometheus\n"
+		"text format, for the textfile collector of the node exporter. The file\n"
+		"is replaced at once, never left half written.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--interval=<ms>\n"
+		"   Writes the file again every <ms> milliseconds, until interrupted.\n"
+		"   The objects are found and opened once.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"   $ restool exporter write /var/lib/node_exporter/restool.prom --interval=15000\n"
+		"\n";
+	struct exporter exp;
+	long interval_ms = 0;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(WRITE_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(WRITE_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<file> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(WRITE_OPT_INTERVAL)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(WRITE_OPT_INTERVAL);
+		error = get_option_value(WRITE_OPT_INTERVAL, &interval_ms,
+					 "Invalid interval", 1, 3600000);
+		if (error)
+			return error;
+	}
+
+	if (interval_ms != 0) {
+		error = daemon_decline_command();
+		if (error)
+			return error;
+	}
+
+	error = exporter_start(&exp);
+	if (error < 0)
+		goto out;
+
+	if (interval_ms == 0)
+		error = exporter_write_file(&exp, restool.obj_name);
+	else
+		error = interval_run((uint64_t)interval_ms * 1000000, 0,
+				     exporter_write_sample, &exp);
+out:
+	exporter_free(&exp);
+	return error;
+}
+
+/**
+ * Open a listening socket on 'addr': "unix:<path>" for a UNIX socket,
+ * "[tcp:][<host>:]<port>" for TCP
+ */
+static int exporter_listen(const char *addr, const char **unix_path)
+{
+	struct addrinfo hints;
+	struct addrinfo *res;
+	struct addrinfo *ai;
+	char host[256] = "";
+	const char *port;
+	int fd = -1;
+	int error;
+	int one = 1;
+
+	*unix_path = NULL;
+	if (strncmp(addr, "unix:", 5) == 0) {
+		struct sockaddr_un sun;
+
+		memset(&sun, 0, sizeof(sun));
+		sun.sun_family = AF_UNIX;
+		if (strlen(addr + 5) == 0 ||
+		    strlen(addr + 5) >= sizeof(sun.sun_path)) {
+			ERROR_PRINTF("Invalid socket path: %s\n", addr + 5);
+			return -EINVAL;
+		}
+		strcpy(sun.sun_path, addr + 5);
+
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+			return -errno;
+
+		(void)unlink(sun.sun_path);
+		if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+			error = -errno;
+			ERROR_PRINTF("cannot bind %s (error %d)\n",
+				     sun.sun_path, error);
+			close(fd);
+			return error;
+		}
+
+		*unix_path = addr + 5;
+		goto listen;
+	}
+
+	if (strncmp(addr, "tcp:", 4) == 0)
+		addr += 4;
+
+	port = strrchr(addr, ':');
+	if (port) {
+		size_t len = port - addr;
+
+		/* [<ipv6 address>]:<port> */
+		if (len >= 2 && addr[0] == '[' && addr[len - 1] == ']') {
+			addr++;
+			len -= 2;
+		}
+
+		if (len >= sizeof(host)) {
+			ERROR_PRINTF("Invalid listen address: %s\n", addr);
+			return -EINVAL;
+		}
+
+		memcpy(host, addr, len);
+		host[len] = '\0';
+		port++;
+	} else {
+		port = addr;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	error = getaddrinfo(host[0] ? host : NULL, port, &hints, &res);
+	if (error != 0) {
+		ERROR_PRINTF("Invalid listen address: %s (%s)\n",
+			     addr, gai_strerror(error));
+		return -EINVAL;
+	}
+
+	error = -EADDRNOTAVAIL;
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+			    ai->ai_protocol);
+		if (fd < 0) {
+			error = -errno;
+			continue;
+		}
+
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+
+		error = -errno;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+
+	if (fd < 0) {
+		ERROR_PRINTF("cannot bind %s (error %d)\n", addr, error);
+		return error;
+	}
+
+listen:
+	if (listen(fd, 16) < 0) {
+		error = -errno;
+		ERROR_PRINTF("listen() failed (error %d)\n", error);
+		close(fd);
+		if (*unix_path)
+			(void)unlink(*unix_path);
+		return error;
+	}
+
+	return fd;
+}
+
+static void exporter_reply(int fd, const char *status,
+			   const char *content_type,
+			   const char *body, size_t len)
+{
+	char header[256];
+	int header_len;
+
+	header_len = snprintf(header, sizeof(header),
+			      "HTTP/1.0 %s\r\n"
+			      "Content-Type: %s\r\n"
+			      "Content-Length: %zu\r\n"
+			      "Connection: close\r\n"
+			      "\r\n",
+			      status, content_type, len);
+	if (write(fd, header, header_len) != header_len)
+		return;
+
+	while (len > 0) {
+		ssize_t n = write(fd, body, len);
+
+		if (n <= 0)
+			return;
+		body += n;
+		len -= n;
+	}
+}
+
+/**
+ * Answer one HTTP request: GET /metrics samples the counters. The
+ * OpenMetrics format is served to the scrapers asking for it.
+ */
+static void exporter_handle_client(struct exporter *exp, int fd)
+{
+	static const char plain[] = "text/plain; charset=utf-8";
+	struct timeval timeout = { .tv_sec = EXPORTER_TIMEOUT_S };
+	char request[EXPORTER_MAX_REQUEST + 1];
+	char method[8];
+	char path[256];
+	bool openmetrics;
+	size_t len = 0;
+	size_t size;
+	char *body;
+	FILE *fp;
+	int error;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	while (len < EXPORTER_MAX_REQUEST) {
+		ssize_t n = read(fd, request + len, EXPORTER_MAX_REQUEST - len);
+
+		if (n <= 0)
+			return;
+		len += n;
+		request[len] = '\0';
+		if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+
+	if (sscanf(request, "%7s %255s", method, path) != 2) {
+		exporter_reply(fd, "400 Bad Request", plain, "", 0);
+		return;
+	}
+
+	if (strcmp(method, "GET") != 0) {
+		exporter_reply(fd, "405 Method Not Allowed", plain, "", 0);
+		return;
+	}
+
+	path[strcspn(path, "?")] = '\0';
+	if (strcmp(path, "/metrics") != 0 && strcmp(path, "/") != 0) {
+		exporter_reply(fd, "404 Not Found", plain, "", 0);
+		return;
+	}
+
+	openmetrics = strcasestr(request, "application/openmetrics-text");
+	fp = open_memstream(&body, &size);
+	if (!fp) {
+		exporter_reply(fd, "500 Internal Server Error", plain, "", 0);
+		return;
+	}
+
+	error = exporter_render(exp, fp, openmetrics);
+	fclose(fp);
+	if (error < 0) {
+		ERROR_PRINTF("scrape failed (error %d)\n", error);
+		exporter_reply(fd, "500 Internal Server Error", plain, "", 0);
+	} else {
+		exporter_reply(fd, "200 OK",
+			       openmetrics ? EXPORTER_OPENMETRICS_TYPE :
+					     EXPORTER_TEXT_TYPE,
+			       body, size);
+	}
+	free(body);
+}
+
+static int cmd_exporter_serve(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool exporter serve --listen=<address>\n"
+		"\n"
+		"Serves the counters of every DPNI and DPMAC on GET /metrics, in the\n"
+		"Prometheus text format or in the OpenMetrics format when asked for it.\n"
+		"The objects are found and opened once; each scrape only reads their\n"
+		"counters. Serves until interrupted.\n"
+		"\n"
+		"--listen=<address>\n"
+		"   unix:<path> listens on a UNIX socket, [tcp:][<host>:]<port> on TCP.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"   $ restool exporter serve --listen=:9712\n"
+		"\n";
+	const char *unix_path = NULL;
+	struct sigaction old_pipe;
+	struct sigaction sa;
+	struct exporter exp;
+	int listen_fd = -1;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(SERVE_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(SERVE_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name != NULL) {
+		ERROR_PRINTF("Unexpected argument: \'%s\'\n\n",
+			     restool.obj_name);
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	if (!(restool.cmd_option_mask & ONE_BIT_MASK(SERVE_OPT_LISTEN))) {
+		ERROR_PRINTF("--listen option missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+	restool.cmd_option_mask &= ~ONE_BIT_MASK(SERVE_OPT_LISTEN);
+
+	error = daemon_decline_command();
+	if (error)
+		return error;
+
+	error = exporter_start(&exp);
+	if (error < 0)
+		goto out;
+
+	listen_fd = exporter_listen(restool.cmd_option_args[SERVE_OPT_LISTEN],
+				    &unix_path);
+	if (listen_fd < 0) {
+		error = listen_fd;
+		goto out;
+	}
+
+	/* a scraper going away must not kill restool */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = SIG_IGN;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGPIPE, &sa, &old_pipe);
+	stop_signals_catch();
+
+	while (!stop_requested()) {
+		int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			error = -errno;
+			ERROR_PRINTF("accept() failed (error %d)\n", error);
+			break;
+		}
+
+		exporter_handle_client(&exp, fd);
+		close(fd);
+	}
+
+	stop_signals_restore();
+	sigaction(SIGPIPE, &old_pipe, NULL);
+out:
+	if (listen_fd >= 0)
+		close(listen_fd);
+	if (unix_path)
+		(void)unlink(unix_path);
+	exporter_free(&exp);
+	return error;
+}
+
+struct object_command exporter_commands[] = {
+	{ .cmd_name = "help",
+	  .options = NULL,
+	  .cmd_func = cmd_exporter_help },
+
+	{ .cmd_name = "serve",
+	  .options = exporter_serve_options,
+	  .cmd_func = cmd_exporter_serve },
+
+	{ .cmd_name = "write",
+	  .options = exporter_write_options,
+	  .cmd_func = cmd_exporter_write },
+
+	{ .cmd_name = NULL },
+};
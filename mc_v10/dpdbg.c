@@ -398,7 +398,7 @@ int dpdbg_get_ctlu_profiling_counters(struct fsl_mc_io *mc_io,
 	(void)(cmd_flags);
 
 	/* prepare command */
-	cmd.header = mc_encode_cmd_header(DPDBG_CMDID_SET_CTLU_PROFILING,
+	cmd.header = mc_encode_cmd_header(DPDBG_CMDID_GET_CTLU_PROFILING,
 					  0,
 					  token);
 	cmd_params =
@@ -30,6 +30,7 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <string.h>
 #include "fsl_mc_sys.h"
 #include "fsl_mc_cmd.h"
 #include "fsl_dprc.h"
@@ -119,7 +120,7 @@ int dprc_create_container(struct fsl_mc_io *mc_io,
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_create_container *cmd_params;
 	struct dprc_rsp_create_container *rsp_params;
-	int err, i;
+	int err;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_CREATE_CONT,
@@ -128,8 +129,8 @@ int dprc_create_container(struct fsl_mc_io *mc_io,
 	cmd_params->options = cpu_to_le32(cfg->options);
 	cmd_params->icid = cpu_to_le32(cfg->icid);
 	cmd_params->portal_id = cpu_to_le32(cfg->portal_id);
-	for (i = 0; i < 16; i++)
-		cmd_params->label[i] = cfg->label[i];
+	strncpy((char *)cmd_params->label, cfg->label,
+		sizeof(cmd_params->label));
 
 	/* send command to mc*/
 	err = mc_send_command(mc_io, &cmd);
@@ -310,7 +311,6 @@ int dprc_assign(struct fsl_mc_io *mc_io,
 {
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_assign *cmd_params;
-	int i;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_ASSIGN,
@@ -320,8 +320,8 @@ int dprc_assign(struct fsl_mc_io *mc_io,
 	cmd_params->options = cpu_to_le32(res_req->options);
 	cmd_params->num = cpu_to_le32(res_req->num);
 	cmd_params->id_base_align = cpu_to_le32(res_req->id_base_align);
-	for (i = 0; i < 16; i++)
-		cmd_params->type[i] = res_req->type[i];
+	strncpy((char *)cmd_params->type, res_req->type,
+		sizeof(cmd_params->type));
 
 	/* send command to mc*/
 	return mc_send_command(mc_io, &cmd);
@@ -350,7 +350,6 @@ int dprc_unassign(struct fsl_mc_io *mc_io,
 {
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_unassign *cmd_params;
-	int i;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_UNASSIGN,
@@ -361,8 +360,8 @@ int dprc_unassign(struct fsl_mc_io *mc_io,
 	cmd_params->options = cpu_to_le32(res_req->options);
 	cmd_params->num = cpu_to_le32(res_req->num);
 	cmd_params->id_base_align = cpu_to_le32(res_req->id_base_align);
-	for (i = 0; i < 16; i++)
-		cmd_params->type[i] = res_req->type[i];
+	strncpy((char *)cmd_params->type, res_req->type,
+		sizeof(cmd_params->type));
 
 	/* send command to mc*/
 	return mc_send_command(mc_io, &cmd);
@@ -559,14 +558,14 @@ int dprc_get_res_count(struct fsl_mc_io *mc_io,
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_get_res_count *cmd_params;
 	struct dprc_rsp_get_res_count *rsp_params;
-	int err, i;
+	int err;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_GET_RES_COUNT,
 					  cmd_flags, token);
 	cmd_params = (struct dprc_cmd_get_res_count *)cmd.params;
-	for (i = 0; i < 16; i++)
-		cmd_params->type[i] = type[i];
+	strncpy((char *)cmd_params->type, type,
+		sizeof(cmd_params->type));
 
 	/* send command to mc*/
 	err = mc_send_command(mc_io, &cmd);
@@ -600,7 +599,7 @@ int dprc_get_res_ids(struct fsl_mc_io *mc_io,
 	struct dprc_cmd_get_res_ids *cmd_params;
 	struct dprc_rsp_get_res_ids *rsp_params;
 	uint8_t iter_lo, iter_hi;
-	int err, i;
+	int err;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_GET_RES_IDS,
@@ -614,8 +613,8 @@ int dprc_get_res_ids(struct fsl_mc_io *mc_io,
 	dprc_set_field(cmd_params->iter_status_hi,
 		       ITER_STATUS_HI,
 		       range_desc->iter_status & 0x40);
-	for (i = 0; i < 16; i++)
-		cmd_params->type[i] = type[i];
+	strncpy((char *)cmd_params->type, type,
+		sizeof(cmd_params->type));
 
 	/* send command to mc*/
 	err = mc_send_command(mc_io, &cmd);
@@ -653,7 +652,6 @@ int dprc_set_obj_label(struct fsl_mc_io *mc_io,
 {
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_set_obj_label *cmd_params;
-	int i;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_SET_OBJ_LABEL,
@@ -661,10 +659,10 @@ int dprc_set_obj_label(struct fsl_mc_io *mc_io,
 					  token);
 	cmd_params = (struct dprc_cmd_set_obj_label *)cmd.params;
 	cmd_params->obj_id = cpu_to_le32(obj_id);
-	for (i = 0; i < 16; i++) {
-		cmd_params->label[i] = label[i];
-		cmd_params->obj_type[i] = obj_type[i];
-	}
+	strncpy((char *)cmd_params->label, label,
+		sizeof(cmd_params->label));
+	strncpy((char *)cmd_params->obj_type, obj_type,
+		sizeof(cmd_params->obj_type));
 
 	/* send command to mc*/
 	return mc_send_command(mc_io, &cmd);
@@ -777,7 +775,6 @@ int dprc_connect(struct fsl_mc_io *mc_io,
 {
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_connect *cmd_params;
-	int i;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_CONNECT,
@@ -790,10 +787,10 @@ int dprc_connect(struct fsl_mc_io *mc_io,
 	cmd_params->ep2_interface_id = cpu_to_le16(endpoint2->if_id);
 	cmd_params->max_rate = cpu_to_le32(cfg->max_rate);
 	cmd_params->committed_rate = cpu_to_le32(cfg->committed_rate);
-	for (i = 0; i < 16; i++) {
-		cmd_params->ep1_type[i] = endpoint1->type[i];
-		cmd_params->ep2_type[i] = endpoint2->type[i];
-	}
+	strncpy((char *)cmd_params->ep1_type, endpoint1->type,
+		sizeof(cmd_params->ep1_type));
+	strncpy((char *)cmd_params->ep2_type, endpoint2->type,
+		sizeof(cmd_params->ep2_type));
 
 	/* send command to mc*/
 	return mc_send_command(mc_io, &cmd);
@@ -815,7 +812,6 @@ int dprc_disconnect(struct fsl_mc_io *mc_io,
 {
 	struct mc_command cmd = { 0 };
 	struct dprc_cmd_disconnect *cmd_params;
-	int i;
 
 	/* prepare command */
 	cmd.header = mc_encode_cmd_header(DPRC_CMDID_DISCONNECT,
@@ -824,8 +820,8 @@ int dprc_disconnect(struct fsl_mc_io *mc_io,
 	cmd_params = (struct dprc_cmd_disconnect *)cmd.params;
 	cmd_params->id = cpu_to_le32(endpoint->id);
 	cmd_params->interface_id = cpu_to_le32(endpoint->if_id);
-	for (i = 0; i < 16; i++)
-		cmd_params->type[i] = endpoint->type[i];
+	strncpy((char *)cmd_params->type, endpoint->type,
+		sizeof(cmd_params->type));
 
 	/* send command to mc*/
 	return mc_send_command(mc_io, &cmd);
@@ -865,8 +861,8 @@ int dprc_get_connection(struct fsl_mc_io *mc_io,
 	cmd_params = (struct dprc_cmd_get_connection *)cmd.params;
 	cmd_params->ep1_id = cpu_to_le32(endpoint1->id);
 	cmd_params->ep1_interface_id = cpu_to_le16(endpoint1->if_id);
-	for (i = 0; i < 16; i++)
-		cmd_params->ep1_type[i] = endpoint1->type[i];
+	strncpy((char *)cmd_params->ep1_type, endpoint1->type,
+		sizeof(cmd_params->ep1_type));
 
 	/* send command to mc*/
 	err = mc_send_command(mc_io, &cmd);
@@ -56,6 +56,8 @@
 #define DPDMUX_CMDID_GET_IRQ_MASK		DPDMUX_CMD(0x015)
 #define DPDMUX_CMDID_GET_IRQ_STATUS		DPDMUX_CMD(0x016)
 
+#define DPDMUX_CMDID_IF_GET_COUNTER		DPDMUX_CMD(0x0b2)
+
 #define DPDMUX_MASK(field)        \
 	GENMASK(DPDMUX_##field##_SHIFT + DPDMUX_##field##_SIZE - 1, \
 		DPDMUX_##field##_SHIFT)
@@ -126,5 +128,15 @@ struct dpdmux_rsp_get_api_version {
 	uint16_t minor;
 };
 
+struct dpdmux_cmd_if_get_counter {
+	uint16_t if_id;
+	uint8_t counter_type;
+};
+
+struct dpdmux_rsp_if_get_counter {
+	uint64_t pad;
+	uint64_t counter;
+};
+
 #pragma pack(pop)
 #endif /* _FSL_DPDMUX_CMD_H */
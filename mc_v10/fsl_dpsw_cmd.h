@@ -52,6 +52,7 @@
 #define DPSW_CMDID_GET_ATTR                     DPSW_CMD(0x004)
 #define DPSW_CMDID_GET_IRQ_MASK                 DPSW_CMD(0x015)
 #define DPSW_CMDID_GET_IRQ_STATUS               DPSW_CMD(0x016)
+#define DPSW_CMDID_IF_GET_COUNTER               DPSW_CMD(0x034)
 
 /* Macros for accessing command fields smaller than 1byte */
 #define DPSW_MASK(field)        \
@@ -144,5 +145,19 @@ struct dpsw_rsp_get_api_version {
 	uint16_t version_minor;
 };
 
+#define DPSW_COUNTER_TYPE_SHIFT		0
+#define DPSW_COUNTER_TYPE_SIZE		5
+
+struct dpsw_cmd_if_get_counter {
+	uint16_t if_id;
+	/* from LSB: type:5 */
+	uint8_t type;
+};
+
+struct dpsw_rsp_if_get_counter {
+	uint64_t pad;
+	uint64_t counter;
+};
+
 #pragma pack(pop)
 #endif /* __FSL_DPSW_CMD_H */
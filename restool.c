@@ -38,9 +38,10 @@
 #include <errno.h>
 #include <assert.h>
 #include <getopt.h>
-#include <sys/ioctl.h>
 #include "restool.h"
 #include "utils.h"
+#include "mc_v10/fsl_dpsw.h"
+#include "mc_v10/fsl_dpdmux.h"
 
 static struct option global_options[] = {
 	[GLOBAL_OPT_HELP] = {
@@ -79,6 +80,40 @@ static struct option global_options[] = {
 		.val = 'e',
 	},
 
+	[GLOBAL_OPT_DAEMON] = {
+		.name = "daemon",
+		.val = 'D',
+	},
+
+	[GLOBAL_OPT_BATCH] = {
+		.name = "batch",
+		.val = 'b',
+		.has_arg = required_argument,
+	},
+
+	[GLOBAL_OPT_PORTALS] = {
+		.name = "portals",
+		.val = 'p',
+		.has_arg = required_argument,
+	},
+
+	[GLOBAL_OPT_STATS] = {
+		.name = "stats",
+		.val = 'S',
+	},
+
+	[GLOBAL_OPT_DEVICE] = {
+		.name = "device",
+		.val = 'V',
+		.has_arg = required_argument,
+	},
+
+	[GLOBAL_OPT_RECORD] = {
+		.name = "record",
+		.val = 'R',
+		.has_arg = required_argument,
+	},
+
 	{ 0 },
 };
 
@@ -152,6 +187,18 @@ static const struct obj_command_versions dpdbg_command_versions[] = {
 	{ .version = 1, .obj_commands = dpdbg_commands },
 	{ .version = 0, .obj_commands = NULL },
 };
+static const struct obj_command_versions dpl_command_versions[] = {
+	{ .version = 1, .obj_commands = dpl_commands },
+	{ .version = 0, .obj_commands = NULL },
+};
+static const struct obj_command_versions exporter_command_versions[] = {
+	{ .version = 1, .obj_commands = exporter_commands },
+	{ .version = 0, .obj_commands = NULL },
+};
+static const struct obj_command_versions sampler_command_versions[] = {
+	{ .version = 1, .obj_commands = sampler_commands },
+	{ .version = 0, .obj_commands = NULL },
+};
 static const struct obj_command_versions dprtc_command_versions[] = {
 	{ .version = 1, .obj_commands = dprtc_commands_v9 },
 	{ .version = 2, .obj_commands = dprtc_commands_v10 },
@@ -180,6 +227,9 @@ static const struct object_cmd_parser object_cmd_parsers[] = {
 	{ .obj_type = "dpaiop", .obj_commands_versions = dpaiop_command_versions },
 	{ .obj_type = "dpdbg",  .obj_commands_versions = dpdbg_command_versions },
 	{ .obj_type = "dprtc",  .obj_commands_versions = dprtc_command_versions },
+	{ .obj_type = "dpl",    .obj_commands_versions = dpl_command_versions },
+	{ .obj_type = "exporter", .obj_commands_versions = exporter_command_versions },
+	{ .obj_type = "sampler", .obj_commands_versions = sampler_command_versions },
 	{ .obj_type = "dpdmai", .obj_commands_versions = dpdmai_command_versions },
 };
 /**
@@ -264,6 +314,19 @@ struct version_table dpdbg_version_table[] = {
 	{ .mc_major_version = 10, .object_version = 1 },
 	{ .mc_major_version = 0 }
 };
+struct version_table dpl_version_table[] = {
+	{ .mc_major_version = 9, .object_version = 1 },
+	{ .mc_major_version = 10, .object_version = 1 },
+	{ .mc_major_version = 0 }
+};
+struct version_table exporter_version_table[] = {
+	{ .mc_major_version = 10, .object_version = 1 },
+	{ .mc_major_version = 0 }
+};
+struct version_table sampler_version_table[] = {
+	{ .mc_major_version = 10, .object_version = 1 },
+	{ .mc_major_version = 0 }
+};
 struct version_table dprtc_version_table[] = {
 	{ .mc_major_version = 9, .object_version = 1 },
 	{ .mc_major_version = 10, .object_version = 2 },
@@ -291,6 +354,9 @@ struct lut_entry version_lut[] = {
 	{ .object = "dpsw",   .versions_table = dpsw_version_table   },
 	{ .object = "dpdbg",  .versions_table = dpdbg_version_table  },
 	{ .object = "dprtc",  .versions_table = dprtc_version_table  },
+	{ .object = "dpl",    .versions_table = dpl_version_table    },
+	{ .object = "exporter", .versions_table = exporter_version_table },
+	{ .object = "sampler", .versions_table = sampler_version_table },
 };
 
 struct restool restool;
@@ -372,6 +438,23 @@ int find_target_obj_desc(uint32_t dprc_id, uint16_t dprc_handle,
 		return 0;
 	}
 
+	if (nesting_level == 0 && dprc_id == restool.root_dprc_id) {
+		error = topology_lookup(target_type, target_id,
+					target_obj_desc,
+					target_parent_dprc_id);
+		if (error == 0) {
+			DEBUG_PRINTF("target_parent_dprc_id: dprc.%d\n",
+				     *target_parent_dprc_id);
+			*found = true;
+			return 0;
+		}
+
+		if (error == -ENOENT)
+			return 0;
+
+		DEBUG_PRINTF("topology index unavailable (error %d)\n", error);
+	}
+
 	error = dprc_get_obj_count(&restool.mc_io, 0,
 				   dprc_handle,
 				   &num_child_devices);
@@ -615,6 +698,11 @@ bool in_use(const char *obj, const char *situation)
 
 void print_new_obj(char *type, int id, const char *parent)
 {
+	if (restool.new_obj_id) {
+		*restool.new_obj_id = id;
+		return;
+	}
+
 	if (restool.script) {
 		printf("%s.%d\n", type, id);
 		return;
@@ -628,6 +716,89 @@ void print_new_obj(char *type, int id, const char *parent)
 	printf("%s.%d is created under %s\n", type, id, parent);
 }
 
+int get_create_count_options(int count_option, int label_prefix_option,
+			     long *count, const char **label_prefix)
+{
+	int error;
+
+	*count = 1;
+	*label_prefix = NULL;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(count_option)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(count_option);
+		error = get_option_value(count_option, count,
+					 "Invalid count", 1, UINT16_MAX);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(label_prefix_option)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(label_prefix_option);
+		*label_prefix = restool.cmd_option_args[label_prefix_option];
+
+		/* the label of the last object is the longest */
+		if (strlen(*label_prefix) +
+		    snprintf(NULL, 0, "%ld", *count - 1) >
+		    MC_OBJ_LABEL_MAX_LENGTH) {
+			ERROR_PRINTF("label length > %d characters\n",
+				     MC_OBJ_LABEL_MAX_LENGTH);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int create_objs(char *type, uint16_t dprc_handle, const char *parent,
+		long count, const char *label_prefix,
+		create_obj_func create, const void *cfg)
+{
+	enum mc_cmd_status mc_status;
+	char label[32];
+	long num_created = 0;
+	uint32_t obj_id;
+	int error = 0;
+
+	while (num_created < count) {
+		if (daemon_interrupted()) {
+			ERROR_PRINTF("interrupted\n");
+			error = -EINTR;
+			break;
+		}
+
+		error = create(dprc_handle, cfg, &obj_id);
+		if (error < 0)
+			break;
+
+		num_created++;
+		print_new_obj(type, obj_id, parent);
+
+		if (label_prefix) {
+			snprintf(label, sizeof(label), "%s%ld",
+				 label_prefix, num_created - 1);
+			error = dprc_set_obj_label(&restool.mc_io, 0,
+						   dprc_handle, type, obj_id,
+						   label);
+			if (error < 0)
+				break;
+		}
+	}
+
+	if (error < 0) {
+		if (error != -EINTR) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status),
+				     mc_status);
+		}
+		if (count > 1)
+			ERROR_PRINTF("%ld of %ld %s objects created\n",
+				     num_created, count, type);
+	}
+
+	return error;
+}
+
 void print_unexpected_options_error(uint32_t option_mask,
 				    const struct option *options)
 {
@@ -659,6 +830,65 @@ int get_option_value(int option, long *value, const char *error_msg, long min, l
 	return 0;
 }
 
+int get_obj_num_ifs(const char *type, uint32_t id, uint16_t *num_ifs)
+{
+	enum mc_cmd_status mc_status;
+	uint16_t token;
+	int error;
+	int error2;
+
+	if (strcmp(type, "dpsw") == 0) {
+		struct dpsw_attr_v10 dpsw_attr;
+
+		error = dpsw_open_v10(&restool.mc_io, 0, id, &token);
+		if (error < 0)
+			goto mc_error;
+
+		memset(&dpsw_attr, 0, sizeof(dpsw_attr));
+		error = dpsw_get_attributes_v10(&restool.mc_io, 0, token,
+						&dpsw_attr);
+		*num_ifs = dpsw_attr.num_ifs;
+		error2 = dpsw_close_v10(&restool.mc_io, 0, token);
+	} else if (strcmp(type, "dpdmux") == 0) {
+		struct dpdmux_attr_v10 dpdmux_attr;
+
+		error = dpdmux_open_v10(&restool.mc_io, 0, id, &token);
+		if (error < 0)
+			goto mc_error;
+
+		memset(&dpdmux_attr, 0, sizeof(dpdmux_attr));
+		error = dpdmux_get_attributes_v10(&restool.mc_io, 0, token,
+						  &dpdmux_attr);
+		*num_ifs = dpdmux_attr.num_ifs + 1;
+		error2 = dpdmux_close_v10(&restool.mc_io, 0, token);
+	} else {
+		*num_ifs = 1;
+		return 0;
+	}
+
+	if (error == 0)
+		error = error2;
+	if (error == 0)
+		return 0;
+
+mc_error:
+	mc_status = flib_error_to_mc_status(error);
+	ERROR_PRINTF("MC error: %s (status %#x)\n",
+		     mc_status_to_string(mc_status), mc_status);
+	return error;
+}
+
+/**
+ * Current time of CLOCK_MONOTONIC, in nanoseconds
+ */
+uint64_t now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
 int get_parent_dprc_id(uint32_t obj_id, char *obj_type, uint32_t *parent_dprc_id)
 {
 	struct dprc_obj_desc target_obj_desc;
@@ -706,6 +936,22 @@ static void print_usage(void)
 		"   -s, --script     Display script friendly output\n"
 		"   --rescan         Issues a rescan of fsl-mc bus before exiting\n"
 		"   --root=[dprc]    Specifies root container name\n"
+		"   --daemon         Keeps the MC portal open and serves restool commands\n"
+		"                    on " RESTOOL_DAEMON_SOCKET " for the clients using\n"
+		"                    the same --root\n"
+		"   --batch=<file>   Runs the restool commands found in <file>, one per\n"
+		"                    line, in a single process ('-' reads stdin). The\n"
+		"                    changes made by the lines between 'begin' and\n"
+		"                    'commit' are undone if one of them fails\n"
+		"   --portals=<n>    Number of MC portals used to walk the container tree,\n"
+		"                    generate a DPL and sample counters (default: %u,\n"
+		"                    max: %u)\n"
+		"   --stats          Prints statistics of the MC commands sent on exit\n"
+		"   --device=<dev>   Sends the MC commands to <dev> instead of the fsl-mc bus.\n"
+		"                    sim[:<n>[:<c>]] is a simulated MC with <n> dpni/dpmac\n"
+		"                    pairs (default: 16) spread over <c> child containers,\n"
+		"                    replay:<file> answers from a trace written by --record\n"
+		"   --record=<file>  Writes the MC commands sent and their responses to <file>\n"
 		"\n"
 		"  Valid <object-type> values: <dprc|dpni|dpio|dpsw|dpbp|dpci|dpcon|dpseci|dpdmux|\n"
 		"                               dpmcp|dpmac|dpdcei|dpaiop|dpdmai>\n"
@@ -720,7 +966,8 @@ static void print_usage(void)
 		"  <object-name> is a string containing object type and ID (e.g. dpni.7)\n"
 		"\n";
 
-	puts(usage_msg);
+	printf(usage_msg, DEFAULT_NUM_PORTALS, MAX_NUM_PORTALS);
+	putchar('\n');
 	restool.global_option_mask &= ~ONE_BIT_MASK(GLOBAL_OPT_HELP);
 }
 
@@ -751,9 +998,30 @@ static void print_usage_v9(void)
 		"   -s, --script     Display script friendly output\n"
 		"   --rescan         Issues a rescan of fsl-mc bus before exiting\n"
 		"   --root=[dprc]    Specifies root container name\n"
+		"   --daemon         Keeps the MC portal open and serves restool commands\n"
+		"                    on " RESTOOL_DAEMON_SOCKET " for the clients using\n"
+		"                    the same --root\n"
+		"   --batch=<file>   Runs the restool commands found in <file>, one per\n"
+		"                    line, in a single process ('-' reads stdin). The\n"
+		"                    changes made by the lines between 'begin' and\n"
+		"                    'commit' are undone if one of them fails\n"
+		"   --portals=<n>    Number of MC portals used to walk the container tree,\n"
+		"                    generate a DPL and sample counters (default: %u,\n"
+		"                    max: %u)\n"
+		"   --stats          Prints statistics of the MC commands sent on exit\n"
+		"   --device=<dev>   Sends the MC commands to <dev> instead of the fsl-mc bus.\n"
+		"                    sim[:<n>[:<c>]] is a simulated MC with <n> dpni/dpmac\n"
+		"                    pairs (default: 16) spread over <c> child containers,\n"
+		"                    replay:<file> answers from a trace written by --record\n"
+		"   --record=<file>  Writes the MC commands sent and their responses to <file>\n"
 		"\n"
 		"  Valid <object-type> values: <dprc|dpni|dpio|dpsw|dpbp|dpci|dpcon|dpseci|dpdmux|\n"
 		"                               dpmcp|dpmac|dpdcei|dpaiop|dprtc|dpdmai>\n"
+		"  'restool dpl apply <file>' creates the layout described by a DPL file\n"
+		"  'restool exporter serve --listen=<addr>' serves the DPNI and DPMAC counters\n"
+		"  to Prometheus\n"
+		"  'restool sampler record <objects> --output=<file>' samples counters into\n"
+		"  a ring buffer file, 'restool sampler report <file>' analyzes it\n"
 		"\n"
 		"  Valid commands vary for each object type.\n"
 		"  Most objects support the following commands:\n"
@@ -765,7 +1033,8 @@ static void print_usage_v9(void)
 		"  <object-name> is a string containing object type and ID (e.g. dpni.7)\n"
 		"\n";
 
-	puts(usage_msg);
+	printf(usage_msg, DEFAULT_NUM_PORTALS, MAX_NUM_PORTALS);
+	putchar('\n');
 	restool.global_option_mask &= ~ONE_BIT_MASK(GLOBAL_OPT_HELP);
 }
 
@@ -928,6 +1197,38 @@ static int parse_global_options(int argc, char *argv[],
 		case 'e':
 			opt_index = GLOBAL_OPT_RESCAN;
 			break;
+		case 'D':
+			opt_index = GLOBAL_OPT_DAEMON;
+			break;
+		case 'b':
+			opt_index = GLOBAL_OPT_BATCH;
+			break;
+		case 'p': {
+			char *endptr;
+			long val;
+
+			opt_index = GLOBAL_OPT_PORTALS;
+			errno = 0;
+			val = strtol(optarg, &endptr, 0);
+			if (STRTOL_ERROR(optarg, endptr, val, errno) ||
+			    val < 1 || val > MAX_NUM_PORTALS) {
+				ERROR_PRINTF("Invalid Argument: portals must be between 1 and %u\n",
+					     MAX_NUM_PORTALS);
+				return -EINVAL;
+			}
+
+			restool.num_portals = val;
+			break;
+		}
+		case 'S':
+			opt_index = GLOBAL_OPT_STATS;
+			break;
+		case 'V':
+			opt_index = GLOBAL_OPT_DEVICE;
+			break;
+		case 'R':
+			opt_index = GLOBAL_OPT_RECORD;
+			break;
 		default:
 			DEBUG_PRINTF("\n");
 			assert(false);
@@ -968,7 +1269,12 @@ static int parse_cmd_options(int argc, char *argv[],
 	optind = 1;
 	optarg = NULL;
 
+	/*
+	 * Commands test the arguments of their options, clear the ones
+	 * of the previous command run by the same process
+	 */
 	restool.cmd_option_mask = 0;
+	memset(restool.cmd_option_args, 0, sizeof(restool.cmd_option_args));
 	assert(options != NULL);
 
 	for ( ; ; ) {
@@ -1032,7 +1338,12 @@ static uint16_t get_obj_version(const char *obj_type)
 	 */
 	versions_table = lut_obj_entry->versions_table;
 	for (i = 0; versions_table[i].mc_major_version != 0; i++) {
-		if (mc_major_version == versions_table[i].mc_major_version)
+		/*
+		 * without an MC portal, the commands not needing one are
+		 * looked up in the latest object version
+		 */
+		if (mc_major_version == versions_table[i].mc_major_version ||
+		    mc_major_version == 0)
 			obj_version = versions_table[i].object_version;
 	}
 
@@ -1115,6 +1426,33 @@ out:
 	return obj_cmd;
 }
 
+/**
+ * Tells if 'obj_type cmd_name' needs an MC portal, in any object version
+ */
+static bool obj_cmd_needs_mc(const char *obj_type, const char *cmd_name)
+{
+	const struct obj_command_versions *obj_cmd_versions;
+	struct object_command *obj_commands;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(object_cmd_parsers); i++) {
+		if (strcmp(obj_type, object_cmd_parsers[i].obj_type) != 0)
+			continue;
+
+		obj_cmd_versions = object_cmd_parsers[i].obj_commands_versions;
+		for (int j = 0; obj_cmd_versions[j].obj_commands != NULL; j++) {
+			obj_commands = obj_cmd_versions[j].obj_commands;
+			for (int k = 0; obj_commands[k].cmd_name != NULL; k++) {
+				if (strcmp(cmd_name,
+					   obj_commands[k].cmd_name) == 0 &&
+				    obj_commands[k].no_mc)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 static int parse_obj_command(const char *obj_type,
 			     const char *cmd_name,
 			     int argc,
@@ -1188,6 +1526,9 @@ static int parse_obj_command(const char *obj_type,
 		error = -EINVAL;
 	}
 out:
+	if (!topology_cmd_is_read_only(cmd_name))
+		topology_invalidate();
+
 	return error;
 }
 
@@ -1196,7 +1537,7 @@ static int get_device_file(void)
 	int num_dev_files = 0;
 	struct dirent *dir;
 	int error = 0;
-	char *device;
+	char *device = NULL;
 	int num_char;
 	long val;
 	DIR *d;
@@ -1279,29 +1620,46 @@ out:
 	return error;
 }
 
-static int open_root_container(void)
+/**
+ * Select the transport named by --device, "sim[:<params>]" or
+ * "replay:<file>"
+ */
+static int get_device_transport(const char *device,
+				const struct fsl_mc_transport **transport)
 {
 	int error;
-	uint32_t root_dprc_id;
 
-	if (strcmp(restool.device_file, "/dev/mc_restool") == 0) {
-		DEBUG_PRINTF("calling ioctl(RESTOOL_GET_ROOT_DPRC_INFO)\n");
-		error = ioctl(restool.mc_io.fd,
-			      RESTOOL_GET_ROOT_DPRC_INFO,
-			      &root_dprc_id);
-		if (error == -1) {
-			error = -errno;
+	if (strcmp(device, "sim") == 0 || strncmp(device, "sim:", 4) == 0) {
+		error = mc_sim_configure(device[3] ? &device[4] : NULL);
+		if (error < 0)
 			return error;
-		}
 
-		DEBUG_PRINTF("ioctl returned MC-bus's root_dprc_id: %#x\n",
-			     root_dprc_id);
-	} else {
-		char *dev_file = restool.device_file;
+		*transport = &mc_sim_transport;
+		return 0;
+	}
+
+	if (strncmp(device, "replay:", 7) == 0) {
+		error = mc_replay_configure(&device[7]);
+		if (error < 0)
+			return error;
 
-		root_dprc_id = atoi(&dev_file[10]);
+		*transport = &mc_replay_transport;
+		return 0;
 	}
 
+	ERROR_PRINTF("Invalid Argument: unknown device '%s'\n", device);
+	return -EINVAL;
+}
+
+static int open_root_container(void)
+{
+	int error;
+	uint32_t root_dprc_id;
+
+	error = mc_get_root_dprc_id(&restool.mc_io, &root_dprc_id);
+	if (error < 0)
+		return error;
+
 	restool.root_dprc_id = root_dprc_id;
 	error = open_dprc(restool.root_dprc_id,
 			  &restool.root_dprc_handle);
@@ -1317,97 +1675,100 @@ static int get_endianness(void)
 	return BIG_ENDIAN;
 }
 
-int main(int argc, char *argv[])
+/**
+ * Parse the global options found in argv and run the requested object
+ * command. The MC portal and the root container are expected to be open.
+ */
+int restool_execute(int argc, char *argv[])
 {
 	int error;
 	int next_argv_index;
 	const char *obj_type;
 	const char *cmd_name;
-	bool mc_io_initialized = false;
-	bool root_dprc_opened = false;
-	enum mc_cmd_status mc_status;
-	bool talk_to_mc = true;
-
-	#ifdef DEBUG
-	restool.debug = true;
-	#endif
-
-	memset(restool.specified_dev_file, '\0', USR_DEV_FILE_SIZE);
+	bool stats = false;
 
 	error = parse_global_options(argc, argv, &next_argv_index);
 	if (error < 0)
 		goto out;
 
-	error = get_device_file();
-	if (error < 0)
-		goto out;
-
-	DEBUG_PRINTF("restool built on " __DATE__ " " __TIME__ "\n");
-	error = mc_io_init(&restool.mc_io);
-	if (error != 0)
-		goto out;
-
-	mc_io_initialized = true;
-	DEBUG_PRINTF("restool.mc_io.fd: %d\n", restool.mc_io.fd);
+	if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_STATS)) {
+		restool.global_option_mask &= ~ONE_BIT_MASK(GLOBAL_OPT_STATS);
+		if (!restool.stats) {
+			mc_stats_reset();
+			restool.stats = true;
+			stats = true;
+		}
+	}
 
-	error = mc_get_version(&restool.mc_io, 0,
-				&restool.mc_fw_version);
-	if (error != 0) {
-		mc_status = flib_error_to_mc_status(error);
-		ERROR_PRINTF("MC error: %s (status %#x)\n",
-			mc_status_to_string(mc_status), mc_status);
+	if (restool.daemon &&
+	    (restool.global_option_mask & (ONE_BIT_MASK(GLOBAL_OPT_DAEMON) |
+					   ONE_BIT_MASK(GLOBAL_OPT_BATCH) |
+					   ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+					   ONE_BIT_MASK(GLOBAL_OPT_RECORD)))) {
+		ERROR_PRINTF("--daemon, --batch, --device and --record are not accepted by the restool daemon\n");
+		error = -EINVAL;
 		goto out;
 	}
 
-	if (restool.mc_fw_version.major < 9) {
-		ERROR_PRINTF("This version of restool does no longer support MC\
-			     firmware versions lower than v9. \
-			     Please use restool v1.5\n");
+	/*
+	 * The daemon only runs the commands whose --root names its own
+	 * root container
+	 */
+	if (restool.daemon)
+		restool.global_option_mask &= ~ONE_BIT_MASK(GLOBAL_OPT_ROOT);
+
+	if (restool.batch &&
+	    (restool.global_option_mask & (ONE_BIT_MASK(GLOBAL_OPT_ROOT) |
+					   ONE_BIT_MASK(GLOBAL_OPT_DAEMON) |
+					   ONE_BIT_MASK(GLOBAL_OPT_BATCH) |
+					   ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+					   ONE_BIT_MASK(GLOBAL_OPT_RECORD)))) {
+		ERROR_PRINTF("--root, --daemon, --batch, --device and --record are not accepted in a batch file\n");
+		error = -EINVAL;
 		goto out;
 	}
 
-	// MC versions lower or equal to V9 are not big-endian compatible
-	if (restool.mc_fw_version.major <= 9 && get_endianness() == BIG_ENDIAN) {
-		ERROR_PRINTF("Restool does not support MC versions lower than \
-				V10 on big-endian systems. Please upgrade your \
-				MC binary\n");
-	}
+	if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_BATCH)) {
+		const char *path = restool.global_option_args[GLOBAL_OPT_BATCH];
 
-	DEBUG_PRINTF("MC firmware version: %u.%u.%u\n",
-		     restool.mc_fw_version.major,
-		     restool.mc_fw_version.minor,
-		     restool.mc_fw_version.revision);
+		restool.global_option_mask &= ~(ONE_BIT_MASK(GLOBAL_OPT_BATCH) |
+						ONE_BIT_MASK(GLOBAL_OPT_ROOT) |
+						ONE_BIT_MASK(GLOBAL_OPT_PORTALS) |
+						ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+						ONE_BIT_MASK(GLOBAL_OPT_RECORD));
+		if (restool.global_option_mask &
+		    ONE_BIT_MASK(GLOBAL_OPT_DEBUG)) {
+			restool.global_option_mask &=
+				~ONE_BIT_MASK(GLOBAL_OPT_DEBUG);
+			restool.debug = true;
+		}
 
-	for (int i = 0; i < argc; i++) {
-		if (strcmp(argv[i], "-v") == 0 ||
-			strcmp(argv[i], "--version") == 0 ||
-			strcmp(argv[i], "--mc-version") == 0 ||
-			strcmp(argv[i], "-h") == 0 ||
-			strcmp(argv[i], "-?") == 0 ||
-			strcmp(argv[i], "--help") == 0 ||
-			strcmp(argv[i], "help") == 0) {
-			talk_to_mc = false;
-			break;
+		if (restool.global_option_mask &
+		    ONE_BIT_MASK(GLOBAL_OPT_SCRIPT)) {
+			restool.global_option_mask &=
+				~ONE_BIT_MASK(GLOBAL_OPT_SCRIPT);
+			restool.script = true;
 		}
-	}
 
-	DEBUG_PRINTF("talk_to_mc = %d\n", talk_to_mc);
-	if (talk_to_mc) {
+		if (restool.global_option_mask &
+		    ONE_BIT_MASK(GLOBAL_OPT_RESCAN)) {
+			restool.global_option_mask &=
+				~ONE_BIT_MASK(GLOBAL_OPT_RESCAN);
+			restool.rescan = true;
+		}
 
-		error = open_root_container();
+		if (restool.global_option_mask != 0 ||
+		    next_argv_index != argc) {
+			ERROR_PRINTF("--batch only accepts the --debug, --script, --root, --rescan, --portals, --device and --record options\n");
+			print_try_help();
+			error = -EINVAL;
+			goto out;
+		}
 
+		error = batch_run(path);
 		if (error < 0)
 			goto out;
-
-		DEBUG_PRINTF("newly opened restool's root_dprc_handle: %#x\n",
-			     restool.root_dprc_handle);
-		root_dprc_opened = true;
-	}
-
-	if (error < 0)
-		goto out;
-
-	if (next_argv_index == argc) {
+	} else if (next_argv_index == argc) {
 		if (restool.global_option_mask == 0) {
 			ERROR_PRINTF("Incomplete command line\n");
 			print_try_help();
@@ -1433,6 +1794,9 @@ int main(int argc, char *argv[])
 		    ONE_BIT_MASK(GLOBAL_OPT_MC_VERSION))
 			print_mc_version();
 
+		restool.global_option_mask &= ~(ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+						ONE_BIT_MASK(GLOBAL_OPT_RECORD));
+
 		if (restool.global_option_mask &
 		    ONE_BIT_MASK(GLOBAL_OPT_DEBUG)) {
 			restool.global_option_mask &=
@@ -1485,6 +1849,10 @@ int main(int argc, char *argv[])
 			restool.rescan = true;
 		}
 
+		restool.global_option_mask &= ~(ONE_BIT_MASK(GLOBAL_OPT_PORTALS) |
+						ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+						ONE_BIT_MASK(GLOBAL_OPT_RECORD));
+
 		int num_remaining_args;
 
 		assert(next_argv_index < argc);
@@ -1525,6 +1893,188 @@ int main(int argc, char *argv[])
 		}
 	}
 
+out:
+	if (stats) {
+		mc_stats_print(stderr);
+		restool.stats = false;
+	}
+
+	return error;
+}
+
+int main(int argc, char *argv[])
+{
+	int error;
+	int next_argv_index;
+	bool mc_io_initialized = false;
+	bool root_dprc_opened = false;
+	enum mc_cmd_status mc_status;
+	bool talk_to_mc = true;
+	bool stats = false;
+	const struct fsl_mc_transport *transport = &mc_ioctl_transport;
+	const char *device = NULL;
+	const char *record = NULL;
+	int status;
+
+	#ifdef DEBUG
+	restool.debug = true;
+	#endif
+
+	memset(restool.specified_dev_file, '\0', USR_DEV_FILE_SIZE);
+	restool.num_portals = DEFAULT_NUM_PORTALS;
+
+	error = parse_global_options(argc, argv, &next_argv_index);
+	if (error < 0)
+		goto out;
+
+	if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_DEVICE)) {
+		if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_ROOT)) {
+			ERROR_PRINTF("--root and --device cannot be used together\n");
+			error = -EINVAL;
+			goto out;
+		}
+
+		device = restool.global_option_args[GLOBAL_OPT_DEVICE];
+	}
+
+	if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_RECORD))
+		record = restool.global_option_args[GLOBAL_OPT_RECORD];
+
+	if (!(restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_DAEMON)) &&
+	    next_argv_index + 1 < argc &&
+	    !obj_cmd_needs_mc(argv[next_argv_index],
+			      argv[next_argv_index + 1])) {
+		/*
+		 * The command only reads files, it runs without opening
+		 * a device
+		 */
+		error = restool_execute(argc, argv);
+		goto out;
+	}
+
+	if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_DAEMON)) {
+		restool.global_option_mask &= ~ONE_BIT_MASK(GLOBAL_OPT_DAEMON);
+		if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_DEBUG)) {
+			restool.global_option_mask &=
+				~ONE_BIT_MASK(GLOBAL_OPT_DEBUG);
+			restool.debug = true;
+		}
+
+		restool.global_option_mask &= ~(ONE_BIT_MASK(GLOBAL_OPT_ROOT) |
+						ONE_BIT_MASK(GLOBAL_OPT_PORTALS) |
+						ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+						ONE_BIT_MASK(GLOBAL_OPT_RECORD));
+		if (restool.global_option_mask != 0 ||
+		    next_argv_index != argc) {
+			ERROR_PRINTF("--daemon only accepts the --debug, --root, --portals, --device and --record options\n");
+			print_try_help();
+			error = -EINVAL;
+			goto out;
+		}
+
+		restool.daemon = true;
+	} else if (!(restool.global_option_mask &
+		     (ONE_BIT_MASK(GLOBAL_OPT_BATCH) |
+		      ONE_BIT_MASK(GLOBAL_OPT_DEVICE) |
+		      ONE_BIT_MASK(GLOBAL_OPT_RECORD)))) {
+		/*
+		 * Let a running daemon execute the command on its MC portal,
+		 * fall back to opening a portal of our own otherwise.
+		 */
+		if (daemon_client_run(argc, argv, &status) == 0)
+			return status;
+	}
+
+	if (restool.global_option_mask & ONE_BIT_MASK(GLOBAL_OPT_STATS)) {
+		/*
+		 * Also count the commands used to set up restool
+		 */
+		mc_stats_reset();
+		restool.stats = true;
+		stats = true;
+	}
+
+	if (device)
+		error = get_device_transport(device, &transport);
+	else
+		error = get_device_file();
+
+	if (error < 0)
+		goto out;
+
+	if (record) {
+		error = mc_trace_open(record);
+		if (error < 0)
+			goto out;
+	}
+
+	DEBUG_PRINTF("restool built on " __DATE__ " " __TIME__ "\n");
+	error = mc_io_init(&restool.mc_io, transport);
+	if (error != 0)
+		goto out;
+
+	mc_io_initialized = true;
+	DEBUG_PRINTF("restool.mc_io.fd: %d\n", restool.mc_io.fd);
+
+	error = mc_get_version(&restool.mc_io, 0,
+				&restool.mc_fw_version);
+	if (error != 0) {
+		mc_status = flib_error_to_mc_status(error);
+		ERROR_PRINTF("MC error: %s (status %#x)\n",
+			mc_status_to_string(mc_status), mc_status);
+		goto out;
+	}
+
+	if (restool.mc_fw_version.major < 9) {
+		ERROR_PRINTF("This version of restool does no longer support MC\
+			     firmware versions lower than v9. \
+			     Please use restool v1.5\n");
+		goto out;
+	}
+
+	// MC versions lower or equal to V9 are not big-endian compatible
+	if (restool.mc_fw_version.major <= 9 && get_endianness() == BIG_ENDIAN) {
+		ERROR_PRINTF("Restool does not support MC versions lower than \
+				V10 on big-endian systems. Please upgrade your \
+				MC binary\n");
+	}
+
+	DEBUG_PRINTF("MC firmware version: %u.%u.%u\n",
+		     restool.mc_fw_version.major,
+		     restool.mc_fw_version.minor,
+		     restool.mc_fw_version.revision);
+
+	for (int i = 0; i < argc && !restool.daemon; i++) {
+		if (strcmp(argv[i], "-v") == 0 ||
+			strcmp(argv[i], "--version") == 0 ||
+			strcmp(argv[i], "--mc-version") == 0 ||
+			strcmp(argv[i], "-h") == 0 ||
+			strcmp(argv[i], "-?") == 0 ||
+			strcmp(argv[i], "--help") == 0 ||
+			strcmp(argv[i], "help") == 0) {
+			talk_to_mc = false;
+			break;
+		}
+	}
+
+	DEBUG_PRINTF("talk_to_mc = %d\n", talk_to_mc);
+	if (talk_to_mc) {
+
+		error = open_root_container();
+
+		if (error < 0)
+			goto out;
+
+		DEBUG_PRINTF("newly opened restool's root_dprc_handle: %#x\n",
+			     restool.root_dprc_handle);
+		root_dprc_opened = true;
+	}
+
+	if (restool.daemon)
+		error = daemon_serve();
+	else
+		error = restool_execute(argc, argv);
+
 out:
 	if (root_dprc_opened) {
 		int error2;
@@ -1542,6 +2092,16 @@ out:
 	if (mc_io_initialized)
 		mc_io_cleanup(&restool.mc_io);
 
+	if (record) {
+		int error2 = mc_trace_close();
+
+		if (error == 0)
+			error = error2;
+	}
+
+	if (stats)
+		mc_stats_print(stderr);
+
 	return error;
 }
 
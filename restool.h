@@ -34,10 +34,12 @@
 #ifndef _RESTOOL_H_
 #define _RESTOOL_H_
 
+#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <limits.h>
+#include <pthread.h>
 #include "mc_v10/fsl_mc_cmd.h"
 #include "mc_v10/fsl_dprc.h"
 #include "mc_v10/fsl_dpmng.h"
@@ -77,6 +79,23 @@
  */
 #define MAX_DPRC_NESTING	16
 
+/**
+ * UNIX socket the restool daemon listens on
+ */
+#define RESTOOL_DAEMON_SOCKET	"/run/restool.sock"
+
+/**
+ * File caching the objects of the container tree between restool runs
+ */
+#define RESTOOL_TOPOLOGY_CACHE	"/run/restool.topology"
+
+/**
+ * Default and maximum number of MC portals used to walk the container tree,
+ * to fetch the objects of a generated DPL and to sample counters
+ */
+#define DEFAULT_NUM_PORTALS	4
+#define MAX_NUM_PORTALS		16
+
 /**
  * Maximum length of object label (without including the null terminator)
  */
@@ -136,6 +155,11 @@ struct object_command {
 	 * Pointer to command function
 	 */
 	restool_cmd_func_t *cmd_func;
+
+	/**
+	 * The command only works on files and runs without an MC portal
+	 */
+	bool no_mc;
 };
 
 /**
@@ -272,6 +296,46 @@ struct restool {
 	 */
 	bool rescan;
 
+	/**
+	 * global flag set while restool is serving commands
+	 * as a daemon
+	 */
+	bool daemon;
+
+	/**
+	 * global flag set while restool is running the commands
+	 * of a batch file
+	 */
+	bool batch;
+
+	/**
+	 * number of MC portals used to walk the container tree, to fetch
+	 * the objects of a generated DPL and to sample counters
+	 */
+	unsigned int num_portals;
+
+	/**
+	 * global flag to record statistics of the MC commands sent
+	 */
+	bool stats;
+
+	/**
+	 * global flag to write the MC commands sent to a trace file
+	 */
+	bool record;
+
+	/**
+	 * global flag to journal the MC commands changing the layout,
+	 * set inside a batch transaction
+	 */
+	bool journal;
+
+	/**
+	 * if not NULL, the create commands store the id of the object
+	 * they create here instead of printing its name
+	 */
+	int *new_obj_id;
+
 	/**
 	 * device file used by restool
 	 */
@@ -295,6 +359,12 @@ enum global_options {
 	GLOBAL_OPT_SCRIPT,
 	GLOBAL_OPT_ROOT,
 	GLOBAL_OPT_RESCAN,
+	GLOBAL_OPT_DAEMON,
+	GLOBAL_OPT_BATCH,
+	GLOBAL_OPT_PORTALS,
+	GLOBAL_OPT_STATS,
+	GLOBAL_OPT_DEVICE,
+	GLOBAL_OPT_RECORD,
 };
 
 /* object option map entry */
@@ -326,12 +396,17 @@ typedef int flib_obj_get_irq_status_t(struct fsl_mc_io	*mc_io,
 					uint16_t	token,
 					uint8_t		irq_index,
 					uint32_t	*status);
+typedef int flib_obj_destroy_t(struct fsl_mc_io	*mc_io,
+				uint16_t	dprc_token,
+				uint32_t	cmd_flags,
+				uint32_t	obj_id);
 
 struct flib_ops {
 	flib_obj_open_t *obj_open;
 	flib_obj_close_t *obj_close;
 	flib_obj_get_irq_mask_t *obj_get_irq_mask;
 	flib_obj_get_irq_status_t *obj_get_irq_status;
+	flib_obj_destroy_t *obj_destroy;
 };
 
 extern const struct flib_ops dpaiop_ops;
@@ -379,6 +454,28 @@ int print_obj_verbose(struct dprc_obj_desc *target_obj_desc,
 
 void print_new_obj(char *type, int id, const char *parent);
 
+/**
+ * Parse the --count and --label-prefix options of a create command:
+ * 'count' defaults to 1 and 'label_prefix' to NULL
+ */
+int get_create_count_options(int count_option, int label_prefix_option,
+			     long *count, const char **label_prefix);
+
+/**
+ * Create one object in the container 'dprc_handle' from 'cfg'
+ */
+typedef int (*create_obj_func)(uint16_t dprc_handle, const void *cfg,
+			       uint32_t *obj_id);
+
+/**
+ * Create 'count' objects of 'type' with 'create' back to back on the open
+ * container 'dprc_handle', label them '<label_prefix><n>' when
+ * 'label_prefix' is not NULL and print their names
+ */
+int create_objs(char *type, uint16_t dprc_handle, const char *parent,
+		long count, const char *label_prefix,
+		create_obj_func create, const void *cfg);
+
 /* functions used to handle generic object handling */
 int open_dprc(uint32_t dprc_id, uint16_t *dprc_handle);
 
@@ -394,9 +491,294 @@ int check_resource_type(char *res_type);
 
 bool in_use(const char *obj, const char *situation);
 
+/**
+ * Number of interfaces of an object: the interfaces of a DPSW or DPDMUX,
+ * including the uplink of a DPDMUX, and 1 for the other objects
+ */
+int get_obj_num_ifs(const char *type, uint32_t id, uint16_t *num_ifs);
+
+uint64_t now_ns(void);
+
 int get_parent_dprc_id(uint32_t obj_id, char *obj_type,
 		       uint32_t *parent_dprc_id);
 
+int restool_execute(int argc, char *argv[]);
+
+/* functions used to run restool as a daemon or as its client */
+int daemon_serve(void);
+
+int daemon_client_run(int argc, char *argv[], int *status);
+
+int daemon_decline_command(void);
+
+bool daemon_interrupted(void);
+
+/* function used to run a file of restool commands */
+int batch_run(const char *path);
+
+/**
+ * struct walk_container - container found by walk_containers()
+ * @id: container id
+ * @parent_id: id of the parent container, 0 for the first container
+ * @nesting_level: depth of the container below the first container
+ * @options: container options, only read with WALK_ATTRIBUTES
+ * @num_objs: number of objects in the container
+ * @objs: objects of the container, in container index order
+ * @children: for each object, index of its walk_container if it is a
+ *	dprc, -1 otherwise
+ */
+struct walk_container {
+	uint32_t id;
+	uint32_t parent_id;
+	int nesting_level;
+	uint64_t options;
+	int num_objs;
+	struct dprc_obj_desc *objs;
+	int *children;
+};
+
+/**
+ * struct walk_result - containers found by walk_containers()
+ */
+struct walk_result {
+	struct walk_container *containers;
+	unsigned int num_containers;
+};
+
+/*
+ * walk_containers() flags
+ */
+#define WALK_ATTRIBUTES		0x1	/* read the container attributes */
+
+/**
+ * struct counter_desc - counter of an object type
+ * @name: counter name, as displayed
+ * @group: counters of the same group are read by a single MC command
+ * @index: index of the counter in the values read for its group
+ */
+struct counter_desc {
+	const char *name;
+	unsigned int group;
+	unsigned int index;
+};
+
+/**
+ * struct counter_obj - object whose counters are sampled
+ * @type: object type
+ * @id: object id
+ * @if_id: interface of the object whose counters are sampled
+ * @num_counters: number of counters sampled
+ * @counters: counters sampled, in the order they were selected
+ * @values: values of @counters read by the last sample
+ * @prev_values: values of @counters read by the sample before
+ */
+struct counter_obj {
+	const char *type;
+	uint32_t id;
+	uint16_t if_id;
+	unsigned int num_counters;
+	const struct counter_desc **counters;
+	uint64_t *values;
+	uint64_t *prev_values;
+};
+
+/**
+ * struct counter_set - objects whose counters are sampled together
+ * @objs: objects added by counters_add()
+ * @num_objs: number of objects in @objs
+ * @num_samples: number of samples read so far
+ * @when_ns: CLOCK_MONOTONIC time of the last sample, in nanoseconds
+ * @prev_when_ns: time of the sample before
+ * @engine: state of the portals and threads reading the counters
+ */
+struct counter_set {
+	struct counter_obj *objs;
+	unsigned int num_objs;
+	unsigned int num_samples;
+	uint64_t when_ns;
+	uint64_t prev_when_ns;
+	struct counter_engine *engine;
+};
+
+/**
+ * struct dpl_prop - property of a DPL node
+ * @name: property name
+ * @data: property value, in the flattened device tree format: strings are
+ *	NUL terminated and cells are big endian 32-bit words
+ * @len: length of @data in bytes
+ * @next: next property of the node, in file order
+ */
+struct dpl_prop {
+	char *name;
+	uint8_t *data;
+	unsigned int len;
+	struct dpl_prop *next;
+};
+
+/**
+ * struct dpl_node - node of a DPL loaded by dpl_load()
+ * @name: node name, including the unit address (e.g. "dpni@1")
+ * @props: properties of the node
+ * @children: subnodes of the node, in file order
+ * @next: next sibling of the node
+ * @parent: parent node, NULL for the root node
+ */
+struct dpl_node {
+	char *name;
+	struct dpl_prop *props;
+	struct dpl_node *children;
+	struct dpl_node *next;
+	struct dpl_node *parent;
+};
+
+/* functions used to read a DPL from a DTS or DTB file and write it as DTB */
+int dpl_parse(const char *name, const uint8_t *buf, size_t size,
+	      struct dpl_node **root);
+
+int dpl_load(const char *path, struct dpl_node **root);
+
+void dpl_free(struct dpl_node *node);
+
+struct dpl_node *dpl_get_node(const struct dpl_node *node, const char *path);
+
+struct dpl_prop *dpl_get_prop(const struct dpl_node *node, const char *name);
+
+bool dpl_prop_is_string(const struct dpl_prop *prop);
+
+unsigned int dpl_prop_num_cells(const struct dpl_prop *prop);
+
+uint32_t dpl_prop_cell(const struct dpl_prop *prop, unsigned int index);
+
+int dpl_write_dtb(FILE *fp, const struct dpl_node *root);
+
+int dpl_clone(uint32_t dprc_id, uint32_t parent_dprc_id, unsigned int count);
+
+/**
+ * portal_pool_func_t - work of a portal_pool thread, run on the MC portal
+ * 'mc_io' of the thread, 'index' being the number of the thread, from 0
+ */
+typedef int portal_pool_func_t(void *arg, struct fsl_mc_io *mc_io,
+			       unsigned int index);
+
+/**
+ * struct portal_thread - thread of a portal_pool and its MC portal
+ * @error: value returned by the work of the thread
+ */
+struct portal_thread {
+	pthread_t thread;
+	struct fsl_mc_io mc_io;
+	struct portal_pool *pool;
+	unsigned int index;
+	int error;
+};
+
+/**
+ * struct portal_pool - threads running the same work, each one on an MC
+ * portal of its own cloned from restool.mc_io
+ */
+struct portal_pool {
+	struct portal_thread *threads;
+	unsigned int num_threads;
+	portal_pool_func_t *func;
+	void *arg;
+};
+
+/* functions used to run threads on MC portals of their own */
+int portal_pool_start(struct portal_pool *pool, unsigned int max_threads,
+		      portal_pool_func_t *func, void *arg);
+
+int portal_pool_join(struct portal_pool *pool);
+
+/* functions used to walk the container tree on several MC portals */
+int walk_containers(uint32_t dprc_id, uint16_t dprc_handle,
+		    unsigned int flags, struct walk_result *result);
+
+void walk_free(struct walk_result *result);
+
+/* functions used to sample the counters of objects on several MC portals */
+int counters_add(struct counter_set *set, const char *type, uint32_t id,
+		 const char *names);
+
+int counters_add_if(struct counter_set *set, const char *type, uint32_t id,
+		    uint16_t if_id, const char *names);
+
+int counters_start(struct counter_set *set);
+
+int counters_sample(struct counter_set *set);
+
+int counters_read_open(struct counter_set *set, const uint16_t *tokens);
+
+double counters_rate(const struct counter_set *set,
+		     const struct counter_obj *obj, unsigned int counter);
+
+void counters_free(struct counter_set *set);
+
+/**
+ * interval_run() callback, 'n' being the number of the call, from 0.
+ * Returns 0 to go on, 1 to stop, negative on error.
+ */
+typedef int interval_func_t(void *arg, long n);
+
+int interval_run(uint64_t interval_ns, long count, interval_func_t *func,
+		 void *arg);
+
+void stop_signals_catch(void);
+
+void stop_signals_restore(void);
+
+bool stop_requested(void);
+
+/* functions used to collect statistics of the MC commands */
+void mc_stats_record(uint16_t cmd_id, uint64_t ns, bool failed);
+
+void mc_stats_reset(void);
+
+void mc_stats_print(FILE *fp);
+
+/* simulated MC selected by --device=sim */
+extern const struct fsl_mc_transport mc_sim_transport;
+
+int mc_sim_configure(const char *params);
+
+/* functions used to record MC commands and to replay them */
+int mc_trace_open(const char *path);
+
+void mc_trace_record(int portal, const struct mc_command *request,
+		     const struct mc_command *response, int error,
+		     uint64_t start_ns, uint64_t latency_ns);
+
+void mc_trace_record_root(uint32_t root_dprc_id);
+
+void mc_trace_flush(void);
+
+int mc_trace_close(void);
+
+extern const struct fsl_mc_transport mc_replay_transport;
+
+int mc_replay_configure(const char *path);
+
+/* functions used to undo the MC commands of a failed batch transaction */
+void journal_begin(const struct fsl_mc_io *mc_io, uint16_t root_token);
+
+int journal_prepare(struct fsl_mc_io *portal,
+		    const struct mc_command *request);
+
+void journal_record(const struct fsl_mc_io *portal,
+		    const struct mc_command *request,
+		    const struct mc_command *response, int obj_state);
+
+void journal_commit(void);
+
+int journal_rollback(void);
+
+/* functions used to query the index of the objects in the container tree */
+int topology_lookup(const char *obj_type, uint32_t obj_id,
+		    struct dprc_obj_desc *obj_desc, uint32_t *parent_dprc_id);
+
+void topology_invalidate(void);
+
+bool topology_cmd_is_read_only(const char *cmd_name);
+
 extern struct restool restool;
 
 /* command maps for all MC objects */
@@ -445,5 +827,8 @@ extern struct object_command dpsw_commands[];
 extern struct object_command dpsw_commands_v9[];
 extern struct object_command dpsw_commands_v10[];
 extern struct object_command dpdbg_commands[];
+extern struct object_command dpl_commands[];
+extern struct object_command exporter_commands[];
+extern struct object_command sampler_commands[];
 
 #endif /* _RESTOOL_H_ */
@@ -0,0 +1,297 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "restool.h"
+#include "utils.h"
+
+/**
+ * Maximum number of words in a batch command line
+ */
+#define BATCH_MAX_ARGC		128
+
+/**
+ * Split 'line' in place into shell-like words. Words are separated by
+ * blanks, may be quoted with '' or "" and a '#' starting a word begins a
+ * comment that runs to the end of the line.
+ *
+ * Returns the number of words found, or a negative value on error.
+ */
+static int batch_split_line(char *line, char *argv[], int max_argc)
+{
+	char *src = line;
+	char *dst = line;
+	int argc = 0;
+
+	for ( ; ; ) {
+		char quote = '\0';
+
+		while (*src == ' ' || *src == '\t' || *src == '\n' ||
+		       *src == '\r')
+			src++;
+
+		if (*src == '\0' || *src == '#')
+			break;
+
+		if (argc == max_argc) {
+			ERROR_PRINTF("too many words\n");
+			return -E2BIG;
+		}
+
+		argv[argc++] = dst;
+		for ( ; *src != '\0'; src++) {
+			if (quote != '\0') {
+				if (*src == quote)
+					quote = '\0';
+				else
+					*dst++ = *src;
+			} else if (*src == '\'' || *src == '"') {
+				quote = *src;
+			} else if (*src == '\\' && src[1] != '\0') {
+				*dst++ = *++src;
+			} else if (*src == ' ' || *src == '\t' ||
+				   *src == '\n' || *src == '\r') {
+				break;
+			} else {
+				*dst++ = *src;
+			}
+		}
+
+		if (quote != '\0') {
+			ERROR_PRINTF("unterminated quote\n");
+			return -EINVAL;
+		}
+
+		if (*src != '\0')
+			src++;
+		*dst++ = '\0';
+	}
+
+	return argc;
+}
+
+/**
+ * Undo the changes of the transaction started on line 'begin_line'
+ */
+static int batch_rollback(unsigned int begin_line)
+{
+	int error;
+
+	fprintf(stderr, "rolling back the transaction of line %u\n",
+		begin_line);
+	error = journal_rollback();
+	fflush(stdout);
+	if (error)
+		fprintf(stderr, "line %u: rollback error %d\n",
+			begin_line, error);
+
+	return error;
+}
+
+/**
+ * Run the restool commands found in 'path' ("-" for stdin), one per line,
+ * on the MC portal and root container already opened by main(). Each
+ * line is a regular restool command line, optionally starting with the
+ * word "restool". The status of every command is reported on stderr.
+ *
+ * The commands between a "begin" line and a "commit" line form a
+ * transaction: the layout changes they make are journaled and, if one
+ * of them fails, undone in reverse order and the rest of the transaction
+ * is skipped. A transaction still open at the end of the file is rolled
+ * back.
+ *
+ * Returns 0 if all the commands succeeded, the error of the first failed
+ * command otherwise.
+ */
+int batch_run(const char *path)
+{
+	char *argv[BATCH_MAX_ARGC + 2];
+	bool debug = restool.debug;
+	bool script = restool.script;
+	bool rescan = restool.rescan;
+	unsigned int num_portals = restool.num_portals;
+	unsigned int line_num = 0;
+	unsigned int num_cmds = 0;
+	unsigned int num_failed = 0;
+	unsigned int num_skipped = 0;
+	unsigned int begin_line = 0;
+	bool in_transaction = false;
+	bool skipping = false;
+	size_t line_size = 0;
+	char *line = NULL;
+	int first_error = 0;
+	int argc;
+	int error;
+	FILE *fp;
+
+	if (strcmp(path, "-") == 0) {
+		fp = stdin;
+	} else {
+		fp = fopen(path, "r");
+		if (!fp) {
+			error = -errno;
+			ERROR_PRINTF("cannot open %s (error %d)\n",
+				     path, error);
+			return error;
+		}
+	}
+
+	restool.batch = true;
+	argv[0] = "restool";
+	while (getline(&line, &line_size, fp) >= 0) {
+		char **words = &argv[1];
+
+		line_num++;
+		argc = batch_split_line(line, words, BATCH_MAX_ARGC);
+		if (argc == 0)
+			continue;
+
+		if (argc > 0 && strcmp(words[0], "restool") == 0) {
+			words++;
+			argc--;
+		}
+
+		if (argc == 1 && strcmp(words[0], "begin") == 0) {
+			if (in_transaction) {
+				fprintf(stderr, "line %u: transaction of line %u not committed\n",
+					line_num, begin_line);
+				num_failed++;
+				if (first_error == 0)
+					first_error = -EINVAL;
+				continue;
+			}
+
+			in_transaction = true;
+			skipping = false;
+			begin_line = line_num;
+			journal_begin(&restool.mc_io, restool.root_dprc_handle);
+			continue;
+		}
+
+		if (argc == 1 && strcmp(words[0], "commit") == 0) {
+			if (!in_transaction) {
+				fprintf(stderr, "line %u: no transaction to commit\n",
+					line_num);
+				num_failed++;
+				if (first_error == 0)
+					first_error = -EINVAL;
+				continue;
+			}
+
+			if (!skipping) {
+				journal_commit();
+				fprintf(stderr, "line %u: transaction of line %u committed\n",
+					line_num, begin_line);
+			}
+			in_transaction = false;
+			skipping = false;
+			continue;
+		}
+
+		if (skipping) {
+			num_skipped++;
+			continue;
+		}
+
+		num_cmds++;
+		if (argc > 0) {
+			words[-1] = "restool";
+			words[argc] = NULL;
+
+			/*
+			 * Global flags given on a line only apply to that line
+			 */
+			restool.debug = debug;
+			restool.script = script;
+			restool.num_portals = num_portals;
+			restool.rescan = false;
+			restool.obj_name = NULL;
+			restool.obj_cmd = NULL;
+
+			error = restool_execute(argc + 1, &words[-1]);
+			fflush(stdout);
+		} else if (argc == 0) {
+			ERROR_PRINTF("missing command\n");
+			error = -EINVAL;
+		} else {
+			error = argc;
+		}
+
+		if (error) {
+			fprintf(stderr, "line %u: error %d\n", line_num, error);
+			num_failed++;
+			if (in_transaction) {
+				(void)batch_rollback(begin_line);
+				skipping = true;
+			}
+			if (first_error == 0)
+				first_error = error;
+		} else {
+			fprintf(stderr, "line %u: ok\n", line_num);
+		}
+	}
+
+	if (ferror(fp)) {
+		error = -errno;
+		ERROR_PRINTF("error reading %s (error %d)\n", path, error);
+		if (first_error == 0)
+			first_error = error;
+	}
+
+	if (in_transaction && !skipping) {
+		fprintf(stderr, "transaction of line %u not committed\n",
+			begin_line);
+		error = batch_rollback(begin_line);
+		if (first_error == 0)
+			first_error = error ? error : -EINVAL;
+	}
+
+	fprintf(stderr, "%u command(s) executed, %u failed",
+		num_cmds, num_failed);
+	if (num_skipped)
+		fprintf(stderr, ", %u skipped", num_skipped);
+	fprintf(stderr, "\n");
+
+	restool.batch = false;
+	restool.debug = debug;
+	restool.script = script;
+	restool.rescan = rescan;
+	restool.num_portals = num_portals;
+	free(line);
+	if (fp != stdin)
+		fclose(fp);
+
+	return first_error;
+}
@@ -0,0 +1,943 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+#include "mc_v10/fsl_dpni.h"
+#include "mc_v10/fsl_dpmac.h"
+#include "mc_v10/fsl_dpsw.h"
+#include "mc_v10/fsl_dpdmux.h"
+
+/*
+ * Maximum number of values read by one MC command of a counter type
+ */
+#define COUNTERS_MAX_GROUP_VALUES	8
+
+/*
+ * Minimum number of MC commands worth the open of an object on one more
+ * portal: with fewer commands per sample, the opens and closes would cost
+ * more than the round trips they save.
+ */
+#define COUNTERS_MIN_UNITS_PER_PORTAL	4
+
+/**
+ * struct counter_type - how the counters of an object type are read
+ * @type: object type
+ * @counters: counters of the type, in display order
+ * @num_counters: number of entries in @counters
+ * @open: opens an object on 'mc_io'
+ * @close: closes an object opened by @open
+ * @read: reads the values of the counters of group 'group' of interface
+ *	'if_id', the value of a counter is stored at its index in 'values'
+ */
+struct counter_type {
+	const char *type;
+	const struct counter_desc *counters;
+	unsigned int num_counters;
+	int (*open)(struct fsl_mc_io *mc_io, uint32_t id, uint16_t *token);
+	int (*close)(struct fsl_mc_io *mc_io, uint16_t token);
+	int (*read)(struct fsl_mc_io *mc_io, uint16_t token, uint16_t if_id,
+		    unsigned int group, uint64_t *values);
+};
+
+/*
+ * Each DPMAC counter is read by its own MC command: the counter id is
+ * the group.
+ */
+static const struct counter_desc dpmac_counters[] = {
+	{ "rx all frames",	DPMAC_CNT_ING_ALL_FRAME,		0 },
+	{ "rx frames ok",	DPMAC_CNT_ING_GOOD_FRAME,		0 },
+	{ "rx frame errors",	DPMAC_CNT_ING_ERR_FRAME,		0 },
+	{ "rx frame discards",	DPMAC_CNT_ING_FRAME_DISCARD,		0 },
+	{ "rx u-cast",		DPMAC_CNT_ING_UCAST_FRAME,		0 },
+	{ "rx b-cast",		DPMAC_CNT_ING_BCAST_FRAME,		0 },
+	{ "rx m-cast",		DPMAC_CNT_ING_MCAST_FRAME,		0 },
+	{ "rx 64 bytes",	DPMAC_CNT_ING_FRAME_64,			0 },
+	{ "rx 65-127 bytes",	DPMAC_CNT_ING_FRAME_127,		0 },
+	{ "rx 128-255 bytes",	DPMAC_CNT_ING_FRAME_255,		0 },
+	{ "rx 256-511 bytes",	DPMAC_CNT_ING_FRAME_511,		0 },
+	{ "rx 512-1023 bytes",	DPMAC_CNT_ING_FRAME_1023,		0 },
+	{ "rx 1024-1518 bytes",	DPMAC_CNT_ING_FRAME_1518,		0 },
+	{ "rx 1519-max bytes",	DPMAC_CNT_ING_FRAME_1519_MAX,		0 },
+	{ "rx frags",		DPMAC_CNT_ING_FRAG,			0 },
+	{ "rx jabber",		DPMAC_CNT_ING_JABBER,			0 },
+	{ "rx align errors",	DPMAC_CNT_ING_ALIGN_ERR,		0 },
+	{ "rx oversized",	DPMAC_CNT_ING_OVERSIZED,		0 },
+	{ "rx pause",		DPMAC_CNT_ING_VALID_PAUSE_FRAME,	0 },
+	{ "rx bytes",		DPMAC_CNT_ING_BYTE,			0 },
+	{ "tx frames ok",	DPMAC_CNT_ENG_GOOD_FRAME,		0 },
+	{ "tx u-cast",		DPMAC_CNT_EGR_UCAST_FRAME,		0 },
+	{ "tx m-cast",		DPMAC_CNT_EGR_MCAST_FRAME,		0 },
+	{ "tx b-cast",		DPMAC_CNT_EGR_BCAST_FRAME,		0 },
+	{ "tx frame errors",	DPMAC_CNT_EGR_ERR_FRAME,		0 },
+	{ "tx undersized",	DPMAC_CNT_EGR_UNDERSIZED,		0 },
+	{ "tx b-pause",		DPMAC_CNT_EGR_VALID_PAUSE_FRAME,	0 },
+	{ "tx bytes",		DPMAC_CNT_EGR_BYTE,			0 },
+};
+
+static int dpmac_counters_open(struct fsl_mc_io *mc_io, uint32_t id,
+			       uint16_t *token)
+{
+	return dpmac_open_v10(mc_io, 0, id, token);
+}
+
+static int dpmac_counters_close(struct fsl_mc_io *mc_io, uint16_t token)
+{
+	return dpmac_close_v10(mc_io, 0, token);
+}
+
+static int dpmac_counters_read(struct fsl_mc_io *mc_io, uint16_t token,
+			       uint16_t if_id, unsigned int group,
+			       uint64_t *values)
+{
+	(void)if_id;
+	return dpmac_get_counter_v10(mc_io, 0, token,
+				     (enum dpmac_counter)group, &values[0]);
+}
+
+/*
+ * A DPNI statistics page is read by one MC command: the page is the
+ * group and the index is the position of the counter in the page.
+ */
+static const struct counter_desc dpni_counters[] = {
+	{ "ingress_all_frames",		0, 0 },
+	{ "ingress_all_bytes",		0, 1 },
+	{ "ingress_multicast_frames",	0, 2 },
+	{ "ingress_multicast_bytes",	0, 3 },
+	{ "ingress_broadcast_frames",	0, 4 },
+	{ "ingress_broadcast_bytes",	0, 5 },
+	{ "egress_all_frames",		1, 0 },
+	{ "egress_all_bytes",		1, 1 },
+	{ "egress_multicast_frames",	1, 2 },
+	{ "egress_multicast_bytes",	1, 3 },
+	{ "egress_broadcast_frames",	1, 4 },
+	{ "egress_broadcast_bytes",	1, 5 },
+	{ "ingress_filtered_frames",	2, 0 },
+	{ "ingress_discarded_frames",	2, 1 },
+	{ "ingress_nobuffer_discards",	2, 2 },
+	{ "egress_discarded_frames",	2, 3 },
+	{ "egress_confirmed_frames",	2, 4 },
+};
+
+C_ASSERT(DPNI_STATISTICS_CNT <= COUNTERS_MAX_GROUP_VALUES);
+
+static int dpni_counters_open(struct fsl_mc_io *mc_io, uint32_t id,
+			      uint16_t *token)
+{
+	return dpni_open_v10(mc_io, 0, id, token);
+}
+
+static int dpni_counters_close(struct fsl_mc_io *mc_io, uint16_t token)
+{
+	return dpni_close_v10(mc_io, 0, token);
+}
+
+static int dpni_counters_read(struct fsl_mc_io *mc_io, uint16_t token,
+			      uint16_t if_id, unsigned int group,
+			      uint64_t *values)
+{
+	union dpni_statistics_v10 stats;
+	int error;
+
+	(void)if_id;
+	error = dpni_get_statistics_v10(mc_io, 0, token, group, 0, &stats);
+	if (error < 0)
+		return error;
+
+	memcpy(values, stats.raw.counter, sizeof(stats.raw.counter));
+	return 0;
+}
+
+/*
+ * DPSW and DPDMUX counters are read one interface at a time, one counter
+ * per MC command like the DPMAC counters
+ */
+static const struct counter_desc dpsw_counters[] = {
+	{ "rx frames",			DPSW_CNT_ING_FRAME,		0 },
+	{ "rx bytes",			DPSW_CNT_ING_BYTE,		0 },
+	{ "rx filtered frames",		DPSW_CNT_ING_FLTR_FRAME,	0 },
+	{ "rx frame discards",		DPSW_CNT_ING_FRAME_DISCARD,	0 },
+	{ "rx m-cast",			DPSW_CNT_ING_MCAST_FRAME,	0 },
+	{ "rx m-cast bytes",		DPSW_CNT_ING_MCAST_BYTE,	0 },
+	{ "rx b-cast",			DPSW_CNT_ING_BCAST_FRAME,	0 },
+	{ "rx b-cast bytes",		DPSW_CNT_ING_BCAST_BYTES,	0 },
+	{ "rx no buffer discards",	DPSW_CNT_ING_NO_BUFF_DISCARD,	0 },
+	{ "tx frames",			DPSW_CNT_EGR_FRAME,		0 },
+	{ "tx bytes",			DPSW_CNT_EGR_BYTE,		0 },
+	{ "tx frame discards",		DPSW_CNT_EGR_FRAME_DISCARD,	0 },
+	{ "tx stp discards",		DPSW_CNT_EGR_STP_FRAME_DISCARD,	0 },
+};
+
+static int dpsw_counters_open(struct fsl_mc_io *mc_io, uint32_t id,
+			      uint16_t *token)
+{
+	return dpsw_open_v10(mc_io, 0, id, token);
+}
+
+static int dpsw_counters_close(struct fsl_mc_io *mc_io, uint16_t token)
+{
+	return dpsw_close_v10(mc_io, 0, token);
+}
+
+static int dpsw_counters_read(struct fsl_mc_io *mc_io, uint16_t token,
+			      uint16_t if_id, unsigned int group,
+			      uint64_t *values)
+{
+	return dpsw_if_get_counter_v10(mc_io, 0, token, if_id,
+				       (enum dpsw_counter)group, &values[0]);
+}
+
+static const struct counter_desc dpdmux_counters[] = {
+	{ "rx frames",			DPDMUX_CNT_ING_FRAME,		0 },
+	{ "rx bytes",			DPDMUX_CNT_ING_BYTE,		0 },
+	{ "rx filtered frames",		DPDMUX_CNT_ING_FLTR_FRAME,	0 },
+	{ "rx frame discards",		DPDMUX_CNT_ING_FRAME_DISCARD,	0 },
+	{ "rx m-cast",			DPDMUX_CNT_ING_MCAST_FRAME,	0 },
+	{ "rx m-cast bytes",		DPDMUX_CNT_ING_MCAST_BYTE,	0 },
+	{ "rx b-cast",			DPDMUX_CNT_ING_BCAST_FRAME,	0 },
+	{ "rx b-cast bytes",		DPDMUX_CNT_ING_BCAST_BYTES,	0 },
+	{ "rx no buffer discards",	DPDMUX_CNT_ING_NO_BUFFER_DISCARD, 0 },
+	{ "tx frames",			DPDMUX_CNT_EGR_FRAME,		0 },
+	{ "tx bytes",			DPDMUX_CNT_EGR_BYTE,		0 },
+	{ "tx frame discards",		DPDMUX_CNT_EGR_FRAME_DISCARD,	0 },
+};
+
+static int dpdmux_counters_open(struct fsl_mc_io *mc_io, uint32_t id,
+				uint16_t *token)
+{
+	return dpdmux_open_v10(mc_io, 0, id, token);
+}
+
+static int dpdmux_counters_close(struct fsl_mc_io *mc_io, uint16_t token)
+{
+	return dpdmux_close_v10(mc_io, 0, token);
+}
+
+static int dpdmux_counters_read(struct fsl_mc_io *mc_io, uint16_t token,
+				uint16_t if_id, unsigned int group,
+				uint64_t *values)
+{
+	return dpdmux_if_get_counter_v10(mc_io, 0, token, if_id,
+					 (enum dpdmux_counter_type)group,
+					 &values[0]);
+}
+
+static const struct counter_type counter_types[] = {
+	{ .type = "dpni",
+	  .counters = dpni_counters,
+	  .num_counters = ARRAY_SIZE(dpni_counters),
+	  .open = dpni_counters_open,
+	  .close = dpni_counters_close,
+	  .read = dpni_counters_read },
+	{ .type = "dpmac",
+	  .counters = dpmac_counters,
+	  .num_counters = ARRAY_SIZE(dpmac_counters),
+	  .open = dpmac_counters_open,
+	  .close = dpmac_counters_close,
+	  .read = dpmac_counters_read },
+	{ .type = "dpsw",
+	  .counters = dpsw_counters,
+	  .num_counters = ARRAY_SIZE(dpsw_counters),
+	  .open = dpsw_counters_open,
+	  .close = dpsw_counters_close,
+	  .read = dpsw_counters_read },
+	{ .type = "dpdmux",
+	  .counters = dpdmux_counters,
+	  .num_counters = ARRAY_SIZE(dpdmux_counters),
+	  .open = dpdmux_counters_open,
+	  .close = dpdmux_counters_close,
+	  .read = dpdmux_counters_read },
+};
+
+/**
+ * struct counter_unit - MC command sent for each sample
+ * @obj: index of the object in the counter set
+ * @handle: index of the handle of the object in the handles of the
+ *	worker sending the command
+ * @group: group of counters read by the command
+ */
+struct counter_unit {
+	unsigned int obj;
+	unsigned int handle;
+	unsigned int group;
+};
+
+/**
+ * struct counter_handle - object held open on the portal of a worker
+ */
+struct counter_handle {
+	unsigned int obj;
+	uint16_t token;
+};
+
+/**
+ * struct counter_worker - thread sending its share of the MC commands of
+ * each sample on its own MC portal, the first worker is the caller of
+ * counters_sample() and uses restool.mc_io, the others are the threads
+ * of the portal pool of the engine
+ * @generation: last sample read by the worker
+ * @units: MC commands sent by the worker for each sample
+ * @handles: objects opened on @io
+ */
+struct counter_worker {
+	struct fsl_mc_io *io;
+	struct counter_engine *engine;
+	unsigned int generation;
+	struct counter_unit *units;
+	unsigned int num_units;
+	struct counter_handle *handles;
+	unsigned int num_handles;
+	int error;
+};
+
+/**
+ * struct counter_engine - state shared by the workers of a counter set
+ * @lock: protects @generation, @num_pending and @stop
+ * @start: signaled when a sample starts or the workers must stop
+ * @done: signaled when a worker is done with a sample
+ * @generation: incremented for each sample
+ * @num_pending: number of threads still reading the current sample
+ * @stop: set when the workers must exit
+ */
+struct counter_engine {
+	struct counter_set *set;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned int generation;
+	unsigned int num_pending;
+	bool stop;
+	struct counter_worker *workers;
+	unsigned int num_workers;
+	struct portal_pool pool;
+	struct counter_unit *units;
+	unsigned int num_units;
+};
+
+static const struct counter_type *find_counter_type(const char *type)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(counter_types); i++) {
+		if (strcmp(counter_types[i].type, type) == 0)
+			return &counter_types[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Compare a counter name with a name given on the command line, where
+ * '-' may stand for the spaces of the counter name
+ */
+static bool counter_name_matches(const char *name, const char *given,
+				 size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len && name[i] != '\0'; i++) {
+		if (name[i] != given[i] &&
+		    !(name[i] == ' ' && given[i] == '-'))
+			return false;
+	}
+
+	return i == len && name[i] == '\0';
+}
+
+/**
+ * Add interface 'if_id' of object 'type'.'id' to 'set', sampling the
+ * counters named in the comma separated list 'names', or all its counters
+ * if 'names' is NULL. Objects can only be added before counters_start().
+ */
+int counters_add_if(struct counter_set *set, const char *type, uint32_t id,
+		    uint16_t if_id, const char *names)
+{
+	const struct counter_type *counter_type;
+	struct counter_obj *obj;
+	const char *name;
+	unsigned int n;
+
+	if (set->engine) {
+		DEBUG_PRINTF("counters_add() called after counters_start()\n");
+		return -EBUSY;
+	}
+
+	counter_type = find_counter_type(type);
+	if (!counter_type) {
+		ERROR_PRINTF("%s objects have no counters\n", type);
+		return -EINVAL;
+	}
+
+	obj = realloc(set->objs, (set->num_objs + 1) * sizeof(*obj));
+	if (!obj)
+		return -ENOMEM;
+
+	set->objs = obj;
+	obj = &set->objs[set->num_objs];
+	memset(obj, 0, sizeof(*obj));
+	obj->type = counter_type->type;
+	obj->id = id;
+	obj->if_id = if_id;
+	obj->counters = calloc(counter_type->num_counters,
+			       sizeof(*obj->counters));
+	obj->values = calloc(counter_type->num_counters,
+			     sizeof(*obj->values));
+	obj->prev_values = calloc(counter_type->num_counters,
+				  sizeof(*obj->prev_values));
+	set->num_objs++;
+	if (!obj->counters || !obj->values || !obj->prev_values)
+		return -ENOMEM;
+
+	if (!names) {
+		for (n = 0; n < counter_type->num_counters; n++)
+			obj->counters[n] = &counter_type->counters[n];
+		obj->num_counters = n;
+		return 0;
+	}
+
+	for (name = names; *name != '\0'; ) {
+		size_t len = strcspn(name, ",");
+
+		for (n = 0; n < counter_type->num_counters; n++) {
+			if (counter_name_matches(counter_type->counters[n].name,
+						 name, len))
+				break;
+		}
+
+		if (n == counter_type->num_counters) {
+			ERROR_PRINTF("Unknown %s counter: %.*s\n",
+				     type, (int)len, name);
+			return -EINVAL;
+		}
+
+		/* a counter given twice is sampled once */
+		for (unsigned int i = 0; i < obj->num_counters; i++) {
+			if (obj->counters[i] == &counter_type->counters[n]) {
+				n = counter_type->num_counters;
+				break;
+			}
+		}
+
+		if (n < counter_type->num_counters)
+			obj->counters[obj->num_counters++] =
+				&counter_type->counters[n];
+
+		name += len;
+		if (*name == ',')
+			name++;
+	}
+
+	if (obj->num_counters == 0) {
+		ERROR_PRINTF("No %s counter selected\n", type);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Add object 'type'.'id' to 'set', for the objects that have a single
+ * interface
+ */
+int counters_add(struct counter_set *set, const char *type, uint32_t id,
+		 const char *names)
+{
+	return counters_add_if(set, type, id, 0, names);
+}
+
+/**
+ * List the MC commands of a sample: one per group of counters of each
+ * object, in object order so that consecutive commands share handles.
+ */
+static int counters_build_units(struct counter_engine *engine)
+{
+	struct counter_set *set = engine->set;
+	unsigned int max_units = 0;
+
+	for (unsigned int i = 0; i < set->num_objs; i++)
+		max_units += set->objs[i].num_counters;
+
+	engine->units = calloc(max_units ? : 1, sizeof(*engine->units));
+	if (!engine->units)
+		return -ENOMEM;
+
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		struct counter_obj *obj = &set->objs[i];
+		unsigned int first = engine->num_units;
+
+		for (unsigned int c = 0; c < obj->num_counters; c++) {
+			unsigned int group = obj->counters[c]->group;
+			unsigned int u;
+
+			for (u = first; u < engine->num_units; u++) {
+				if (engine->units[u].group == group)
+					break;
+			}
+
+			if (u < engine->num_units)
+				continue;
+
+			engine->units[u].obj = i;
+			engine->units[u].group = group;
+			engine->num_units++;
+		}
+	}
+
+	return 0;
+}
+
+static void counters_mc_error(int error)
+{
+	enum mc_cmd_status mc_status = flib_error_to_mc_status(error);
+
+	ERROR_PRINTF("MC error: %s (status %#x)\n",
+		     mc_status_to_string(mc_status), mc_status);
+}
+
+/**
+ * Give worker 'worker' its share of the MC commands of a sample and open
+ * the objects they read on the portal of the worker
+ */
+static int counters_assign(struct counter_engine *engine,
+			   struct counter_worker *worker,
+			   unsigned int first_unit, unsigned int num_units)
+{
+	struct counter_set *set = engine->set;
+
+	worker->units = &engine->units[first_unit];
+	worker->num_units = num_units;
+	worker->handles = calloc(num_units ? : 1, sizeof(*worker->handles));
+	if (!worker->handles)
+		return -ENOMEM;
+
+	for (unsigned int u = 0; u < num_units; u++) {
+		struct counter_unit *unit = &worker->units[u];
+		struct counter_handle *handle;
+		struct counter_obj *obj;
+		int error;
+
+		/* the interfaces of an object share its handle */
+		obj = &set->objs[unit->obj];
+		if (worker->num_handles != 0) {
+			handle = &worker->handles[worker->num_handles - 1];
+			if (set->objs[handle->obj].id == obj->id &&
+			    set->objs[handle->obj].type == obj->type) {
+				unit->handle = worker->num_handles - 1;
+				continue;
+			}
+		}
+
+		handle = &worker->handles[worker->num_handles];
+		handle->obj = unit->obj;
+		error = find_counter_type(obj->type)->open(worker->io, obj->id,
+							   &handle->token);
+		if (error < 0) {
+			counters_mc_error(error);
+			return error;
+		}
+
+		unit->handle = worker->num_handles++;
+	}
+
+	return 0;
+}
+
+/**
+ * Send the MC commands of 'worker' for one sample and store the values
+ * read in the objects of the set
+ */
+static int counters_read(struct counter_worker *worker)
+{
+	struct counter_set *set = worker->engine->set;
+	uint64_t values[COUNTERS_MAX_GROUP_VALUES];
+
+	for (unsigned int u = 0; u < worker->num_units; u++) {
+		const struct counter_unit *unit = &worker->units[u];
+		struct counter_obj *obj = &set->objs[unit->obj];
+		const struct counter_type *counter_type;
+		int error;
+
+		counter_type = find_counter_type(obj->type);
+		error = counter_type->read(worker->io,
+					   worker->handles[unit->handle].token,
+					   obj->if_id, unit->group, values);
+		if (error < 0) {
+			counters_mc_error(error);
+			return error;
+		}
+
+		for (unsigned int c = 0; c < obj->num_counters; c++) {
+			if (obj->counters[c]->group == unit->group)
+				obj->values[c] = values[obj->counters[c]->index];
+		}
+	}
+
+	return 0;
+}
+
+static int counters_worker_run(void *arg, struct fsl_mc_io *mc_io,
+			       unsigned int index)
+{
+	struct counter_engine *engine = arg;
+	struct counter_worker *worker = &engine->workers[index + 1];
+	int error;
+
+	/* counters_start() gave the worker its portal as worker->io */
+	(void)mc_io;
+
+	pthread_mutex_lock(&engine->lock);
+	for ( ; ; ) {
+		while (!engine->stop && worker->generation == engine->generation)
+			pthread_cond_wait(&engine->start, &engine->lock);
+
+		if (engine->stop)
+			break;
+
+		worker->generation = engine->generation;
+		pthread_mutex_unlock(&engine->lock);
+
+		error = counters_read(worker);
+
+		pthread_mutex_lock(&engine->lock);
+		worker->error = error;
+		if (--engine->num_pending == 0)
+			pthread_cond_signal(&engine->done);
+	}
+	pthread_mutex_unlock(&engine->lock);
+
+	return 0;
+}
+
+/**
+ * Open the objects of 'set' and get ready to sample their counters.
+ *
+ * MC commands are synchronous on a portal: to keep several commands in
+ * flight, the commands of a sample are spread over up to
+ * restool.num_portals portals, each served by its own thread. Every
+ * object stays open on the portals reading it until counters_free(), so
+ * that a sample only sends the commands reading the counters.
+ */
+int counters_start(struct counter_set *set)
+{
+	struct counter_engine *engine;
+	unsigned int max_workers;
+	unsigned int first_unit;
+	int error;
+
+	engine = calloc(1, sizeof(*engine));
+	if (!engine)
+		return -ENOMEM;
+
+	pthread_mutex_init(&engine->lock, NULL);
+	pthread_cond_init(&engine->start, NULL);
+	pthread_cond_init(&engine->done, NULL);
+	engine->set = set;
+	set->engine = engine;
+
+	error = counters_build_units(engine);
+	if (error < 0)
+		return error;
+
+	max_workers = engine->num_units / COUNTERS_MIN_UNITS_PER_PORTAL;
+	if (max_workers > restool.num_portals)
+		max_workers = restool.num_portals;
+	if (max_workers == 0)
+		max_workers = 1;
+
+	engine->workers = calloc(max_workers, sizeof(*engine->workers));
+	if (!engine->workers)
+		return -ENOMEM;
+
+	for (unsigned int i = 0; i < max_workers; i++)
+		engine->workers[i].engine = engine;
+
+	/* give more commands to each worker if a portal is missing */
+	error = portal_pool_start(&engine->pool, max_workers - 1,
+				  counters_worker_run, engine);
+	if (error < 0)
+		return error;
+
+	engine->workers[0].io = &restool.mc_io;
+	for (unsigned int i = 0; i < engine->pool.num_threads; i++)
+		engine->workers[i + 1].io = &engine->pool.threads[i].mc_io;
+	engine->num_workers = engine->pool.num_threads + 1;
+
+	first_unit = 0;
+	for (unsigned int i = 0; i < engine->num_workers; i++) {
+		unsigned int num_units;
+
+		num_units = (engine->num_units - first_unit) /
+			    (engine->num_workers - i);
+		error = counters_assign(engine, &engine->workers[i],
+					first_unit, num_units);
+		if (error < 0)
+			return error;
+
+		first_unit += num_units;
+	}
+
+	return 0;
+}
+
+/**
+ * Read the counters of all the objects of 'set'. The values read by the
+ * previous sample are kept in the 'prev_values' of the objects.
+ */
+int counters_sample(struct counter_set *set)
+{
+	struct counter_engine *engine = set->engine;
+	int error;
+
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		struct counter_obj *obj = &set->objs[i];
+		uint64_t *values = obj->prev_values;
+
+		obj->prev_values = obj->values;
+		obj->values = values;
+	}
+	set->prev_when_ns = set->when_ns;
+
+	pthread_mutex_lock(&engine->lock);
+	engine->generation++;
+	engine->num_pending = engine->pool.num_threads;
+	pthread_cond_broadcast(&engine->start);
+	pthread_mutex_unlock(&engine->lock);
+
+	error = counters_read(&engine->workers[0]);
+
+	pthread_mutex_lock(&engine->lock);
+	while (engine->num_pending != 0)
+		pthread_cond_wait(&engine->done, &engine->lock);
+
+	for (unsigned int i = 1; i < engine->num_workers; i++) {
+		if (error == 0)
+			error = engine->workers[i].error;
+	}
+	pthread_mutex_unlock(&engine->lock);
+
+	set->when_ns = now_ns();
+	set->num_samples++;
+	return error;
+}
+
+/**
+ * Read once the counters of the objects of 'set', each one already open
+ * on restool.mc_io with the token at the same index in 'tokens'. Nothing
+ * is opened and no worker is started, for the one-shot displays reading
+ * a few counters of an object the caller holds open.
+ */
+int counters_read_open(struct counter_set *set, const uint16_t *tokens)
+{
+	uint64_t values[COUNTERS_MAX_GROUP_VALUES];
+
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		struct counter_obj *obj = &set->objs[i];
+		const struct counter_type *counter_type;
+
+		counter_type = find_counter_type(obj->type);
+		for (unsigned int c = 0; c < obj->num_counters; c++) {
+			unsigned int group = obj->counters[c]->group;
+			unsigned int prev;
+			int error;
+
+			/* the values of a group are all read at once */
+			for (prev = 0; prev < c; prev++) {
+				if (obj->counters[prev]->group == group)
+					break;
+			}
+			if (prev < c)
+				continue;
+
+			error = counter_type->read(&restool.mc_io, tokens[i],
+						   obj->if_id, group, values);
+			if (error < 0) {
+				counters_mc_error(error);
+				return error;
+			}
+
+			for (unsigned int k = c; k < obj->num_counters; k++) {
+				if (obj->counters[k]->group == group)
+					obj->values[k] =
+						values[obj->counters[k]->index];
+			}
+		}
+	}
+
+	set->num_samples++;
+	return 0;
+}
+
+/**
+ * Rate per second of counter 'counter' of 'obj' between the last two
+ * samples of 'set'. Counters are free running: a wrap is not a negative
+ * rate.
+ */
+double counters_rate(const struct counter_set *set,
+		     const struct counter_obj *obj, unsigned int counter)
+{
+	uint64_t delta = obj->values[counter] - obj->prev_values[counter];
+
+	if (set->num_samples < 2 || set->when_ns == set->prev_when_ns)
+		return 0;
+
+	return delta * 1e9 / (set->when_ns - set->prev_when_ns);
+}
+
+/**
+ * Close the objects, stop the workers and release everything held by
+ * 'set', also after a failed counters_add() or counters_start()
+ */
+void counters_free(struct counter_set *set)
+{
+	struct counter_engine *engine = set->engine;
+
+	if (engine) {
+		pthread_mutex_lock(&engine->lock);
+		engine->stop = true;
+		pthread_cond_broadcast(&engine->start);
+		pthread_mutex_unlock(&engine->lock);
+
+		/* the threads exit without sending more MC commands */
+		for (unsigned int i = 0; i < engine->num_workers; i++) {
+			struct counter_worker *worker = &engine->workers[i];
+
+			for (unsigned int h = 0; h < worker->num_handles; h++) {
+				struct counter_handle *handle =
+					&worker->handles[h];
+				struct counter_obj *obj =
+					&set->objs[handle->obj];
+				int error;
+
+				error = find_counter_type(obj->type)->close(
+						worker->io, handle->token);
+				if (error < 0)
+					counters_mc_error(error);
+			}
+
+			free(worker->handles);
+		}
+		portal_pool_join(&engine->pool);
+
+		free(engine->workers);
+		free(engine->units);
+		pthread_cond_destroy(&engine->done);
+		pthread_cond_destroy(&engine->start);
+		pthread_mutex_destroy(&engine->lock);
+		free(engine);
+	}
+
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		free(set->objs[i].counters);
+		free(set->objs[i].values);
+		free(set->objs[i].prev_values);
+	}
+
+	free(set->objs);
+	memset(set, 0, sizeof(*set));
+}
+
+static volatile sig_atomic_t stop_signaled;
+static struct sigaction stop_old_int;
+static struct sigaction stop_old_term;
+
+static void stop_signal_handler(int sig)
+{
+	(void)sig;
+	stop_signaled = 1;
+}
+
+/**
+ * Turn SIGINT and SIGTERM into a stop request, read by stop_requested(),
+ * until stop_signals_restore(). The calls do not nest.
+ */
+void stop_signals_catch(void)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stop_signal_handler;
+	sigemptyset(&sa.sa_mask);
+	stop_signaled = 0;
+	sigaction(SIGINT, &sa, &stop_old_int);
+	sigaction(SIGTERM, &sa, &stop_old_term);
+}
+
+void stop_signals_restore(void)
+{
+	sigaction(SIGINT, &stop_old_int, NULL);
+	sigaction(SIGTERM, &stop_old_term, NULL);
+}
+
+bool stop_requested(void)
+{
+	return stop_signaled;
+}
+
+/**
+ * Call 'func' at once, then every 'interval_ns', 'count' more times or
+ * until SIGINT or SIGTERM if 'count' is 0. The deadlines are absolute,
+ * so that they do not drift with the time spent in 'func', and a late
+ * call is made at once.
+ */
+int interval_run(uint64_t interval_ns, long count, interval_func_t *func,
+		 void *arg)
+{
+	struct timespec deadline;
+	uint64_t deadline_ns;
+	int error;
+
+	stop_signals_catch();
+	deadline_ns = now_ns();
+	for (long n = 0; ; n++) {
+		error = func(arg, n);
+		if (error != 0 || stop_requested() ||
+		    (count != 0 && n == count))
+			break;
+
+		deadline_ns += interval_ns;
+		deadline.tv_sec = deadline_ns / 1000000000;
+		deadline.tv_nsec = deadline_ns % 1000000000;
+		while (!stop_requested() &&
+		       clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+				       &deadline, NULL) == EINTR)
+			;
+		if (stop_requested())
+			break;
+	}
+	stop_signals_restore();
+
+	return error < 0 ? error : 0;
+}
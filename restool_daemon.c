@@ -0,0 +1,680 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "restool.h"
+#include "utils.h"
+
+#define DAEMON_REQUEST_MAGIC	0x52535444	/* "RSTD" */
+
+/**
+ * Maximum number of arguments and total argument size of a request
+ */
+#define DAEMON_MAX_ARGC		256
+#define DAEMON_MAX_ARGS_LEN	(64 * 1024)
+
+/**
+ * Number of file descriptors passed along with a request: the client's
+ * stdin, stdout and stderr, then its current directory
+ */
+#define DAEMON_NUM_STDIO_FDS	3
+#define DAEMON_FD_CWD		3
+#define DAEMON_NUM_FDS		4
+
+/**
+ * Time a client is given to send its request and to take the reply, the
+ * daemon serves no other client meanwhile
+ */
+#define DAEMON_TIMEOUT_S	5
+
+/**
+ * struct daemon_request - header of a command sent to the daemon
+ * @magic: DAEMON_REQUEST_MAGIC
+ * @argc: number of arguments following the root container name
+ * @len: total length of the root container name given with --root
+ *	(empty for the default one) and of the arguments, each one NUL
+ *	terminated
+ */
+struct daemon_request {
+	uint32_t magic;
+	uint32_t argc;
+	uint32_t len;
+};
+
+/**
+ * struct daemon_reply - result of a command sent to the daemon
+ * @result: value returned by the command
+ * @declined: non zero if the daemon did not run the command, which the
+ *	client then runs on an MC portal of its own
+ */
+struct daemon_reply {
+	int32_t result;
+	uint32_t declined;
+};
+
+static volatile sig_atomic_t daemon_stop;
+
+/**
+ * Connection of the client whose command is running, -1 if none
+ */
+static int daemon_client_fd = -1;
+
+/**
+ * Set once the client of the running command asked to stop it
+ */
+static bool daemon_client_stop;
+
+/**
+ * Set by daemon_decline_command() while the daemon runs a command
+ */
+static bool daemon_declined;
+
+/**
+ * Connection to the daemon while the client waits for its result
+ */
+static volatile int daemon_forward_fd = -1;
+
+static void daemon_signal_handler(int sig)
+{
+	(void)sig;
+	daemon_stop = 1;
+}
+
+/*
+ * Forward SIGINT and SIGTERM received by the client to the daemon
+ */
+static void daemon_forward_signal(int sig)
+{
+	uint8_t byte = sig;
+
+	if (daemon_forward_fd >= 0)
+		(void)send(daemon_forward_fd, &byte, sizeof(byte),
+			   MSG_NOSIGNAL);
+}
+
+static int daemon_socket_address(struct sockaddr_un *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(RESTOOL_DAEMON_SOCKET) >= sizeof(addr->sun_path))
+		return -ENAMETOOLONG;
+
+	strcpy(addr->sun_path, RESTOOL_DAEMON_SOCKET);
+	return 0;
+}
+
+static int read_full(int fd, void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = read(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -errno;
+		if (n == 0)
+			return -EPIPE;
+
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -errno;
+
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/**
+ * Forward the command line to a running restool daemon, passing it our
+ * stdin, stdout, stderr and current directory so that the command output
+ * goes straight to the caller and relative paths are ours. SIGINT and
+ * SIGTERM are forwarded to the daemon while it runs the command.
+ *
+ * Returns 0 if the daemon ran the command (its result is stored in
+ * 'status'), negative if no daemon could be reached or if it declined
+ * the command: a daemon serves a single root container and does not run
+ * the commands which only stop when interrupted.
+ */
+int daemon_client_run(int argc, char *argv[], int *status)
+{
+	char cmsg_buf[CMSG_SPACE(DAEMON_NUM_FDS * sizeof(int))];
+	const char *root = restool.specified_dev_file;
+	struct sigaction old_int;
+	struct sigaction old_term;
+	struct sigaction sa;
+	struct daemon_request req;
+	struct daemon_reply reply;
+	struct sockaddr_un addr;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	int cwd_fd = -1;
+	char *args;
+	size_t len;
+	int error;
+	int fd;
+
+	if (access(RESTOOL_DAEMON_SOCKET, F_OK) != 0)
+		return -ENOENT;
+
+	error = daemon_socket_address(&addr);
+	if (error)
+		return error;
+
+	len = strlen(root) + 1;
+	for (int i = 0; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+
+	if (argc > DAEMON_MAX_ARGC || len > DAEMON_MAX_ARGS_LEN)
+		return -E2BIG;
+
+	cwd_fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (cwd_fd < 0)
+		return -errno;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		error = -errno;
+		close(cwd_fd);
+		return error;
+	}
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		error = -errno;
+		DEBUG_PRINTF("cannot connect to %s (error %d)\n",
+			     RESTOOL_DAEMON_SOCKET, error);
+		goto out;
+	}
+
+	args = malloc(len);
+	if (!args) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	strcpy(args, root);
+	len = strlen(root) + 1;
+	for (int i = 0; i < argc; i++) {
+		strcpy(args + len, argv[i]);
+		len += strlen(argv[i]) + 1;
+	}
+
+	req.magic = DAEMON_REQUEST_MAGIC;
+	req.argc = argc;
+	req.len = len;
+
+	iov.iov_base = &req;
+	iov.iov_len = sizeof(req);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsg_buf;
+	msg.msg_controllen = sizeof(cmsg_buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(DAEMON_NUM_FDS * sizeof(int));
+	for (int i = 0; i < DAEMON_NUM_STDIO_FDS; i++)
+		((int *)CMSG_DATA(cmsg))[i] = i;
+	((int *)CMSG_DATA(cmsg))[DAEMON_FD_CWD] = cwd_fd;
+
+	if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(req)) {
+		error = -errno;
+		free(args);
+		goto out;
+	}
+
+	error = write_full(fd, args, len);
+	free(args);
+	if (error)
+		goto out;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = daemon_forward_signal;
+	sigemptyset(&sa.sa_mask);
+	daemon_forward_fd = fd;
+	sigaction(SIGINT, &sa, &old_int);
+	sigaction(SIGTERM, &sa, &old_term);
+
+	/*
+	 * The command has been handed over, so from now on a failure must
+	 * not make the caller run it a second time locally.
+	 */
+	error = read_full(fd, &reply, sizeof(reply));
+
+	sigaction(SIGINT, &old_int, NULL);
+	sigaction(SIGTERM, &old_term, NULL);
+	daemon_forward_fd = -1;
+	if (error) {
+		ERROR_PRINTF("restool daemon did not complete the command (error %d)\n",
+			     error);
+		*status = error;
+		error = 0;
+		goto out;
+	}
+
+	if (reply.declined) {
+		DEBUG_PRINTF("the restool daemon declined the command\n");
+		error = -EAGAIN;
+		goto out;
+	}
+
+	*status = reply.result;
+	error = 0;
+out:
+	close(fd);
+	close(cwd_fd);
+	return error;
+}
+
+static int daemon_receive_request(int fd, const char **root_out,
+				  int *argc_out, char ***argv_out,
+				  char **args_out, int fds[DAEMON_NUM_FDS])
+{
+	char cmsg_buf[CMSG_SPACE(DAEMON_NUM_FDS * sizeof(int))];
+	struct timeval timeout = { .tv_sec = DAEMON_TIMEOUT_S };
+	struct daemon_request req;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	char **argv = NULL;
+	char *args = NULL;
+	ssize_t n;
+	size_t pos;
+	int error;
+
+	for (int i = 0; i < DAEMON_NUM_FDS; i++)
+		fds[i] = -1;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	iov.iov_base = &req;
+	iov.iov_len = sizeof(req);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsg_buf;
+	msg.msg_controllen = sizeof(cmsg_buf);
+
+	n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+	if (n < 0)
+		return -errno;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		size_t num_fds;
+
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		if (num_fds == DAEMON_NUM_FDS && fds[0] < 0) {
+			memcpy(fds, CMSG_DATA(cmsg),
+			       DAEMON_NUM_FDS * sizeof(int));
+			continue;
+		}
+
+		/* the descriptors not kept would leak in the daemon */
+		for (size_t i = 0; i < num_fds; i++) {
+			int unused_fd;
+
+			memcpy(&unused_fd, CMSG_DATA(cmsg) + i * sizeof(int),
+			       sizeof(int));
+			close(unused_fd);
+		}
+	}
+
+	if (n != sizeof(req) || (msg.msg_flags & MSG_CTRUNC) ||
+	    req.magic != DAEMON_REQUEST_MAGIC ||
+	    req.argc == 0 || req.argc > DAEMON_MAX_ARGC ||
+	    req.len == 0 || req.len > DAEMON_MAX_ARGS_LEN || fds[0] < 0) {
+		ERROR_PRINTF("malformed restool daemon request\n");
+		error = -EINVAL;
+		goto error;
+	}
+
+	args = malloc(req.len);
+	argv = calloc(req.argc + 1, sizeof(*argv));
+	if (!args || !argv) {
+		error = -ENOMEM;
+		goto error;
+	}
+
+	error = read_full(fd, args, req.len);
+	if (error)
+		goto error;
+
+	if (args[req.len - 1] != '\0') {
+		error = -EINVAL;
+		goto error;
+	}
+
+	pos = strlen(args) + 1;
+	for (uint32_t i = 0; i < req.argc; i++) {
+		if (pos >= req.len) {
+			error = -EINVAL;
+			goto error;
+		}
+		argv[i] = args + pos;
+		pos += strlen(args + pos) + 1;
+	}
+
+	*root_out = args;
+	*argc_out = req.argc;
+	*argv_out = argv;
+	*args_out = args;
+	return 0;
+
+error:
+	free(argv);
+	free(args);
+	for (int i = 0; i < DAEMON_NUM_FDS; i++) {
+		if (fds[i] >= 0)
+			close(fds[i]);
+		fds[i] = -1;
+	}
+	return error;
+}
+
+/**
+ * Let the commands which only stop when interrupted decline to run in
+ * the daemon, before they print anything, so that the client runs them
+ * on an MC portal of its own instead of holding the daemon.
+ *
+ * Returns 0 if the command may go on, negative if it must return.
+ */
+int daemon_decline_command(void)
+{
+	if (!restool.daemon)
+		return 0;
+
+	if (restool.batch) {
+		ERROR_PRINTF("this command cannot be run by the restool daemon in a batch file\n");
+		return -EINVAL;
+	}
+
+	daemon_declined = true;
+	return -EAGAIN;
+}
+
+/**
+ * Tell whether the client of the running command was interrupted by
+ * SIGINT or SIGTERM, or went away
+ */
+bool daemon_interrupted(void)
+{
+	uint8_t sig;
+	ssize_t n;
+
+	if (daemon_client_fd < 0 || daemon_client_stop)
+		return daemon_client_stop;
+
+	n = recv(daemon_client_fd, &sig, sizeof(sig), MSG_DONTWAIT);
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+		DEBUG_PRINTF("restool daemon client went away\n");
+		daemon_client_stop = true;
+	} else if (n > 0) {
+		DEBUG_PRINTF("restool daemon client got signal %u\n", sig);
+		daemon_client_stop = true;
+	}
+
+	return daemon_client_stop;
+}
+
+static void daemon_handle_client(int fd, const int saved_fds[DAEMON_NUM_FDS],
+				 const char *daemon_root, bool debug,
+				 unsigned int num_portals)
+{
+	struct daemon_reply reply = { 0 };
+	int fds[DAEMON_NUM_FDS];
+	const char *root;
+	char **argv;
+	char *args;
+	int argc;
+	int error;
+
+	error = daemon_receive_request(fd, &root, &argc, &argv, &args, fds);
+	if (error) {
+		reply.result = error;
+		(void)write_full(fd, &reply, sizeof(reply));
+		return;
+	}
+
+	/*
+	 * Clients asking for another root container than the one the
+	 * daemon has open run their command themselves
+	 */
+	if (strcmp(root, daemon_root) != 0) {
+		DEBUG_PRINTF("declined a command for root '%s'\n", root);
+		reply.declined = 1;
+		goto out;
+	}
+
+	if (fchdir(fds[DAEMON_FD_CWD]) < 0) {
+		reply.result = -errno;
+		ERROR_PRINTF("cannot change to the client directory (error %d)\n",
+			     reply.result);
+		goto out;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	for (int i = 0; i < DAEMON_NUM_STDIO_FDS; i++)
+		(void)dup2(fds[i], i);
+
+	/*
+	 * Per-command flags must not leak from one request to the next
+	 */
+	restool.debug = debug;
+	restool.num_portals = num_portals;
+	restool.script = false;
+	restool.rescan = false;
+	restool.obj_name = NULL;
+	restool.obj_cmd = NULL;
+	daemon_client_fd = fd;
+	daemon_client_stop = false;
+	daemon_declined = false;
+
+	/*
+	 * The container tree may have been changed by other processes
+	 * since the previous request
+	 */
+	topology_invalidate();
+
+	reply.result = restool_execute(argc, argv);
+	reply.declined = daemon_declined;
+	daemon_client_fd = -1;
+
+	if (restool.record)
+		mc_trace_flush();
+
+	fflush(stdout);
+	fflush(stderr);
+	for (int i = 0; i < DAEMON_NUM_STDIO_FDS; i++)
+		(void)dup2(saved_fds[i], i);
+	(void)fchdir(saved_fds[DAEMON_FD_CWD]);
+
+	DEBUG_PRINTF("'%s %s' returned %d%s\n", argv[1],
+		     argc > 2 ? argv[2] : "", reply.result,
+		     reply.declined ? " (declined)" : "");
+out:
+	for (int i = 0; i < DAEMON_NUM_FDS; i++)
+		close(fds[i]);
+	free(argv);
+	free(args);
+
+	(void)write_full(fd, &reply, sizeof(reply));
+}
+
+/**
+ * Serve restool commands received on RESTOOL_DAEMON_SOCKET until SIGINT
+ * or SIGTERM is received. Commands run one at a time on the MC portal
+ * and root container opened by main(), in the client's directory.
+ */
+int daemon_serve(void)
+{
+	int saved_fds[DAEMON_NUM_FDS] = { -1, -1, -1, -1 };
+	char daemon_root[USR_DEV_FILE_SIZE];
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	unsigned int num_portals = restool.num_portals;
+	bool debug = restool.debug;
+	mode_t old_umask;
+	int listen_fd;
+	int error;
+
+	error = daemon_socket_address(&addr);
+	if (error)
+		return error;
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		error = -errno;
+		ERROR_PRINTF("socket() failed (error %d)\n", error);
+		return error;
+	}
+
+	if (connect(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+		ERROR_PRINTF("a restool daemon is already serving %s\n",
+			     RESTOOL_DAEMON_SOCKET);
+		close(listen_fd);
+		return -EBUSY;
+	}
+
+	close(listen_fd);
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0)
+		return -errno;
+
+	(void)unlink(RESTOOL_DAEMON_SOCKET);
+	old_umask = umask(0077);
+	error = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_umask);
+	if (error < 0) {
+		error = -errno;
+		ERROR_PRINTF("cannot bind %s (error %d)\n",
+			     RESTOOL_DAEMON_SOCKET, error);
+		close(listen_fd);
+		return error;
+	}
+
+	if (listen(listen_fd, 16) < 0) {
+		error = -errno;
+		ERROR_PRINTF("listen() failed (error %d)\n", error);
+		goto out;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = daemon_signal_handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	for (int i = 0; i < DAEMON_NUM_STDIO_FDS; i++) {
+		saved_fds[i] = fcntl(i, F_DUPFD_CLOEXEC, 0);
+		if (saved_fds[i] < 0) {
+			error = -errno;
+			goto out;
+		}
+	}
+
+	saved_fds[DAEMON_FD_CWD] = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (saved_fds[DAEMON_FD_CWD] < 0) {
+		error = -errno;
+		goto out;
+	}
+
+	/*
+	 * The clients' own --root must name the same root container
+	 */
+	strcpy(daemon_root, restool.specified_dev_file);
+
+	DEBUG_PRINTF("serving restool commands on %s\n",
+		     RESTOOL_DAEMON_SOCKET);
+	while (!daemon_stop) {
+		int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			error = -errno;
+			ERROR_PRINTF("accept() failed (error %d)\n", error);
+			goto out;
+		}
+
+		daemon_handle_client(fd, saved_fds, daemon_root, debug,
+				     num_portals);
+		close(fd);
+	}
+
+	error = 0;
+out:
+	for (int i = 0; i < DAEMON_NUM_FDS; i++) {
+		if (saved_fds[i] >= 0)
+			close(saved_fds[i]);
+	}
+	close(listen_fd);
+	(void)unlink(RESTOOL_DAEMON_SOCKET);
+	return error;
+}
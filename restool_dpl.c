@@ -0,0 +1,979 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include "restool.h"
+#include "utils.h"
+
+/*
+ * Flattened device tree format, as written by dtc -O dtb
+ */
+#define FDT_MAGIC		0xd00dfeed
+#define FDT_BEGIN_NODE		0x1
+#define FDT_END_NODE		0x2
+#define FDT_PROP		0x3
+#define FDT_NOP			0x4
+#define FDT_END			0x9
+#define FDT_HEADER_SIZE		40
+#define FDT_MIN_VERSION		16
+#define FDT_ALIGN(_len)		(((_len) + 3) & ~3u)
+
+/**
+ * struct dts_parser - state of the DTS text parser
+ * @path: file being parsed, for error messages
+ * @text: NUL terminated file contents
+ * @pos: next character to parse
+ * @line: line of @pos, for error messages
+ */
+struct dts_parser {
+	const char *path;
+	const char *text;
+	const char *pos;
+	unsigned int line;
+};
+
+static struct dpl_node *dpl_new_node(struct dpl_node *parent,
+				     const char *name, size_t name_len)
+{
+	struct dpl_node *node;
+	struct dpl_node **link;
+
+	node = calloc(1, sizeof(*node));
+	if (!node)
+		return NULL;
+
+	node->name = strndup(name, name_len);
+	if (!node->name) {
+		free(node);
+		return NULL;
+	}
+
+	node->parent = parent;
+	if (parent) {
+		for (link = &parent->children; *link; link = &(*link)->next)
+			;
+		*link = node;
+	}
+
+	return node;
+}
+
+/*
+ * Set property 'name' of 'node', replacing its previous value if the
+ * property already exists. 'data' is owned by the node on success.
+ */
+static int dpl_set_prop(struct dpl_node *node, const char *name,
+			size_t name_len, uint8_t *data, unsigned int len)
+{
+	struct dpl_prop *prop;
+	struct dpl_prop **link;
+
+	for (link = &node->props; *link; link = &(*link)->next) {
+		prop = *link;
+		if (strlen(prop->name) == name_len &&
+		    strncmp(prop->name, name, name_len) == 0) {
+			free(prop->data);
+			prop->data = data;
+			prop->len = len;
+			return 0;
+		}
+	}
+
+	prop = calloc(1, sizeof(*prop));
+	if (!prop)
+		return -ENOMEM;
+
+	prop->name = strndup(name, name_len);
+	if (!prop->name) {
+		free(prop);
+		return -ENOMEM;
+	}
+
+	prop->data = data;
+	prop->len = len;
+	*link = prop;
+
+	return 0;
+}
+
+void dpl_free(struct dpl_node *node)
+{
+	struct dpl_node *child;
+	struct dpl_prop *prop;
+
+	if (!node)
+		return;
+
+	while (node->props) {
+		prop = node->props;
+		node->props = prop->next;
+		free(prop->name);
+		free(prop->data);
+		free(prop);
+	}
+
+	while (node->children) {
+		child = node->children;
+		node->children = child->next;
+		dpl_free(child);
+	}
+
+	free(node->name);
+	free(node);
+}
+
+static struct dpl_node *dpl_get_child(const struct dpl_node *node,
+				      const char *name, size_t name_len)
+{
+	struct dpl_node *child;
+
+	for (child = node->children; child; child = child->next) {
+		if (strlen(child->name) == name_len &&
+		    strncmp(child->name, name, name_len) == 0)
+			return child;
+	}
+
+	return NULL;
+}
+
+/**
+ * Look up the node found at 'path' below 'node', path components being
+ * separated by '/'. A leading '/' is ignored.
+ */
+struct dpl_node *dpl_get_node(const struct dpl_node *node, const char *path)
+{
+	const char *end;
+
+	while (node && *path != '\0') {
+		if (*path == '/') {
+			path++;
+			continue;
+		}
+
+		end = strchrnul(path, '/');
+		node = dpl_get_child(node, path, end - path);
+		path = end;
+	}
+
+	return (struct dpl_node *)node;
+}
+
+struct dpl_prop *dpl_get_prop(const struct dpl_node *node, const char *name)
+{
+	struct dpl_prop *prop;
+
+	for (prop = node->props; prop; prop = prop->next) {
+		if (strcmp(prop->name, name) == 0)
+			return prop;
+	}
+
+	return NULL;
+}
+
+/**
+ * Tell whether the value of 'prop' is a list of printable strings, the
+ * same way fdtget guesses the type of a property
+ */
+bool dpl_prop_is_string(const struct dpl_prop *prop)
+{
+	unsigned int i;
+
+	if (prop->len == 0 || prop->data[prop->len - 1] != '\0' ||
+	    prop->data[0] == '\0')
+		return false;
+
+	for (i = 0; i < prop->len; i++) {
+		if (prop->data[i] == '\0') {
+			if (i > 0 && prop->data[i - 1] == '\0')
+				return false;
+			continue;
+		}
+
+		if (!isprint(prop->data[i]))
+			return false;
+	}
+
+	return true;
+}
+
+unsigned int dpl_prop_num_cells(const struct dpl_prop *prop)
+{
+	return prop->len / sizeof(uint32_t);
+}
+
+uint32_t dpl_prop_cell(const struct dpl_prop *prop, unsigned int index)
+{
+	uint32_t cell;
+
+	assert(index < dpl_prop_num_cells(prop));
+	memcpy(&cell, &prop->data[index * sizeof(uint32_t)], sizeof(cell));
+
+	return ntohl(cell);
+}
+
+/*
+ * DTS text parser
+ */
+
+static void dts_skip_blanks(struct dts_parser *parser)
+{
+	const char *end;
+
+	for (;;) {
+		if (*parser->pos == '\n') {
+			parser->line++;
+			parser->pos++;
+		} else if (isspace(*parser->pos)) {
+			parser->pos++;
+		} else if (strncmp(parser->pos, "//", 2) == 0) {
+			parser->pos = strchrnul(parser->pos, '\n');
+		} else if (strncmp(parser->pos, "/*", 2) == 0) {
+			end = strstr(parser->pos + 2, "*/");
+			if (!end)
+				end = parser->pos + strlen(parser->pos) - 2;
+			for (; parser->pos < end; parser->pos++) {
+				if (*parser->pos == '\n')
+					parser->line++;
+			}
+			parser->pos = end + 2;
+		} else {
+			break;
+		}
+	}
+}
+
+static int dts_error(struct dts_parser *parser, const char *what)
+{
+	ERROR_PRINTF("%s:%u: %s\n", parser->path, parser->line, what);
+	return -EINVAL;
+}
+
+static bool dts_is_name_char(char c)
+{
+	return isalnum(c) || strchr(",._+*#?@-", c) != NULL;
+}
+
+static size_t dts_name_len(struct dts_parser *parser)
+{
+	const char *end = parser->pos;
+
+	while (*end != '\0' && dts_is_name_char(*end))
+		end++;
+
+	return end - parser->pos;
+}
+
+static int dts_expect(struct dts_parser *parser, char c)
+{
+	char what[32];
+
+	dts_skip_blanks(parser);
+	if (*parser->pos != c) {
+		snprintf(what, sizeof(what), "'%c' expected", c);
+		return dts_error(parser, what);
+	}
+
+	parser->pos++;
+
+	return 0;
+}
+
+static int dts_append(uint8_t **data, unsigned int *len,
+		      const void *bytes, unsigned int num_bytes)
+{
+	uint8_t *new_data;
+
+	new_data = realloc(*data, *len + num_bytes);
+	if (!new_data)
+		return -ENOMEM;
+
+	memcpy(new_data + *len, bytes, num_bytes);
+	*data = new_data;
+	*len += num_bytes;
+
+	return 0;
+}
+
+static int dts_parse_string(struct dts_parser *parser,
+			    uint8_t **data, unsigned int *len)
+{
+	char c;
+	int error;
+
+	parser->pos++;
+	while (*parser->pos != '"') {
+		c = *parser->pos++;
+		if (c == '\0' || c == '\n')
+			return dts_error(parser, "unterminated string");
+
+		if (c == '\\') {
+			c = *parser->pos++;
+			if (c == 'n')
+				c = '\n';
+			else if (c == 't')
+				c = '\t';
+			else if (c == '\0')
+				return dts_error(parser, "unterminated string");
+		}
+
+		error = dts_append(data, len, &c, 1);
+		if (error)
+			return error;
+	}
+
+	parser->pos++;
+	c = '\0';
+
+	return dts_append(data, len, &c, 1);
+}
+
+static int dts_parse_cells(struct dts_parser *parser,
+			   uint8_t **data, unsigned int *len)
+{
+	unsigned long long val;
+	uint32_t cell;
+	char *end;
+	int error;
+
+	parser->pos++;
+	for (;;) {
+		dts_skip_blanks(parser);
+		if (*parser->pos == '>')
+			break;
+
+		errno = 0;
+		val = strtoull(parser->pos, &end, 0);
+		if (end == parser->pos || errno != 0 || val > UINT32_MAX ||
+		    dts_is_name_char(*end))
+			return dts_error(parser, "invalid cell value");
+
+		parser->pos = end;
+		cell = htonl((uint32_t)val);
+		error = dts_append(data, len, &cell, sizeof(cell));
+		if (error)
+			return error;
+	}
+
+	parser->pos++;
+
+	return 0;
+}
+
+static int dts_parse_bytes(struct dts_parser *parser,
+			   uint8_t **data, unsigned int *len)
+{
+	char digits[3] = { 0 };
+	uint8_t byte;
+	int error;
+
+	parser->pos++;
+	for (;;) {
+		dts_skip_blanks(parser);
+		if (*parser->pos == ']')
+			break;
+
+		if (!isxdigit(parser->pos[0]) || !isxdigit(parser->pos[1]))
+			return dts_error(parser, "invalid byte value");
+
+		memcpy(digits, parser->pos, 2);
+		byte = strtoul(digits, NULL, 16);
+		parser->pos += 2;
+		error = dts_append(data, len, &byte, 1);
+		if (error)
+			return error;
+	}
+
+	parser->pos++;
+
+	return 0;
+}
+
+/*
+ * Parse the value of a property, after the '=' sign and up to the ';'
+ */
+static int dts_parse_value(struct dts_parser *parser,
+			   uint8_t **data, unsigned int *len)
+{
+	int error;
+
+	for (;;) {
+		dts_skip_blanks(parser);
+		if (*parser->pos == '"')
+			error = dts_parse_string(parser, data, len);
+		else if (*parser->pos == '<')
+			error = dts_parse_cells(parser, data, len);
+		else if (*parser->pos == '[')
+			error = dts_parse_bytes(parser, data, len);
+		else
+			error = dts_error(parser, "invalid property value");
+		if (error)
+			return error;
+
+		dts_skip_blanks(parser);
+		if (*parser->pos != ',')
+			break;
+		parser->pos++;
+	}
+
+	return dts_expect(parser, ';');
+}
+
+/*
+ * Parse the contents of 'node', after its opening brace and up to the
+ * matching "};". Nodes defined twice are merged, as dtc does.
+ */
+static int dts_parse_node(struct dts_parser *parser, struct dpl_node *node)
+{
+	struct dpl_node *child;
+	const char *name;
+	size_t name_len;
+	uint8_t *data;
+	unsigned int len;
+	int error;
+
+	for (;;) {
+		dts_skip_blanks(parser);
+		if (*parser->pos == '}')
+			break;
+
+		name = parser->pos;
+		name_len = dts_name_len(parser);
+		if (name_len == 0)
+			return dts_error(parser, "node or property name expected");
+		parser->pos += name_len;
+
+		/* skip a label */
+		if (*parser->pos == ':') {
+			parser->pos++;
+			continue;
+		}
+
+		dts_skip_blanks(parser);
+		if (*parser->pos == '{') {
+			parser->pos++;
+			child = dpl_get_child(node, name, name_len);
+			if (!child) {
+				child = dpl_new_node(node, name, name_len);
+				if (!child)
+					return -ENOMEM;
+			}
+
+			error = dts_parse_node(parser, child);
+			if (error)
+				return error;
+			continue;
+		}
+
+		data = NULL;
+		len = 0;
+		if (*parser->pos == '=') {
+			parser->pos++;
+			error = dts_parse_value(parser, &data, &len);
+		} else {
+			error = dts_expect(parser, ';');
+		}
+
+		if (error == 0)
+			error = dpl_set_prop(node, name, name_len, data, len);
+		if (error) {
+			free(data);
+			return error;
+		}
+	}
+
+	parser->pos++;
+
+	return dts_expect(parser, ';');
+}
+
+static int dts_parse(const char *path, const char *text,
+		     struct dpl_node *root)
+{
+	struct dts_parser parser = {
+		.path = path,
+		.text = text,
+		.pos = text,
+		.line = 1,
+	};
+	int error;
+
+	for (;;) {
+		dts_skip_blanks(&parser);
+		if (*parser.pos == '\0')
+			break;
+
+		if (strncmp(parser.pos, "/dts-v1/", 8) == 0) {
+			parser.pos += 8;
+			error = dts_expect(&parser, ';');
+		} else if (strncmp(parser.pos, "/memreserve/", 12) == 0) {
+			parser.pos = strchrnul(parser.pos, ';');
+			error = dts_expect(&parser, ';');
+		} else if (*parser.pos == '/') {
+			parser.pos++;
+			error = dts_expect(&parser, '{');
+			if (error == 0)
+				error = dts_parse_node(&parser, root);
+		} else {
+			error = dts_error(&parser, "root node expected");
+		}
+
+		if (error)
+			return error;
+	}
+
+	return 0;
+}
+
+/*
+ * DTB parser
+ */
+
+static uint32_t fdt_word(const uint8_t *fdt, uint32_t offset)
+{
+	uint32_t word;
+
+	memcpy(&word, fdt + offset, sizeof(word));
+
+	return ntohl(word);
+}
+
+static int dtb_parse(const char *path, const uint8_t *fdt, size_t size,
+		     struct dpl_node *root)
+{
+	uint32_t off_struct, size_struct, off_strings, size_strings;
+	struct dpl_node *node = NULL;
+	uint32_t offset, end, token;
+	uint32_t len, name_off;
+	const char *name;
+	uint8_t *data;
+	int error;
+
+	if (size < FDT_HEADER_SIZE || fdt_word(fdt, 4) > size ||
+	    fdt_word(fdt, 20) < FDT_MIN_VERSION)
+		goto invalid;
+
+	size = fdt_word(fdt, 4);
+	off_struct = fdt_word(fdt, 8);
+	off_strings = fdt_word(fdt, 12);
+	size_strings = fdt_word(fdt, 32);
+	size_struct = fdt_word(fdt, 36);
+	if (off_struct > size || size_struct > size - off_struct ||
+	    off_strings > size || size_strings > size - off_strings)
+		goto invalid;
+
+	offset = off_struct;
+	end = off_struct + size_struct;
+	while (offset + sizeof(uint32_t) <= end) {
+		token = fdt_word(fdt, offset);
+		offset += sizeof(uint32_t);
+
+		switch (token) {
+		case FDT_BEGIN_NODE:
+			name = (const char *)fdt + offset;
+			len = strnlen(name, end - offset);
+			if (offset + len >= end)
+				goto invalid;
+
+			if (!node) {
+				node = root;
+			} else {
+				node = dpl_new_node(node, name, len);
+				if (!node)
+					return -ENOMEM;
+			}
+			offset += FDT_ALIGN(len + 1);
+			break;
+		case FDT_END_NODE:
+			if (!node)
+				goto invalid;
+			node = node->parent;
+			if (!node)
+				return 0;
+			break;
+		case FDT_PROP:
+			if (!node || offset + 2 * sizeof(uint32_t) > end)
+				goto invalid;
+
+			len = fdt_word(fdt, offset);
+			name_off = fdt_word(fdt, offset + sizeof(uint32_t));
+			offset += 2 * sizeof(uint32_t);
+			if (len > end - offset || name_off >= size_strings)
+				goto invalid;
+
+			name = (const char *)fdt + off_strings + name_off;
+			if (strnlen(name, size_strings - name_off) ==
+			    size_strings - name_off)
+				goto invalid;
+
+			data = NULL;
+			if (len != 0) {
+				data = malloc(len);
+				if (!data)
+					return -ENOMEM;
+				memcpy(data, fdt + offset, len);
+			}
+
+			error = dpl_set_prop(node, name, strlen(name),
+					     data, len);
+			if (error) {
+				free(data);
+				return error;
+			}
+			offset += FDT_ALIGN(len);
+			break;
+		case FDT_NOP:
+			break;
+		case FDT_END:
+		default:
+			goto invalid;
+		}
+	}
+
+invalid:
+	ERROR_PRINTF("%s: invalid or truncated DTB file\n", path);
+	return -EINVAL;
+}
+
+/**
+ * Parse the DPL held in 'buf', 'size' bytes followed by a NUL character.
+ * 'name' is only used in error messages.
+ */
+int dpl_parse(const char *name, const uint8_t *buf, size_t size,
+	      struct dpl_node **root)
+{
+	struct dpl_node *node;
+	int error;
+
+	node = dpl_new_node(NULL, "", 0);
+	if (!node)
+		return -ENOMEM;
+
+	if (size >= sizeof(uint32_t) && fdt_word(buf, 0) == FDT_MAGIC) {
+		error = dtb_parse(name, buf, size, node);
+	} else if (memchr(buf, '\0', size) != NULL) {
+		ERROR_PRINTF("%s is neither a DTS nor a DTB file\n", name);
+		error = -EINVAL;
+	} else {
+		error = dts_parse(name, (const char *)buf, node);
+	}
+
+	if (error) {
+		dpl_free(node);
+		return error;
+	}
+
+	*root = node;
+
+	return 0;
+}
+
+/**
+ * Load the DPL found in 'path', either a DTS source file or a DTB blob
+ * compiled by dtc. On success, '*root' is the root node of the DPL, to be
+ * freed with dpl_free().
+ */
+int dpl_load(const char *path, struct dpl_node **root)
+{
+	uint8_t *buf = NULL;
+	size_t size = 0;
+	size_t n;
+	int error;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		error = -errno;
+		ERROR_PRINTF("cannot open %s (error %d)\n", path, error);
+		return error;
+	}
+
+	for (;;) {
+		uint8_t *new_buf = realloc(buf, size + 65536 + 1);
+
+		if (!new_buf) {
+			error = -ENOMEM;
+			goto out;
+		}
+
+		buf = new_buf;
+		n = fread(buf + size, 1, 65536, fp);
+		size += n;
+		if (n < 65536)
+			break;
+	}
+
+	if (ferror(fp)) {
+		error = -EIO;
+		ERROR_PRINTF("error reading %s\n", path);
+		goto out;
+	}
+	buf[size] = '\0';
+
+	error = dpl_parse(path, buf, size, root);
+out:
+	free(buf);
+	fclose(fp);
+
+	return error;
+}
+
+/*
+ * DTB writer
+ */
+
+#define FDT_VERSION		17
+#define FDT_RSVMAP_SIZE		16	/* a single terminating entry */
+
+/**
+ * struct dtb_block - block of a DTB being written
+ */
+struct dtb_block {
+	uint8_t *data;
+	size_t len;
+	size_t max;
+};
+
+/**
+ * struct dtb_writer - state of the DTB writer
+ * @dt_struct: structure block
+ * @dt_strings: strings block, holding each property name once
+ * @string_hash: open addressing hash set of the names in @dt_strings,
+ *	holds their offsets plus 1, 0 for a free slot
+ * @hash_size: number of slots of @string_hash, a power of 2
+ * @num_strings: number of names in @dt_strings
+ * @error: first error met
+ */
+struct dtb_writer {
+	struct dtb_block dt_struct;
+	struct dtb_block dt_strings;
+	uint32_t *string_hash;
+	uint32_t hash_size;
+	uint32_t num_strings;
+	int error;
+};
+
+static void dtb_append(struct dtb_writer *writer, struct dtb_block *block,
+		       const void *data, size_t len, size_t padded_len)
+{
+	uint8_t *new_data;
+	size_t max;
+
+	if (writer->error)
+		return;
+
+	if (block->len + padded_len > block->max) {
+		max = block->max ? block->max : 4096;
+		while (block->len + padded_len > max)
+			max *= 2;
+
+		new_data = realloc(block->data, max);
+		if (!new_data) {
+			writer->error = -ENOMEM;
+			return;
+		}
+		block->data = new_data;
+		block->max = max;
+	}
+
+	if (len != 0)
+		memcpy(block->data + block->len, data, len);
+	memset(block->data + block->len + len, 0, padded_len - len);
+	block->len += padded_len;
+}
+
+static void dtb_append_word(struct dtb_writer *writer, uint32_t word)
+{
+	word = htonl(word);
+	dtb_append(writer, &writer->dt_struct, &word, sizeof(word),
+		   sizeof(word));
+}
+
+static uint32_t dtb_string_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	/* FNV-1a */
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+
+	return hash;
+}
+
+/*
+ * Keep the hash set of the names at most half full
+ */
+static int dtb_grow_strings(struct dtb_writer *writer)
+{
+	uint32_t hash_size = writer->hash_size ? 2 * writer->hash_size : 64;
+	uint32_t *string_hash;
+	uint32_t offset;
+	uint32_t slot;
+
+	string_hash = calloc(hash_size, sizeof(*string_hash));
+	if (!string_hash)
+		return -ENOMEM;
+
+	for (uint32_t i = 0; i < writer->hash_size; i++) {
+		if (!writer->string_hash[i])
+			continue;
+
+		offset = writer->string_hash[i] - 1;
+		slot = dtb_string_hash((char *)writer->dt_strings.data +
+				       offset) & (hash_size - 1);
+		while (string_hash[slot])
+			slot = (slot + 1) & (hash_size - 1);
+		string_hash[slot] = offset + 1;
+	}
+
+	free(writer->string_hash);
+	writer->string_hash = string_hash;
+	writer->hash_size = hash_size;
+
+	return 0;
+}
+
+/*
+ * Offset of 'name' in the strings block, where it is added the first time
+ */
+static uint32_t dtb_string(struct dtb_writer *writer, const char *name)
+{
+	uint32_t offset;
+	uint32_t slot;
+
+	if (writer->error)
+		return 0;
+
+	if (2 * (writer->num_strings + 1) > writer->hash_size) {
+		writer->error = dtb_grow_strings(writer);
+		if (writer->error)
+			return 0;
+	}
+
+	for (slot = dtb_string_hash(name) & (writer->hash_size - 1);
+	     writer->string_hash[slot];
+	     slot = (slot + 1) & (writer->hash_size - 1)) {
+		offset = writer->string_hash[slot] - 1;
+		if (strcmp((char *)writer->dt_strings.data + offset, name) == 0)
+			return offset;
+	}
+
+	offset = writer->dt_strings.len;
+	dtb_append(writer, &writer->dt_strings, name, strlen(name) + 1,
+		   strlen(name) + 1);
+	writer->string_hash[slot] = offset + 1;
+	writer->num_strings++;
+
+	return offset;
+}
+
+static void dtb_write_node(struct dtb_writer *writer,
+			   const struct dpl_node *node)
+{
+	const struct dpl_prop *prop;
+	const struct dpl_node *child;
+	size_t len = strlen(node->name) + 1;
+
+	dtb_append_word(writer, FDT_BEGIN_NODE);
+	dtb_append(writer, &writer->dt_struct, node->name, len,
+		   FDT_ALIGN(len));
+
+	for (prop = node->props; prop; prop = prop->next) {
+		dtb_append_word(writer, FDT_PROP);
+		dtb_append_word(writer, prop->len);
+		dtb_append_word(writer, dtb_string(writer, prop->name));
+		dtb_append(writer, &writer->dt_struct, prop->data, prop->len,
+			   FDT_ALIGN(prop->len));
+	}
+
+	for (child = node->children; child; child = child->next)
+		dtb_write_node(writer, child);
+
+	dtb_append_word(writer, FDT_END_NODE);
+}
+
+/**
+ * Write the DPL rooted at 'root' to 'fp' as a DTB blob, like dtc -O dtb
+ * would compile its DTS source
+ */
+int dpl_write_dtb(FILE *fp, const struct dpl_node *root)
+{
+	struct dtb_writer writer;
+	uint8_t rsvmap[FDT_RSVMAP_SIZE] = { 0 };
+	uint32_t header[FDT_HEADER_SIZE / sizeof(uint32_t)];
+	uint32_t off_struct;
+	uint32_t off_strings;
+	uint32_t size;
+	int error;
+
+	memset(&writer, 0, sizeof(writer));
+	dtb_write_node(&writer, root);
+	dtb_append_word(&writer, FDT_END);
+	error = writer.error;
+	if (error)
+		goto out;
+
+	/* the memory reservation map is 8 byte aligned */
+	off_struct = FDT_HEADER_SIZE + FDT_RSVMAP_SIZE;
+	off_strings = off_struct + writer.dt_struct.len;
+	size = off_strings + writer.dt_strings.len;
+
+	header[0] = htonl(FDT_MAGIC);
+	header[1] = htonl(size);
+	header[2] = htonl(off_struct);
+	header[3] = htonl(off_strings);
+	header[4] = htonl(FDT_HEADER_SIZE);	/* off_mem_rsvmap */
+	header[5] = htonl(FDT_VERSION);
+	header[6] = htonl(FDT_MIN_VERSION);	/* last_comp_version */
+	header[7] = htonl(0);			/* boot_cpuid_phys */
+	header[8] = htonl(writer.dt_strings.len);
+	header[9] = htonl(writer.dt_struct.len);
+
+	if (fwrite(header, sizeof(header), 1, fp) != 1 ||
+	    fwrite(rsvmap, sizeof(rsvmap), 1, fp) != 1 ||
+	    fwrite(writer.dt_struct.data, writer.dt_struct.len, 1, fp) != 1 ||
+	    (writer.dt_strings.len != 0 &&
+	     fwrite(writer.dt_strings.data, writer.dt_strings.len, 1,
+		    fp) != 1))
+		error = -EIO;
+out:
+	free(writer.dt_struct.data);
+	free(writer.dt_strings.data);
+	free(writer.string_hash);
+
+	return error;
+}
@@ -0,0 +1,632 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Journal of the MC commands changing the layout, kept while a batch
+ * transaction runs so that a failed transaction can be undone.
+ *
+ * mc_send_command() hands every successful command to journal_record(),
+ * which keeps the ones creating an object or a container, moving an
+ * object, changing its plugged state, connecting two endpoints or locking
+ * a container. journal_rollback() sends their inverse commands, the most
+ * recent first. The plugged state an object had before a command
+ * changing it is read by journal_prepare(), before the command is sent.
+ *
+ * The commands refer to containers through tokens, which do not outlive
+ * the restool command that opened them. The journal tracks the container
+ * each open token refers to and records container ids instead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+#include "mc_v10/fsl_dprc_cmd.h"
+#include "mc_v10/fsl_dpni_cmd.h"
+#include "mc_v10/fsl_dpsw_cmd.h"
+#include "mc_v10/fsl_dpio_cmd.h"
+#include "mc_v10/fsl_dpbp_cmd.h"
+#include "mc_v10/fsl_dpdmux_cmd.h"
+#include "mc_v10/fsl_dpci_cmd.h"
+#include "mc_v10/fsl_dpcon_cmd.h"
+#include "mc_v10/fsl_dpseci_cmd.h"
+#include "mc_v10/fsl_dpaiop_cmd.h"
+#include "mc_v10/fsl_dpmcp_cmd.h"
+#include "mc_v10/fsl_dpmac_cmd.h"
+#include "mc_v10/fsl_dpdcei_cmd.h"
+#include "mc_v10/fsl_dpdmai_cmd.h"
+#include "mc_v10/fsl_dprtc_cmd.h"
+
+/*
+ * Command numbers shared by all object types, the low bits of the create
+ * command number are the object type code
+ */
+#define JOURNAL_CMD_CLOSE	0x800
+#define JOURNAL_CMD_CREATE	0x900
+#define JOURNAL_CMD_TYPE_MASK	0x01f
+
+#define JOURNAL_CMD_NUM(cmd_id)	((cmd_id) >> DPRC_CMD_ID_OFFSET)
+#define JOURNAL_CMD_CODE(cmd_id) \
+	(JOURNAL_CMD_NUM(cmd_id) & JOURNAL_CMD_TYPE_MASK)
+
+enum journal_op {
+	JOURNAL_CREATE,
+	JOURNAL_CREATE_CONTAINER,
+	JOURNAL_ASSIGN,
+	JOURNAL_UNASSIGN,
+	JOURNAL_CONNECT,
+	JOURNAL_SET_LOCKED,
+};
+
+/**
+ * struct journal_type - object type whose creation can be undone
+ * @code: type code of the create command
+ * @name: object type name
+ * @ops: flib operations of the type
+ */
+struct journal_type {
+	uint16_t code;
+	const char *name;
+	const struct flib_ops *ops;
+};
+
+static const struct journal_type journal_types[] = {
+	{ JOURNAL_CMD_CODE(DPNI_CMDID_CREATE), "dpni", &dpni_ops },
+	{ JOURNAL_CMD_CODE(DPSW_CMDID_CREATE), "dpsw", &dpsw_ops },
+	{ JOURNAL_CMD_CODE(DPIO_CMDID_CREATE), "dpio", &dpio_ops },
+	{ JOURNAL_CMD_CODE(DPBP_CMDID_CREATE), "dpbp", &dpbp_ops },
+	{ JOURNAL_CMD_CODE(DPDMUX_CMDID_CREATE), "dpdmux", &dpdmux_ops },
+	{ JOURNAL_CMD_CODE(DPCI_CMDID_CREATE), "dpci", &dpci_ops },
+	{ JOURNAL_CMD_CODE(DPCON_CMDID_CREATE), "dpcon", &dpcon_ops },
+	{ JOURNAL_CMD_CODE(DPSECI_CMDID_CREATE), "dpseci", &dpseci_ops },
+	{ JOURNAL_CMD_CODE(DPAIOP_CMDID_CREATE), "dpaiop", &dpaiop_ops },
+	{ JOURNAL_CMD_CODE(DPMCP_CMDID_CREATE), "dpmcp", &dpmcp_ops },
+	{ JOURNAL_CMD_CODE(DPMAC_CMDID_CREATE), "dpmac", &dpmac_ops },
+	{ JOURNAL_CMD_CODE(DPDCEI_CMDID_CREATE), "dpdcei", &dpdcei_ops },
+	{ JOURNAL_CMD_CODE(DPDMAI_CMDID_CREATE), "dpdmai", &dpdmai_ops },
+	{ JOURNAL_CMD_CODE(DPRTC_CMDID_CREATE), "dprtc", &dprtc_ops },
+};
+
+/**
+ * struct journal_entry - MC command to undo
+ * @op: kind of command
+ * @container_id: container the command was sent to
+ * @type: type of the object created or moved, NULL for an object type
+ *	whose creation cannot be undone
+ * @obj_type: object type of @obj as sent to the MC
+ * @obj_id: id of the object created, moved or connected, or of the child
+ *	container created or locked
+ * @child_id: container the object was moved to or from
+ * @options: DPRC_RES_REQ_OPT_* options of an assign command
+ * @was_plugged: plugged state of the object before a plugged state change
+ * @if_id: interface of the object connected
+ * @locked: locked state set
+ */
+struct journal_entry {
+	enum journal_op op;
+	uint32_t container_id;
+	const struct journal_type *type;
+	char obj_type[16];
+	uint32_t obj_id;
+	uint32_t child_id;
+	uint32_t options;
+	bool was_plugged;
+	uint16_t if_id;
+	uint8_t locked;
+};
+
+/**
+ * struct journal_token - container a token is open on
+ */
+struct journal_token {
+	const struct fsl_mc_io *portal;
+	uint16_t token;
+	uint32_t container_id;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	struct journal_entry *entries;
+	unsigned int num_entries;
+	unsigned int max_entries;
+	struct journal_token *tokens;
+	unsigned int num_tokens;
+	unsigned int max_tokens;
+	int error;
+} journal = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static struct journal_token *
+journal_find_token(const struct fsl_mc_io *portal, uint16_t token)
+{
+	for (unsigned int i = 0; i < journal.num_tokens; i++)
+		if (journal.tokens[i].portal == portal &&
+		    journal.tokens[i].token == token)
+			return &journal.tokens[i];
+
+	return NULL;
+}
+
+static void journal_add_token(const struct fsl_mc_io *portal,
+			      uint16_t token, uint32_t container_id)
+{
+	struct journal_token *entry;
+
+	entry = journal_find_token(portal, token);
+	if (!entry) {
+		if (journal.num_tokens == journal.max_tokens) {
+			unsigned int max = journal.max_tokens * 2 + 8;
+
+			entry = realloc(journal.tokens, max * sizeof(*entry));
+			if (!entry) {
+				journal.error = -ENOMEM;
+				return;
+			}
+
+			journal.tokens = entry;
+			journal.max_tokens = max;
+		}
+
+		entry = &journal.tokens[journal.num_tokens++];
+		entry->portal = portal;
+		entry->token = token;
+	}
+
+	entry->container_id = container_id;
+}
+
+static void journal_remove_token(const struct fsl_mc_io *portal,
+				 uint16_t token)
+{
+	struct journal_token *entry = journal_find_token(portal, token);
+
+	if (entry)
+		*entry = journal.tokens[--journal.num_tokens];
+}
+
+static struct journal_entry *journal_add_entry(enum journal_op op,
+					       uint32_t container_id)
+{
+	struct journal_entry *entry;
+
+	if (journal.num_entries == journal.max_entries) {
+		unsigned int max = journal.max_entries * 2 + 16;
+
+		entry = realloc(journal.entries, max * sizeof(*entry));
+		if (!entry) {
+			journal.error = -ENOMEM;
+			return NULL;
+		}
+
+		journal.entries = entry;
+		journal.max_entries = max;
+	}
+
+	entry = &journal.entries[journal.num_entries++];
+	memset(entry, 0, sizeof(*entry));
+	entry->op = op;
+	entry->container_id = container_id;
+	return entry;
+}
+
+static const struct journal_type *journal_find_type(uint16_t code)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(journal_types); i++)
+		if (journal_types[i].code == code)
+			return &journal_types[i];
+
+	return NULL;
+}
+
+/**
+ * Start journaling the MC commands. 'root_token' is the token of the root
+ * container, already open on 'mc_io'.
+ */
+void journal_begin(const struct fsl_mc_io *mc_io, uint16_t root_token)
+{
+	pthread_mutex_lock(&journal.lock);
+	journal.num_entries = 0;
+	journal.num_tokens = 0;
+	journal.error = 0;
+	journal_add_token(mc_io, root_token, restool.root_dprc_id);
+	pthread_mutex_unlock(&journal.lock);
+	restool.journal = true;
+}
+
+/**
+ * Read the state of the object whose plugged state the MC command
+ * 'request' changes, before it is sent on 'portal': an assign or an
+ * unassign command moving the object to the container it is in
+ *
+ * Returns the DPRC_OBJ_STATE_* flags of the object, 0 for the other
+ * commands, negative if the object could not be read
+ */
+int journal_prepare(struct fsl_mc_io *portal,
+		    const struct mc_command *request)
+{
+	const struct mc_cmd_header *hdr = (const void *)&request->header;
+	uint16_t cmd_num = JOURNAL_CMD_NUM(le16_to_cpu(hdr->cmd_id));
+	uint16_t token = le16_to_cpu(hdr->token);
+	const struct dprc_cmd_assign *cmd_params =
+		(const void *)request->params;
+	struct dprc_obj_desc obj_desc;
+	struct journal_token *open;
+	char obj_type[16];
+	int obj_id;
+	int num_objs;
+	bool plug;
+	int error;
+
+	if (cmd_num != JOURNAL_CMD_NUM(DPRC_CMDID_ASSIGN) &&
+	    cmd_num != JOURNAL_CMD_NUM(DPRC_CMDID_UNASSIGN))
+		return 0;
+
+	pthread_mutex_lock(&journal.lock);
+	open = journal_find_token(portal, token);
+	plug = open && open->container_id ==
+		       le32_to_cpu(cmd_params->container_id);
+	pthread_mutex_unlock(&journal.lock);
+	if (!plug)
+		return 0;
+
+	memcpy(obj_type, cmd_params->type, sizeof(obj_type));
+	obj_type[sizeof(obj_type) - 1] = '\0';
+	obj_id = le32_to_cpu(cmd_params->id_base_align);
+
+	error = dprc_get_obj_count(portal, 0, token, &num_objs);
+	for (int i = 0; error == 0 && i < num_objs; i++) {
+		error = dprc_get_obj(portal, 0, token, i, &obj_desc);
+		if (error == 0 && obj_desc.id == obj_id &&
+		    strcmp(obj_desc.type, obj_type) == 0)
+			return obj_desc.state;
+	}
+
+	return error < 0 ? error : -ENXIO;
+}
+
+/**
+ * Record the MC command 'request' sent on 'portal' if it changes the
+ * layout, 'response' being its successful response and 'obj_state' the
+ * value returned by journal_prepare() for 'request'
+ */
+void journal_record(const struct fsl_mc_io *portal,
+		    const struct mc_command *request,
+		    const struct mc_command *response, int obj_state)
+{
+	const struct mc_cmd_header *hdr = (const void *)&request->header;
+	uint16_t cmd_num = JOURNAL_CMD_NUM(le16_to_cpu(hdr->cmd_id));
+	uint16_t token = le16_to_cpu(hdr->token);
+	const void *params = request->params;
+	struct journal_entry *entry;
+	struct journal_token *open;
+	uint32_t container_id;
+
+	pthread_mutex_lock(&journal.lock);
+	if (cmd_num == JOURNAL_CMD_NUM(DPRC_CMDID_OPEN)) {
+		const struct dprc_cmd_open *cmd_params = params;
+
+		journal_add_token(portal,
+				  mc_cmd_hdr_read_token((void *)response),
+				  le32_to_cpu(cmd_params->container_id));
+		goto out;
+	}
+
+	if (cmd_num == JOURNAL_CMD_CLOSE) {
+		journal_remove_token(portal, token);
+		goto out;
+	}
+
+	/*
+	 * The layout is only changed through container tokens, commands
+	 * sent on object tokens are not recorded
+	 */
+	open = journal_find_token(portal, token);
+	if (!open)
+		goto out;
+
+	container_id = open->container_id;
+	if ((cmd_num & ~JOURNAL_CMD_TYPE_MASK) == JOURNAL_CMD_CREATE) {
+		uint16_t code = cmd_num & JOURNAL_CMD_TYPE_MASK;
+
+		entry = journal_add_entry(JOURNAL_CREATE, container_id);
+		if (!entry)
+			goto out;
+
+		entry->type = journal_find_type(code);
+		entry->obj_id = mc_cmd_read_object_id((void *)response);
+		if (entry->type)
+			strcpy(entry->obj_type, entry->type->name);
+		else
+			snprintf(entry->obj_type, sizeof(entry->obj_type),
+				 "type %#x", code);
+		goto out;
+	}
+
+	switch (cmd_num) {
+	case JOURNAL_CMD_NUM(DPRC_CMDID_CREATE_CONT): {
+		const struct dprc_rsp_create_container *rsp_params =
+			(const void *)response->params;
+
+		entry = journal_add_entry(JOURNAL_CREATE_CONTAINER,
+					  container_id);
+		if (entry)
+			entry->obj_id =
+				le32_to_cpu(rsp_params->child_container_id);
+		break;
+	}
+	case JOURNAL_CMD_NUM(DPRC_CMDID_ASSIGN):
+	case JOURNAL_CMD_NUM(DPRC_CMDID_UNASSIGN): {
+		const struct dprc_cmd_assign *cmd_params = params;
+		uint32_t options = le32_to_cpu(cmd_params->options);
+		bool plugged;
+
+		plugged = cmd_num == JOURNAL_CMD_NUM(DPRC_CMDID_ASSIGN) &&
+			  (options & DPRC_RES_REQ_OPT_PLUGGED);
+		if (le32_to_cpu(cmd_params->container_id) == container_id) {
+			if (obj_state < 0) {
+				journal.error = obj_state;
+				break;
+			}
+
+			/* nothing to undo if the plugged state is the same */
+			if (!!(obj_state & DPRC_OBJ_STATE_PLUGGED) == plugged)
+				break;
+		}
+
+		entry = journal_add_entry(
+				cmd_num == JOURNAL_CMD_NUM(DPRC_CMDID_ASSIGN) ?
+				JOURNAL_ASSIGN : JOURNAL_UNASSIGN,
+				container_id);
+		if (!entry)
+			break;
+
+		memcpy(entry->obj_type, cmd_params->type,
+		       sizeof(entry->obj_type));
+		entry->obj_type[sizeof(entry->obj_type) - 1] = '\0';
+		entry->obj_id = le32_to_cpu(cmd_params->id_base_align);
+		entry->child_id = le32_to_cpu(cmd_params->container_id);
+		entry->options = options;
+		entry->was_plugged = obj_state & DPRC_OBJ_STATE_PLUGGED;
+		break;
+	}
+	case JOURNAL_CMD_NUM(DPRC_CMDID_CONNECT): {
+		const struct dprc_cmd_connect *cmd_params = params;
+
+		entry = journal_add_entry(JOURNAL_CONNECT, container_id);
+		if (!entry)
+			break;
+
+		memcpy(entry->obj_type, cmd_params->ep1_type,
+		       sizeof(entry->obj_type));
+		entry->obj_type[sizeof(entry->obj_type) - 1] = '\0';
+		entry->obj_id = le32_to_cpu(cmd_params->ep1_id);
+		entry->if_id = le16_to_cpu(cmd_params->ep1_interface_id);
+		break;
+	}
+	case JOURNAL_CMD_NUM(DPRC_CMDID_SET_LOCKED): {
+		const struct dprc_cmd_set_locked *cmd_params = params;
+
+		entry = journal_add_entry(JOURNAL_SET_LOCKED, container_id);
+		if (!entry)
+			break;
+
+		entry->obj_id = le32_to_cpu(cmd_params->child_container_id);
+		entry->locked = cmd_params->locked;
+		break;
+	}
+	}
+out:
+	pthread_mutex_unlock(&journal.lock);
+}
+
+/**
+ * Send the inverse of the MC command of 'entry', on the container open
+ * on 'token'
+ */
+static int journal_undo(const struct journal_entry *entry, uint16_t token)
+{
+	struct dprc_endpoint endpoint;
+	struct dprc_res_req res_req;
+	int error;
+
+	switch (entry->op) {
+	case JOURNAL_CREATE:
+		if (!entry->type) {
+			ERROR_PRINTF("object %u of %s cannot be destroyed\n",
+				     entry->obj_id, entry->obj_type);
+			return -ENOTSUP;
+		}
+
+		error = entry->type->ops->obj_destroy(&restool.mc_io, token,
+						      0, entry->obj_id);
+		if (error == 0)
+			printf("%s.%u is destroyed\n", entry->obj_type,
+			       entry->obj_id);
+		return error;
+	case JOURNAL_CREATE_CONTAINER:
+		error = dprc_destroy_container(&restool.mc_io, 0, token,
+					       entry->obj_id);
+		if (error == 0)
+			printf("dprc.%u is destroyed\n", entry->obj_id);
+		return error;
+	case JOURNAL_ASSIGN:
+	case JOURNAL_UNASSIGN:
+		memset(&res_req, 0, sizeof(res_req));
+		strcpy(res_req.type, entry->obj_type);
+		res_req.num = 1;
+		res_req.id_base_align = entry->obj_id;
+		res_req.options = entry->options & ~DPRC_RES_REQ_OPT_PLUGGED;
+
+		if (entry->child_id == entry->container_id) {
+			/* plugged state change: restore the state before it */
+			if (entry->was_plugged)
+				res_req.options |= DPRC_RES_REQ_OPT_PLUGGED;
+			error = dprc_assign(&restool.mc_io, 0, token,
+					    entry->child_id, &res_req);
+			if (error == 0)
+				printf("%s.%u is %s\n", entry->obj_type,
+				       entry->obj_id,
+				       res_req.options &
+				       DPRC_RES_REQ_OPT_PLUGGED ?
+				       "plugged" : "unplugged");
+			return error;
+		}
+
+		if (entry->op == JOURNAL_UNASSIGN) {
+			error = dprc_assign(&restool.mc_io, 0, token,
+					    entry->child_id, &res_req);
+			if (error == 0)
+				printf("%s.%u is moved back to dprc.%u\n",
+				       entry->obj_type, entry->obj_id,
+				       entry->child_id);
+			return error;
+		}
+
+		/*
+		 * An object plugged by the assign command must be unplugged
+		 * in the child container before it can leave it
+		 */
+		if (entry->options & DPRC_RES_REQ_OPT_PLUGGED) {
+			uint16_t child_token;
+
+			error = dprc_open(&restool.mc_io, 0, entry->child_id,
+					  &child_token);
+			if (error < 0)
+				return error;
+
+			error = dprc_assign(&restool.mc_io, 0, child_token,
+					    entry->child_id, &res_req);
+			(void)dprc_close(&restool.mc_io, 0, child_token);
+			if (error < 0)
+				return error;
+		}
+
+		error = dprc_unassign(&restool.mc_io, 0, token,
+				      entry->child_id, &res_req);
+		if (error == 0)
+			printf("%s.%u is moved back to dprc.%u\n",
+			       entry->obj_type, entry->obj_id,
+			       entry->container_id);
+		return error;
+	case JOURNAL_CONNECT:
+		memset(&endpoint, 0, sizeof(endpoint));
+		strcpy(endpoint.type, entry->obj_type);
+		endpoint.id = entry->obj_id;
+		endpoint.if_id = entry->if_id;
+		error = dprc_disconnect(&restool.mc_io, 0, token, &endpoint);
+		if (error == 0)
+			printf("%s.%u.%u is disconnected\n", entry->obj_type,
+			       entry->obj_id, entry->if_id);
+		return error;
+	case JOURNAL_SET_LOCKED:
+		error = dprc_set_locked(&restool.mc_io, 0, token,
+					!entry->locked, entry->obj_id);
+		if (error == 0)
+			printf("dprc.%u is %s\n", entry->obj_id,
+			       entry->locked ? "unlocked" : "locked");
+		return error;
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * Stop journaling and forget the MC commands journaled so far
+ */
+void journal_commit(void)
+{
+	restool.journal = false;
+	pthread_mutex_lock(&journal.lock);
+	journal.num_entries = 0;
+	journal.num_tokens = 0;
+	pthread_mutex_unlock(&journal.lock);
+}
+
+/**
+ * Stop journaling and undo the MC commands journaled so far, the most
+ * recent first. Undoing goes on after an error, so that as little as
+ * possible is left behind.
+ *
+ * Returns 0 if all the commands were undone, the first error otherwise.
+ */
+int journal_rollback(void)
+{
+	enum mc_cmd_status mc_status;
+	int first_error = 0;
+	int error;
+
+	restool.journal = false;
+	if (journal.error < 0) {
+		ERROR_PRINTF("the journal is incomplete, some changes are not undone\n");
+		first_error = journal.error;
+	}
+
+	while (journal.num_entries > 0) {
+		const struct journal_entry *entry =
+			&journal.entries[--journal.num_entries];
+		uint16_t token = restool.root_dprc_handle;
+		bool opened = false;
+
+		if (entry->container_id != restool.root_dprc_id) {
+			error = dprc_open(&restool.mc_io, 0,
+					  entry->container_id, &token);
+			if (error < 0)
+				goto report;
+			opened = true;
+		}
+
+		error = journal_undo(entry, token);
+		if (opened) {
+			int error2;
+
+			error2 = dprc_close(&restool.mc_io, 0, token);
+			if (error == 0)
+				error = error2;
+		}
+report:
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("undoing a change of dprc.%u failed: %s (status %#x)\n",
+				     entry->container_id,
+				     mc_status_to_string(mc_status), mc_status);
+			if (first_error == 0)
+				first_error = error;
+		}
+	}
+
+	journal.num_tokens = 0;
+	topology_invalidate();
+	return first_error;
+}
@@ -0,0 +1,1153 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Simulated MC, used in place of the fsl-mc bus driver by --device=sim.
+ *
+ * The simulation keeps the containers, objects and connections of an MC
+ * firmware v10 in memory and implements the DPRC commands restool relies
+ * on. Other object commands succeed on any open object and return zeroed
+ * responses, except the counters read by 'dpni info --stats',
+ * 'dpmac info' and 'dpdbg profile', which grow with the object age, and
+ * the DPCI peer attributes. All portals of a process share the same
+ * state, so that the container tree can be walked on several portals.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+#include "mc_v10/fsl_dprc_cmd.h"
+#include "mc_v10/fsl_dpmng_cmd.h"
+#include "mc_v10/fsl_dpni_cmd.h"
+#include "mc_v10/fsl_dpmac_cmd.h"
+#include "mc_v10/fsl_dpsw_cmd.h"
+#include "mc_v10/fsl_dpdmux_cmd.h"
+#include "mc_v10/fsl_dpdbg_cmd.h"
+#include "mc_v10/fsl_dpci_cmd.h"
+
+#define SIM_MC_VERSION_MAJOR	10
+#define SIM_MC_VERSION_MINOR	18
+#define SIM_MC_VERSION_REVISION	0
+
+#define SIM_ROOT_DPRC_ID	1
+#define SIM_VENDOR_ID		0x1957
+
+/*
+ * Default number of dpni objects, each connected to a dpmac
+ */
+#define SIM_DEFAULT_NUM_NIS	16
+#define SIM_MAX_NUM_NIS		4096
+#define SIM_MAX_NUM_CONTAINERS	256
+
+/*
+ * Number of each of the dpio, dpbp, dpcon and dpmcp objects of the root
+ * container
+ */
+#define SIM_NUM_SERVICE_OBJS	8
+
+#define SIM_MAX_TOKENS		UINT16_MAX
+
+/*
+ * MC command numbers shared by all object types. The open, create,
+ * destroy and get_api_version commands of an object type are the base
+ * number plus the type code.
+ */
+#define SIM_CMD_CLOSE		0x800
+#define SIM_CMD_GET_ATTR	0x004
+#define SIM_CMD_OPEN		0x800
+#define SIM_CMD_CREATE		0x900
+#define SIM_CMD_DESTROY		0x980
+#define SIM_CMD_GET_API_VERSION	0xa00
+#define SIM_CMD_TYPE_MASK	0x01f
+
+#define SIM_CMD_NUM(cmd_id)	((cmd_id) >> DPRC_CMD_ID_OFFSET)
+
+/*
+ * Number of interfaces of the simulated DPSWs and DPDMUXs, the uplink of
+ * a DPDMUX not included
+ */
+#define SIM_NUM_IFS		4
+
+/**
+ * struct sim_type - object type known by the simulated MC
+ * @name: object type name
+ * @code: type code of the open, create, destroy and get_api_version
+ *	commands
+ * @ver_major: object API major version
+ * @ver_minor: object API minor version
+ * @irq_count: number of interrupts
+ * @region_count: number of mappable regions
+ * @attr_id_offset: byte offset of the object id in the get_attributes
+ *	response, -1 if the response has no id
+ * @attr_id_size: size in bytes of the object id in the get_attributes
+ *	response
+ */
+struct sim_type {
+	const char *name;
+	uint16_t code;
+	uint16_t ver_major;
+	uint16_t ver_minor;
+	uint8_t irq_count;
+	uint8_t region_count;
+	int8_t attr_id_offset;
+	uint8_t attr_id_size;
+};
+
+static const struct sim_type sim_types[] = {
+	{ "dpni", 0x1, 7, 9, 1, 0, -1, 0 },
+	{ "dpsw", 0x2, 8, 2, 1, 0, 12, 4 },
+	{ "dpio", 0x3, 4, 2, 1, 2, 0, 4 },
+	{ "dpbp", 0x4, 3, 3, 0, 0, 4, 4 },
+	{ "dprc", 0x5, 6, 4, 1, 1, 0, 4 },
+	{ "dpdmux", 0x6, 6, 5, 1, 0, 16, 4 },
+	{ "dpci", 0x7, 3, 4, 1, 0, 0, 4 },
+	{ "dpcon", 0x8, 3, 3, 1, 0, 0, 4 },
+	{ "dpseci", 0x9, 5, 3, 1, 0, 0, 4 },
+	{ "dpaiop", 0xa, 2, 3, 1, 0, 0, 4 },
+	{ "dpmcp", 0xb, 4, 0, 1, 1, 4, 4 },
+	{ "dpmac", 0xc, 4, 2, 1, 0, 2, 2 },
+	{ "dpdcei", 0xd, 2, 3, 1, 0, 0, 4 },
+	{ "dpdmai", 0xe, 3, 2, 1, 0, 0, 4 },
+	{ "dpdbg", 0xf, 1, 0, 0, 0, 0, 4 },
+	{ "dprtc", 0x10, 2, 0, 1, 0, 4, 4 },
+};
+
+/**
+ * struct sim_obj - object of the simulated MC
+ * @type: object type
+ * @id: object id
+ * @label: object label
+ * @state: DPRC_OBJ_STATE_* flags, DPRC_OBJ_STATE_OPEN is derived from
+ *	@open_count
+ * @open_count: number of tokens open on the object
+ * @container: container the object is assigned to, NULL for the root
+ *	container
+ * @creator: container the object was created in
+ * @created_ns: creation time, used to make up counters
+ * @options: container options, only for dprc objects
+ * @icid: container isolation context id, only for dprc objects
+ * @portal_id: container MC portal id, only for dprc objects
+ * @locked: container locked flag, only for dprc objects
+ * @objs: objects assigned to the container, in dprc_get_obj() order
+ * @num_objs: number of entries of @objs
+ * @max_objs: allocated entries of @objs
+ */
+struct sim_obj {
+	const struct sim_type *type;
+	uint32_t id;
+	char label[16];
+	uint32_t state;
+	unsigned int open_count;
+	struct sim_obj *container;
+	struct sim_obj *creator;
+	uint64_t created_ns;
+	uint32_t options;
+	uint32_t icid;
+	uint32_t portal_id;
+	bool locked;
+	struct sim_obj **objs;
+	uint32_t num_objs;
+	uint32_t max_objs;
+};
+
+/**
+ * struct sim_endpoint - interface of an object
+ */
+struct sim_endpoint {
+	struct sim_obj *obj;
+	uint16_t if_id;
+};
+
+/**
+ * struct sim_connection - link between two object interfaces
+ */
+struct sim_connection {
+	struct sim_endpoint ep[2];
+};
+
+/**
+ * struct sim - state of the simulated MC
+ * @lock: serializes the commands sent on all portals
+ * @initialized: the default layout was created
+ * @num_nis: number of dpni/dpmac pairs of the default layout
+ * @num_containers: number of child containers of the default layout
+ * @root: root container
+ * @objs: all objects but the root container
+ * @num_objs: number of entries of @objs
+ * @max_objs: allocated entries of @objs
+ * @tokens: object each token is open on, token i is @tokens[i - 1]
+ * @next_token: index of @tokens the search for a free token starts at
+ * @conns: connections between object interfaces
+ * @num_conns: number of entries of @conns
+ * @max_conns: allocated entries of @conns
+ */
+struct sim {
+	pthread_mutex_t lock;
+	bool initialized;
+	unsigned int num_nis;
+	unsigned int num_containers;
+	struct sim_obj *root;
+	struct sim_obj **objs;
+	uint32_t num_objs;
+	uint32_t max_objs;
+	struct sim_obj **tokens;
+	uint32_t next_token;
+	struct sim_connection *conns;
+	uint32_t num_conns;
+	uint32_t max_conns;
+};
+
+static struct sim sim = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.num_nis = SIM_DEFAULT_NUM_NIS,
+};
+
+static const struct sim_type *sim_type_by_name(const char *name)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(sim_types); i++)
+		if (strncmp(sim_types[i].name, name, 16) == 0)
+			return &sim_types[i];
+
+	return NULL;
+}
+
+static const struct sim_type *sim_type_by_code(uint16_t code)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(sim_types); i++)
+		if (sim_types[i].code == code)
+			return &sim_types[i];
+
+	return NULL;
+}
+
+static int grow_array(void *array, uint32_t *max, size_t entry_size)
+{
+	uint32_t new_max = *max ? 2 * *max : 16;
+	void *p;
+
+	p = realloc(*(void **)array, new_max * entry_size);
+	if (!p)
+		return -ENOMEM;
+
+	*(void **)array = p;
+	*max = new_max;
+	return 0;
+}
+
+static struct sim_obj *sim_find(const struct sim_type *type, uint32_t id)
+{
+	if (type == sim.root->type && id == sim.root->id)
+		return sim.root;
+
+	for (uint32_t i = 0; i < sim.num_objs; i++)
+		if (sim.objs[i]->type == type && sim.objs[i]->id == id)
+			return sim.objs[i];
+
+	return NULL;
+}
+
+static struct sim_obj *sim_find_by_name(const uint8_t *type_name, uint32_t id)
+{
+	char name[17];
+	const struct sim_type *type;
+
+	memcpy(name, type_name, 16);
+	name[16] = '\0';
+	type = sim_type_by_name(name);
+	if (!type)
+		return NULL;
+
+	return sim_find(type, id);
+}
+
+static int sim_container_add(struct sim_obj *container, struct sim_obj *obj)
+{
+	int error;
+
+	if (container->num_objs == container->max_objs) {
+		error = grow_array(&container->objs, &container->max_objs,
+				   sizeof(*container->objs));
+		if (error < 0)
+			return error;
+	}
+
+	container->objs[container->num_objs++] = obj;
+	obj->container = container;
+	return 0;
+}
+
+static void sim_container_remove(struct sim_obj *obj)
+{
+	struct sim_obj *container = obj->container;
+	uint32_t i;
+
+	for (i = 0; i < container->num_objs; i++)
+		if (container->objs[i] == obj)
+			break;
+
+	assert(i < container->num_objs);
+	memmove(&container->objs[i], &container->objs[i + 1],
+		(container->num_objs - i - 1) * sizeof(*container->objs));
+	container->num_objs--;
+	obj->container = NULL;
+}
+
+/*
+ * Create an object of the given type in a container, with the next free
+ * id of the type
+ */
+static int sim_create(struct sim_obj *container, const struct sim_type *type,
+		      struct sim_obj **new_obj)
+{
+	struct sim_obj *obj;
+	uint32_t id = 1;
+	int error;
+
+	for (uint32_t i = 0; i < sim.num_objs; i++)
+		if (sim.objs[i]->type == type && sim.objs[i]->id >= id)
+			id = sim.objs[i]->id + 1;
+
+	if (type == sim.root->type && id <= sim.root->id)
+		id = sim.root->id + 1;
+
+	if (sim.num_objs == sim.max_objs) {
+		error = grow_array(&sim.objs, &sim.max_objs,
+				   sizeof(*sim.objs));
+		if (error < 0)
+			return error;
+	}
+
+	obj = calloc(1, sizeof(*obj));
+	if (!obj)
+		return -ENOMEM;
+
+	obj->type = type;
+	obj->id = id;
+	obj->creator = container;
+	obj->created_ns = now_ns();
+	error = sim_container_add(container, obj);
+	if (error < 0) {
+		free(obj);
+		return error;
+	}
+
+	sim.objs[sim.num_objs++] = obj;
+	*new_obj = obj;
+	return 0;
+}
+
+static void sim_disconnect(struct sim_obj *obj, int if_id)
+{
+	uint32_t i = 0;
+
+	while (i < sim.num_conns) {
+		struct sim_connection *conn = &sim.conns[i];
+
+		if ((conn->ep[0].obj == obj &&
+		     (if_id < 0 || conn->ep[0].if_id == if_id)) ||
+		    (conn->ep[1].obj == obj &&
+		     (if_id < 0 || conn->ep[1].if_id == if_id)))
+			*conn = sim.conns[--sim.num_conns];
+		else
+			i++;
+	}
+}
+
+/*
+ * Destroy an object. The objects of a destroyed container go back to its
+ * parent, except the ones created in it, which are destroyed as well.
+ */
+static void sim_destroy(struct sim_obj *obj)
+{
+	while (obj->num_objs != 0) {
+		struct sim_obj *child = obj->objs[obj->num_objs - 1];
+
+		if (child->creator == obj) {
+			sim_destroy(child);
+		} else {
+			sim_container_remove(child);
+			child->state &= ~DPRC_OBJ_STATE_PLUGGED;
+			(void)sim_container_add(obj->container, child);
+		}
+	}
+
+	for (uint32_t i = 0; i < SIM_MAX_TOKENS && sim.tokens; i++)
+		if (sim.tokens[i] == obj)
+			sim.tokens[i] = NULL;
+
+	for (uint32_t i = 0; i < sim.num_objs; i++) {
+		if (sim.objs[i] == obj) {
+			sim.objs[i] = sim.objs[--sim.num_objs];
+			break;
+		}
+	}
+
+	sim_disconnect(obj, -1);
+	sim_container_remove(obj);
+	free(obj->objs);
+	free(obj);
+}
+
+static int sim_connect(struct sim_obj *obj1, uint16_t if_id1,
+		       struct sim_obj *obj2, uint16_t if_id2)
+{
+	struct sim_connection *conn;
+	int error;
+
+	if (sim.num_conns == sim.max_conns) {
+		error = grow_array(&sim.conns, &sim.max_conns,
+				   sizeof(*sim.conns));
+		if (error < 0)
+			return error;
+	}
+
+	conn = &sim.conns[sim.num_conns++];
+	conn->ep[0].obj = obj1;
+	conn->ep[0].if_id = if_id1;
+	conn->ep[1].obj = obj2;
+	conn->ep[1].if_id = if_id2;
+	return 0;
+}
+
+static struct sim_endpoint *sim_peer(struct sim_obj *obj, uint16_t if_id)
+{
+	for (uint32_t i = 0; i < sim.num_conns; i++) {
+		struct sim_connection *conn = &sim.conns[i];
+
+		if (conn->ep[0].obj == obj && conn->ep[0].if_id == if_id)
+			return &conn->ep[1];
+		if (conn->ep[1].obj == obj && conn->ep[1].if_id == if_id)
+			return &conn->ep[0];
+	}
+
+	return NULL;
+}
+
+/*
+ * Create the root container with its dpni objects connected to dpmac
+ * objects, a few objects of each type used by the Linux drivers, and the
+ * requested number of empty child containers
+ */
+static int sim_init(void)
+{
+	static const char * const service_types[] = {
+		"dpio", "dpbp", "dpcon", "dpmcp",
+	};
+	struct sim_obj *ni;
+	struct sim_obj *mac;
+	struct sim_obj *obj;
+	int error;
+
+	sim.tokens = calloc(SIM_MAX_TOKENS, sizeof(*sim.tokens));
+	sim.root = calloc(1, sizeof(*sim.root));
+	if (!sim.tokens || !sim.root)
+		return -ENOMEM;
+
+	sim.root->type = sim_type_by_name("dprc");
+	sim.root->id = SIM_ROOT_DPRC_ID;
+	sim.root->creator = sim.root;
+	sim.root->options = DPRC_CFG_OPT_SPAWN_ALLOWED |
+			    DPRC_CFG_OPT_ALLOC_ALLOWED |
+			    DPRC_CFG_OPT_OBJ_CREATE_ALLOWED |
+			    DPRC_CFG_OPT_TOPOLOGY_CHANGES_ALLOWED |
+			    DPRC_CFG_OPT_IRQ_CFG_ALLOWED;
+	sim.root->icid = 0;
+	sim.root->portal_id = 0;
+	sim.root->created_ns = now_ns();
+
+	for (unsigned int i = 0; i < sim.num_nis; i++) {
+		error = sim_create(sim.root, sim_type_by_name("dpmac"), &mac);
+		if (error < 0)
+			return error;
+
+		error = sim_create(sim.root, sim_type_by_name("dpni"), &ni);
+		if (error < 0)
+			return error;
+
+		error = sim_connect(ni, 0, mac, 0);
+		if (error < 0)
+			return error;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(service_types); i++) {
+		for (unsigned int j = 0; j < SIM_NUM_SERVICE_OBJS; j++) {
+			error = sim_create(sim.root,
+					   sim_type_by_name(service_types[i]),
+					   &obj);
+			if (error < 0)
+				return error;
+		}
+	}
+
+	/*
+	 * The MC creates dpdbg.0 in the root container
+	 */
+	error = sim_create(sim.root, sim_type_by_name("dpdbg"), &obj);
+	if (error < 0)
+		return error;
+
+	obj->id = 0;
+
+	for (unsigned int i = 0; i < sim.num_containers; i++) {
+		error = sim_create(sim.root, sim.root->type, &obj);
+		if (error < 0)
+			return error;
+
+		obj->options = sim.root->options;
+		obj->icid = obj->id;
+		obj->portal_id = obj->id;
+	}
+
+	/*
+	 * Spread the dpni objects over the child containers
+	 */
+	for (unsigned int i = 0; i < sim.num_nis && sim.num_containers; i++) {
+		struct sim_obj *container;
+
+		if (i % (sim.num_containers + 1) == 0)
+			continue;
+
+		ni = sim_find(sim_type_by_name("dpni"), i + 1);
+		container = sim_find(sim.root->type,
+				     SIM_ROOT_DPRC_ID +
+				     i % (sim.num_containers + 1));
+		sim_container_remove(ni);
+		error = sim_container_add(container, ni);
+		if (error < 0)
+			return error;
+	}
+
+	sim.initialized = true;
+	return 0;
+}
+
+static int sim_open_token(struct sim_obj *obj, uint16_t *token)
+{
+	for (uint32_t n = 0; n < SIM_MAX_TOKENS; n++) {
+		uint32_t i = (sim.next_token + n) % SIM_MAX_TOKENS;
+
+		if (!sim.tokens[i]) {
+			sim.tokens[i] = obj;
+			sim.next_token = i + 1;
+			obj->open_count++;
+			*token = i + 1;
+			return 0;
+		}
+	}
+
+	return -EBUSY;
+}
+
+static uint32_t sim_obj_state(const struct sim_obj *obj)
+{
+	return obj->state | (obj->open_count ? DPRC_OBJ_STATE_OPEN : 0);
+}
+
+/*
+ * Made up counter growing with the age of the object
+ */
+static uint64_t sim_counter(const struct sim_obj *obj, unsigned int scale,
+			    unsigned int divisor)
+{
+	uint64_t age_us = (now_ns() - obj->created_ns) / 1000;
+
+	return age_us * (obj->id + 1) * scale / divisor;
+}
+
+static int sim_dprc_command(struct sim_obj *dprc, uint16_t cmd_num,
+			    struct mc_command *cmd)
+{
+	uint64_t params[MC_CMD_NUM_OF_PARAMS];
+	struct sim_obj *obj;
+	struct sim_obj *child;
+	struct sim_endpoint *peer;
+	int error;
+
+	memcpy(params, cmd->params, sizeof(params));
+	memset(cmd->params, 0, sizeof(cmd->params));
+	switch (cmd_num) {
+	case SIM_CMD_NUM(DPRC_CMDID_GET_ATTR): {
+		struct dprc_rsp_get_attributes *rsp = (void *)cmd->params;
+
+		rsp->container_id = cpu_to_le32(dprc->id);
+		rsp->icid = cpu_to_le32(dprc->icid);
+		rsp->options = cpu_to_le32(dprc->options);
+		rsp->portal_id = cpu_to_le32(dprc->portal_id);
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_CREATE_CONT): {
+		struct dprc_cmd_create_container *cmd_params = (void *)params;
+		struct dprc_rsp_create_container *rsp = (void *)cmd->params;
+		uint32_t icid = le32_to_cpu(cmd_params->icid);
+		uint32_t portal_id = le32_to_cpu(cmd_params->portal_id);
+
+		if (!(dprc->options & DPRC_CFG_OPT_SPAWN_ALLOWED))
+			return -EPERM;
+
+		error = sim_create(dprc, dprc->type, &child);
+		if (error < 0)
+			return error;
+
+		child->options = le32_to_cpu(cmd_params->options);
+		child->icid = icid == DPRC_GET_ICID_FROM_POOL ? child->id : icid;
+		child->portal_id = (int)portal_id == DPRC_GET_PORTAL_ID_FROM_POOL ?
+				   child->id : portal_id;
+		memcpy(child->label, cmd_params->label, sizeof(child->label));
+		rsp->child_container_id = cpu_to_le32(child->id);
+		rsp->child_portal_addr =
+			cpu_to_le64(0x80c000000ull + child->portal_id * 0x10000);
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_DESTROY_CONT): {
+		struct dprc_cmd_destroy_container *cmd_params = (void *)params;
+
+		child = sim_find(dprc->type,
+				 le32_to_cpu(cmd_params->child_container_id));
+		if (!child || child->container != dprc)
+			return -ENXIO;
+
+		if (child->open_count)
+			return -EBUSY;
+
+		sim_destroy(child);
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_SET_LOCKED): {
+		struct dprc_cmd_set_locked *cmd_params = (void *)params;
+
+		child = sim_find(dprc->type,
+				 le32_to_cpu(cmd_params->child_container_id));
+		if (!child || child->container != dprc)
+			return -ENXIO;
+
+		child->locked = cmd_params->locked;
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_ASSIGN):
+	case SIM_CMD_NUM(DPRC_CMDID_UNASSIGN): {
+		struct dprc_cmd_assign *cmd_params = (void *)params;
+		uint32_t options = le32_to_cpu(cmd_params->options);
+		struct sim_obj *from;
+		struct sim_obj *to;
+
+		child = sim_find(dprc->type,
+				 le32_to_cpu(cmd_params->container_id));
+		if (!child || (child != dprc && child->container != dprc))
+			return -ENXIO;
+
+		/*
+		 * Only objects can be moved, the simulated MC has no pools of
+		 * resources
+		 */
+		if (!(options & DPRC_RES_REQ_OPT_EXPLICIT))
+			return -ENAVAIL;
+
+		obj = sim_find_by_name(cmd_params->type,
+				       le32_to_cpu(cmd_params->id_base_align));
+		if (!obj || obj->type == dprc->type)
+			return -ENAVAIL;
+
+		if (cmd_num == SIM_CMD_NUM(DPRC_CMDID_ASSIGN)) {
+			from = dprc;
+			to = child;
+		} else {
+			from = child;
+			to = dprc;
+		}
+
+		if (obj->container != from)
+			return -ENAVAIL;
+
+		if (child->locked && child != dprc)
+			return -EACCES;
+
+		if (from != to) {
+			if (obj->state & DPRC_OBJ_STATE_PLUGGED)
+				return -EBUSY;
+
+			sim_container_remove(obj);
+			error = sim_container_add(to, obj);
+			if (error < 0) {
+				(void)sim_container_add(from, obj);
+				return error;
+			}
+		}
+
+		if (cmd_num == SIM_CMD_NUM(DPRC_CMDID_ASSIGN) &&
+		    (options & DPRC_RES_REQ_OPT_PLUGGED))
+			obj->state |= DPRC_OBJ_STATE_PLUGGED;
+		else
+			obj->state &= ~DPRC_OBJ_STATE_PLUGGED;
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_GET_OBJ_COUNT): {
+		struct dprc_rsp_get_obj_count *rsp = (void *)cmd->params;
+
+		rsp->obj_count = cpu_to_le32(dprc->num_objs);
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_GET_OBJ): {
+		struct dprc_cmd_get_obj *cmd_params = (void *)params;
+		struct dprc_rsp_get_obj *rsp = (void *)cmd->params;
+		uint32_t index = le32_to_cpu(cmd_params->obj_index);
+
+		if (index >= dprc->num_objs)
+			return -ENXIO;
+
+		obj = dprc->objs[index];
+		rsp->id = cpu_to_le32(obj->id);
+		rsp->vendor = cpu_to_le16(SIM_VENDOR_ID);
+		rsp->irq_count = obj->type->irq_count;
+		rsp->region_count = obj->type->region_count;
+		rsp->state = cpu_to_le32(sim_obj_state(obj));
+		rsp->version_major = cpu_to_le16(obj->type->ver_major);
+		rsp->version_minor = cpu_to_le16(obj->type->ver_minor);
+		strncpy((char *)rsp->type, obj->type->name, sizeof(rsp->type));
+		memcpy(rsp->label, obj->label, sizeof(rsp->label));
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_SET_OBJ_LABEL): {
+		struct dprc_cmd_set_obj_label *cmd_params = (void *)params;
+
+		obj = sim_find_by_name(cmd_params->obj_type,
+				       le32_to_cpu(cmd_params->obj_id));
+		if (!obj || (obj != dprc && obj->container != dprc))
+			return -ENXIO;
+
+		memcpy(obj->label, cmd_params->label, sizeof(obj->label));
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_CONNECT): {
+		struct dprc_cmd_connect *cmd_params = (void *)params;
+		struct sim_obj *obj2;
+		uint16_t if_id1 = le16_to_cpu(cmd_params->ep1_interface_id);
+		uint16_t if_id2 = le16_to_cpu(cmd_params->ep2_interface_id);
+
+		obj = sim_find_by_name(cmd_params->ep1_type,
+				       le32_to_cpu(cmd_params->ep1_id));
+		obj2 = sim_find_by_name(cmd_params->ep2_type,
+					le32_to_cpu(cmd_params->ep2_id));
+		if (!obj || !obj2)
+			return -ENXIO;
+
+		if (sim_peer(obj, if_id1) || sim_peer(obj2, if_id2))
+			return -EBUSY;
+
+		return sim_connect(obj, if_id1, obj2, if_id2);
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_DISCONNECT): {
+		struct dprc_cmd_disconnect *cmd_params = (void *)params;
+		uint32_t if_id = le32_to_cpu(cmd_params->interface_id);
+
+		obj = sim_find_by_name(cmd_params->type,
+				       le32_to_cpu(cmd_params->id));
+		if (!obj)
+			return -ENXIO;
+
+		if (!sim_peer(obj, if_id))
+			return -ENAVAIL;
+
+		sim_disconnect(obj, if_id);
+		return 0;
+	}
+	case SIM_CMD_NUM(DPRC_CMDID_GET_CONNECTION): {
+		struct dprc_cmd_get_connection *cmd_params = (void *)params;
+		struct dprc_rsp_get_connection *rsp = (void *)cmd->params;
+
+		obj = sim_find_by_name(cmd_params->ep1_type,
+				       le32_to_cpu(cmd_params->ep1_id));
+		if (!obj)
+			return -ENXIO;
+
+		peer = sim_peer(obj,
+				le16_to_cpu(cmd_params->ep1_interface_id));
+		if (!peer) {
+			/* no connection is not an error, only a state */
+			rsp->state = cpu_to_le32(-1);
+			return 0;
+		}
+
+		rsp->ep2_id = cpu_to_le32(peer->obj->id);
+		rsp->ep2_interface_id = cpu_to_le16(peer->if_id);
+		strncpy((char *)rsp->ep2_type, peer->obj->type->name,
+			sizeof(rsp->ep2_type));
+		rsp->state = cpu_to_le32(1);
+		return 0;
+	}
+	default:
+		/*
+		 * The simulated MC has no resource pools: get_res_count,
+		 * get_pool_count and the irq commands return zeroes
+		 */
+		return 0;
+	}
+}
+
+static int sim_obj_command(struct sim_obj *obj, uint16_t cmd_num,
+			   struct mc_command *cmd)
+{
+	uint64_t params[MC_CMD_NUM_OF_PARAMS];
+
+	memcpy(params, cmd->params, sizeof(params));
+	memset(cmd->params, 0, sizeof(cmd->params));
+	if (cmd_num == SIM_CMD_GET_ATTR && obj->type->attr_id_offset >= 0) {
+		uint8_t *rsp = (uint8_t *)cmd->params;
+		uint32_t id = cpu_to_le32(obj->id);
+		uint16_t id16 = cpu_to_le16(obj->id);
+
+		if (obj->type->attr_id_size == sizeof(id16))
+			memcpy(&rsp[obj->type->attr_id_offset], &id16,
+			       sizeof(id16));
+		else
+			memcpy(&rsp[obj->type->attr_id_offset], &id,
+			       sizeof(id));
+
+		if (obj->type->code == 0x2)
+			((struct dpsw_rsp_get_attr *)rsp)->num_ifs =
+				cpu_to_le16(SIM_NUM_IFS);
+		else if (obj->type->code == 0x6)
+			((struct dpdmux_rsp_get_attr *)rsp)->num_ifs =
+				cpu_to_le16(SIM_NUM_IFS);
+	} else if ((obj->type->code == 0x2 &&
+		    cmd_num == SIM_CMD_NUM(DPSW_CMDID_IF_GET_COUNTER)) ||
+		   (obj->type->code == 0x6 &&
+		    cmd_num == SIM_CMD_NUM(DPDMUX_CMDID_IF_GET_COUNTER))) {
+		struct dpsw_cmd_if_get_counter *cmd_params = (void *)params;
+		struct dpsw_rsp_if_get_counter *rsp = (void *)cmd->params;
+		uint16_t if_id = le16_to_cpu(cmd_params->if_id);
+
+		/* both commands have the same layout */
+		if (if_id > SIM_NUM_IFS)
+			return -EINVAL;
+
+		rsp->counter = cpu_to_le64(sim_counter(obj, if_id + 1,
+						       cmd_params->type + 1));
+	} else if (obj->type->code == 0x1 &&
+	    cmd_num == SIM_CMD_NUM(DPNI_CMDID_GET_STATISTICS)) {
+		struct dpni_cmd_get_statistics *cmd_params = (void *)params;
+		struct dpni_rsp_get_statistics *rsp = (void *)cmd->params;
+		unsigned int page = cmd_params->page_number;
+
+		/*
+		 * Pages hold pairs of frame and byte counters
+		 */
+		for (unsigned int i = 0; i < ARRAY_SIZE(rsp->counter); i++)
+			rsp->counter[i] = cpu_to_le64(
+				sim_counter(obj, i % 2 ? 512 : 1,
+					    (i / 2 + 1) * (page + 1)));
+	} else if (obj->type->code == 0xc &&
+		   cmd_num == SIM_CMD_NUM(DPMAC_CMDID_GET_COUNTER)) {
+		struct dpmac_cmd_get_counter *cmd_params = (void *)params;
+		struct dpmac_rsp_get_counter *rsp = (void *)cmd->params;
+
+		rsp->counter = cpu_to_le64(sim_counter(obj, 1,
+						       cmd_params->type + 1));
+	} else if (obj->type->code == 0xf &&
+		   cmd_num == SIM_CMD_NUM(DPDBG_CMDID_GET_CTLU_PROFILING)) {
+		struct dpdbg_cmd_get_ctlu_profiling_counters *cmd_params =
+			(void *)params;
+		struct dpdbg_rsp_get_ctlu_profiling_counters *rsp =
+			(void *)cmd->params;
+		unsigned int divisor = (cmd_params->ctlu_type & 0x7) + 1;
+
+		/*
+		 * 32 bit counters, hits are a fraction of the lookups
+		 */
+		rsp->rule_lookups = cpu_to_le32(sim_counter(obj, 10, divisor));
+		rsp->rule_hits = cpu_to_le32(sim_counter(obj, 9, divisor));
+		rsp->entry_lookups = cpu_to_le32(sim_counter(obj, 30, divisor));
+		rsp->entry_hits = cpu_to_le32(sim_counter(obj, 12, divisor));
+		rsp->cache_accesses = cpu_to_le32(sim_counter(obj, 30, divisor));
+		rsp->cache_hits = cpu_to_le32(sim_counter(obj, 27, divisor));
+		rsp->cache_updates = cpu_to_le32(sim_counter(obj, 3, divisor));
+		rsp->memory_accesses =
+			cpu_to_le32(sim_counter(obj, 25, divisor));
+	} else if (obj->type->code == 0x7 &&
+		   cmd_num == SIM_CMD_NUM(DPCI_CMDID_GET_PEER_ATTR)) {
+		struct dpci_rsp_get_peer_attr *rsp = (void *)cmd->params;
+		struct sim_endpoint *peer = sim_peer(obj, 0);
+
+		/* a DPCI peer is the DPCI it is connected to */
+		if (peer && peer->obj->type == obj->type)
+			rsp->id = cpu_to_le32(peer->obj->id);
+		else
+			rsp->id = cpu_to_le32(-1);
+	}
+
+	return 0;
+}
+
+static int sim_command(uint16_t token, uint16_t cmd_num,
+		       struct mc_command *cmd)
+{
+	const struct sim_type *type;
+	struct sim_obj *container = NULL;
+	struct sim_obj *obj = NULL;
+	uint32_t id = le32_to_cpu(*(uint32_t *)cmd->params);
+
+	if (token != 0) {
+		obj = sim.tokens[token - 1];
+		if (!obj)
+			return -EACCES;
+	}
+
+	if (cmd_num == SIM_CMD_NUM(DPMNG_CMDID_GET_VERSION)) {
+		struct dpmng_rsp_get_version *rsp = (void *)cmd->params;
+
+		memset(cmd->params, 0, sizeof(cmd->params));
+		rsp->revision = cpu_to_le32(SIM_MC_VERSION_REVISION);
+		rsp->version_major = cpu_to_le32(SIM_MC_VERSION_MAJOR);
+		rsp->version_minor = cpu_to_le32(SIM_MC_VERSION_MINOR);
+		return 0;
+	}
+
+	if (cmd_num == SIM_CMD_CLOSE) {
+		if (!obj)
+			return -EACCES;
+
+		sim.tokens[token - 1] = NULL;
+		obj->open_count--;
+		return 0;
+	}
+
+	if (obj && obj->type == sim.root->type)
+		container = obj;
+
+	type = sim_type_by_code(cmd_num & SIM_CMD_TYPE_MASK);
+	switch (cmd_num & ~SIM_CMD_TYPE_MASK) {
+	case SIM_CMD_OPEN: {
+		struct sim_obj *target;
+		uint16_t new_token;
+		int error;
+
+		if (!type)
+			break;
+
+		target = sim_find(type, id);
+		if (!target)
+			return -ENXIO;
+
+		error = sim_open_token(target, &new_token);
+		if (error < 0)
+			return error;
+
+		memset(cmd->params, 0, sizeof(cmd->params));
+		((struct mc_cmd_header *)&cmd->header)->token =
+			cpu_to_le16(new_token);
+		return 0;
+	}
+	case SIM_CMD_CREATE: {
+		struct sim_obj *new_obj;
+		int error;
+
+		if (!type || type == sim.root->type)
+			break;
+		if (!container)
+			return -EACCES;
+		if (!(container->options & DPRC_CFG_OPT_OBJ_CREATE_ALLOWED))
+			return -EPERM;
+
+		error = sim_create(container, type, &new_obj);
+		if (error < 0)
+			return error;
+
+		memset(cmd->params, 0, sizeof(cmd->params));
+		cmd->params[0] = cpu_to_le64(new_obj->id);
+		return 0;
+	}
+	case SIM_CMD_DESTROY: {
+		struct sim_obj *target;
+
+		if (!type || type == sim.root->type)
+			break;
+		if (!container)
+			return -EACCES;
+
+		target = sim_find(type, id);
+		if (!target || target->container != container)
+			return -ENXIO;
+		if (target->open_count)
+			return -EBUSY;
+
+		sim_destroy(target);
+		memset(cmd->params, 0, sizeof(cmd->params));
+		return 0;
+	}
+	case SIM_CMD_GET_API_VERSION: {
+		struct dprc_rsp_get_api_version *rsp = (void *)cmd->params;
+
+		if (!type)
+			break;
+
+		memset(cmd->params, 0, sizeof(cmd->params));
+		rsp->major = cpu_to_le16(type->ver_major);
+		rsp->minor = cpu_to_le16(type->ver_minor);
+		return 0;
+	}
+	}
+
+	if (cmd_num == SIM_CMD_NUM(DPRC_CMDID_GET_CONT_ID)) {
+		memset(cmd->params, 0, sizeof(cmd->params));
+		cmd->params[0] = cpu_to_le64(sim.root->id);
+		return 0;
+	}
+
+	if (cmd_num == SIM_CMD_NUM(DPMNG_CMDID_GET_SOC_VERSION)) {
+		memset(cmd->params, 0, sizeof(cmd->params));
+		return 0;
+	}
+
+	if (!obj)
+		return -EACCES;
+
+	if (container)
+		return sim_dprc_command(container, cmd_num, cmd);
+
+	return sim_obj_command(obj, cmd_num, cmd);
+}
+
+static enum mc_cmd_status sim_error_to_status(int error)
+{
+	switch (error) {
+	case 0:
+		return MC_CMD_STATUS_OK;
+	case -EACCES:
+		return MC_CMD_STATUS_AUTH_ERR;
+	case -EPERM:
+		return MC_CMD_STATUS_NO_PRIVILEGE;
+	case -ENXIO:
+		return MC_CMD_STATUS_CONFIG_ERR;
+	case -ENAVAIL:
+		return MC_CMD_STATUS_NO_RESOURCE;
+	case -ENOMEM:
+		return MC_CMD_STATUS_NO_MEMORY;
+	case -EBUSY:
+		return MC_CMD_STATUS_BUSY;
+	default:
+		return MC_CMD_STATUS_INVALID_STATE;
+	}
+}
+
+static int sim_send_command(struct fsl_mc_io *mc_io, struct mc_command *cmd)
+{
+	struct mc_cmd_header *hdr = (struct mc_cmd_header *)&cmd->header;
+	uint16_t cmd_id = le16_to_cpu(hdr->cmd_id);
+	int error;
+
+	(void)mc_io;
+	pthread_mutex_lock(&sim.lock);
+	error = sim_command(le16_to_cpu(hdr->token), SIM_CMD_NUM(cmd_id), cmd);
+	pthread_mutex_unlock(&sim.lock);
+
+	hdr->status = sim_error_to_status(error);
+	if (error < 0)
+		DEBUG_PRINTF("simulated MC command %#x failed with error %d\n",
+			     cmd_id, error);
+
+	return error;
+}
+
+static int sim_open(struct fsl_mc_io *mc_io)
+{
+	int error = 0;
+
+	pthread_mutex_lock(&sim.lock);
+	if (!sim.initialized)
+		error = sim_init();
+	pthread_mutex_unlock(&sim.lock);
+
+	mc_io->fd = -1;
+	return error;
+}
+
+static void sim_close(struct fsl_mc_io *mc_io)
+{
+	(void)mc_io;
+}
+
+static int sim_get_root_dprc_id(struct fsl_mc_io *mc_io,
+				uint32_t *root_dprc_id)
+{
+	(void)mc_io;
+	*root_dprc_id = SIM_ROOT_DPRC_ID;
+	return 0;
+}
+
+const struct fsl_mc_transport mc_sim_transport = {
+	.name = "sim",
+	.open = sim_open,
+	.close = sim_close,
+	.send_command = sim_send_command,
+	.get_root_dprc_id = sim_get_root_dprc_id,
+};
+
+/**
+ * Set up the default layout of the simulated MC from the parameters of
+ * --device=sim[:<num-nis>[:<num-containers>]]. Must be called before the
+ * first portal is opened.
+ */
+int mc_sim_configure(const char *params)
+{
+	unsigned long val[2] = { SIM_DEFAULT_NUM_NIS, 0 };
+	static const unsigned long max[2] = {
+		SIM_MAX_NUM_NIS, SIM_MAX_NUM_CONTAINERS
+	};
+	const char *p = params;
+	char *endptr;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(val) && p && *p; i++) {
+		errno = 0;
+		val[i] = strtoul(p, &endptr, 0);
+		if (errno || endptr == p || (*endptr && *endptr != ':') ||
+		    val[i] > max[i]) {
+			ERROR_PRINTF("Invalid simulated MC parameters: '%s'\n",
+				     params);
+			return -EINVAL;
+		}
+
+		p = *endptr ? endptr + 1 : NULL;
+	}
+
+	if (p && *p) {
+		ERROR_PRINTF("Invalid simulated MC parameters: '%s'\n", params);
+		return -EINVAL;
+	}
+
+	assert(!sim.initialized);
+	sim.num_nis = val[0];
+	sim.num_containers = val[1];
+	return 0;
+}
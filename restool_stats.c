@@ -0,0 +1,208 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+
+/**
+ * Number of distinct MC command ids tracked, must be a power of 2
+ */
+#define MC_STATS_MAX_CMDS	256
+
+/**
+ * Number of latency histogram buckets: bucket 0 counts commands that took
+ * less than 2us, bucket i those that took [2^i, 2^(i+1)) us and the last
+ * bucket everything slower
+ */
+#define MC_STATS_NUM_BUCKETS	24
+
+/**
+ * struct mc_cmd_stats - statistics of one MC command id
+ * @cmd_id: command id, as found in the command header
+ * @calls: number of commands sent
+ * @errors: number of commands that failed
+ * @total_ns: time spent in the MC, in ns
+ * @min_ns: shortest command, in ns
+ * @max_ns: longest command, in ns
+ * @histogram: number of commands per latency bucket
+ */
+struct mc_cmd_stats {
+	uint16_t cmd_id;
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t total_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+	uint64_t histogram[MC_STATS_NUM_BUCKETS];
+};
+
+static struct mc_cmd_stats mc_stats[MC_STATS_MAX_CMDS];
+static unsigned int mc_stats_num_cmds;
+static pthread_mutex_t mc_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Record one MC command that took 'ns' nanoseconds
+ */
+void mc_stats_record(uint16_t cmd_id, uint64_t ns, bool failed)
+{
+	struct mc_cmd_stats *stats = NULL;
+	unsigned int bucket = 0;
+	unsigned int i;
+
+	for (uint64_t us = ns / 1000; us > 1 &&
+	     bucket < MC_STATS_NUM_BUCKETS - 1; us >>= 1)
+		bucket++;
+
+	pthread_mutex_lock(&mc_stats_lock);
+	i = (cmd_id * 2654435761u) & (MC_STATS_MAX_CMDS - 1);
+	for (unsigned int n = 0; n < MC_STATS_MAX_CMDS; n++) {
+		stats = &mc_stats[(i + n) & (MC_STATS_MAX_CMDS - 1)];
+		if (stats->calls == 0 || stats->cmd_id == cmd_id)
+			break;
+		stats = NULL;
+	}
+
+	if (stats) {
+		if (stats->calls == 0) {
+			stats->cmd_id = cmd_id;
+			stats->min_ns = ns;
+			mc_stats_num_cmds++;
+		}
+
+		stats->calls++;
+		if (failed)
+			stats->errors++;
+		stats->total_ns += ns;
+		if (ns < stats->min_ns)
+			stats->min_ns = ns;
+		if (ns > stats->max_ns)
+			stats->max_ns = ns;
+		stats->histogram[bucket]++;
+	}
+	pthread_mutex_unlock(&mc_stats_lock);
+}
+
+void mc_stats_reset(void)
+{
+	pthread_mutex_lock(&mc_stats_lock);
+	memset(mc_stats, 0, sizeof(mc_stats));
+	mc_stats_num_cmds = 0;
+	pthread_mutex_unlock(&mc_stats_lock);
+}
+
+static int compare_total_time(const void *a, const void *b)
+{
+	const struct mc_cmd_stats *stats_a = a;
+	const struct mc_cmd_stats *stats_b = b;
+
+	if (stats_a->total_ns != stats_b->total_ns)
+		return stats_a->total_ns < stats_b->total_ns ? 1 : -1;
+
+	return (int)stats_a->cmd_id - (int)stats_b->cmd_id;
+}
+
+/**
+ * Print the statistics of the MC commands sent since the last reset,
+ * slowest command ids first
+ */
+void mc_stats_print(FILE *fp)
+{
+	struct mc_cmd_stats *sorted;
+	uint64_t total_calls = 0;
+	uint64_t total_ns = 0;
+	unsigned int n = 0;
+
+	pthread_mutex_lock(&mc_stats_lock);
+	sorted = malloc(sizeof(*sorted) * (mc_stats_num_cmds + 1));
+	if (!sorted) {
+		pthread_mutex_unlock(&mc_stats_lock);
+		return;
+	}
+
+	for (unsigned int i = 0; i < MC_STATS_MAX_CMDS; i++) {
+		if (mc_stats[i].calls != 0)
+			sorted[n++] = mc_stats[i];
+	}
+	pthread_mutex_unlock(&mc_stats_lock);
+
+	qsort(sorted, n, sizeof(*sorted), compare_total_time);
+
+	fprintf(fp, "MC command statistics:\n");
+	fprintf(fp, "%-8s %8s %6s %12s %10s %10s %10s\n", "cmd_id",
+		"calls", "errors", "total(us)", "min(us)", "avg(us)",
+		"max(us)");
+	for (unsigned int i = 0; i < n; i++) {
+		struct mc_cmd_stats *stats = &sorted[i];
+
+		total_calls += stats->calls;
+		total_ns += stats->total_ns;
+		fprintf(fp, "%#-8x %8llu %6llu %12.1f %10.1f %10.1f %10.1f\n",
+			stats->cmd_id,
+			(unsigned long long)stats->calls,
+			(unsigned long long)stats->errors,
+			stats->total_ns / 1000.0,
+			stats->min_ns / 1000.0,
+			stats->total_ns / 1000.0 / stats->calls,
+			stats->max_ns / 1000.0);
+	}
+
+	fprintf(fp, "%-8s %8llu %6s %12.1f\n", "total",
+		(unsigned long long)total_calls, "", total_ns / 1000.0);
+
+	fprintf(fp, "\nMC command latency histograms (us):\n");
+	for (unsigned int i = 0; i < n; i++) {
+		struct mc_cmd_stats *stats = &sorted[i];
+
+		fprintf(fp, "%#-8x", stats->cmd_id);
+		for (unsigned int j = 0; j < MC_STATS_NUM_BUCKETS; j++) {
+			if (stats->histogram[j] == 0)
+				continue;
+
+			if (j == 0)
+				fprintf(fp, " [0-2):");
+			else if (j == MC_STATS_NUM_BUCKETS - 1)
+				fprintf(fp, " [%u-):", 1u << j);
+			else
+				fprintf(fp, " [%u-%u):", 1u << j,
+					1u << (j + 1));
+
+			fprintf(fp, "%llu",
+				(unsigned long long)stats->histogram[j]);
+		}
+		fprintf(fp, "\n");
+	}
+
+	free(sorted);
+}
@@ -0,0 +1,509 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "restool.h"
+#include "utils.h"
+
+/**
+ * struct topology_entry - object found while walking the container tree
+ * @desc: object descriptor as returned by dprc_get_obj()
+ * @parent_dprc_id: id of the container holding the object
+ * @index: index of the object in its parent container
+ * @next: next entry in the same hash bucket, -1 for none
+ * @verified: the entry is known to match the MC, always true for an
+ *	index built by this process
+ */
+struct topology_entry {
+	struct dprc_obj_desc desc;
+	uint32_t parent_dprc_id;
+	int index;
+	int next;
+	int verified;
+};
+
+#define TOPOLOGY_CACHE_MAGIC	0x54505352	/* "RSPT" */
+#define TOPOLOGY_CACHE_VERSION	1
+
+/**
+ * struct topology_cache_header - header of RESTOOL_TOPOLOGY_CACHE
+ *
+ * The header is followed by the entries of the index and then by its
+ * hash buckets, so that the file can be used in place once mapped.
+ */
+struct topology_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_size;
+	uint32_t mc_fw_major;
+	uint32_t mc_fw_minor;
+	uint32_t mc_fw_revision;
+	uint32_t root_dprc_id;
+	uint32_t root_obj_count;
+	uint32_t num_entries;
+	uint32_t num_buckets;
+};
+
+/**
+ * struct topology - index of all objects below the root container
+ * @valid: the index reflects the container tree
+ * @entries: objects, in depth-first order
+ * @num_entries: number of valid entries
+ * @max_entries: number of allocated entries
+ * @buckets: first entry of each hash bucket, -1 for none
+ * @num_buckets: number of hash buckets, a power of 2
+ * @root_obj_count: number of objects in the root container
+ * @cache: mapping of RESTOOL_TOPOLOGY_CACHE the entries and buckets
+ *	point into, NULL if they were allocated by this process
+ * @cache_size: size of the mapping
+ */
+struct topology {
+	bool valid;
+	struct topology_entry *entries;
+	unsigned int num_entries;
+	unsigned int max_entries;
+	int *buckets;
+	unsigned int num_buckets;
+	int root_obj_count;
+	void *cache;
+	size_t cache_size;
+};
+
+static struct topology topology;
+
+static uint32_t topology_hash(const char *type, uint32_t id)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*type != '\0') {
+		hash ^= (uint8_t)*type++;
+		hash *= 16777619u;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		hash ^= (id >> (i * 8)) & 0xff;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static int topology_add(const struct dprc_obj_desc *desc,
+			uint32_t parent_dprc_id, int index)
+{
+	struct topology_entry *entry;
+
+	if (topology.num_entries == topology.max_entries) {
+		unsigned int max_entries = topology.max_entries ?
+					   topology.max_entries * 2 : 64;
+
+		entry = realloc(topology.entries,
+				max_entries * sizeof(*entry));
+		if (!entry)
+			return -ENOMEM;
+
+		topology.entries = entry;
+		topology.max_entries = max_entries;
+	}
+
+	entry = &topology.entries[topology.num_entries++];
+	entry->desc = *desc;
+	entry->parent_dprc_id = parent_dprc_id;
+	entry->index = index;
+	entry->next = -1;
+	entry->verified = true;
+	return 0;
+}
+
+static void topology_unmap_cache(void)
+{
+	if (!topology.cache)
+		return;
+
+	munmap(topology.cache, topology.cache_size);
+	topology.cache = NULL;
+	topology.entries = NULL;
+	topology.num_entries = 0;
+	topology.max_entries = 0;
+	topology.buckets = NULL;
+	topology.num_buckets = 0;
+}
+
+/**
+ * Map RESTOOL_TOPOLOGY_CACHE and use it as index if it was written for
+ * the same MC firmware and root container, and if the root container
+ * still holds the same number of objects. Entries are checked against
+ * the MC when they are looked up.
+ */
+static int topology_load_cache(void)
+{
+	struct topology_cache_header *header;
+	struct stat st;
+	size_t size;
+	void *cache;
+	int error;
+	int num_child_devices;
+	int fd;
+
+	/*
+	 * The cache file describes the MC behind the fsl-mc bus
+	 */
+	if (restool.mc_io.transport != &mc_ioctl_transport)
+		return -ENOENT;
+
+	fd = open(RESTOOL_TOPOLOGY_CACHE, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &st) < 0) {
+		error = -errno;
+		close(fd);
+		return error;
+	}
+
+	if ((size_t)st.st_size < sizeof(*header)) {
+		close(fd);
+		return -EINVAL;
+	}
+
+	/*
+	 * The mapping is private, so that entries can be marked as
+	 * verified without touching the file
+	 */
+	cache = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		     fd, 0);
+	close(fd);
+	if (cache == MAP_FAILED)
+		return -errno;
+
+	header = cache;
+	size = sizeof(*header) +
+	       (size_t)header->num_entries * sizeof(struct topology_entry) +
+	       (size_t)header->num_buckets * sizeof(int);
+	if (header->magic != TOPOLOGY_CACHE_MAGIC ||
+	    header->version != TOPOLOGY_CACHE_VERSION ||
+	    header->entry_size != sizeof(struct topology_entry) ||
+	    header->mc_fw_major != restool.mc_fw_version.major ||
+	    header->mc_fw_minor != restool.mc_fw_version.minor ||
+	    header->mc_fw_revision != restool.mc_fw_version.revision ||
+	    header->root_dprc_id != restool.root_dprc_id ||
+	    header->num_buckets == 0 ||
+	    (header->num_buckets & (header->num_buckets - 1)) != 0 ||
+	    size != (size_t)st.st_size) {
+		munmap(cache, st.st_size);
+		return -EINVAL;
+	}
+
+	error = dprc_get_obj_count(&restool.mc_io, 0, restool.root_dprc_handle,
+				   &num_child_devices);
+	if (error < 0 || num_child_devices != (int)header->root_obj_count) {
+		munmap(cache, st.st_size);
+		return -ESTALE;
+	}
+
+	topology_unmap_cache();
+	free(topology.entries);
+	free(topology.buckets);
+	topology.cache = cache;
+	topology.cache_size = st.st_size;
+	topology.entries = (struct topology_entry *)(header + 1);
+	topology.num_entries = header->num_entries;
+	topology.max_entries = header->num_entries;
+	topology.buckets = (int *)(topology.entries + header->num_entries);
+	topology.num_buckets = header->num_buckets;
+	topology.root_obj_count = header->root_obj_count;
+	for (unsigned int i = 0; i < topology.num_entries; i++)
+		topology.entries[i].verified = false;
+
+	DEBUG_PRINTF("topology index loaded from %s with %u objects\n",
+		     RESTOOL_TOPOLOGY_CACHE, topology.num_entries);
+	topology.valid = true;
+	return 0;
+}
+
+/**
+ * Save the index to RESTOOL_TOPOLOGY_CACHE. The file is replaced
+ * atomically, so that concurrent restool runs never see a partial file.
+ */
+static void topology_save_cache(void)
+{
+	struct topology_cache_header header;
+	char tmp_path[] = RESTOOL_TOPOLOGY_CACHE ".XXXXXX";
+	bool ok = true;
+	FILE *fp;
+	int fd;
+
+	if (restool.mc_io.transport != &mc_ioctl_transport)
+		return;
+
+	fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		DEBUG_PRINTF("cannot create %s (error %d)\n", tmp_path, -errno);
+		return;
+	}
+
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd);
+		unlink(tmp_path);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TOPOLOGY_CACHE_MAGIC;
+	header.version = TOPOLOGY_CACHE_VERSION;
+	header.entry_size = sizeof(struct topology_entry);
+	header.mc_fw_major = restool.mc_fw_version.major;
+	header.mc_fw_minor = restool.mc_fw_version.minor;
+	header.mc_fw_revision = restool.mc_fw_version.revision;
+	header.root_dprc_id = restool.root_dprc_id;
+	header.root_obj_count = topology.root_obj_count;
+	header.num_entries = topology.num_entries;
+	header.num_buckets = topology.num_buckets;
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+	    fwrite(topology.entries, sizeof(struct topology_entry),
+		   topology.num_entries, fp) != topology.num_entries ||
+	    fwrite(topology.buckets, sizeof(int), topology.num_buckets,
+		   fp) != topology.num_buckets)
+		ok = false;
+
+	if (fclose(fp) != 0)
+		ok = false;
+
+	if (!ok || rename(tmp_path, RESTOOL_TOPOLOGY_CACHE) < 0) {
+		DEBUG_PRINTF("cannot write %s\n", RESTOOL_TOPOLOGY_CACHE);
+		unlink(tmp_path);
+	}
+}
+
+static int topology_build(void)
+{
+	unsigned int num_buckets = 64;
+	struct walk_result walk;
+	int error;
+
+	topology.valid = false;
+	topology_unmap_cache();
+	topology.num_entries = 0;
+	error = walk_containers(restool.root_dprc_id, restool.root_dprc_handle,
+				0, &walk);
+	for (unsigned int i = 0; i < walk.num_containers && error == 0; i++) {
+		struct walk_container *container = &walk.containers[i];
+
+		for (int j = 0; j < container->num_objs && error == 0; j++)
+			error = topology_add(&container->objs[j],
+					     container->id, j);
+	}
+
+	if (error == 0)
+		topology.root_obj_count = walk.containers[0].num_objs;
+
+	walk_free(&walk);
+	if (error < 0)
+		return error;
+
+	while (num_buckets < 2 * topology.num_entries)
+		num_buckets *= 2;
+
+	if (num_buckets != topology.num_buckets) {
+		int *buckets = realloc(topology.buckets,
+				       num_buckets * sizeof(*buckets));
+
+		if (!buckets)
+			return -ENOMEM;
+
+		topology.buckets = buckets;
+		topology.num_buckets = num_buckets;
+	}
+
+	for (unsigned int i = 0; i < num_buckets; i++)
+		topology.buckets[i] = -1;
+
+	for (unsigned int i = 0; i < topology.num_entries; i++) {
+		struct topology_entry *entry = &topology.entries[i];
+		uint32_t bucket = topology_hash(entry->desc.type,
+						entry->desc.id) &
+				  (num_buckets - 1);
+
+		entry->next = topology.buckets[bucket];
+		topology.buckets[bucket] = i;
+	}
+
+	DEBUG_PRINTF("topology index built with %u objects\n",
+		     topology.num_entries);
+	topology.valid = true;
+	topology_save_cache();
+	return 0;
+}
+
+static int topology_find(const char *obj_type, uint32_t obj_id)
+{
+	unsigned int num_steps = 0;
+	int i;
+
+	i = topology.buckets[topology_hash(obj_type, obj_id) &
+			     (topology.num_buckets - 1)];
+	for ( ; i >= 0; i = topology.entries[i].next) {
+		struct topology_entry *entry = &topology.entries[i];
+
+		/* do not trust the chains read from the cache file */
+		if ((unsigned int)i >= topology.num_entries ||
+		    ++num_steps > topology.num_entries)
+			return -1;
+
+		if ((uint32_t)entry->desc.id == obj_id &&
+		    strcmp(entry->desc.type, obj_type) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Check that an entry loaded from the cache file still matches the MC,
+ * by reading the object found at the same index of the same container,
+ * and refresh its descriptor.
+ */
+static bool topology_verify(struct topology_entry *entry)
+{
+	struct dprc_obj_desc obj_desc;
+	uint16_t dprc_handle;
+	int error;
+
+	if (entry->verified)
+		return true;
+
+	if (entry->parent_dprc_id == restool.root_dprc_id) {
+		dprc_handle = restool.root_dprc_handle;
+	} else {
+		error = open_dprc(entry->parent_dprc_id, &dprc_handle);
+		if (error < 0)
+			return false;
+	}
+
+	error = dprc_get_obj(&restool.mc_io, 0, dprc_handle, entry->index,
+			     &obj_desc);
+
+	if (entry->parent_dprc_id != restool.root_dprc_id)
+		(void)dprc_close(&restool.mc_io, 0, dprc_handle);
+
+	if (error < 0 || obj_desc.id != entry->desc.id ||
+	    strcmp(obj_desc.type, entry->desc.type) != 0)
+		return false;
+
+	entry->desc = obj_desc;
+	entry->verified = true;
+	return true;
+}
+
+/**
+ * Look up an object below the root container. The index is loaded from
+ * RESTOOL_TOPOLOGY_CACHE if possible, and the container tree is walked
+ * again only if the cache file is missing or out of date. The root
+ * container itself is not part of the index.
+ *
+ * Returns 0 if the object was found, -ENOENT if it does not exist, another
+ * negative value if the container tree could not be walked.
+ */
+int topology_lookup(const char *obj_type, uint32_t obj_id,
+		    struct dprc_obj_desc *obj_desc, uint32_t *parent_dprc_id)
+{
+	struct topology_entry *entry;
+	int error;
+	int i;
+
+	if (!topology.valid && topology_load_cache() < 0) {
+		error = topology_build();
+		if (error < 0)
+			return error;
+	}
+
+	i = topology_find(obj_type, obj_id);
+	if (topology.cache &&
+	    (i < 0 || !topology_verify(&topology.entries[i]))) {
+		DEBUG_PRINTF("%s is out of date\n", RESTOOL_TOPOLOGY_CACHE);
+		error = topology_build();
+		if (error < 0)
+			return error;
+
+		i = topology_find(obj_type, obj_id);
+	}
+
+	if (i < 0)
+		return -ENOENT;
+
+	entry = &topology.entries[i];
+	if (obj_desc)
+		*obj_desc = entry->desc;
+	if (parent_dprc_id)
+		*parent_dprc_id = entry->parent_dprc_id;
+	return 0;
+}
+
+/**
+ * Drop the index, so that the next lookup checks the objects it finds
+ * against the MC again
+ */
+void topology_invalidate(void)
+{
+	topology.valid = false;
+}
+
+/**
+ * Tell whether a command leaves the container tree untouched, so that the
+ * index can be kept for the next command run by the same process
+ */
+bool topology_cmd_is_read_only(const char *cmd_name)
+{
+	static const char *const read_only_cmds[] = {
+		"help",
+		"info",
+		"show",
+		"list",
+		"generate-dpl",
+	};
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(read_only_cmds); i++) {
+		if (strcmp(cmd_name, read_only_cmds[i]) == 0)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,570 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Capture of the MC commands sent by restool (--record) and transport
+ * answering MC commands from such a capture (--device=replay:<file>).
+ *
+ * A trace is a struct mc_trace_header followed by struct mc_trace_record
+ * entries in the order the responses were received. Each command record
+ * holds the request and the response of one MC command, with the MC
+ * portal it was sent on, so that tokens of different portals are not
+ * mixed up on replay.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+
+#define MC_TRACE_MAGIC		"MCTRACE"
+#define MC_TRACE_VERSION	1
+
+/*
+ * Record kinds
+ */
+#define MC_TRACE_COMMAND	1	/* MC command and its response */
+#define MC_TRACE_ROOT_DPRC	2	/* root container id in params[0] */
+
+#define MC_TRACE_MAX_TOKENS	UINT16_MAX
+
+/*
+ * MC close command number, shared by all object types
+ */
+#define MC_TRACE_CMD_CLOSE	0x800
+
+#pragma pack(push, 1)
+/**
+ * struct mc_trace_header - header of a trace file
+ * @magic: MC_TRACE_MAGIC
+ * @version: MC_TRACE_VERSION
+ * @record_size: size of struct mc_trace_record
+ */
+struct mc_trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+/**
+ * struct mc_trace_record - record of a trace file, integers are little
+ * endian, MC commands are stored as sent to the MC
+ * @kind: MC_TRACE_COMMAND or MC_TRACE_ROOT_DPRC
+ * @portal: MC portal the command was sent on
+ * @timestamp_ns: time the command was sent, from the start of the trace
+ * @latency_ns: time the MC took to answer
+ * @error: value returned by the transport
+ * @pad: reserved, 0
+ * @request: command as sent
+ * @response: command as received
+ */
+struct mc_trace_record {
+	uint32_t kind;
+	int32_t portal;
+	uint64_t timestamp_ns;
+	uint64_t latency_ns;
+	int32_t error;
+	uint32_t pad;
+	struct mc_command request;
+	struct mc_command response;
+};
+#pragma pack(pop)
+
+static struct {
+	pthread_mutex_t lock;
+	FILE *fp;
+	uint64_t start_ns;
+	bool failed;
+} mc_trace = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/**
+ * Start recording the MC commands sent to 'path'
+ */
+int mc_trace_open(const char *path)
+{
+	struct mc_trace_header header;
+
+	mc_trace.fp = fopen(path, "we");
+	if (!mc_trace.fp) {
+		ERROR_PRINTF("cannot open %s: %s\n", path, strerror(errno));
+		return -errno;
+	}
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, MC_TRACE_MAGIC);
+	header.version = htole32(MC_TRACE_VERSION);
+	header.record_size = htole32(sizeof(struct mc_trace_record));
+	if (fwrite(&header, sizeof(header), 1, mc_trace.fp) != 1)
+		mc_trace.failed = true;
+
+	mc_trace.start_ns = now_ns();
+	restool.record = true;
+	return 0;
+}
+
+static void mc_trace_write(struct mc_trace_record *record)
+{
+	pthread_mutex_lock(&mc_trace.lock);
+	if (mc_trace.fp && fwrite(record, sizeof(*record), 1, mc_trace.fp) != 1)
+		mc_trace.failed = true;
+	pthread_mutex_unlock(&mc_trace.lock);
+}
+
+/**
+ * Record an MC command sent on 'portal' at 'start_ns', whose response took
+ * 'latency_ns'
+ */
+void mc_trace_record(int portal, const struct mc_command *request,
+		     const struct mc_command *response, int error,
+		     uint64_t start_ns, uint64_t latency_ns)
+{
+	struct mc_trace_record record;
+
+	memset(&record, 0, sizeof(record));
+	record.kind = htole32(MC_TRACE_COMMAND);
+	record.portal = htole32(portal);
+	record.timestamp_ns = htole64(start_ns - mc_trace.start_ns);
+	record.latency_ns = htole64(latency_ns);
+	record.error = htole32(error);
+	record.request = *request;
+	record.response = *response;
+	mc_trace_write(&record);
+}
+
+/**
+ * Record the id of the root container, which does not come from an MC
+ * command
+ */
+void mc_trace_record_root(uint32_t root_dprc_id)
+{
+	struct mc_trace_record record;
+
+	memset(&record, 0, sizeof(record));
+	record.kind = htole32(MC_TRACE_ROOT_DPRC);
+	record.timestamp_ns = htole64(now_ns() - mc_trace.start_ns);
+	record.response.params[0] = htole64(root_dprc_id);
+	mc_trace_write(&record);
+}
+
+/**
+ * Write the records buffered so far
+ */
+void mc_trace_flush(void)
+{
+	pthread_mutex_lock(&mc_trace.lock);
+	if (mc_trace.fp && fflush(mc_trace.fp) != 0)
+		mc_trace.failed = true;
+	pthread_mutex_unlock(&mc_trace.lock);
+}
+
+/**
+ * Stop recording, returns a negative value if the trace is incomplete
+ */
+int mc_trace_close(void)
+{
+	int error = 0;
+
+	if (!mc_trace.fp)
+		return 0;
+
+	restool.record = false;
+	mc_trace_flush();
+	if (fclose(mc_trace.fp) != 0)
+		mc_trace.failed = true;
+
+	mc_trace.fp = NULL;
+	if (mc_trace.failed) {
+		ERROR_PRINTF("error: the MC command trace is incomplete\n");
+		error = -EIO;
+	}
+
+	return error;
+}
+
+/**
+ * struct replay_group - recorded commands with the same request
+ * @first: first record of the group
+ * @last: last record of the group
+ * @cursor: record answering the next matching request, the last record
+ *	is used again once all of them were used
+ * @next: next group of the same hash bucket, -1 for none
+ */
+struct replay_group {
+	int first;
+	int last;
+	int cursor;
+	int next;
+};
+
+/**
+ * struct replay_token - token handed out on replay
+ * @used: the token is open
+ * @portal: recorded portal the token was opened on
+ * @token: recorded token
+ */
+struct replay_token {
+	bool used;
+	int portal;
+	uint16_t token;
+};
+
+/**
+ * struct replay - state of the replay transport
+ * @lock: serializes the commands sent on all portals
+ * @path: trace file
+ * @loaded: the trace was read
+ * @records: records of the trace
+ * @num_records: number of entries of @records
+ * @next: for each record, next record of its group, -1 for none
+ * @groups: groups of records with the same request
+ * @num_groups: number of entries of @groups
+ * @buckets: hash buckets of @groups, -1 for empty buckets
+ * @num_buckets: number of entries of @buckets, a power of 2
+ * @root_dprc_id: id of the root container
+ * @has_root_dprc: the trace holds the root container id
+ * @tokens: recorded portal and token of each token handed out, token i is
+ *	@tokens[i - 1]
+ * @next_token: index of @tokens the search for a free token starts at
+ */
+static struct {
+	pthread_mutex_t lock;
+	const char *path;
+	bool loaded;
+	struct mc_trace_record *records;
+	int num_records;
+	int *next;
+	struct replay_group *groups;
+	int num_groups;
+	int *buckets;
+	unsigned int num_buckets;
+	uint32_t root_dprc_id;
+	bool has_root_dprc;
+	struct replay_token *tokens;
+	uint32_t next_token;
+} replay = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/*
+ * Commands opening objects are matched on any portal, other commands on
+ * the portal their token was opened on
+ */
+static int replay_key_portal(const struct mc_command *request, int portal)
+{
+	return mc_cmd_hdr_read_token((struct mc_command *)request) ?
+	       portal : -1;
+}
+
+static uint32_t replay_hash(int portal, const struct mc_command *request)
+{
+	const uint8_t *p = (const uint8_t *)request;
+	uint32_t hash = 2166136261u ^ (uint32_t)portal;
+
+	for (size_t i = 0; i < sizeof(*request); i++)
+		hash = (hash ^ p[i]) * 16777619u;
+
+	return hash;
+}
+
+static int replay_find_group(int portal, const struct mc_command *request)
+{
+	uint32_t bucket = replay_hash(portal, request) &
+			  (replay.num_buckets - 1);
+
+	for (int i = replay.buckets[bucket]; i != -1;
+	     i = replay.groups[i].next) {
+		struct mc_trace_record *record =
+			&replay.records[replay.groups[i].first];
+
+		if (replay_key_portal(&record->request,
+				      le32toh(record->portal)) == portal &&
+		    memcmp(&record->request, request, sizeof(*request)) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static int replay_index(void)
+{
+	for (int i = 0; i < replay.num_records; i++) {
+		struct mc_trace_record *record = &replay.records[i];
+		int portal = replay_key_portal(&record->request,
+					       le32toh(record->portal));
+		struct replay_group *group;
+		uint32_t bucket;
+		int g;
+
+		replay.next[i] = -1;
+		if (le32toh(record->kind) == MC_TRACE_ROOT_DPRC) {
+			replay.root_dprc_id =
+				le64toh(record->response.params[0]);
+			replay.has_root_dprc = true;
+			continue;
+		}
+
+		if (le32toh(record->kind) != MC_TRACE_COMMAND)
+			continue;
+
+		g = replay_find_group(portal, &record->request);
+		if (g != -1) {
+			group = &replay.groups[g];
+			replay.next[group->last] = i;
+			group->last = i;
+			continue;
+		}
+
+		bucket = replay_hash(portal, &record->request) &
+			 (replay.num_buckets - 1);
+		group = &replay.groups[replay.num_groups];
+		group->first = i;
+		group->last = i;
+		group->cursor = i;
+		group->next = replay.buckets[bucket];
+		replay.buckets[bucket] = replay.num_groups++;
+	}
+
+	if (!replay.has_root_dprc) {
+		ERROR_PRINTF("%s has no root container id\n", replay.path);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int replay_load(void)
+{
+	struct mc_trace_header header;
+	long size;
+	FILE *fp;
+	int error = 0;
+
+	fp = fopen(replay.path, "re");
+	if (!fp) {
+		ERROR_PRINTF("cannot open %s: %s\n", replay.path,
+			     strerror(errno));
+		return -errno;
+	}
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+	    memcmp(header.magic, MC_TRACE_MAGIC, sizeof(MC_TRACE_MAGIC)) != 0 ||
+	    le32toh(header.version) != MC_TRACE_VERSION ||
+	    le32toh(header.record_size) != sizeof(struct mc_trace_record) ||
+	    fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+	    fseek(fp, sizeof(header), SEEK_SET) != 0) {
+		ERROR_PRINTF("%s is not an MC command trace\n", replay.path);
+		error = -EINVAL;
+		goto out;
+	}
+
+	replay.num_records = (size - sizeof(header)) /
+			     sizeof(struct mc_trace_record);
+	for (replay.num_buckets = 64;
+	     replay.num_buckets < 2 * (unsigned int)replay.num_records;
+	     replay.num_buckets *= 2)
+		;
+
+	replay.records = malloc((replay.num_records + 1) *
+				sizeof(*replay.records));
+	replay.next = malloc((replay.num_records + 1) * sizeof(*replay.next));
+	replay.groups = malloc((replay.num_records + 1) *
+			       sizeof(*replay.groups));
+	replay.buckets = malloc(replay.num_buckets * sizeof(*replay.buckets));
+	replay.tokens = calloc(MC_TRACE_MAX_TOKENS, sizeof(*replay.tokens));
+	if (!replay.records || !replay.next || !replay.groups ||
+	    !replay.buckets || !replay.tokens) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	if (fread(replay.records, sizeof(*replay.records), replay.num_records,
+		  fp) != (size_t)replay.num_records) {
+		ERROR_PRINTF("cannot read %s\n", replay.path);
+		error = -EIO;
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < replay.num_buckets; i++)
+		replay.buckets[i] = -1;
+
+	error = replay_index();
+	if (error < 0)
+		goto out;
+
+	DEBUG_PRINTF("%s: %d records, %d distinct commands\n", replay.path,
+		     replay.num_records, replay.num_groups);
+	replay.loaded = true;
+out:
+	fclose(fp);
+	return error;
+}
+
+static int replay_open_token(int portal, uint16_t recorded_token,
+			     uint16_t *token)
+{
+	for (uint32_t n = 0; n < MC_TRACE_MAX_TOKENS; n++) {
+		uint32_t i = (replay.next_token + n) % MC_TRACE_MAX_TOKENS;
+
+		if (!replay.tokens[i].used) {
+			replay.tokens[i].used = true;
+			replay.tokens[i].portal = portal;
+			replay.tokens[i].token = recorded_token;
+			replay.next_token = i + 1;
+			*token = i + 1;
+			return 0;
+		}
+	}
+
+	return -EBUSY;
+}
+
+static int replay_command(struct mc_command *cmd)
+{
+	struct mc_cmd_header *hdr = (struct mc_cmd_header *)&cmd->header;
+	uint16_t token = le16toh(hdr->token);
+	struct mc_command request = *cmd;
+	struct mc_trace_record *record;
+	struct replay_group *group;
+	int portal = -1;
+	int error;
+	int g;
+
+	if (token != 0) {
+		struct replay_token *t = &replay.tokens[token - 1];
+
+		if (!t->used)
+			return -EACCES;
+
+		portal = t->portal;
+		((struct mc_cmd_header *)&request.header)->token =
+			htole16(t->token);
+	}
+
+	g = replay_find_group(portal, &request);
+	if (g == -1) {
+		ERROR_PRINTF("MC command %#x is not in %s\n",
+			     le16toh(hdr->cmd_id), replay.path);
+		return -EIO;
+	}
+
+	group = &replay.groups[g];
+	record = &replay.records[group->cursor];
+	if (replay.next[group->cursor] != -1)
+		group->cursor = replay.next[group->cursor];
+
+	*cmd = record->response;
+	error = (int32_t)le32toh(record->error);
+	if (error != 0)
+		return error;
+
+	hdr = (struct mc_cmd_header *)&cmd->header;
+	if (token == 0 && hdr->token != 0) {
+		uint16_t new_token;
+
+		error = replay_open_token(le32toh(record->portal),
+					  le16toh(hdr->token), &new_token);
+		if (error < 0)
+			return error;
+
+		hdr->token = htole16(new_token);
+	} else if (token != 0) {
+		hdr->token = htole16(token);
+		if ((le16toh(hdr->cmd_id) >> 4) == MC_TRACE_CMD_CLOSE)
+			replay.tokens[token - 1].used = false;
+	}
+
+	return 0;
+}
+
+static int replay_send_command(struct fsl_mc_io *mc_io, struct mc_command *cmd)
+{
+	int error;
+
+	(void)mc_io;
+	pthread_mutex_lock(&replay.lock);
+	error = replay_command(cmd);
+	pthread_mutex_unlock(&replay.lock);
+	return error;
+}
+
+static int replay_open(struct fsl_mc_io *mc_io)
+{
+	int error = 0;
+
+	pthread_mutex_lock(&replay.lock);
+	if (!replay.loaded)
+		error = replay_load();
+	pthread_mutex_unlock(&replay.lock);
+
+	mc_io->fd = -1;
+	return error;
+}
+
+static void replay_close(struct fsl_mc_io *mc_io)
+{
+	(void)mc_io;
+}
+
+static int replay_get_root_dprc_id(struct fsl_mc_io *mc_io,
+				   uint32_t *root_dprc_id)
+{
+	(void)mc_io;
+	*root_dprc_id = replay.root_dprc_id;
+	return 0;
+}
+
+const struct fsl_mc_transport mc_replay_transport = {
+	.name = "replay",
+	.open = replay_open,
+	.close = replay_close,
+	.send_command = replay_send_command,
+	.get_root_dprc_id = replay_get_root_dprc_id,
+};
+
+/**
+ * Set the trace file of --device=replay:<file>. Must be called before the
+ * first portal is opened.
+ */
+int mc_replay_configure(const char *path)
+{
+	if (!path || *path == '\0') {
+		ERROR_PRINTF("Invalid Argument: replay needs a trace file\n");
+		return -EINVAL;
+	}
+
+	replay.path = path;
+	return 0;
+}
@@ -0,0 +1,396 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "restool.h"
+#include "utils.h"
+
+/**
+ * struct walk_state - state shared by the threads walking a container tree
+ * @lock: protects all the fields below
+ * @cond: signaled when containers are added or the walk is over
+ * @result: containers found so far
+ * @max_containers: number of allocated containers in @result
+ * @next_scan: index of the next container to scan, containers before it
+ *	are scanned or being scanned
+ * @num_busy: number of containers being scanned
+ * @error: first error met, the walk stops as soon as it is set
+ * @flags: WALK_* flags given to walk_containers()
+ */
+struct walk_state {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct walk_result *result;
+	unsigned int max_containers;
+	unsigned int next_scan;
+	unsigned int num_busy;
+	int error;
+	unsigned int flags;
+};
+
+/* Must be called with state->lock held */
+static int walk_add_container(struct walk_state *state, uint32_t id,
+			      uint32_t parent_id, int nesting_level)
+{
+	struct walk_result *result = state->result;
+	struct walk_container *container;
+
+	if (result->num_containers == state->max_containers) {
+		unsigned int max_containers = state->max_containers ?
+					      state->max_containers * 2 : 16;
+
+		container = realloc(result->containers,
+				    max_containers * sizeof(*container));
+		if (!container)
+			return -ENOMEM;
+
+		result->containers = container;
+		state->max_containers = max_containers;
+	}
+
+	container = &result->containers[result->num_containers];
+	memset(container, 0, sizeof(*container));
+	container->id = id;
+	container->parent_id = parent_id;
+	container->nesting_level = nesting_level;
+	return result->num_containers++;
+}
+
+/**
+ * Read the attributes and objects of one container and queue its child
+ * containers. 'dprc_handle' must be a handle of the container opened on
+ * 'mc_io'.
+ */
+static int walk_scan(struct walk_state *state, struct fsl_mc_io *mc_io,
+		     unsigned int index, uint16_t dprc_handle)
+{
+	struct walk_container *container;
+	struct dprc_attributes dprc_attr;
+	struct dprc_obj_desc *objs = NULL;
+	enum mc_cmd_status mc_status;
+	int num_objs = 0;
+	int *children = NULL;
+	int nesting_level;
+	uint32_t id;
+	int error;
+
+	pthread_mutex_lock(&state->lock);
+	id = state->result->containers[index].id;
+	nesting_level = state->result->containers[index].nesting_level;
+	pthread_mutex_unlock(&state->lock);
+
+	memset(&dprc_attr, 0, sizeof(dprc_attr));
+	if (state->flags & WALK_ATTRIBUTES) {
+		error = dprc_get_attributes(mc_io, 0, dprc_handle, &dprc_attr);
+		if (error < 0)
+			goto mc_error;
+	}
+
+	error = dprc_get_obj_count(mc_io, 0, dprc_handle, &num_objs);
+	if (error < 0)
+		goto mc_error;
+
+	if (num_objs > 0) {
+		objs = calloc(num_objs, sizeof(*objs));
+		children = calloc(num_objs, sizeof(*children));
+		if (!objs || !children) {
+			error = -ENOMEM;
+			goto out;
+		}
+	}
+
+	for (int i = 0; i < num_objs; i++) {
+		error = dprc_get_obj(mc_io, 0, dprc_handle, i, &objs[i]);
+		if (error < 0) {
+			DEBUG_PRINTF("dprc_get_object(%u) failed with error %d\n",
+				     i, error);
+			goto out;
+		}
+
+		DEBUG_PRINTF("it is %s.%u\n", objs[i].type, objs[i].id);
+	}
+
+	pthread_mutex_lock(&state->lock);
+	for (int i = 0; i < num_objs && error == 0; i++) {
+		children[i] = -1;
+		if (strcmp(objs[i].type, "dprc") != 0)
+			continue;
+
+		if (nesting_level == MAX_DPRC_NESTING) {
+			ERROR_PRINTF("dprc.%d nested too deep\n", objs[i].id);
+			error = -ELOOP;
+			break;
+		}
+
+		error = walk_add_container(state, objs[i].id, id,
+					   nesting_level + 1);
+		if (error >= 0) {
+			children[i] = error;
+			error = 0;
+		}
+	}
+
+	if (error == 0) {
+		container = &state->result->containers[index];
+		container->options = dprc_attr.options;
+		container->num_objs = num_objs;
+		container->objs = objs;
+		container->children = children;
+		objs = NULL;
+		children = NULL;
+	}
+	pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+	goto out;
+
+mc_error:
+	mc_status = flib_error_to_mc_status(error);
+	ERROR_PRINTF("MC error: %s (status %#x)\n",
+		     mc_status_to_string(mc_status), mc_status);
+out:
+	free(objs);
+	free(children);
+	return error;
+}
+
+/**
+ * Scan queued containers on 'mc_io' until all containers are scanned or
+ * an error is met
+ */
+static int walk_run(struct walk_state *state, struct fsl_mc_io *mc_io)
+{
+	enum mc_cmd_status mc_status;
+	uint16_t dprc_handle;
+	unsigned int index;
+	uint32_t id;
+	int error;
+	int error2;
+
+	pthread_mutex_lock(&state->lock);
+	for ( ; ; ) {
+		while (state->error == 0 &&
+		       state->next_scan == state->result->num_containers &&
+		       state->num_busy != 0)
+			pthread_cond_wait(&state->cond, &state->lock);
+
+		if (state->error != 0 ||
+		    state->next_scan == state->result->num_containers)
+			break;
+
+		index = state->next_scan++;
+		id = state->result->containers[index].id;
+		state->num_busy++;
+		pthread_mutex_unlock(&state->lock);
+
+		error = dprc_open(mc_io, 0, id, &dprc_handle);
+		if (error < 0) {
+			mc_status = flib_error_to_mc_status(error);
+			ERROR_PRINTF("MC error: %s (status %#x)\n",
+				     mc_status_to_string(mc_status), mc_status);
+		} else {
+			DEBUG_PRINTF("entering dprc.%u\n", id);
+			error = walk_scan(state, mc_io, index, dprc_handle);
+			error2 = dprc_close(mc_io, 0, dprc_handle);
+			if (error2 < 0) {
+				mc_status = flib_error_to_mc_status(error2);
+				ERROR_PRINTF("MC error: %s (status %#x)\n",
+					     mc_status_to_string(mc_status),
+					     mc_status);
+				if (error == 0)
+					error = error2;
+			}
+		}
+
+		pthread_mutex_lock(&state->lock);
+		state->num_busy--;
+		if (error < 0 && state->error == 0)
+			state->error = error;
+		pthread_cond_broadcast(&state->cond);
+	}
+	error = state->error;
+	pthread_mutex_unlock(&state->lock);
+
+	return error;
+}
+
+static int walk_worker_run(void *arg, struct fsl_mc_io *mc_io,
+			   unsigned int index)
+{
+	(void)index;
+	return walk_run(arg, mc_io);
+}
+
+static void *portal_thread_run(void *arg)
+{
+	struct portal_thread *thread = arg;
+	struct portal_pool *pool = thread->pool;
+
+	thread->error = pool->func(pool->arg, &thread->mc_io, thread->index);
+	return NULL;
+}
+
+/**
+ * Start up to 'max_threads' threads running 'func' with 'arg', each one
+ * on an MC portal of its own cloned from restool.mc_io. Portals are a
+ * limited resource: as many as we can get are used, so the work of
+ * 'func' must get done by fewer threads if an open fails. 'pool' must
+ * not move until portal_pool_join().
+ *
+ * Returns 0 on success, negative otherwise
+ */
+int portal_pool_start(struct portal_pool *pool, unsigned int max_threads,
+		      portal_pool_func_t *func, void *arg)
+{
+	memset(pool, 0, sizeof(*pool));
+	pool->func = func;
+	pool->arg = arg;
+	if (max_threads == 0)
+		return 0;
+
+	pool->threads = calloc(max_threads, sizeof(*pool->threads));
+	if (!pool->threads)
+		return -ENOMEM;
+
+	while (pool->num_threads < max_threads) {
+		struct portal_thread *thread =
+			&pool->threads[pool->num_threads];
+
+		if (mc_io_clone(&thread->mc_io, &restool.mc_io) < 0)
+			break;
+
+		thread->pool = pool;
+		thread->index = pool->num_threads;
+		if (pthread_create(&thread->thread, NULL, portal_thread_run,
+				   thread) != 0) {
+			mc_io_cleanup(&thread->mc_io);
+			break;
+		}
+
+		pool->num_threads++;
+	}
+	DEBUG_PRINTF("%u of %u threads started on MC portals of their own\n",
+		     pool->num_threads, max_threads);
+
+	return 0;
+}
+
+/**
+ * Wait for the threads of 'pool' and close their MC portals
+ *
+ * Returns the first error returned by the work of a thread, 0 if none
+ */
+int portal_pool_join(struct portal_pool *pool)
+{
+	int error = 0;
+
+	for (unsigned int i = 0; i < pool->num_threads; i++) {
+		pthread_join(pool->threads[i].thread, NULL);
+		mc_io_cleanup(&pool->threads[i].mc_io);
+		if (error == 0)
+			error = pool->threads[i].error;
+	}
+
+	free(pool->threads);
+	memset(pool, 0, sizeof(*pool));
+	return error;
+}
+
+/**
+ * Walk the tree of containers rooted at 'dprc_id', whose handle on
+ * restool.mc_io is 'dprc_handle'. Containers are scanned concurrently on
+ * up to restool.num_portals MC portals; the result does not depend on
+ * the number of portals or on the order of the scans.
+ *
+ * The first container of 'result' is 'dprc_id' and the tree is followed
+ * through the 'children' of each container. 'result' must be released
+ * with walk_free(), also on error.
+ */
+int walk_containers(uint32_t dprc_id, uint16_t dprc_handle,
+		    unsigned int flags, struct walk_result *result)
+{
+	unsigned int max_threads = 0;
+	struct portal_pool pool;
+	struct walk_state state;
+	int error;
+	int error2;
+
+	memset(result, 0, sizeof(*result));
+	memset(&state, 0, sizeof(state));
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.cond, NULL);
+	state.result = result;
+	state.flags = flags;
+
+	error = walk_add_container(&state, dprc_id, 0, 0);
+	if (error < 0)
+		goto out;
+
+	state.next_scan = 1;
+	error = walk_scan(&state, &restool.mc_io, 0, dprc_handle);
+	if (error < 0)
+		goto out;
+
+	if (result->num_containers > 2) {
+		max_threads = restool.num_portals - 1;
+		if (max_threads > result->num_containers - 1)
+			max_threads = result->num_containers - 1;
+	}
+
+	error = portal_pool_start(&pool, max_threads, walk_worker_run, &state);
+	if (error < 0)
+		goto out;
+
+	error = walk_run(&state, &restool.mc_io);
+	error2 = portal_pool_join(&pool);
+	if (error == 0)
+		error = error2;
+
+out:
+	pthread_cond_destroy(&state.cond);
+	pthread_mutex_destroy(&state.lock);
+	return error;
+}
+
+void walk_free(struct walk_result *result)
+{
+	for (unsigned int i = 0; i < result->num_containers; i++) {
+		free(result->containers[i].objs);
+		free(result->containers[i].children);
+	}
+
+	free(result->containers);
+	result->containers = NULL;
+	result->num_containers = 0;
+}
@@ -0,0 +1,798 @@
+/* Copyright 2021 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * * Neither the name of the above-listed copyright holders nor the
+ * names of any contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "restool.h"
+#include "utils.h"
+
+#define SAMPLER_MAGIC		0x504d5352	/* "RSMP" */
+#define SAMPLER_VERSION		1
+
+#define SAMPLER_OBJECT_LEN	16
+#define SAMPLER_COUNTER_LEN	32
+
+/*
+ * Number of records of a file when neither --records nor --duration is
+ * given: a minute at the default interval of 1 ms
+ */
+#define SAMPLER_DEFAULT_RECORDS	60000
+
+/*
+ * Largest file 'sampler record' creates
+ */
+#define SAMPLER_MAX_FILE_SIZE	(4ULL << 30)
+
+/**
+ * struct sampler_header - header of a file written by 'sampler record'
+ * @magic: SAMPLER_MAGIC
+ * @version: SAMPLER_VERSION
+ * @num_columns: number of counters in each record
+ * @record_size: size of a record in bytes
+ * @num_records: number of records in the ring buffer
+ * @interval_ns: sampling interval asked for
+ * @start_ns: CLOCK_REALTIME time of the first sample
+ * @head: number of records written so far, the next record is written
+ *	at index @head % @num_records
+ *
+ * The header is followed by @num_columns struct sampler_column and by
+ * the ring buffer of @num_records records. Numbers are in host order.
+ */
+struct sampler_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_columns;
+	uint32_t record_size;
+	uint64_t num_records;
+	uint64_t interval_ns;
+	uint64_t start_ns;
+	uint64_t head;
+};
+
+/**
+ * struct sampler_column - counter recorded in a column of the records
+ */
+struct sampler_column {
+	char object[SAMPLER_OBJECT_LEN];
+	char counter[SAMPLER_COUNTER_LEN];
+};
+
+/**
+ * struct sampler_record - one sample of all the columns
+ * @when_ns: time of the sample, from the first sample
+ * @values: value of each column
+ */
+struct sampler_record {
+	uint64_t when_ns;
+	uint64_t values[];
+};
+
+/**
+ * struct sampler_file - file of records mapped in memory
+ */
+struct sampler_file {
+	struct sampler_header *header;
+	struct sampler_column *columns;
+	uint8_t *records;
+	size_t size;
+};
+
+enum sampler_record_options {
+	RECORD_OPT_HELP = 0,
+	RECORD_OPT_OUTPUT,
+	RECORD_OPT_COUNTERS,
+	RECORD_OPT_INTERVAL,
+	RECORD_OPT_DURATION,
+	RECORD_OPT_RECORDS,
+};
+
+static struct option sampler_record_options[] = {
+	[RECORD_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[RECORD_OPT_OUTPUT] = {
+		.name = "output",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[RECORD_OPT_COUNTERS] = {
+		.name = "counters",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[RECORD_OPT_INTERVAL] = {
+		.name = "interval",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[RECORD_OPT_DURATION] = {
+		.name = "duration",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[RECORD_OPT_RECORDS] = {
+		.name = "records",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(sampler_record_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+enum sampler_report_options {
+	REPORT_OPT_HELP = 0,
+	REPORT_OPT_WINDOW,
+};
+
+static struct option sampler_report_options[] = {
+	[REPORT_OPT_HELP] = {
+		.name = "help",
+		.has_arg = 0,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	[REPORT_OPT_WINDOW] = {
+		.name = "window",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0,
+	},
+
+	{ 0 },
+};
+
+C_ASSERT(ARRAY_SIZE(sampler_report_options) <= MAX_NUM_CMD_LINE_OPTIONS + 1);
+
+static int cmd_sampler_help(void)
+{
+	static const char help_msg[] =
+		"\n"
+		"Usage: restool sampler <command> [--help] [ARGS...]\n"
+		"Where <command> can be:\n"
+		"   record - samples DPNI and DPMAC counters into a ring buffer file.\n"
+		"   report - displays the rates, percentiles and peaks of a recording.\n"
+		"\n"
+		"For command-specific help, use the --help option of each command.\n"
+		"\n";
+
+	printf(help_msg);
+	return 0;
+}
+
+static struct sampler_record *sampler_get_record(struct sampler_file *file,
+						 uint64_t index)
+{
+	return (struct sampler_record *)(file->records +
+		(index % file->header->num_records) *
+		file->header->record_size);
+}
+
+static void sampler_unmap(struct sampler_file *file)
+{
+	if (file->header)
+		munmap(file->header, file->size);
+	memset(file, 0, sizeof(*file));
+}
+
+/**
+ * Create 'path' for 'num_records' records of 'num_columns' counters and
+ * map it in memory
+ */
+static int sampler_create(struct sampler_file *file, const char *path,
+			  uint32_t num_columns, uint64_t num_records)
+{
+	size_t columns_size = num_columns * sizeof(struct sampler_column);
+	uint32_t record_size = sizeof(struct sampler_record) +
+			       num_columns * sizeof(uint64_t);
+	unsigned long long size;
+	void *addr;
+	int error;
+	int fd;
+
+	size = sizeof(struct sampler_header) + columns_size +
+	       (unsigned long long)record_size * num_records;
+	if (size > SAMPLER_MAX_FILE_SIZE) {
+		ERROR_PRINTF("%llu records of %u bytes do not fit in %llu bytes\n",
+			     (unsigned long long)num_records, record_size,
+			     SAMPLER_MAX_FILE_SIZE);
+		return -EFBIG;
+	}
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		error = -errno;
+		ERROR_PRINTF("cannot create %s (error %d)\n", path, error);
+		return error;
+	}
+
+	/* the blocks are allocated now, not while sampling */
+	error = posix_fallocate(fd, 0, size);
+	if (error == EOPNOTSUPP || error == EINVAL)
+		error = ftruncate(fd, size) < 0 ? errno : 0;
+	if (error != 0) {
+		ERROR_PRINTF("cannot allocate %llu bytes for %s (error %d)\n",
+			     size, path, -error);
+		close(fd);
+		unlink(path);
+		return -error;
+	}
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		error = -errno;
+		ERROR_PRINTF("cannot map %s (error %d)\n", path, error);
+		unlink(path);
+		return error;
+	}
+
+	file->header = addr;
+	file->columns = (struct sampler_column *)(file->header + 1);
+	file->records = (uint8_t *)addr + sizeof(struct sampler_header) +
+			columns_size;
+	file->size = size;
+
+	memset(file->header, 0, sizeof(*file->header));
+	file->header->magic = SAMPLER_MAGIC;
+	file->header->version = SAMPLER_VERSION;
+	file->header->num_columns = num_columns;
+	file->header->record_size = record_size;
+	file->header->num_records = num_records;
+	return 0;
+}
+
+/**
+ * Map 'path' written by 'sampler record' in memory, read only
+ */
+static int sampler_open(struct sampler_file *file, const char *path)
+{
+	struct sampler_header *header;
+	struct stat st;
+	size_t columns_size;
+	void *addr;
+	int error;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		error = -errno;
+		ERROR_PRINTF("cannot open %s (error %d)\n", path, error);
+		return error;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		error = -errno;
+		close(fd);
+		return error;
+	}
+
+	if ((size_t)st.st_size < sizeof(*header)) {
+		ERROR_PRINTF("%s is not a sampler recording\n", path);
+		close(fd);
+		return -EINVAL;
+	}
+
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		error = -errno;
+		ERROR_PRINTF("cannot map %s (error %d)\n", path, error);
+		return error;
+	}
+
+	file->header = header = addr;
+	file->size = st.st_size;
+	if (header->magic != SAMPLER_MAGIC ||
+	    header->version != SAMPLER_VERSION) {
+		ERROR_PRINTF("%s is not a sampler recording\n", path);
+		sampler_unmap(file);
+		return -EINVAL;
+	}
+
+	/* a product of the header fields could wrap, divide instead */
+	columns_size = (size_t)header->num_columns *
+		       sizeof(struct sampler_column);
+	if (columns_size > file->size - sizeof(*header) ||
+	    header->record_size != sizeof(struct sampler_record) +
+				  (size_t)header->num_columns *
+				  sizeof(uint64_t) ||
+	    header->num_records == 0 ||
+	    header->num_records > (file->size - sizeof(*header) -
+				   columns_size) / header->record_size) {
+		ERROR_PRINTF("%s is truncated or corrupted\n", path);
+		sampler_unmap(file);
+		return -EINVAL;
+	}
+
+	file->columns = (struct sampler_column *)(header + 1);
+	file->records = (uint8_t *)addr + sizeof(*header) + columns_size;
+	return 0;
+}
+
+/**
+ * Add the objects of the comma separated list 'names' to 'set'
+ */
+static int sampler_add_objs(struct counter_set *set, const char *names,
+			    const char *counters)
+{
+	char obj_type[OBJ_TYPE_MAX_LENGTH + 1];
+	uint32_t obj_id;
+	int num_chars;
+	int error;
+
+	for (const char *name = names; *name != '\0'; ) {
+		if (sscanf(name, "%" STRINGIFY(OBJ_TYPE_MAX_LENGTH) "[a-z].%u%n",
+			   obj_type, &obj_id, &num_chars) != 2 ||
+		    (name[num_chars] != ',' && name[num_chars] != '\0')) {
+			ERROR_PRINTF("Invalid MC object name: %.*s\n",
+				     (int)strcspn(name, ","), name);
+			return -EINVAL;
+		}
+
+		error = counters_add(set, obj_type, obj_id, counters);
+		if (error < 0)
+			return error;
+
+		name += num_chars;
+		if (*name == ',')
+			name++;
+	}
+
+	return 0;
+}
+
+/**
+ * struct sampler_run - state of 'sampler record'
+ * @first_ns: time of the first sample
+ */
+struct sampler_run {
+	struct counter_set *set;
+	struct sampler_file *file;
+	uint64_t duration_ns;
+	uint64_t first_ns;
+};
+
+/*
+ * Take one sample: only the MC commands reading the counters are sent,
+ * and their values are copied into the mapped file. A late sample is
+ * taken at once, the report uses the time of each sample, not the
+ * interval.
+ */
+static int sampler_sample(void *arg, long n)
+{
+	struct sampler_run *run = arg;
+	struct sampler_header *header = run->file->header;
+	struct counter_set *set = run->set;
+	struct sampler_record *record;
+	uint64_t *values;
+	int error;
+
+	(void)n;
+	error = counters_sample(set);
+	if (error < 0)
+		return error;
+
+	if (header->head == 0)
+		run->first_ns = set->when_ns;
+
+	record = sampler_get_record(run->file, header->head);
+	record->when_ns = set->when_ns - run->first_ns;
+	values = record->values;
+	for (unsigned int i = 0; i < set->num_objs; i++) {
+		const struct counter_obj *obj = &set->objs[i];
+
+		memcpy(values, obj->values,
+		       obj->num_counters * sizeof(*values));
+		values += obj->num_counters;
+	}
+
+	/* a reader of the file only sees complete records */
+	__atomic_store_n(&header->head, header->head + 1, __ATOMIC_RELEASE);
+
+	return run->duration_ns != 0 && record->when_ns >= run->duration_ns;
+}
+
+/*
+ * Sample until 'duration_ns' is over, if not 0, or until SIGINT or
+ * SIGTERM
+ */
+static int sampler_run(struct counter_set *set, struct sampler_file *file,
+		       uint64_t duration_ns)
+{
+	struct sampler_run run = {
+		.set = set,
+		.file = file,
+		.duration_ns = duration_ns,
+	};
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	file->header->start_ns = (uint64_t)now.tv_sec * 1000000000 +
+				 now.tv_nsec;
+	return interval_run(file->header->interval_ns, 0, sampler_sample,
+			    &run);
+}
+
+static int cmd_sampler_record(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool sampler record <object>[,<object>...] --output=<file>\n"
+		"                              [--counters=<names>] [--interval=<ms>]\n"
+		"                              [--duration=<s>] [--records=<n>]\n"
+		"\n"
+		"Samples the counters of DPNI and DPMAC objects into <file>, a ring buffer\n"
+		"of fixed size records mapped in memory: the latest samples overwrite the\n"
+		"oldest ones. Records until interrupted or until --duration is over.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--output=<file>\n"
+		"   File of the records, read by 'restool sampler report'.\n"
+		"--counters=<names>\n"
+		"   Only samples the counters in the comma separated list <names>, named\n"
+		"   as in 'restool dpni stats' or 'restool dpmac stats'. All the objects\n"
+		"   sample the same counters, so DPNIs and DPMACs are then recorded to\n"
+		"   different files. All the counters are sampled by default.\n"
+		"--interval=<ms>\n"
+		"   Samples every <ms> milliseconds, 1 by default.\n"
+		"--duration=<s>\n"
+		"   Stops after <s> seconds.\n"
+		"--records=<n>\n"
+		"   Number of records of the ring buffer. By default, enough for\n"
+		"   --duration, or for a minute at the default interval.\n"
+		"\n"
+		"EXAMPLE:\n"
+		"Sample the frame counters of two DPMACs every millisecond for 5 minutes:\n"
+		"   $ restool sampler record dpmac.1,dpmac.2 --output=burst.rec \\\n"
+		"       --counters=rx-all-frames,tx-frames-ok --duration=300\n"
+		"\n";
+	struct sampler_file file = { 0 };
+	struct counter_set set = { 0 };
+	const char *counters = NULL;
+	const char *output = NULL;
+	long num_records = 0;
+	long interval_ms = 1;
+	long duration_s = 0;
+	unsigned int num_columns = 0;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECORD_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECORD_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<object> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	if (!(restool.cmd_option_mask & ONE_BIT_MASK(RECORD_OPT_OUTPUT))) {
+		ERROR_PRINTF("--output option missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+	restool.cmd_option_mask &= ~ONE_BIT_MASK(RECORD_OPT_OUTPUT);
+	output = restool.cmd_option_args[RECORD_OPT_OUTPUT];
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECORD_OPT_COUNTERS)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECORD_OPT_COUNTERS);
+		counters = restool.cmd_option_args[RECORD_OPT_COUNTERS];
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECORD_OPT_INTERVAL)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECORD_OPT_INTERVAL);
+		error = get_option_value(RECORD_OPT_INTERVAL, &interval_ms,
+					 "Invalid interval", 1, 3600000);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECORD_OPT_DURATION)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECORD_OPT_DURATION);
+		error = get_option_value(RECORD_OPT_DURATION, &duration_s,
+					 "Invalid duration", 1, 86400);
+		if (error)
+			return error;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(RECORD_OPT_RECORDS)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(RECORD_OPT_RECORDS);
+		error = get_option_value(RECORD_OPT_RECORDS, &num_records,
+					 "Invalid number of records", 2,
+					 INT32_MAX);
+		if (error)
+			return error;
+	} else if (duration_s != 0) {
+		num_records = duration_s * 1000 / interval_ms + 1;
+	} else {
+		num_records = SAMPLER_DEFAULT_RECORDS;
+	}
+
+	error = daemon_decline_command();
+	if (error)
+		return error;
+
+	error = sampler_add_objs(&set, restool.obj_name, counters);
+	if (error < 0)
+		goto out;
+
+	for (unsigned int i = 0; i < set.num_objs; i++)
+		num_columns += set.objs[i].num_counters;
+
+	error = sampler_create(&file, output, num_columns, num_records);
+	if (error < 0)
+		goto out;
+
+	file.header->interval_ns = (uint64_t)interval_ms * 1000000;
+	for (unsigned int i = 0, col = 0; i < set.num_objs; i++) {
+		const struct counter_obj *obj = &set.objs[i];
+
+		for (unsigned int c = 0; c < obj->num_counters; c++, col++) {
+			snprintf(file.columns[col].object, SAMPLER_OBJECT_LEN,
+				 "%s.%u", obj->type, obj->id);
+			snprintf(file.columns[col].counter,
+				 SAMPLER_COUNTER_LEN, "%s",
+				 obj->counters[c]->name);
+		}
+	}
+
+	error = counters_start(&set);
+	if (error < 0) {
+		/* no sample was taken, do not leave an empty recording */
+		sampler_unmap(&file);
+		unlink(output);
+		goto out;
+	}
+
+	error = sampler_run(&set, &file, (uint64_t)duration_s * 1000000000);
+
+	if (!restool.script)
+		printf("%llu samples of %u counters written to %s\n",
+		       (unsigned long long)file.header->head, num_columns,
+		       output);
+out:
+	if (file.header)
+		msync(file.header, file.size, MS_SYNC);
+	sampler_unmap(&file);
+	counters_free(&set);
+	return error;
+}
+
+static int compare_rates(const void *a, const void *b)
+{
+	double rate_a = *(const double *)a;
+	double rate_b = *(const double *)b;
+
+	return (rate_a > rate_b) - (rate_a < rate_b);
+}
+
+/*
+ * Nearest rank percentile of the sorted 'rates'
+ */
+static double sampler_percentile(const double *rates, size_t num_rates,
+				 unsigned int percent)
+{
+	size_t rank = (num_rates * percent + 99) / 100;
+
+	return rates[rank ? rank - 1 : 0];
+}
+
+static int cmd_sampler_report(void)
+{
+	static const char usage_msg[] =
+		"\n"
+		"Usage: restool sampler report <file> [--window=<ms>]\n"
+		"\n"
+		"Displays, for each counter recorded in <file> by 'restool sampler record',\n"
+		"its mean rate per second, the 50th, 90th and 99th percentiles of its\n"
+		"rate over successive windows and its peak rate with the time of the\n"
+		"peak, in seconds from the first sample.\n"
+		"\n"
+		"OPTIONS:\n"
+		"--window=<ms>\n"
+		"   Computes the rates over windows of at least <ms> milliseconds,\n"
+		"   by default the interval between two samples.\n"
+		"\n";
+	struct sampler_file file = { 0 };
+	struct sampler_header *header;
+	const struct sampler_record *first;
+	const struct sampler_record *last;
+	uint64_t num_windows = 0;
+	uint64_t window_ns = 0;
+	uint64_t oldest;
+	uint64_t count;
+	uint64_t num_late = 0;
+	double *rates = NULL;
+	long window_ms;
+	int error;
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(REPORT_OPT_HELP)) {
+		puts(usage_msg);
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(REPORT_OPT_HELP);
+		return 0;
+	}
+
+	if (restool.obj_name == NULL) {
+		ERROR_PRINTF("<file> argument missing\n");
+		puts(usage_msg);
+		return -EINVAL;
+	}
+
+	if (restool.cmd_option_mask & ONE_BIT_MASK(REPORT_OPT_WINDOW)) {
+		restool.cmd_option_mask &= ~ONE_BIT_MASK(REPORT_OPT_WINDOW);
+		error = get_option_value(REPORT_OPT_WINDOW, &window_ms,
+					 "Invalid window", 1, 3600000);
+		if (error)
+			return error;
+
+		window_ns = (uint64_t)window_ms * 1000000;
+	}
+
+	error = sampler_open(&file, restool.obj_name);
+	if (error < 0)
+		return error;
+
+	header = file.header;
+	count = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+	oldest = count > header->num_records ? count - header->num_records : 0;
+	count -= oldest;
+	if (count < 2 || sampler_get_record(&file, oldest + count - 1)->when_ns ==
+			 sampler_get_record(&file, oldest)->when_ns) {
+		ERROR_PRINTF("%s has less than 2 samples\n", restool.obj_name);
+		error = -EINVAL;
+		goto out;
+	}
+
+	first = sampler_get_record(&file, oldest);
+	last = sampler_get_record(&file, oldest + count - 1);
+	for (uint64_t i = 1; i < count; i++) {
+		const struct sampler_record *prev;
+		const struct sampler_record *curr;
+
+		prev = sampler_get_record(&file, oldest + i - 1);
+		curr = sampler_get_record(&file, oldest + i);
+		if (curr->when_ns - prev->when_ns > header->interval_ns * 3 / 2)
+			num_late++;
+	}
+
+	printf("%llu samples over %.3f s, every %.3f ms", (unsigned long long)count,
+	       (last->when_ns - first->when_ns) / 1e9,
+	       header->interval_ns / 1e6);
+	if (oldest != 0)
+		printf(", %llu oldest samples overwritten",
+		       (unsigned long long)oldest);
+	printf("\n%llu samples more than 50%% late\n\n",
+	       (unsigned long long)num_late);
+
+	rates = malloc((count - 1) * sizeof(*rates));
+	if (!rates) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	printf("%-12s %-26s %12s %12s %12s %12s %12s %9s\n", "object",
+	       "counter", "mean/s", "p50/s", "p90/s", "p99/s", "peak/s",
+	       "peak at");
+	for (uint32_t col = 0; col < header->num_columns; col++) {
+		uint64_t peak_ns = 0;
+		double peak = 0;
+		uint64_t start = 0;
+
+		num_windows = 0;
+		for (uint64_t end = 1; end < count; end++) {
+			const struct sampler_record *a;
+			const struct sampler_record *b;
+			uint64_t elapsed;
+
+			a = sampler_get_record(&file, oldest + start);
+			b = sampler_get_record(&file, oldest + end);
+			elapsed = b->when_ns - a->when_ns;
+			if (elapsed == 0 || elapsed < window_ns)
+				continue;
+
+			rates[num_windows] = (b->values[col] - a->values[col]) *
+					     1e9 / elapsed;
+			if (rates[num_windows] > peak || num_windows == 0) {
+				peak = rates[num_windows];
+				peak_ns = a->when_ns;
+			}
+			num_windows++;
+			start = end;
+		}
+
+		if (num_windows == 0) {
+			ERROR_PRINTF("the recording is shorter than the window\n");
+			error = -EINVAL;
+			goto out;
+		}
+
+		qsort(rates, num_windows, sizeof(*rates), compare_rates);
+		printf("%-12.*s %-26.*s %12.0f %12.0f %12.0f %12.0f %12.0f %8.3fs\n",
+		       SAMPLER_OBJECT_LEN, file.columns[col].object,
+		       SAMPLER_COUNTER_LEN, file.columns[col].counter,
+		       (last->values[col] - first->values[col]) * 1e9 /
+		       (last->when_ns - first->when_ns),
+		       sampler_percentile(rates, num_windows, 50),
+		       sampler_percentile(rates, num_windows, 90),
+		       sampler_percentile(rates, num_windows, 99),
+		       peak, peak_ns / 1e9);
+	}
+
+out:
+	free(rates);
+	sampler_unmap(&file);
+	return error;
+}
+
+struct object_command sampler_commands[] = {
+	{ .cmd_name = "help",
+	  .options = NULL,
+	  .cmd_func = cmd_sampler_help },
+
+	{ .cmd_name = "record",
+	  .options = sampler_record_options,
+	  .cmd_func = cmd_sampler_record },
+
+	{ .cmd_name = "report",
+	  .options = sampler_report_options,
+	  .cmd_func = cmd_sampler_report,
+	  .no_mc = true },
+
+	{ .cmd_name = NULL },
+};